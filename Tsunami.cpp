@@ -19,7 +19,7 @@ uint8_t txbuf[5];
 
 	versionRcvd = false;
 	sysinfoRcvd = false;
-  	TsunamiSerial.begin(57600);
+  	TsunamiOut.begin(57600);
 	flush();
 
 	// Request version string
@@ -28,7 +28,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_GET_VERSION;
 	txbuf[4] = EOMTS;
-	TsunamiSerial.write(txbuf, 5);
+	TsunamiOut.write(txbuf, 5);
 
 	// Request system info
 	txbuf[0] = SOM1;
@@ -36,7 +36,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_GET_SYS_INFO;
 	txbuf[4] = EOMTS;
-	TsunamiSerial.write(txbuf, 5);
+	TsunamiOut.write(txbuf, 5);
 }
 
 // **************************************************************
@@ -50,8 +50,8 @@ int i;
 	for (i = 0; i < MAX_NUM_VOICES; i++) {
 		voiceTable[i] = 0xffff;
 	}
-	while(TsunamiSerial.available())
-		i = TsunamiSerial.read();
+	while(TsunamiOut.available())
+		i = TsunamiOut.read();
 }
 
 
@@ -64,8 +64,8 @@ uint8_t voice;
 uint16_t track;
 
 	rxMsgReady = false;
-	while (TsunamiSerial.available() > 0) {
-		dat = TsunamiSerial.read();
+	while (TsunamiOut.available() > 0) {
+		dat = TsunamiOut.read();
 		if ((rxCount == 0) && (dat == SOM1)) {
 			rxCount++;
 		}
@@ -157,7 +157,7 @@ uint16_t track;
 
 		} // if (rxMsgReady)
 
-	} // while (TsunamiSerial.available() > 0)
+	} // while (TsunamiOut.available() > 0)
 }
 
 // **************************************************************
@@ -191,7 +191,7 @@ uint8_t o;
 	txbuf[5] = (uint8_t)vol;
 	txbuf[6] = (uint8_t)(vol >> 8);
 	txbuf[7] = EOMTS;
-	TsunamiSerial.write(txbuf, 8);
+	TsunamiOut.write(txbuf, 8);
 }
 
 // **************************************************************
@@ -205,7 +205,7 @@ uint8_t txbuf[6];
 	txbuf[3] = CMD_SET_REPORTING;
 	txbuf[4] = enable;
 	txbuf[5] = EOMTS;
-	TsunamiSerial.write(txbuf, 6);
+	TsunamiOut.write(txbuf, 6);
 }
 
 // **************************************************************
@@ -226,6 +226,23 @@ int i;
 	return true;
 }
 
+// **************************************************************
+// Asks for the version string again, without restarting the port as start() does.  getVersion() reports whether
+// it has come back.
+void Tsunami::requestVersion(void) {
+
+uint8_t txbuf[5];
+
+	update();
+	versionRcvd = false;
+	txbuf[0] = SOM1;
+	txbuf[1] = SOM2;
+	txbuf[2] = 0x05;
+	txbuf[3] = CMD_GET_VERSION;
+	txbuf[4] = EOMTS;
+	TsunamiOut.write(txbuf, 5);
+}
+
 // **************************************************************
 int Tsunami::getNumTracks(void) {
 
@@ -308,7 +325,7 @@ uint8_t o;
 	txbuf[7] = (uint8_t)o;
 	txbuf[8] = (uint8_t)flags;
 	txbuf[9] = EOMTS;
-	TsunamiSerial.write(txbuf, 10);
+	TsunamiOut.write(txbuf, 10);
 }
 
 // **************************************************************
@@ -321,7 +338,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_STOP_ALL;
 	txbuf[4] = EOMTS;
-	TsunamiSerial.write(txbuf, 5);
+	TsunamiOut.write(txbuf, 5);
 }
 
 // **************************************************************
@@ -334,7 +351,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_RESUME_ALL_SYNC;
 	txbuf[4] = EOMTS;
-	TsunamiSerial.write(txbuf, 5);
+	TsunamiOut.write(txbuf, 5);
 }
 
 // **************************************************************
@@ -353,7 +370,7 @@ unsigned short vol;
 	txbuf[6] = (uint8_t)vol;
 	txbuf[7] = (uint8_t)(vol >> 8);
 	txbuf[8] = EOMTS;
-	TsunamiSerial.write(txbuf, 9);
+	TsunamiOut.write(txbuf, 9);
 }
 
 // **************************************************************
@@ -375,7 +392,7 @@ unsigned short vol;
 	txbuf[9] = (uint8_t)(time >> 8);
 	txbuf[10] = stopFlag;
 	txbuf[11] = EOMTS;
-	TsunamiSerial.write(txbuf, 12);
+	TsunamiOut.write(txbuf, 12);
 }
 
 // **************************************************************
@@ -395,7 +412,7 @@ uint8_t o;
 	txbuf[5] = (uint8_t)off;
 	txbuf[6] = (uint8_t)(off >> 8);
 	txbuf[7] = EOMTS;
-	TsunamiSerial.write(txbuf, 8);
+	TsunamiOut.write(txbuf, 8);
 }
 
 // **************************************************************
@@ -409,7 +426,7 @@ void Tsunami::setTriggerBank(int bank) {
 	txbuf[3] = CMD_SET_TRIGGER_BANK;
 	txbuf[4] = (uint8_t)bank;
 	txbuf[5] = EOMTS;
-	TsunamiSerial.write(txbuf, 6);
+	TsunamiOut.write(txbuf, 6);
 }
 
 // **************************************************************
@@ -423,7 +440,7 @@ void Tsunami::setInputMix(int mix) {
 	txbuf[3] = CMD_SET_INPUT_MIX;
 	txbuf[4] = (uint8_t)mix;
 	txbuf[5] = EOMTS;
-	TsunamiSerial.write(txbuf, 6);
+	TsunamiOut.write(txbuf, 6);
 }
 
 // **************************************************************
@@ -437,7 +454,7 @@ void Tsunami::setMidiBank(int bank) {
 	txbuf[3] = CMD_SET_MIDI_BANK;
 	txbuf[4] = (uint8_t)bank;
 	txbuf[5] = EOMTS;
-	TsunamiSerial.write(txbuf, 6);
+	TsunamiOut.write(txbuf, 6);
 }
 
 
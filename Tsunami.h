@@ -101,6 +101,15 @@
 #endif
 #endif
 
+// Everything goes through TsunamiOut.  With USE_OUTPUT_GATING that's the gated port in sinks.cpp, so a send never
+// waits for room in TsunamiSerial's buffer.
+#ifdef USE_OUTPUT_GATING
+#include "sinks.h"
+#define TsunamiOut trigger_port
+#else
+#define TsunamiOut TsunamiSerial
+#endif
+
 class Tsunami
 {
 public:
@@ -111,6 +120,7 @@ public:
 	void flush(void);
 	void setReporting(bool enable);
 	bool getVersion(char *pDst, int len);
+	void requestVersion(void);
 	int getNumTracks(void);
 	bool isTrackPlaying(int trk);
 	void masterGain(int out, int gain);
@@ -0,0 +1,138 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// A small microbenchmark harness.  On the gurdy it times with the CPU cycle counter; on a computer
+// (tools/bench_host.cpp) it times with std::chrono and, on x86, the time-stamp counter.  Both print the
+// same result lines, so before-and-after numbers line up:
+//
+//   getLongNoteNum               10000 ops      312.4 ns/op      187.4 cycles/op  min 295.0  max 1650.0 ns
+//
+// This header is plain C++ so the host tools can use it.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#if defined(TEENSYDUINO)
+  #include <Arduino.h>
+  typedef uint32_t bench_ticks_t;
+
+  /// @brief Returns the benchmark clock.  On the gurdy this is the CPU cycle counter.
+  inline bench_ticks_t bench_ticks() {
+    return ARM_DWT_CYCCNT;
+  }
+
+  /// @brief Returns how many nanoseconds a benchmark clock tick takes.
+  inline double bench_ns_per_tick() {
+    return 1000000000.0 / F_CPU_ACTUAL;
+  }
+
+  /// @brief Returns how many CPU cycles a benchmark clock tick takes.
+  inline double bench_cycles_per_tick() {
+    return 1.0;
+  }
+#else
+  #include <chrono>
+  #if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+  #endif
+  typedef uint64_t bench_ticks_t;
+
+  inline bench_ticks_t bench_ticks() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  inline double bench_ns_per_tick() {
+    return 1.0;
+  }
+
+  // Estimates the time-stamp counter's rate against the clock, once.  x86 only; elsewhere cycles read as 0.
+  inline double bench_cycles_per_tick() {
+    #if defined(__x86_64__) || defined(__i386__)
+    static double rate = 0;
+    if (rate == 0) {
+      bench_ticks_t t0 = bench_ticks();
+      uint64_t c0 = __rdtsc();
+      while (bench_ticks() - t0 < 20000000) {}
+      rate = double(__rdtsc() - c0) / double(bench_ticks() - t0);
+    }
+    return rate;
+    #else
+    return 0.0;
+    #endif
+  }
+#endif
+
+struct BenchResult {
+  const char *name;
+  uint32_t iterations;
+  double ns_per_op;
+  double cycles_per_op;
+  double min_ns;       // Fastest single call
+  double max_ns;       // Slowest single call
+};
+
+/// @brief Times fn() over a number of calls.
+/// @details The mean comes from timing all the calls together.  The fastest and slowest single calls come
+/// from a second pass timing each call, less the cost of reading the clock.
+/// @param name The benchmark's name, for bench_format()
+/// @param iterations How many calls to time (each pass).  A tenth as many warm-up calls come first.
+/// @param fn The code to time
+template <class F>
+BenchResult bench_run(const char *name, uint32_t iterations, F fn) {
+  BenchResult r;
+  r.name = name;
+  r.iterations = iterations;
+
+  uint32_t warmup = iterations / 10 + 1;
+  for (uint32_t x = 0; x < warmup; x++) {
+    fn();
+  }
+
+  bench_ticks_t start = bench_ticks();
+  for (uint32_t x = 0; x < iterations; x++) {
+    fn();
+  }
+  bench_ticks_t total = bench_ticks() - start;
+
+  // The cost of reading the clock twice.
+  bench_ticks_t overhead = ~(bench_ticks_t)0;
+  for (int x = 0; x < 16; x++) {
+    bench_ticks_t a = bench_ticks();
+    bench_ticks_t b = bench_ticks();
+    if (bench_ticks_t(b - a) < overhead) {
+      overhead = b - a;
+    }
+  }
+
+  bench_ticks_t fastest = ~(bench_ticks_t)0;
+  bench_ticks_t slowest = 0;
+  for (uint32_t x = 0; x < iterations; x++) {
+    bench_ticks_t a = bench_ticks();
+    fn();
+    bench_ticks_t t = bench_ticks() - a;
+    t = (t > overhead) ? t - overhead : 0;
+    if (t < fastest) {
+      fastest = t;
+    }
+    if (t > slowest) {
+      slowest = t;
+    }
+  }
+
+  double per_op = double(total) / (iterations ? iterations : 1);
+  r.ns_per_op = per_op * bench_ns_per_tick();
+  r.cycles_per_op = per_op * bench_cycles_per_tick();
+  r.min_ns = fastest * bench_ns_per_tick();
+  r.max_ns = slowest * bench_ns_per_tick();
+  return r;
+}
+
+/// @brief Formats a result as one line (without a newline).
+/// @return The length of the line, as snprintf()
+inline int bench_format(const BenchResult &r, char *line, int size) {
+  return snprintf(line, size, "%-28s %8lu ops %10.1f ns/op %10.1f cycles/op  min %.1f  max %.1f ns",
+                  r.name, (unsigned long)r.iterations, r.ns_per_op, r.cycles_per_op, r.min_ns, r.max_ns);
+}
+
+#endif
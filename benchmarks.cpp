@@ -0,0 +1,459 @@
+#include "benchmarks.h"
+
+#include <SD.h>
+
+#include "common.h"
+#include "display.h"
+#include "hurdygurdy.h"
+#include "notes.h"
+#include "play_functions.h"
+#include "play_screens.h"
+#include "sinks.h"
+#include "stress.h"
+#include "traffic.h"
+
+#include "crank.h"
+extern Crank *mycrank;
+
+extern HurdyGurdy *mygurdy;
+
+/// @defgroup bench Benchmarks
+/// These functions time the gurdy's hot functions with the CPU cycle counter (see bench.h).
+///
+/// Results are printed over Serial and saved to BENCH_DIR on the SD card, one line per benchmark, in the same
+/// format as tools/bench_host.cpp.  Run them before and after a change to see what it actually did.
+///
+/// The soundOn()/soundOff() benchmarks use a spare string on MIDI channel 16 at volume 0, so nothing is heard.
+/// Note that in output modes 0 and 2 they include waiting for the MIDI-OUT socket, which at 31250 baud is
+/// about 1ms per message once its buffer fills.
+///
+/// The saturation test (with USE_TRAFFIC_STATS) finds the fastest ornaments the outputs keep up with.  It trills
+/// between the first two keys at each rate in STRESS_RATES for STRESS_STEP_MS, with every string sounding on
+/// both MIDI-OUT and the Trigger/Tsunami (output mode 2), gros notes on the melody strings and trompette, the buzz
+/// and the key click, all at volume 0.  Each rate is judged as stress.h describes, and the test stops at the first
+/// that fails.  tools/stress_host.cpp models the same test, to compare against.
+/// @version *New in 3.1.0*
+/// @{
+
+#ifdef USE_BENCH
+
+const int BENCH_MAX_RESULTS = 24;
+static BenchResult bench_results[BENCH_MAX_RESULTS];
+static int bench_count = 0;
+
+static void bench_add(const BenchResult &r) {
+  char line[128];
+  bench_format(r, line, sizeof(line));
+  Serial.println(line);
+
+  if (bench_count < BENCH_MAX_RESULTS) {
+    bench_results[bench_count++] = r;
+  };
+};
+
+/// @brief Opens the next unused results file in BENCH_DIR and writes the firmware header line.
+/// @param prefix The file name's start, e.g. "bench" for bench000.txt
+/// @param path Set to the file's path
+/// @return The file, which is false if there's no SD card.
+static File bench_open(const char *prefix, String *path) {
+  if (!SD.begin(BUILTIN_SDCARD)) {
+    return File();
+  };
+
+  if (!SD.exists(BENCH_DIR)) {
+    SD.mkdir(BENCH_DIR);
+  };
+
+  int num = 0;
+  char name[48];
+  do {
+    snprintf(name, sizeof(name), "%s/%s%03d.txt", BENCH_DIR, prefix, num);
+    num++;
+  } while (SD.exists(name) && num < 1000);
+
+  File f = SD.open(name, FILE_WRITE);
+  if (!f) {
+    return f;
+  };
+
+  char line[128];
+  int len = snprintf(line, sizeof(line), "# firmware=%s f_cpu=%lu\n", VERSION.c_str(), (unsigned long)F_CPU_ACTUAL);
+  f.write((const uint8_t *)line, len);
+
+  *path = String(name);
+  return f;
+};
+
+static bool bench_save(String *path) {
+  File f = bench_open("bench", path);
+  if (!f) {
+    return false;
+  };
+
+  char line[128];
+  int len;
+  for (int x = 0; x < bench_count; x++) {
+    len = bench_format(bench_results[x], line, sizeof(line) - 1);
+    line[len++] = '\n';
+    f.write((const uint8_t *)line, len);
+  };
+  f.close();
+  return true;
+};
+
+/// @brief Runs every benchmark, printing the results over Serial and saving them to the SD card.
+void bench_suite_run() {
+  bench_count = 0;
+
+  // Time the real play screens, not the live status screen standing in for them.
+  bool was_live = live_status_on;
+  live_status_on = false;
+
+  Serial.print("Benchmarks, firmware ");
+  Serial.print(VERSION);
+  Serial.print(", ");
+  Serial.print(F_CPU_ACTUAL / 1000000);
+  Serial.println("MHz:");
+
+  // Strings, in each output mode.
+  GurdyString *bench_string = new GurdyString(16, 60, "Bench", 0, 0);
+  const char *on_names[3] = {"soundOn (MIDI-OUT)", "soundOn (Trigger)", "soundOn (both)"};
+  const char *off_names[3] = {"soundOff (MIDI-OUT)", "soundOff (Trigger)", "soundOff (both)"};
+
+  for (int mode = 0; mode < 3; mode++) {
+    bench_string->setOutputMode(mode);
+    bench_add(bench_run(on_names[mode], BENCH_SOUND_OPS, [&]() { bench_string->soundOn(); }));
+    bench_add(bench_run(off_names[mode], BENCH_SOUND_OPS, [&]() { bench_string->soundOff(); }));
+  };
+  bench_string->soundKill();
+  delete bench_string;
+
+  // Keys and crank.
+  bench_add(bench_run("HurdyGurdy::getMaxOffset", BENCH_FAST_OPS, []() { mygurdy->getMaxOffset(); }));
+  bench_add(bench_run("crank update", BENCH_FAST_OPS, []() { mycrank->update(); }));
+  #ifndef USE_GEARED_CRANK
+  bench_add(bench_run("GurdyCrank::updateExpression", BENCH_FAST_OPS, []() { mycrank->updateExpression(); }));
+  #endif
+
+  // Notes and the display.
+  int note = 0;
+  bench_add(bench_run("getLongNoteNum", BENCH_FAST_OPS, [&]() { getLongNoteNum(note); note = (note + 1) % 128; }));
+
+  u8g2.clearBuffer();
+  bench_add(bench_run("print_note", BENCH_FAST_OPS / 10, []() { print_note("C#4", 0); }));
+
+  note = 48;
+  bench_add(bench_run("draw_play_screen", BENCH_DISPLAY_OPS, [&]() {
+    draw_play_screen(note, play_screen_type, false);
+    note = (note < 84) ? note + 1 : 48;
+  }));
+  bench_add(bench_run("print_display", BENCH_DISPLAY_OPS, []() {
+    print_display(mystring->getOpenNote(), mylowstring->getOpenNote(), mydrone->getOpenNote(), mytromp->getOpenNote(),
+                  tpose_offset, capo_offset, 0, mystring->getMute(), mylowstring->getMute(), mydrone->getMute(), mytromp->getMute());
+  }));
+
+  live_status_on = was_live;
+};
+
+#ifdef USE_TRAFFIC_STATS
+
+static StressStep stress_steps[STRESS_NUM_RATES];
+static int stress_count = 0;
+
+// The slow links' send buffer sizes, taken while they're empty.
+static int stress_tx_size[STRESS_NUM_LINKS];
+
+/// @brief Returns how many bytes are waiting to go out on a slow link.
+static int stress_backlog(int link) {
+  if (link == STRESS_MIDI_OUT) {
+    int waiting = stress_tx_size[link] - Serial1.availableForWrite();
+    #ifdef USE_OUTPUT_GATING
+    waiting += midi_port.queued();
+    #endif
+    return waiting;
+  };
+  int waiting = stress_tx_size[link] - SINK_TRIGGER_PORT.availableForWrite();
+  #ifdef USE_OUTPUT_GATING
+  waiting += trigger_port.queued();
+  #endif
+  return waiting;
+};
+
+/// @brief Counts the Trigger/Tsunami voices taken and given back since the last call.
+/// @param key True if key_change() was just called, whose last play is the key click
+/// @param seen The play, fade and stop counts at the last call
+/// @details Crank expression ramps (USE_TRIGGER_EXPRESSION) are counted as fades too, but the test doesn't turn the
+/// crank, so every fade here is a note ending.
+static void stress_count_voices(StressVoices *voices, bool key, uint32_t *seen) {
+  const uint32_t *m = traffic[TRAFFIC_TRIGGER].messages;
+  uint32_t now = millis();
+
+  if (m[TRAFFIC_TRACK_STOP] != seen[2]) {
+    voices->stop();
+    seen[2] = m[TRAFFIC_TRACK_STOP];
+  };
+  for (; seen[1] < m[TRAFFIC_TRACK_FADE]; seen[1]++) {
+    voices->fade(now);
+  };
+
+  uint32_t plays = m[TRAFFIC_TRACK_PLAY] - seen[0];
+  seen[0] = m[TRAFFIC_TRACK_PLAY];
+  if (key && plays > 0) {
+    voices->shot(now, KEYCLICK_MS);
+    plays--;
+  };
+  for (; plays > 0; plays--) {
+    voices->play(now);
+  };
+};
+
+/// @brief Lets the links send what's left after a rate, pumping MIDI-OUT's queue.
+static void stress_settle() {
+  uint32_t start = millis();
+  while (millis() - start < 500) {
+    mykeyclick->update();
+    #ifdef USE_OUTPUT_GATING
+    sink_update();
+    #endif
+  };
+};
+
+/// @brief Trills at one rate for STRESS_STEP_MS and measures what it did to the outputs.
+/// @param rate Key changes a second
+static void stress_step(int rate, StressStep *s) {
+  memset(s, 0, sizeof(*s));
+  s->rate = rate;
+  s->ms = STRESS_STEP_MS;
+
+  StressVoices voices;
+  uint32_t seen[3] = {0, 0, 0};
+  traffic_reset();
+
+  // What loop() does when the crank starts, then both notes of the trill once so their gains are sent.
+  mystring->soundOn(myoffset + tpose_offset, mel_vibrato);
+  mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
+  mytromp->soundOn(tpose_offset + capo_offset);
+  mydrone->soundOn(tpose_offset + capo_offset);
+  mybuzz->soundOn(tpose_offset + capo_offset);
+  stress_count_voices(&voices, false, seen);
+  for (int x = 0; x < 2; x++) {
+    myoffset = (myoffset == 1) ? 2 : 1;
+    key_change();
+    stress_count_voices(&voices, true, seen);
+  };
+  stress_settle();
+
+  // Count from here.
+  traffic_reset();
+  memset(seen, 0, sizeof(seen));
+  voices.peak = voices.count(millis());
+  #ifdef USE_OUTPUT_GATING
+  sink_reset();
+  #endif
+  for (int x = 0; x < STRESS_NUM_LINKS; x++) {
+    s->backlog_start[x] = -1;
+    s->backlog_end[x] = -1;
+  };
+
+  uint32_t start = millis();
+  uint32_t interval_us = 1000000 / rate;
+  uint32_t next_key_us = micros() + interval_us;
+  uint64_t total_us = 0;
+  uint32_t passes = 0;
+
+  while (millis() - start < (uint32_t)STRESS_STEP_MS) {
+    uint32_t pass_start = micros();
+
+    // The same output work as a pass of loop() with the crank turning.
+    bool key = ((int32_t)(pass_start - next_key_us) >= 0);
+    if (key) {
+      myoffset = (myoffset == 1) ? 2 : 1;
+      key_change();
+      next_key_us += interval_us;
+      s->keys++;
+    };
+    mykeyclick->update();
+    #ifdef USE_OUTPUT_GATING
+    sink_update();
+    #endif
+    traffic_loop_end();
+
+    uint32_t us = micros() - pass_start;
+    total_us += us;
+    passes++;
+    if (us > s->loop_max_us) {
+      s->loop_max_us = us;
+    };
+
+    stress_count_voices(&voices, key, seen);
+    for (int x = 0; x < STRESS_NUM_LINKS; x++) {
+      stress_sample_backlog(s, x, stress_backlog(x), millis() - start, STRESS_STEP_MS);
+    };
+  };
+
+  for (int x = 0; x < TRAFFIC_SINK_COUNT; x++) {
+    s->bytes_per_sec[x] = traffic[x].bytes * 1000 / STRESS_STEP_MS;
+    s->dropped += sinks[x].dropped;
+  };
+  s->loop_avg_us = (passes > 0) ? (uint32_t)(total_us / passes) : 0;
+  s->peak_voices = voices.peak;
+
+  all_soundOff();
+  stress_settle();
+};
+
+/// @brief Runs the saturation test, printing each rate and the ceiling over Serial.
+/// @return The number of rates run.
+int stress_run() {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+  int volume[6];
+  int gros[6];
+  int output[6];
+  bool mute[6];
+  int offset = myoffset;
+
+  all_soundOff();
+  for (int x = 0; x < 6; x++) {
+    volume[x] = strings[x]->getVolume();
+    gros[x] = strings[x]->getGrosMode();
+    output[x] = strings[x]->getOutputMode();
+    mute[x] = strings[x]->getMute();
+
+    strings[x]->setVolume(0);
+    strings[x]->setGrosMode(0);
+    strings[x]->setOutputMode(2);
+    strings[x]->setMute(false);
+  };
+  mystring->setGrosMode(1);
+  mylowstring->setGrosMode(2);
+  mytromp->setGrosMode(3);
+  myoffset = 1;
+
+  stress_settle();
+  stress_tx_size[STRESS_MIDI_OUT] = Serial1.availableForWrite();
+  stress_tx_size[STRESS_TRIGGER] = SINK_TRIGGER_PORT.availableForWrite();
+
+  StressLimits lim = {TRIGGER_MAX_VOICES, STRESS_LOOP_BUDGET_US};
+  char line[200];
+
+  Serial.print("Saturation test, firmware ");
+  Serial.print(VERSION);
+  Serial.print(", legato ");
+  Serial.println((int)mystring->getLegato());
+
+  stress_count = 0;
+  for (int x = 0; x < STRESS_NUM_RATES; x++) {
+    StressStep *s = &stress_steps[x];
+    stress_step(STRESS_RATES[x], s);
+    stress_count++;
+
+    stress_format(*s, lim, line, sizeof(line));
+    Serial.println(line);
+    if (stress_verdict(*s, lim)) {
+      break;
+    };
+  };
+  stress_format_ceiling(stress_steps, stress_count, lim, line, sizeof(line));
+  Serial.println(line);
+
+  for (int x = 0; x < 6; x++) {
+    strings[x]->setVolume(volume[x]);
+    strings[x]->setGrosMode(gros[x]);
+    strings[x]->setOutputMode(output[x]);
+    strings[x]->setMute(mute[x]);
+  };
+  myoffset = offset;
+  all_clearVolArray();
+  traffic_reset();
+
+  return stress_count;
+};
+
+/// @brief Saves the last saturation test to the SD card.
+static bool stress_save(String *path) {
+  File f = bench_open("stress", path);
+  if (!f) {
+    return false;
+  };
+
+  StressLimits lim = {TRIGGER_MAX_VOICES, STRESS_LOOP_BUDGET_US};
+  char line[200];
+  int len;
+  for (int x = 0; x < stress_count; x++) {
+    len = stress_format(stress_steps[x], lim, line, sizeof(line) - 1);
+    line[len++] = '\n';
+    f.write((const uint8_t *)line, len);
+  };
+  len = stress_format_ceiling(stress_steps, stress_count, lim, line, sizeof(line) - 1);
+  line[len++] = '\n';
+  f.write((const uint8_t *)line, len);
+  f.close();
+  return true;
+};
+
+#endif
+
+/// @brief Prompts the user to run the benchmarks, then shows where the results went.
+void bench_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    #ifdef USE_TRAFFIC_STATS
+    print_menu_2("Benchmarks", "Run Benchmarks", "Saturation Test");
+    #else
+    print_menu_2("Benchmarks", "Run Benchmarks", "");
+    #endif
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      print_message_2("Benchmarks", "Running,", "Please wait...");
+      bench_suite_run();
+
+      String path;
+      if (bench_save(&path)) {
+        print_message_2("Benchmarks", "Saved as:", path);
+      } else {
+        print_message_2("Benchmarks", "Sent over Serial.", "(No SD card)");
+      };
+      delay(2000);
+
+    #ifdef USE_TRAFFIC_STATS
+    } else if (my2Button->wasPressed()) {
+      print_message_2("Saturation Test", "Running, about", "30 seconds...");
+      stress_run();
+
+      const StressStep *last = &stress_steps[stress_count - 1];
+      StressLimits lim = {TRIGGER_MAX_VOICES, STRESS_LOOP_BUDGET_US};
+      String ceiling;
+      if (!stress_verdict(*last, lim)) {
+        ceiling = "At least " + String(last->rate) + " keys/s";
+      } else if (stress_count > 1) {
+        ceiling = String(stress_steps[stress_count - 2].rate) + " keys/s";
+      } else {
+        ceiling = "Under " + String(last->rate) + " keys/s";
+      };
+
+      String path;
+      if (stress_save(&path)) {
+        print_message_2("Saturation Test", ceiling, path);
+      } else {
+        print_message_2("Saturation Test", ceiling, "(Sent over Serial)");
+      };
+      delay(3000);
+    #endif
+
+    } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
+      done = true;
+    };
+  };
+};
+
+#endif
+
+/// @}
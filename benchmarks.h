@@ -0,0 +1,13 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "bench.h"
+
+void bench_suite_run();
+int stress_run();
+void bench_screen();
+
+#endif
@@ -28,8 +28,5 @@ float BuzzKnob::getVoltage() {
 /// @brief Gets the calculated velocity threshold based off the current voltage.
 /// @return The buzzing velocity threshold.
 float BuzzKnob::getThreshold() {
-  if (getVoltage() > 1000) {
-    return (240);
-  }
-  return (30 + (getVoltage() / 6.5));
+  return crank_buzz_threshold(getVoltage());
 };
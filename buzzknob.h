@@ -3,6 +3,8 @@
 
 #include <ADC.h>
 
+#include "crank_estimator.h"
+
 extern ADC* adc;
 
 class BuzzKnob {
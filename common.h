@@ -42,7 +42,8 @@ extern KeyboxButton *myBButton;
 // They are differentiated in the main loop():
 // * A melody string is one that changes with the keybox offset.
 // * A drone/trompette is one that doesn't change.
-// * The keyclick "string" is just a drone that comes on and off at particular times.
+// * The keyclick "string" is just a drone that comes on and off at particular times.  It's a one-shot
+//   (see GurdyString::setOneShot()): each click plays once and ends by itself.
 // * The buzz "string" is also just a drone that comes on/off at other particular times.
 extern GurdyString *mystring;
 extern GurdyString *mylowstring;
@@ -30,6 +30,11 @@ const String EXTRA_LINE = "   ";
   /// @brief Enables Tsunami support.
   /// @details Cannot be used with USE_TRIGGER simultaneously
   #define USE_TSUNAMI
+  /// @brief Plays the Tsunami's tracks with MIDI Note-On/Note-Off instead of its serial commands, for 2-5 bytes a
+  /// note instead of 10-19.
+  /// @details USE_TSUNAMI only.  The Tsunami must take MIDI on its serial input, and its MIDI release time (in its
+  /// init file) takes the place of the gurdy's 200ms fade.  See tsunami_midi.h.
+  #define USE_TSUNAMI_MIDI
   /// @brief Enables geared-crank support.
   /// @details Disable for optical-crank support
   #define USE_GEARED_CRANK
@@ -46,6 +51,60 @@ const String EXTRA_LINE = "   ";
   /// @brief Setting this option enables EX pins 7-10, and SPI2 display.
   /// @details meant for rev4 boards.
   #define REV4_MODE
+  /// @brief Enables the SD card tuning library (Teensy 4.1 built-in SD slot).
+  /// @details See SD_TUNING_DIR.  Without a card the library is simply empty.
+  #define USE_SD_TUNINGS
+  /// @brief Lets loop() sleep between passes while the gurdy sits still.
+  /// @details See IDLE_ARM_CLOCK.  Has no effect with USE_GEARED_CRANK.  The wake-to-first-note latency is on the
+  /// live status screen.
+  #define USE_IDLE_MODE
+  /// @brief Replaces the crank sensor with a synthetic crank, for testing.
+  /// @details See CRANK_SIM_PROFILE.  Optical and encoder cranks only.
+  #define CRANK_SIM
+  /// @brief Enables recording raw crank input to the SD card (Other Options -> Diagnostics).
+  /// @details See CRANK_CAPTURE_EVENTS and tools/crank_replay.cpp.  Costs 192 KB (16384 x 12 bytes) of the 512 KB
+  /// second RAM bank (DMAMEM).
+  #define CRANK_CAPTURE
+  /// @brief Enables timeline tracing of loop() and outbound MIDI (Other Options -> Diagnostics).
+  /// @details See TRACE_EVENTS.  Saved traces open in Perfetto or Chrome's about:tracing.  Costs 192 KB (16384 x 12
+  /// bytes) of the 512 KB second RAM bank (DMAMEM).
+  #define USE_TRACE
+  /// @brief Enables the scripted MIDI output self-test (Other Options -> Diagnostics).
+  /// @details See STREAM_TEST_DIR.  Costs 32 KB (4096 x 8 bytes) of the 512 KB second RAM bank (DMAMEM).  With
+  /// CRANK_CAPTURE and USE_TRACE too that's 416 KB, leaving 96 KB for the USB buffers and malloc() that also use it.
+  #define USE_STREAM_TEST
+  /// @brief Enables the on-device microbenchmarks (Other Options -> Diagnostics).
+  /// @details See BENCH_FAST_OPS and tools/bench_host.cpp.
+  #define USE_BENCH
+  /// @brief Counts the messages and bytes sent on each MIDI/Trigger link (Other Options -> Diagnostics).
+  /// @details See TRAFFIC_REPORT_MS.
+  #define USE_TRAFFIC_STATS
+  /// @brief Enables the live loop/crank/output status screen (Other Options -> Diagnostics).
+  /// @details See LIVE_STATUS_REFRESH_MS.
+  #define USE_LIVE_STATUS
+  /// @brief Enables EX button macros: short programs of EX actions kept in EEPROM.
+  /// @details See MACRO_BUDGET and tools/macro_asm.cpp.
+  #define USE_MACROS
+  /// @brief Enables the MPE (MIDI Polyphonic Expression) output option (Other Options -> Input/Output Config).
+  /// @details See MPE_BEND_RANGE.
+  #define USE_MPE
+  /// @brief Sends crank expression with 14 bits (MIDI CC11 and CC43) instead of 7.  Optical and encoder cranks only.
+  /// @details See EXPRESSION_HIRES_DEADBAND.
+  #define USE_HIRES_EXPRESSION
+  /// @brief Tracks whether each output link is alive and stops a dead one from holding up the others.
+  /// @details See SINK_STALL_MS and MIDI_OUT_DROP_POLICY.
+  #define USE_OUTPUT_GATING
+  /// @brief Swells the Trigger/Tsunami tracks with crank expression (and the buzz with buzz expression), as track gain.
+  /// @details See TRIGGER_EXPRESSION_MS.
+  #define USE_TRIGGER_EXPRESSION
+  /// @brief Enables the legato key change options (Other Options -> Input/Output Config).
+  /// @details See LEGATO_BEND_RANGE.
+  #define USE_LEGATO
+  /// @brief Plays incoming MIDI notes and CCs on the strings, so the gurdy can be a sound module.
+  /// @details See MIDI_IN_CHANNELS and MIDI_IN_MAX_PER_LOOP.  This turns off the MIDI library's thru on the
+  /// MIDI-IN socket: messages the strings don't play are passed on to MIDI-OUT from loop() instead (channel
+  /// messages and real-time only, no SysEx).
+  #define USE_MIDI_IN
 #endif
 
 // One of these OLED options must be enabled.
@@ -60,12 +119,49 @@ const String EXTRA_LINE = "   ";
 #define USE_TRIGGER
 //#define USE_TSUNAMI
 
+//#define USE_TSUNAMI_MIDI
+#ifndef USE_TSUNAMI
+  #undef USE_TSUNAMI_MIDI
+#endif
+
 #define ALLOW_COMBO_MODE
 //#define BAZ_MODE
 //#define USB_ALWAYS_ON
 
 #define REV4_MODE
 
+#define USE_SD_TUNINGS
+
+//#define USE_IDLE_MODE
+
+//#define CRANK_SIM
+
+//#define CRANK_CAPTURE
+
+//#define USE_TRACE
+
+//#define USE_STREAM_TEST
+
+//#define USE_BENCH
+
+#define USE_TRAFFIC_STATS
+
+#define USE_LIVE_STATUS
+
+#define USE_MACROS
+
+#define USE_MPE
+
+//#define USE_HIRES_EXPRESSION
+
+//#define USE_OUTPUT_GATING
+
+//#define USE_TRIGGER_EXPRESSION
+
+#define USE_LEGATO
+
+//#define USE_MIDI_IN
+
 /// @brief The audio output channel used by the Tsunami unit.
 /// @details 0 == 1L, 1 == 1R, etc.
 const int TSUNAMI_OUT = 0;
@@ -96,6 +192,173 @@ const int PEDAL_PIN = 38;
 /// * Value is on a 0-1023 scale: 1023 = 3.3V
 const float PEDAL_MAX_V = 658.0;
 
+/// @brief The member-channel pitch bend range in semitones, if USE_MPE is enabled.
+/// @details Sent to the synth when MPE output starts.
+const int MPE_BEND_RANGE = 2;
+
+/// @brief The shortest time (ms) between two MPE expression or vibrato messages on a string.
+/// @details Lower follows the crank more closely, higher sends less.  Each is only sent when it changed, so at
+/// 10ms a crank that never stops changing costs a string at most 200 bytes a second of MIDI-OUT (channel pressure
+/// is two bytes), and a steady vibrato costs nothing.
+const int MPE_RATE_MS = 10;
+
+/// @brief How long the key click's MIDI note lasts, in ms.
+/// @details The key click is a one-shot: its Trigger/Tsunami track plays once through on its own, and its MIDI note
+/// is ended after this long.  A click that comes sooner cuts the last one short.
+const int KEYCLICK_MS = 40;
+
+/// @brief The shortest time (ms) between two crank expression gain changes on a string's Trigger/Tsunami tracks, if
+/// USE_TRIGGER_EXPRESSION is enabled.
+/// @details Each change is a trackFade() to the new gain over this long, so the swell stays smooth.  It is also
+/// only sent once the gain is TRIGGER_EXPRESSION_DB away from the last one, and while the unit's serial port has
+/// room.  At 100ms six sounding tracks use at most 720 bytes a second of the Trigger/Tsunami link.
+const int TRIGGER_EXPRESSION_MS = 100;
+
+/// @brief The smallest crank expression gain change (dB) sent to the Trigger/Tsunami, if USE_TRIGGER_EXPRESSION is
+/// enabled.
+const int TRIGGER_EXPRESSION_DB = 1;
+
+/// @brief The pitch bend range in semitones for legato glides, if USE_LEGATO is enabled.
+/// @details Key changes within this many semitones of the sounding note are pitch bends, further ones strike the
+/// note again.  It is sent to the synth when glide is chosen.  Wider covers more of a run, but a sample bent far
+/// sounds less like itself.
+const int LEGATO_BEND_RANGE = 2;
+
+/// @brief The incoming MIDI channels played on the strings, if USE_MIDI_IN is enabled: bit 0 is channel 1.
+/// @details A message on one of these channels is played by the string sending on that channel (normally 1-6:
+/// melody, low melody, trompette, drone, buzz and key click; 2-7 in MPE mode).  The default takes the melody,
+/// low melody, trompette and drone channels.
+const uint16_t MIDI_IN_CHANNELS = 0x000F;
+
+/// @brief The most incoming MIDI messages played in one pass through loop(), if USE_MIDI_IN is enabled.
+/// @details Incoming messages are played after the keybox and crank are done with each pass, so they can never
+/// hold up live playing by more than this many messages.  The rest wait in the port's buffer for the next pass.
+const int MIDI_IN_MAX_PER_LOOP = 8;
+
+/// @brief How long (us) an incoming NoteOn may have waited before it's dropped instead of played, if USE_MIDI_IN
+/// is enabled.
+/// @details A note that waited this long (say, through a pause menu) would only play late.  NoteOffs and CCs are
+/// always played.
+const uint32_t MIDI_IN_STALE_US = 20000;
+
+/// @brief The SD card directory holding the tuning library, if USE_SD_TUNINGS is enabled.
+/// @details Each file in it holds one tuning per line: `name,hi_mel,lo_mel,drone,tromp,buzz,tpose,capo`
+#define SD_TUNING_DIR "/tunings"
+
+/// @brief The most tunings the SD card library will index.
+/// @details Each one costs 40 bytes of RAM.
+const int SD_MAX_TUNINGS = 1024;
+
+/// @brief The most files in SD_TUNING_DIR the library will read.
+const int SD_MAX_TUNING_FILES = 32;
+
+/// @brief The longest SD tuning file name accepted.
+const int SD_TUNING_FILENAME_LEN = 31;
+
+/// @brief The longest SD tuning line read.
+const int SD_TUNING_LINE_LEN = 80;
+
+/// @brief The CPU clock (Hz) to drop to while idling, if USE_IDLE_MODE is enabled.
+/// @details 0 leaves the clock alone.  Lower clocks save more power but slow down the first
+/// loop() pass after waking (e.g. 150000000 makes it about 4x slower).  Teensy 4 only: other boards ignore it.
+const uint32_t IDLE_ARM_CLOCK = 0;
+
+/// @brief The most crank events one recording holds, if CRANK_CAPTURE is enabled.
+/// @details Each costs 12 bytes of the Teensy 4.1's second RAM bank.  An optical crank makes a few hundred
+/// events a second and an encoder a few thousand, a gear crank one per loop().
+const int CRANK_CAPTURE_EVENTS = 16384;
+
+/// @brief The SD card directory crank recordings are saved in, if CRANK_CAPTURE is enabled.
+#define CRANK_CAPTURE_DIR "/captures"
+
+/// @brief The most events one trace holds, if USE_TRACE is enabled.
+/// @details Each costs 12 bytes of the Teensy 4.1's second RAM bank.  Older events are overwritten, so a trace
+/// always holds the latest ones.  A key change is around ten events.
+const int TRACE_EVENTS = 16384;
+
+/// @brief A loop() pass that takes at least this long (microseconds) is traced even if nothing happened in it.
+const uint32_t TRACE_SLOW_LOOP_US = 1000;
+
+/// @brief The SD card directory traces are saved in, if USE_TRACE is enabled.
+#define TRACE_DIR "/traces"
+
+/// @brief The most messages one MIDI self-test session may send, if USE_STREAM_TEST is enabled.
+/// @details Each costs 8 bytes of the Teensy 4.1's second RAM bank.
+const int STREAM_TEST_EVENTS = 4096;
+
+/// @brief The volume every string is set to for the MIDI self-test sessions.
+const int STREAM_TEST_VOLUME = 70;
+
+/// @brief The SD card directory the MIDI self-test keeps its golden files in, if USE_STREAM_TEST is enabled.
+#define STREAM_TEST_DIR "/selftest"
+
+/// @brief How many calls each quick benchmark times, if USE_BENCH is enabled.
+const int BENCH_FAST_OPS = 10000;
+
+/// @brief How many calls each soundOn()/soundOff() benchmark times, if USE_BENCH is enabled.
+const int BENCH_SOUND_OPS = 200;
+
+/// @brief How many calls each full-display benchmark times, if USE_BENCH is enabled.
+const int BENCH_DISPLAY_OPS = 50;
+
+/// @brief The SD card directory benchmark results are saved in, if USE_BENCH is enabled.
+#define BENCH_DIR "/bench"
+
+/// @brief How long the saturation test plays each trill rate, in ms, if USE_BENCH and USE_TRAFFIC_STATS are enabled.
+/// @details See stress.h.  The whole test plays up to twelve rates, so 2000ms is at most about half a minute.
+const int STRESS_STEP_MS = 2000;
+
+/// @brief The slowest the gurdy's outputs may take in one loop() pass (us) before the saturation test fails a rate.
+/// @details This is only the output work: the sends, the key click and the link checks.  A key change with gros notes
+/// is more than the Trigger/Tsunami's send buffer holds, so the pass that makes one already waits about 5ms for room
+/// at any rate.  Past 10ms the next key change is late enough to hear.
+const uint32_t STRESS_LOOP_BUDGET_US = 10000;
+
+/// @brief How many tracks the Trigger/Tsunami can play at once: 14 on a WAV Trigger, 18 on a stereo Tsunami.
+/// @details Used by the saturation test to spot notes that wouldn't sound.  Set it to 32 for the mono Tsunami firmware.
+#ifdef USE_TSUNAMI
+const int TRIGGER_MAX_VOICES = 18;
+#else
+const int TRIGGER_MAX_VOICES = 14;
+#endif
+
+/// @brief How often the MIDI/Trigger traffic counters are sent to Serial, if USE_TRAFFIC_STATS is enabled.
+/// @details 0 == never.  They're always on the Diagnostics screen.
+const int TRAFFIC_REPORT_MS = 0;
+
+/// @brief How often the live status screen starts a new picture, if USE_LIVE_STATUS is enabled.
+/// @details Each picture is drawn over the next nine loop() passes, a small step each.
+const int LIVE_STATUS_REFRESH_MS = 250;
+
+/// @brief How long MIDI-OUT's send buffer may sit without draining before the link counts as dead, if
+/// USE_OUTPUT_GATING is enabled.
+const int SINK_STALL_MS = 100;
+
+/// @brief How many bytes of messages are held while MIDI-OUT or the Trigger/Tsunami can't take them, if
+/// USE_OUTPUT_GATING is enabled.  Each has its own queue.
+/// @details At 31250 baud, 256 bytes is about 80ms of MIDI; at 57600, about 45ms of Trigger/Tsunami commands.
+const int SINK_QUEUE_SIZE = 256;
+
+/// @brief What happens to MIDI-OUT messages once the socket is dead, if USE_OUTPUT_GATING is enabled.
+/// @details
+/// * 0 - Drop oldest: keep the newest messages that fit in SINK_QUEUE_SIZE bytes, sent if it comes back.
+/// * 1 - Drop all: throw them away until it comes back.
+/// * A dead USB or Trigger/Tsunami link always drops all.
+const int MIDI_OUT_DROP_POLICY = 0;
+
+/// @brief Whether the Trigger/Tsunami must answer from startup to count as alive, if USE_OUTPUT_GATING is enabled.
+/// @details It's asked for its version every SINK_PROBE_MS, and two unanswered asks in a row make it dead.  When
+/// off, one that has never answered (its TX may not be wired back to the Teensy) is taken to be alive; once it has
+/// answered, it has to keep answering.  Turn this on if the TX is wired, to catch a unit that's missing at startup.
+const bool TRIGGER_CHECK_REPLIES = false;
+
+/// @brief How often the Trigger/Tsunami is asked for its version, if USE_OUTPUT_GATING is enabled.
+const int SINK_PROBE_MS = 1000;
+
+/// @brief The most EX button macro instructions run in one loop() pass, if USE_MACROS is enabled.
+/// @details A waiting WAIT or RAMP counts as one.  Loading a tuning takes as long as it does from an EX button.
+const int MACRO_BUDGET = 2;
+
 /// @}
 
 /// @defgroup optical Optical Crank Configuration Variables
@@ -113,6 +376,13 @@ const float EXPRESSION_VMAX = 5.0;
 /// * Silent = 0, Max = 127 
 const int EXPRESSION_START = 30;
 
+/// @ingroup optical
+/// @brief The smallest change in 14-bit expression that is sent, if USE_HIRES_EXPRESSION is enabled.
+/// @details
+/// * Out of 16383; 128 is one step of 7-bit expression, so 32 is four times as fine.
+/// * Smaller changes (a steady crank's jitter) aren't sent.  Raise this if the hi-res expression sends too much.
+const int EXPRESSION_HIRES_DEADBAND = 32;
+
 /// @ingroup optical
 /// @brief The number of "spokes" on the optical crank wheel.
 /// @details * This is the number of black/blocking bars on the wheel, not the number of transitions.
@@ -127,6 +397,72 @@ const int NUM_SPOKES = 80;
 /// @brief The crank speed at which sound begins to play in RPMs.
 const float V_THRESHOLD = 2.0;
 
+/// @ingroup optical
+/// @brief How often (microseconds) an optical crank's speed is estimated, if it moved at least two spokes.
+/// @details tools/crank_sweep.cpp tunes this and the next five values against recorded cranking.
+const uint32_t CRANK_EVAL_US = 25250;
+
+/// @ingroup optical
+/// @brief How often (microseconds) an optical crank's speed decays if it didn't move.
+const uint32_t CRANK_DECAY_US = 31250;
+
+/// @ingroup optical
+/// @brief How much of a speed increase an optical crank takes at once (0-1).
+const float CRANK_RISE_FACTOR = 0.8;
+
+/// @ingroup optical
+/// @brief RPM added to every optical speed increase, so starting is quick.
+const float CRANK_RISE_BIAS = 0.5;
+
+/// @ingroup optical
+/// @brief How much of a speed decrease an optical crank takes at once (0-1).
+const float CRANK_FALL_FACTOR = 0.75;
+
+/// @ingroup optical
+/// @brief An optical crank's speed is multiplied by this each time it decays.
+const float CRANK_DECAY_FACTOR = 0.5;
+
+/// @ingroup optical
+/// @brief How often (microseconds) an encoder's speed is estimated, if it moved.
+const uint32_t ENCODER_EVAL_US = 10000;
+
+/// @ingroup optical
+/// @brief How long (microseconds) without an estimate before an encoder's speed halves.
+const uint32_t ENCODER_DECAY_US = 30000;
+
+/// @ingroup optical
+/// @brief How much of a speed change an encoder takes at once (0-1).
+const float ENCODER_FACTOR = 0.8;
+
+
+/// @ingroup optical
+/// @brief The synthetic crank's profile, if CRANK_SIM is enabled.
+/// @details
+/// * 0 = steady at CRANK_SIM_RPM
+/// * 1 = ramp from CRANK_SIM_RPM to CRANK_SIM_RPM2 over CRANK_SIM_PERIOD_MS, then hold
+/// * 2 = coups: CRANK_SIM_RPM with a surge to CRANK_SIM_RPM2 every CRANK_SIM_PERIOD_MS
+/// * 3 = stop-start: CRANK_SIM_RPM for half of every CRANK_SIM_PERIOD_MS, stopped for the other half
+const int CRANK_SIM_PROFILE = 2;
+
+/// @ingroup optical
+/// @brief The synthetic crank's base speed in RPMs, if CRANK_SIM is enabled.
+const float CRANK_SIM_RPM = 60.0;
+
+/// @ingroup optical
+/// @brief The synthetic crank's second speed in RPMs (ramp target, coup peak), if CRANK_SIM is enabled.
+const float CRANK_SIM_RPM2 = 120.0;
+
+/// @ingroup optical
+/// @brief The synthetic crank's period in ms (ramp time, coup/stop-start cycle), if CRANK_SIM is enabled.
+const int CRANK_SIM_PERIOD_MS = 1000;
+
+/// @ingroup optical
+/// @brief The synthetic crank's random speed wobble as a fraction of speed, if CRANK_SIM is enabled.
+const float CRANK_SIM_JITTER = 0.0;
+
+/// @ingroup optical
+/// @brief How often the synthetic crank reports its target/estimated speed and update() cost to Serial.
+const int CRANK_SIM_REPORT_MS = 1000;
 
 /// @defgroup gear Gear-Motor Crank Configuration Variables
 /// These are configuration variables that only apply to gear-motor-crank models.
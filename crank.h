@@ -0,0 +1,16 @@
+#ifndef CRANK_H
+#define CRANK_H
+
+#include "config.h"
+
+// The crank type this gurdy is built with.  Code that only uses what every crank does (see CrankBase) declares
+// `extern Crank *mycrank;` and needs no USE_GEARED_CRANK branches of its own.
+#ifdef USE_GEARED_CRANK
+  #include "gearcrank.h"
+  typedef GearCrank Crank;
+#else
+  #include "gurdycrank.h"
+  typedef GurdyCrank Crank;
+#endif
+
+#endif
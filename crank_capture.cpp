@@ -0,0 +1,242 @@
+#include "crank_capture.h"
+
+#include <SD.h>
+
+#include "common.h"
+#include "display.h"
+
+#include "crank.h"
+extern Crank *mycrank;
+
+/// @defgroup capture Crank Capture
+/// These functions record the crank's raw input so it can be replayed on a computer.
+///
+/// While recording, every raw optical edge (before debouncing), encoder position change, gear-crank
+/// ADC average and buzz knob change is timestamped into a RAM buffer.  Nothing touches the SD card
+/// until the recording is saved, so recording doesn't disturb play.  Saved captures go in
+/// CRANK_CAPTURE_DIR as text, one event per line:
+///
+///     # kind=optical edges_per_rev=80 spokes=80 noise=0 firmware=3.0.0
+///     K 0 512
+///     E 1520
+///     E 14210
+///
+/// `tools/crank_replay.cpp` replays captures through the same estimators GurdyCrank and GearCrank use.
+/// `tools/trace_cols.cpp` packs them, with any traces, into one file for statistics over a whole gig.
+/// @version *New in 3.1.0*
+/// @{
+
+#ifdef CRANK_CAPTURE
+
+struct CaptureEvent {
+  uint32_t time;
+  int32_t value;
+  char kind;
+};
+
+// This is big, so it goes in the Teensy 4.1's second RAM bank.
+DMAMEM static CaptureEvent capture_buf[CRANK_CAPTURE_EVENTS];
+static volatile int capture_len = 0;
+static uint32_t capture_start = 0;
+
+// Encoder and knob readings are only recorded when they change.
+static int32_t last_count = 0;
+static int32_t last_knob = 0;
+static bool have_count = false;
+static bool have_knob = false;
+
+volatile bool crank_capturing = false;
+
+/// @brief Records an optical edge.  Safe to call from the crank interrupt.
+/// @param time The edge's micros()
+void crank_capture_edge(uint32_t time) {
+  int len = capture_len;
+
+  if (len >= CRANK_CAPTURE_EVENTS) {
+    crank_capturing = false;
+    return;
+  };
+
+  capture_buf[len].time = time;
+  capture_buf[len].value = 0;
+  capture_buf[len].kind = CAPTURE_EDGE;
+  capture_len = len + 1;
+};
+
+/// @brief Records a crank reading from loop().
+/// @param kind CAPTURE_COUNT, CAPTURE_ADC or CAPTURE_KNOB
+/// @param time The reading's micros()
+/// @param value The reading
+void crank_capture_event(char kind, uint32_t time, int32_t value) {
+  if (kind == CAPTURE_COUNT) {
+    if (have_count && value == last_count) {
+      return;
+    };
+    last_count = value;
+    have_count = true;
+
+  } else if (kind == CAPTURE_KNOB) {
+    if (have_knob && value == last_knob) {
+      return;
+    };
+    last_knob = value;
+    have_knob = true;
+  };
+
+  // The crank interrupt also writes to the buffer.
+  noInterrupts();
+  int len = capture_len;
+  if (len < CRANK_CAPTURE_EVENTS) {
+    capture_buf[len].time = time;
+    capture_buf[len].value = value;
+    capture_buf[len].kind = kind;
+    capture_len = len + 1;
+  } else {
+    crank_capturing = false;
+  };
+  interrupts();
+};
+
+/// @brief Throws away any previous recording and starts a new one.
+void crank_capture_start() {
+  crank_capturing = false;
+  capture_len = 0;
+  have_count = false;
+  have_knob = false;
+  capture_start = micros();
+  crank_capturing = true;
+};
+
+/// @brief Stops recording.  The recording is kept until the next crank_capture_start().
+void crank_capture_stop() {
+  crank_capturing = false;
+};
+
+/// @brief Returns the number of events recorded.
+int crank_capture_count() {
+  return capture_len;
+};
+
+/// @brief Returns whether the recording filled the buffer and stopped itself.
+bool crank_capture_full() {
+  return capture_len >= CRANK_CAPTURE_EVENTS;
+};
+
+/// @brief Saves the recording to the next free file name in CRANK_CAPTURE_DIR.
+/// @param path Set to the saved file's path
+/// @return True if saved, false if there is no card or the card is full.
+bool crank_capture_save(String *path) {
+  crank_capturing = false;
+
+  if (!SD.begin(BUILTIN_SDCARD)) {
+    return false;
+  };
+
+  if (!SD.exists(CRANK_CAPTURE_DIR)) {
+    SD.mkdir(CRANK_CAPTURE_DIR);
+  };
+
+  int num = 0;
+  char name[48];
+  do {
+    snprintf(name, sizeof(name), "%s/crank%03d.txt", CRANK_CAPTURE_DIR, num);
+    num++;
+  } while (SD.exists(name) && num < 1000);
+
+  File f = SD.open(name, FILE_WRITE);
+  if (!f) {
+    return false;
+  };
+
+  char line[64];
+  int len;
+
+  #if defined(USE_GEARED_CRANK)
+  len = snprintf(line, sizeof(line), "# kind=gear noise=%d firmware=%s\n", mycrank->getNoise(), VERSION.c_str());
+  #elif defined(USE_ENCODER)
+  len = snprintf(line, sizeof(line), "# kind=encoder edges_per_rev=%d spokes=%d firmware=%s\n",
+                 NUM_SPOKES * 2, NUM_SPOKES, VERSION.c_str());
+  #else
+  len = snprintf(line, sizeof(line), "# kind=optical edges_per_rev=%d spokes=%d firmware=%s\n",
+                 NUM_SPOKES, NUM_SPOKES, VERSION.c_str());
+  #endif
+  f.write((const uint8_t *)line, len);
+
+  // Batch the lines up so the card sees whole blocks.
+  char block[512];
+  int used = 0;
+
+  for (int x = 0; x < capture_len; x++) {
+    CaptureEvent *e = &capture_buf[x];
+    uint32_t t = e->time - capture_start;
+
+    if (e->kind == CAPTURE_EDGE) {
+      len = snprintf(line, sizeof(line), "%c %lu\n", e->kind, (unsigned long)t);
+    } else {
+      len = snprintf(line, sizeof(line), "%c %lu %ld\n", e->kind, (unsigned long)t, (long)e->value);
+    };
+
+    if (used + len > (int)sizeof(block)) {
+      f.write((const uint8_t *)block, used);
+      used = 0;
+    };
+    memcpy(block + used, line, len);
+    used += len;
+  };
+  f.write((const uint8_t *)block, used);
+  f.close();
+
+  *path = String(name);
+  return true;
+};
+
+/// @brief Prompts the user to start, stop and save crank recordings.
+/// @return True if recording was started (so the menus should close and play resume), false otherwise.
+bool crank_capture_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    String title = String("Crank Capture: ") + crank_capture_count();
+    String opt1 = crank_capturing ? "Stop Recording" : "Start Recording";
+    String opt2 = crank_capture_count() > 0 ? "Save to SD Card" : "";
+
+    print_menu_2(title, opt1, opt2);
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      if (crank_capturing) {
+        crank_capture_stop();
+      } else {
+        crank_capture_start();
+        print_message_2("Crank Capture", "Recording started,", "crank away!");
+        delay(1000);
+        return true;
+      };
+
+    } else if (my2Button->wasPressed() && crank_capture_count() > 0) {
+      print_message_2("Crank Capture", "Saving to SD card,", "Please wait...");
+
+      String path;
+      if (crank_capture_save(&path)) {
+        print_message_2("Crank Capture", "Saved as:", path);
+      } else {
+        print_message_2("Crank Capture", "Could not save,", "check the SD card.");
+      };
+      delay(2000);
+
+    } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
+      done = true;
+    };
+  };
+  return false;
+};
+
+#endif
+
+/// @}
@@ -0,0 +1,27 @@
+#ifndef CRANK_CAPTURE_H
+#define CRANK_CAPTURE_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// The kinds of crank capture events.  These are also the first letter of each line in a capture file.
+const char CAPTURE_EDGE = 'E';    // An optical sensor rising edge, before debouncing
+const char CAPTURE_COUNT = 'C';   // A new encoder position
+const char CAPTURE_ADC = 'A';     // A gear crank update's averaged ADC reading
+const char CAPTURE_KNOB = 'K';    // A new buzz knob reading
+
+extern volatile bool crank_capturing;
+
+void crank_capture_edge(uint32_t time);
+void crank_capture_event(char kind, uint32_t time, int32_t value);
+
+void crank_capture_start();
+void crank_capture_stop();
+int crank_capture_count();
+bool crank_capture_full();
+bool crank_capture_save(String *path);
+
+bool crank_capture_screen();
+
+#endif
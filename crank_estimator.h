@@ -0,0 +1,336 @@
+#ifndef CRANK_ESTIMATOR_H
+#define CRANK_ESTIMATOR_H
+
+// The crank estimators: the math that turns raw crank input (optical edges, encoder counts or
+// gear-crank voltage) into speed, spinning/buzzing and expression, and the event stage every crank shares.
+// GurdyCrank and GearCrank do the hardware side and hand their readings to these (see CrankBase).  This header is plain C++ with no Arduino
+// dependencies so the host tools in tools/ can replay recorded crank sessions through exactly the
+// same code.
+//
+// Times are in microseconds, speeds in the crank's (estimated) RPM.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// The tuning values of the optical/encoder estimators.  On the gurdy these come from config.h;
+// CRANK_ESTIMATOR_DEFAULTS is a copy of config.h's defaults for the host tools.
+struct CrankEstimatorParams {
+  // Optical (CRANK_EVAL_US etc. in config.h)
+  uint32_t eval_us;         // Estimate the speed this often, if there were at least two edges
+  uint32_t decay_us;        // Decay the speed this often if there weren't
+  float rise_factor;        // How much of a speed increase to take at once
+  float rise_bias;          // Extra RPM added on every increase
+  float fall_factor;        // How much of a speed decrease to take at once
+  float decay_factor;       // The speed is multiplied by this when decaying
+
+  // Encoder (ENCODER_EVAL_US etc.)
+  uint32_t enc_eval_us;
+  uint32_t enc_decay_us;
+  float enc_factor;
+
+  // Both (V_THRESHOLD, EXPRESSION_VMAX and EXPRESSION_START in config.h)
+  float v_threshold;
+  float expression_vmax;
+  int expression_start;
+};
+
+const CrankEstimatorParams CRANK_ESTIMATOR_DEFAULTS = {
+  25250, 31250, 0.8, 0.5, 0.75, 0.5,
+  10000, 30000, 0.8,
+  2.0, 5.0, 30
+};
+
+// The tuning values of the gear-crank estimator.  These match the gear group in config.h.
+struct GearEstimatorParams {
+  int vol_threshold;
+  int max_spin;
+  int spin_weight;
+  int spin_decay;
+  int spin_threshold;
+  int spin_stop_threshold;
+  int buzz_smoothing;
+  int buzz_decay;
+};
+
+const GearEstimatorParams GEAR_ESTIMATOR_DEFAULTS = {5, 7600, 2500, 200, 5001, 1000, 250, 1};
+
+// Buzzing must last at least this long (ms) before it can stop.
+const uint32_t CRANK_BUZZ_MIN_MS = 50;
+
+// How often (ms) expression is recalculated.
+const uint32_t CRANK_EXPRESSION_MS = 50;
+
+/// @brief The buzzing speed threshold for a buzz knob reading (0-1023).
+inline float crank_buzz_threshold(float knob_voltage) {
+  if (knob_voltage > 1000) {
+    return 240;
+  }
+  return 30 + (knob_voltage / 6.5);
+}
+
+/// @brief The string expression (MIDI CC11) for a crank speed.
+inline int crank_expression(double v, const CrankEstimatorParams &p) {
+  if (v > p.expression_vmax) {
+    v = p.expression_vmax;
+  } else if (v < p.v_threshold) {
+    v = p.v_threshold;
+  }
+  return int(((v - p.v_threshold) / (p.expression_vmax - p.v_threshold)) * (127 - p.expression_start) + p.expression_start);
+}
+
+/// @brief The 14-bit string expression (MIDI CC11 MSB and CC43 LSB, 0-16383) for a crank speed.
+/// @details The same curve as crank_expression(): the top seven bits are the 7-bit value, give or take one.
+inline int crank_expression14(double v, const CrankEstimatorParams &p) {
+  if (v > p.expression_vmax) {
+    v = p.expression_vmax;
+  } else if (v < p.v_threshold) {
+    v = p.v_threshold;
+  }
+  int start = p.expression_start << 7;
+  return int(((v - p.v_threshold) / (p.expression_vmax - p.v_threshold)) * (16383 - start) + start);
+}
+
+// What crank_expression14_send() decided to send.
+enum CrankExpressionSend {
+  CRANK_EXPR14_NONE = 0,   // Nothing: the receiver is already within the deadband
+  CRANK_EXPR14_MSB,        // CC11 only, which also resets the receiver's LSB to 0
+  CRANK_EXPR14_LSB         // CC43 only
+};
+
+/// @brief Decides which half of a new 14-bit expression to send, if either.
+/// @param value The new expression
+/// @param sent The expression the receiver has now (see crank_expression14_sent()), -1 if none
+/// @param deadband The smallest change (out of 16383) worth sending
+/// @details At most one CC is sent per update, so 14-bit expression never sends faster than 7-bit does.  A new
+/// MSB goes first; the LSB follows on the next update if it's still needed.  A change smaller than the deadband
+/// isn't sent, so a steady crank's jitter costs nothing, except to reach either end of the range.
+inline int crank_expression14_send(int value, int sent, int deadband, const CrankEstimatorParams &p) {
+  if (sent < 0 || (value >> 7) != (sent >> 7)) {
+    return CRANK_EXPR14_MSB;
+  }
+  if (value == sent) {
+    return CRANK_EXPR14_NONE;
+  }
+  bool at_end = (value == 16383 || value == (p.expression_start << 7));
+  if (abs(value - sent) < deadband && !at_end) {
+    return CRANK_EXPR14_NONE;
+  }
+  return CRANK_EXPR14_LSB;
+}
+
+/// @brief The expression the receiver has after crank_expression14_send() chose send for value.
+inline int crank_expression14_sent(int value, int sent, int send) {
+  if (send == CRANK_EXPR14_MSB) {
+    return value & ~0x7F;
+  } else if (send == CRANK_EXPR14_LSB) {
+    return value;
+  }
+  return sent;
+}
+
+/// @brief The buzz expression (MIDI CC11) for a crank speed and buzz threshold.
+inline int crank_buzz_expression(double v, float threshold) {
+  int e = int(((v - threshold) / (0.45 * threshold)) * (42) + 85);
+  return (e > 127) ? 127 : e;
+}
+
+inline bool crank_is_spinning(double v, const CrankEstimatorParams &p) {
+  return v > p.v_threshold;
+}
+
+inline bool crank_buzz_on(double v, float threshold) {
+  return v > threshold;
+}
+
+inline bool crank_buzz_off(double v, float threshold) {
+  return v <= threshold * 0.95;
+}
+
+// The event stage.  An estimator says whether the crank is spinning and whether it's fast (or slow) enough to
+// start (or stop) buzzing; this turns that into the started/stopped events loop() acts on.  Each event is
+// reported once, the first time it's asked for after it happens, so a change made while loop() was busy with
+// something else isn't lost.  Buzzing lasts at least CRANK_BUZZ_MIN_MS.
+class CrankEvents {
+  public:
+    bool was_spinning = false;
+    bool was_buzzing = false;
+    uint32_t buzz_start_ms = 0;
+
+    bool startedSpinning(bool spinning) {
+      if (spinning && !was_spinning) {
+        was_spinning = true;
+        return true;
+      }
+      return false;
+    }
+
+    bool stoppedSpinning(bool spinning) {
+      if (!spinning && was_spinning) {
+        was_spinning = false;
+        return true;
+      }
+      return false;
+    }
+
+    /// @param buzz_on The crank is fast enough to buzz
+    /// @param now_ms The time in milliseconds
+    bool startedBuzzing(bool buzz_on, uint32_t now_ms) {
+      if (buzz_on && !was_buzzing) {
+        was_buzzing = true;
+        buzz_start_ms = now_ms;
+        return true;
+      }
+      return false;
+    }
+
+    /// @param buzz_off The crank is slow enough to stop buzzing
+    /// @param now_ms The time in milliseconds
+    bool stoppedBuzzing(bool buzz_off, uint32_t now_ms) {
+      if (buzz_off && was_buzzing && now_ms - buzz_start_ms > CRANK_BUZZ_MIN_MS) {
+        was_buzzing = false;
+        return true;
+      }
+      return false;
+    }
+};
+
+// Optical crank.  The interrupt counts debounced rising edges and times the latest one.
+class OpticalEstimator {
+  public:
+    CrankEstimatorParams p;
+    double cur_vel;
+
+    OpticalEstimator(const CrankEstimatorParams &params) : p(params), cur_vel(0.0) {}
+
+    /// @brief Updates the speed from the interrupt's counts.
+    /// @param since_eval Time since the last estimate
+    /// @param num_events Edges counted since the last estimate
+    /// @param last_event Time of the latest edge, measured from the last estimate
+    /// @param num_spokes NUM_SPOKES
+    /// @return True if an estimate was made: the caller then restarts its timers and counts.
+    bool update(uint32_t since_eval, int num_events, uint32_t last_event, int num_spokes) {
+      if (since_eval > p.eval_us && num_events > 1) {
+        double new_vel = (num_events * (1.0 / (num_spokes * 2.0)) * 60000000.0) / (last_event);
+        if (new_vel > cur_vel) {
+          cur_vel = cur_vel + (p.rise_factor * (new_vel - cur_vel)) + p.rise_bias;
+        } else {
+          cur_vel = cur_vel + (p.fall_factor * (new_vel - cur_vel));
+        }
+        return true;
+      }
+      if (since_eval > p.decay_us && num_events < 2) {
+        cur_vel = cur_vel * p.decay_factor;
+        return true;
+      }
+      return false;
+    }
+};
+
+enum {
+  CRANK_EST_NONE = 0,      // Nothing happened
+  CRANK_EST_SAMPLED = 1,   // The speed was estimated: restart the eval and last-change timers
+  CRANK_EST_DECAYED = 2,   // The speed decayed: restart the eval timer, skip expression this pass
+};
+
+// Encoder crank.  The encoder library keeps a running position count.
+class EncoderEstimator {
+  public:
+    CrankEstimatorParams p;
+    double cur_vel;
+    long last_pulse;
+
+    EncoderEstimator(const CrankEstimatorParams &params) : p(params), cur_vel(0.0), last_pulse(0) {}
+
+    /// @brief Updates the speed from the encoder position.
+    /// @param since_eval Time since the last estimate
+    /// @param pulse The encoder position
+    /// @param since_change Time since the position last changed (as of the last estimate)
+    /// @param num_spokes NUM_SPOKES
+    /// @return One of CRANK_EST_NONE, CRANK_EST_SAMPLED or CRANK_EST_DECAYED
+    int update(uint32_t since_eval, long pulse, uint32_t since_change, int num_spokes) {
+      if (since_eval > p.enc_decay_us) {
+        cur_vel = cur_vel / 2.0;
+        return CRANK_EST_DECAYED;
+      }
+      if (since_eval > p.enc_eval_us && last_pulse != pulse) {
+        double new_vel = (labs(last_pulse - pulse) * 30000000.0) / (num_spokes * (double)since_change);
+        cur_vel = cur_vel + (p.enc_factor * (new_vel - cur_vel));
+        last_pulse = pulse;
+        return CRANK_EST_SAMPLED;
+      }
+      return CRANK_EST_NONE;
+    }
+};
+
+// Gear-motor crank.  The crank voltage is averaged over many ADC readings every update, and two
+// weighted counters ("spin" and the buzz countdown) smooth out the motor's stepped output.  The started/stopped
+// events come from CrankEvents, as for the other cranks.
+class GearEstimator {
+  public:
+    GearEstimatorParams p;
+    int crank_voltage;
+    int smoothed_voltage;
+    int spin;
+    int buzz_countdown;
+
+    bool is_spinning;
+    bool is_buzzing;
+
+    GearEstimator(const GearEstimatorParams &params) : p(params) {
+      crank_voltage = 0;
+      smoothed_voltage = 0;
+      spin = 0;
+      buzz_countdown = p.buzz_smoothing;
+      is_spinning = false;
+      is_buzzing = false;
+    }
+
+    /// @brief Updates buzzing from the knob and the latest crank voltage.
+    void updateBuzz(float knob_voltage) {
+      if (crank_voltage > knob_voltage) {
+        buzz_countdown = p.buzz_smoothing;
+      } else if (buzz_countdown > 0) {
+        buzz_countdown -= p.buzz_decay;
+      }
+
+      is_buzzing = (buzz_countdown > 0);
+    }
+
+    /// @brief Updates spinning from a new averaged ADC reading.
+    /// @param adc_avg The average of this update's ADC readings
+    /// @param noise The average reading from crank detection, subtracted as noise
+    void update(int adc_avg, int noise) {
+      smoothed_voltage = (adc_avg + crank_voltage) / 2;
+      crank_voltage = smoothed_voltage - noise;
+
+      if (crank_voltage > p.vol_threshold) {
+        spin += p.spin_weight;
+        if (spin > p.max_spin) {
+          spin = p.max_spin;
+        }
+      } else {
+        spin -= p.spin_decay;
+        if (spin < 0) {
+          spin = 0;
+        }
+      }
+
+      if (spin > p.spin_threshold) {
+        is_spinning = true;
+      } else if (spin < p.spin_stop_threshold) {
+        is_spinning = false;
+      }
+    }
+
+    /// @brief Acts like a crank that never gets spun (no crank detected).
+    void clearSpin() {
+      is_spinning = false;
+    }
+
+    /// @brief Never buzzes (no crank detected).
+    void clearBuzz() {
+      is_buzzing = false;
+    }
+};
+
+#endif
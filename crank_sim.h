@@ -0,0 +1,148 @@
+#ifndef CRANK_SIM_H
+#define CRANK_SIM_H
+
+// Synthetic crank input.  A CrankSim turns a CrankProfile (an RPM-over-time curve) into the same
+// edge stream an optical sensor or encoder would produce, so crank code can be fed identical,
+// repeatable input.  This header is plain C++ with no Arduino dependencies: the gurdy uses it when
+// CRANK_SIM is enabled, and the host tools in tools/ use it directly.
+//
+// Times are in microseconds.  An "edge" is one counted event: a rising edge for the optical
+// sensor (NUM_SPOKES per revolution) or one count for an encoder (2 * NUM_SPOKES per revolution).
+
+#include <stdint.h>
+#include <math.h>
+
+enum CrankProfileType {
+  CRANK_STEADY = 0,      // rpm the whole time
+  CRANK_RAMP = 1,        // rpm to rpm2, linearly, over period_us, then holds rpm2
+  CRANK_COUPS = 2,       // rpm with a short surge to rpm2 at the start of every period_us
+  CRANK_STOP_START = 3,  // rpm for the first half of every period_us, stopped for the second
+};
+
+const int CRANK_NUM_PROFILES = 4;
+
+struct CrankProfile {
+  CrankProfileType type;
+  float rpm;
+  float rpm2;
+  uint32_t period_us;
+  float jitter;          // Random speed wobble, as a fraction of the speed (0 = none)
+  uint32_t seed;         // Jitter seed, so a jittery run is still repeatable
+};
+
+/// @brief Returns a short name for a profile type.
+inline const char *crank_profile_name(int type) {
+  static const char *names[CRANK_NUM_PROFILES] = {"steady", "ramp", "coups", "stop-start"};
+  return (type >= 0 && type < CRANK_NUM_PROFILES) ? names[type] : "?";
+}
+
+// The coups surge lasts this fraction of the period, rising and falling as a raised cosine.
+const float CRANK_COUP_WIDTH = 0.3;
+
+class CrankSim {
+  private:
+    CrankProfile profile;
+    int edges_per_rev;
+
+    uint32_t start_time;
+    uint32_t last_time;
+    double phase;         // In edges, the integer part has been emitted
+    long edges;
+    uint32_t rng;
+
+    float nextJitter() {
+      // 32-bit LCG (Numerical Recipes).  Not good randomness, but identical everywhere.
+      rng = rng * 1664525UL + 1013904223UL;
+      return ((rng >> 8) / 8388608.0f - 1.0f) * profile.jitter;
+    }
+
+  public:
+    CrankSim(const CrankProfile &p, int edges_per_revolution, uint32_t t0) {
+      profile = p;
+      edges_per_rev = edges_per_revolution;
+      reset(t0);
+    }
+
+    /// @brief Restarts the profile from the beginning at time t0.
+    void reset(uint32_t t0) {
+      start_time = t0;
+      last_time = t0;
+      phase = 0.0;
+      edges = 0;
+      rng = profile.seed;
+    }
+
+    /// @brief The profile's (jitter-free) speed at time t.
+    float rpmAt(uint32_t t) const {
+      uint32_t elapsed = t - start_time;
+      float period = (profile.period_us > 0) ? profile.period_us : 1;
+
+      switch (profile.type) {
+        case CRANK_RAMP:
+          if (elapsed >= profile.period_us) {
+            return profile.rpm2;
+          }
+          return profile.rpm + (profile.rpm2 - profile.rpm) * (elapsed / period);
+
+        case CRANK_COUPS: {
+          float pos = fmodf(elapsed, period) / period;
+          if (pos >= CRANK_COUP_WIDTH) {
+            return profile.rpm;
+          }
+          float surge = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * pos / CRANK_COUP_WIDTH);
+          return profile.rpm + (profile.rpm2 - profile.rpm) * surge;
+        }
+
+        case CRANK_STOP_START:
+          return (fmodf(elapsed, period) < period / 2.0f) ? profile.rpm : 0.0f;
+
+        default:
+          return profile.rpm;
+      }
+    }
+
+    /// @brief Runs the crank forward to time t.
+    /// @param t The new time, not earlier than the last one
+    /// @param edge_times If not null, filled with the time of each new edge
+    /// @param max_edges The size of edge_times
+    /// @return The number of new edges.  Any beyond max_edges are counted but their times dropped.
+    int advance(uint32_t t, uint32_t *edge_times, int max_edges) {
+      uint32_t dt = t - last_time;
+      if (dt == 0) {
+        return 0;
+      }
+
+      float rpm = rpmAt(last_time + dt / 2);
+      if (profile.jitter > 0.0f && rpm > 0.0f) {
+        rpm *= 1.0f + nextJitter();
+      }
+
+      // Edges per microsecond at this speed, assumed constant over the step.
+      double rate = rpm * edges_per_rev / 60000000.0;
+      double new_phase = phase + rate * dt;
+
+      int count = 0;
+      for (long e = (long)phase + 1; e <= (long)new_phase; e++) {
+        if (edge_times != 0 && count < max_edges) {
+          edge_times[count] = last_time + (uint32_t)((e - phase) / rate);
+        }
+        count++;
+      }
+
+      phase = new_phase;
+      edges += count;
+      last_time = t;
+      return count;
+    }
+
+    /// @brief The total edges so far, i.e. what an encoder's read() would return.
+    long position() const {
+      return edges;
+    }
+
+    const CrankProfile &getProfile() const {
+      return profile;
+    }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef CRANKBASE_H
+#define CRANKBASE_H
+
+#include <Arduino.h>
+
+#include "buzzknob.h"
+#include "config.h"
+#include "crank_estimator.h"
+#include "simpleled.h"
+#include "trace.h"
+
+/// @brief What every crank does the same way: the buzz knob, the buzz LED and the spinning/buzzing events.
+/// @details A crank is split in two.  The crank type (GurdyCrank for optical and encoder cranks, GearCrank for
+/// gear-motor cranks) does the acquisition: it reads its sensor and the buzz knob and runs its estimator from
+/// crank_estimator.h.  CrankBase does the rest, for every crank type alike: it turns what the estimator says
+/// into the started/stopped events loop() acts on (see CrankEvents) and lights the buzz LED.
+///
+/// A crank type derives from CrankBase<itself> and provides:
+/// * `void acquire()`, which reads the crank and runs the estimator (the body of update()),
+/// * `bool spinning()`, whether the estimator says the crank is spinning, and
+/// * `bool buzzOn()` and `bool buzzOff()`, whether it's fast enough to start or slow enough to stop buzzing.
+///
+/// These are called directly rather than through virtual methods, since they run every loop().  A crank type
+/// that can tell whether it's connected hides detect() and isDetected() with its own.  crank.h names the
+/// configured crank type Crank.
+/// @version *New in 3.1.0*
+template <class Source>
+class CrankBase {
+  private:
+    CrankEvents events;
+
+    Source *source() {
+      return static_cast<Source *>(this);
+    };
+
+  protected:
+    BuzzKnob* myKnob;
+
+    #ifdef LED_KNOB
+      SimpleLED* myLED = nullptr;
+    #endif
+
+    /// @param buzz_pin The pin of the buzz knob.
+    /// @param led_pin The pin of the LED indicator, -1 if the crank type has none.
+    CrankBase(int buzz_pin, int led_pin) {
+      myKnob = new BuzzKnob(buzz_pin);
+
+      #ifdef LED_KNOB
+        if (led_pin >= 0) {
+          myLED = new SimpleLED(led_pin);
+        };
+      #endif
+    };
+
+  public:
+    /// @brief Samples the crank and updates its state.
+    /// @details This should be run every loop().  It paces itself internally and expects to be run frequently.
+    void update() {
+      TRACE_SCOPE(TRACE_CRANK);
+      source()->acquire();
+    };
+
+    /// @brief Checks whether a crank is connected.  Only gear-motor cranks can tell.
+    void detect() {};
+
+    /// @brief Reports if a crank is connected.
+    /// @return True, unless the crank type can tell it isn't.
+    bool isDetected() {
+      return true;
+    };
+
+    /// @brief Reports whether the crank is currently spinning this update() cycle.
+    /// @return True if crank is spinning, false otherwise.
+    bool isSpinning() {
+      return source()->spinning();
+    };
+
+    /// @brief Reports whether the crank started spinning.
+    /// @return True the first time this is asked after spinning started, false otherwise
+    bool startedSpinning() {
+      return events.startedSpinning(source()->spinning());
+    };
+
+    /// @brief Reports whether the crank stopped spinning.
+    /// @return True the first time this is asked after spinning stopped, false otherwise
+    bool stoppedSpinning() {
+      return events.stoppedSpinning(source()->spinning());
+    };
+
+    /// @brief Reports whether buzzing began.
+    /// @return True the first time this is asked after buzzing started, false otherwise.
+    bool startedBuzzing() {
+      if (!events.startedBuzzing(source()->buzzOn(), millis())) {
+        return false;
+      };
+
+      #ifdef LED_KNOB
+        if (myLED) {
+          myLED->on();
+        };
+      #endif
+
+      return true;
+    };
+
+    /// @brief Reports whether buzzing stopped.  Buzzing lasts at least CRANK_BUZZ_MIN_MS.
+    /// @return True the first time this is asked after buzzing stopped, false otherwise.
+    bool stoppedBuzzing() {
+      if (!events.stoppedBuzzing(source()->buzzOff(), millis())) {
+        return false;
+      };
+
+      #ifdef LED_KNOB
+        if (myLED) {
+          myLED->off();
+        };
+      #endif
+
+      return true;
+    };
+
+    /// @brief Reports whether the buzz is currently on.
+    /// @return True if buzzing, false otherwise.
+    bool isBuzzing() {
+      return events.was_buzzing;
+    };
+
+    /// @brief Enables the buzz LED indicator object.
+    /// @note This does nothing if LED_KNOB is not defined or the crank type has no LED.
+    void enableLED() {
+      #ifdef LED_KNOB
+        if (myLED) {
+          myLED->enable();
+        };
+      #endif
+    };
+
+    /// @brief Disables the buzz LED indicator object.
+    /// @note This does nothing if LED_KNOB is not defined or the crank type has no LED.
+    void disableLED() {
+      #ifdef LED_KNOB
+        if (myLED) {
+          myLED->disable();
+        };
+      #endif
+    };
+};
+
+#endif
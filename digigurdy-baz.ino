@@ -16,11 +16,7 @@
 #include "common.h"
 #include "usb_power.h"
 
-#ifdef USE_GEARED_CRANK
-  #include "gearcrank.h"
-#else
-  #include "gurdycrank.h"
-#endif
+#include "crank.h"
 
 #include "hurdygurdy.h"
 #include "vibknob.h"
@@ -31,9 +27,20 @@
 #include "play_screens.h"    // The screens mid-play (notes and staffs)
 #include "pause_screens.h"   // The pause screen menus
 
+#include "sysex_config.h"    // SysEx configuration dump/load
+#include "idle.h"            // Sleeping while the gurdy sits still
+#include "trace.h"           // Timeline tracing
+#include "traffic.h"         // MIDI/Trigger traffic counters
+#include "live_status.h"     // The live status screen
+#include "macros.h"          // EX button macros
+#include "mpe.h"             // MPE output mode
+#include "sinks.h"           // Output link gating
+#include "midi_in.h"         // Playing incoming MIDI
+
 // As far as I can tell, this *has* to be done here or else you get spooooky runtime problems.
 //MIDI_CREATE_DEFAULT_INSTANCE();
-MIDI_CREATE_INSTANCE(HardwareSerial, Serial1, MIDI);
+// With USE_OUTPUT_GATING, MIDI_PORT is Serial1 behind a GatedSerial (see sinks.h).
+MIDI_CREATE_INSTANCE(MidiPort, MIDI_PORT, MIDI);
 
 #ifdef USE_TRIGGER
   wavTrigger  trigger_obj;
@@ -43,6 +50,10 @@ MIDI_CREATE_INSTANCE(HardwareSerial, Serial1, MIDI);
   Tsunami trigger_obj;
 #endif
 
+#ifdef USE_TSUNAMI_MIDI
+  TsunamiMidiEncoder tsunami_midi;
+#endif
+
 //
 // GLOBAL OBJECTS/VARIABLES
 //
@@ -54,10 +65,9 @@ ADC* adc;
 HurdyGurdy *mygurdy;
 ExButton *bigButton;
 
-#ifdef USE_GEARED_CRANK
-  GearCrank *mycrank;
-#else
-  GurdyCrank *mycrank;
+Crank *mycrank;
+
+#ifndef USE_GEARED_CRANK
   volatile int num_events = 0;
   volatile int last_event = 0;
   elapsedMicros last_event_timer;
@@ -88,7 +98,8 @@ KeyboxButton *myBButton;
 // They are differentiated in the main loop():
 // * A melody string is one that changes with the keybox offset.
 // * A drone/trompette is one that doesn't change.
-// * The keyclick "string" is just a drone that comes on and off at particular times.
+// * The keyclick "string" is just a drone that comes on and off at particular times.  It's a one-shot
+//   (see GurdyString::setOneShot()): each click plays once and ends by itself.
 // * The buzz "string" is also just a drone that comes on/off at other particular times.
 GurdyString *mystring;
 GurdyString *mylowstring;
@@ -179,6 +190,12 @@ void setup() {
   if (EEPROM.read(EEPROM_SEC_OUT) != 1) {
     MIDI.begin(MIDI_CHANNEL_OMNI);
     MIDI.setInputChannel(MIDI_CHANNEL_OMNI);
+
+    #ifdef USE_MIDI_IN
+    // Incoming notes on MIDI_IN_CHANNELS are played by the strings, which send them on themselves.  loop()
+    // passes everything else on by hand in place of the library's thru.
+    MIDI.turnThruOff();
+    #endif
   }
   
   #if defined(USE_TRIGGER)
@@ -206,6 +223,11 @@ void setup() {
       trigger_obj.stopAllTracks();
       trigger_obj.samplerateOffset(1, 0);
     };
+
+    #ifdef USE_TSUNAMI_MIDI
+      // Play on the Tsunami's MIDI input, on TSUNAMI_OUT's channel.
+      tsunami_midi.begin(TSUNAMI_OUT);
+    #endif
   #endif
 
   // Initialize the ADC object and the crank that will use it.
@@ -237,6 +259,11 @@ void setup() {
     myvibknob = new VibKnob(PEDAL_PIN);
   #endif
 
+  // Index the SD card tuning library once, so browsing it later never scans the card.
+  #ifdef USE_SD_TUNINGS
+    sd_tunings_begin();
+  #endif
+
   // The keybox arrangement is decided by pin_array, which is up in the CONFIG SECTION
   // of this file.  Make adjustments there.
   mygurdy = new HurdyGurdy(pin_array, num_keys);
@@ -281,6 +308,7 @@ void setup() {
   mydrone = new GurdyString(4, Note(c2), "Drone", EEPROM.read(EEPROM_SEC_OUT));
   mybuzz = new GurdyString(5,Note(c3), "Buzz", EEPROM.read(EEPROM_SEC_OUT));
   mykeyclick = new GurdyString(6, Note(b5), "Key Click", EEPROM.read(EEPROM_SEC_OUT));
+  mykeyclick->setOneShot(true);
 
   if (EEPROM.read(EEPROM_SEC_OUT) > 0) {
     mystring->setTrackLoops();
@@ -380,6 +408,16 @@ void loop() {
 
     mel_vibrato = EEPROM.read(EEPROM_MEL_VIBRATO);
 
+    #ifdef USE_MPE
+    if (EEPROM.read(EEPROM_MPE) == 1) {
+      mpe_start();
+    };
+    #endif
+
+    #ifdef USE_LEGATO
+    set_legato(EEPROM.read(EEPROM_LEGATO));
+    #endif
+
     // LED may have been reset, too... thanks John!
     if (EEPROM.read(EEPROM_BUZZ_LED) == 1) {
       #ifdef LED_KNOB
@@ -397,6 +435,10 @@ void loop() {
     first_loop = false;
   };
 
+  #ifdef USE_TRACE
+  trace_loop_begin();
+  #endif
+
   // Update the keys, buttons, and crank status (which includes the buzz knob)
   myoffset = mygurdy->getMaxOffset();  // This covers the keybox buttons.
   mycrank->update();
@@ -554,6 +596,20 @@ void loop() {
 
   };
 
+  #ifdef USE_MACROS
+  // Run a few steps of any running macro.  Its auto-crank changes work like the auto-crank buttons.
+  macro_update(mycrank->isSpinning() || autocrank_toggle_on);
+
+  int macro_crank = macro_take_crank();
+  if (macro_crank >= 0 && macro_crank != autocrank_toggle_on) {
+    autocrank_toggle_on = macro_crank;
+    if (autocrank_toggle_on) {
+      any_newly_pressed = true;
+    } else {
+      any_newly_released = true;
+    };
+  };
+  #endif
 
   // Run EX functions (other than open-pause-menu and auto-crank)
   #ifndef USE_GEARED_CRANK
@@ -591,6 +647,7 @@ void loop() {
       mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
       mytromp->soundOn(tpose_offset + capo_offset);
       mydrone->soundOn(tpose_offset + capo_offset);
+      idle_note_started();
       draw_play_screen(mystring->getOpenNote() + tpose_offset + myoffset, play_screen_type, false);
 
     } else if (mycrank->startedSpinning() && !autocrank_toggle_on) {
@@ -598,18 +655,14 @@ void loop() {
       mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
       mytromp->soundOn(tpose_offset + capo_offset);
       mydrone->soundOn(tpose_offset + capo_offset);
+      idle_note_started();
       draw_play_screen(mystring->getOpenNote() + tpose_offset + myoffset, play_screen_type, false);
 
-    // Turn off the previous notes and turn on the new one with a click if new key this cycle.
+    // Turn off the previous notes and turn on the new one with a click if new key this cycle (or glide/slur to it,
+    // see key_change()).
     // NOTE: I'm not touching the drone/trompette.  Just leave it on if it's a key change.
     } else if (mygurdy->higherKeyPressed() || mygurdy->lowerKeyPressed()) {
-      mystring->soundOff();
-      mylowstring->soundOff();
-      mykeyclick->soundOff();
-
-      mystring->soundOn(myoffset + tpose_offset, mel_vibrato);
-      mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
-      mykeyclick->soundOn(tpose_offset);
+      key_change();
       draw_play_screen(mystring->getOpenNote() + tpose_offset + myoffset, play_screen_type, false);
     };
 
@@ -653,22 +706,43 @@ void loop() {
     };
   };
 
-  // Apparently we need to do this to discard incoming data.
-  if (EEPROM.read(EEPROM_SEC_OUT) != 1) {
-    while (MIDI.read()) {
-        Serial.print("Read MIDI message: ");
-        Serial.print(MIDI.getData1());
+  {
+    TRACE_SCOPE(TRACE_MIDI_DRAIN);
+
+    #ifdef USE_MIDI_IN
+    midi_in_pass_begin();
+    #endif
+
+    // Apparently we need to do this to discard incoming data.  With USE_MIDI_IN, notes and CCs on
+    // MIDI_IN_CHANNELS are played instead, a few each pass so they never hold up live playing.
+    if (EEPROM.read(EEPROM_SEC_OUT) != 1) {
+      while (MIDI_IN_ROOM() && MIDI.read()) {
+        if (!MIDI_IN_PLAY(MIDI.getType(), MIDI.getChannel(), MIDI.getData1(), MIDI.getData2())) {
+          #ifdef USE_MIDI_IN
+          MIDI.send(MIDI.getType(), MIDI.getData1(), MIDI.getData2(), MIDI.getChannel());
+          #endif
+          Serial.print("Read MIDI message: ");
+          Serial.print(MIDI.getData1());
+          Serial.print(" ");
+          Serial.println(MIDI.getData2());
+        };
+      };
+    };
+
+    while (MIDI_IN_ROOM() && usbMIDI.read()) {
+      if (usbMIDI.getType() == usbMIDI.SystemExclusive) {
+        sysex_receive(usbMIDI.getSysExArray(), usbMIDI.getSysExArrayLength());
+      } else if (!MIDI_IN_PLAY(usbMIDI.getType(), usbMIDI.getChannel(), usbMIDI.getData1(), usbMIDI.getData2())) {
+        Serial.print("Read USB MIDI message: ");
+        Serial.print(usbMIDI.getData1());
         Serial.print(" ");
-        Serial.println(MIDI.getData2());
+        Serial.println(usbMIDI.getData2());
       };
+    };
   };
 
-  while (usbMIDI.read()) {
-    Serial.print("Read USB MIDI message: ");
-    Serial.print(usbMIDI.getData1());
-    Serial.print(" ");
-    Serial.println(usbMIDI.getData2());
-  };
+  // Send or save one chunk of any SysEx configuration transfer.
+  sysex_update();
 
   // My dev output stuff.
   test_count +=1;
@@ -678,8 +752,13 @@ void loop() {
      Serial.print(millis() - start_time);
      Serial.print(" milliseconds. ");
      Serial.print(500000/(millis() - start_time));
+     #ifdef USE_GEARED_CRANK
+     Serial.print("kHz.  Cur Spin: ");
+     Serial.println(mycrank->getSpin());
+     #else
      Serial.print("kHz.  Cur Velocity: ");
      Serial.println(mycrank->getVAvg());
+     #endif
      // Serial.print("ms.  Avg Velocity: ");
      // Serial.print(mycrank->getVAvg());
      // Serial.print("rpm. Transitions: ");
@@ -693,4 +772,37 @@ void loop() {
 //     #endif
   }
 
+  // End the key click's MIDI note once it's had its length.
+  mykeyclick->update();
+
+  #ifdef USE_MPE
+  mpe_update();
+  #endif
+
+  #ifdef USE_OUTPUT_GATING
+  sink_update();
+  #endif
+
+  #ifdef USE_TSUNAMI_MIDI
+  // Menus, EX functions and the link checks may have sent the Tsunami serial commands this pass, which end
+  // MIDI running status.
+  tsunami_midi.breakStatus();
+  #endif
+
+  #ifdef USE_TRACE
+  trace_loop_end();
+  #endif
+
+  #ifdef USE_TRAFFIC_STATS
+  traffic_loop_end();
+  #endif
+
+  #ifdef USE_LIVE_STATUS
+  live_status_update();
+  #endif
+
+  // Once nothing is playing and the display has settled, sleep until the next interrupt.  Not while the
+  // live status screen is up: it draws a little every loop(), and sleeping would skew its loop timing.
+  idle_update(note_display_off && !autocrank_toggle_on && !mycrank->isSpinning() && !sysex_busy() && !live_status_on);
+
 };
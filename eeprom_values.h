@@ -100,5 +100,21 @@ static const int EEPROM_EX8_SLOT = 135;
 static const int EEPROM_EX9_SLOT = 136;
 static const int EEPROM_EX10_SLOT = 137;
 static const int EEPROM_EXBB_SLOT = 138;
+// The EX button macros: MACRO_SLOTS programs of MACRO_SIZE bytes each, one after the other
+// (see macro_vm.h).  An EX button set to Run Macro keeps the macro number in its _SLOT value.
+static const int EEPROM_MACROS = 139;
+// This int saves the MPE output choice.
+// 0 = Normal channel-per-string MIDI (default)
+// 1 = MPE
+static const int EEPROM_MPE = 331;
+// This int saves the legato key change choice (see LegatoMode in gurdystring.h).
+// 0 = Off, every note is struck again (default)
+// 1 = Pitch bend glide
+// 2 = Mono legato (overlapping notes)
+static const int EEPROM_LEGATO = 332;
+
+// The whole configuration is the EEPROM from address 0 up to (not including) this one.  This is
+// what a SysEx dump/load transfers (see sysex_config.cpp), so move it up when adding values above.
+static const int EEPROM_CONFIG_LEN = 333;
 
 #endif
@@ -25,48 +25,22 @@ void ExButton::setFunc(int func) {
   my_func = func;
 };
 
+/// @brief Re-reads the button's function, transpose steps and slot from EEPROM.
+/// @details Used after the EEPROM has been rewritten from outside the menus, e.g. by a SysEx load.
+void ExButton::reload() {
+  my_func = EEPROM.read(eeprom_addr);
+  slot = EEPROM.read(eeprom_slot_addr);
+  t_toggle_steps = EEPROM.read(eeprom_step_addr) - 12;
+};
+
 /// @brief Execute the button's configured fucntion
+/// @details See ex_run_func() for the numbering of the functions.
 void ExButton::doFunc(bool playing) {
 
   Serial.print("I was clicked for function: ");
   Serial.println(printFunc());
 
-  if (my_func == 1) {
-    return;
-  } else if (my_func == 2) {
-    cycle_mel_mute();
-  } else if (my_func == 3) {
-    cycle_drone_tromp_mute();
-  } else if (my_func == 4) {
-    cycle_drone_mute();
-  } else if (my_func == 5) {
-    cycle_tromp_mute();
-  } else if (my_func == 6) {
-    turn_volume_down();
-  } else if (my_func == 7) {
-    turn_volume_up();
-  } else if (my_func == 8) {
-    ex_tpose_down(playing);
-  } else if (my_func == 9) {
-    ex_tpose_up(playing);
-  } else if (my_func == 10) {
-    ex_cycle_capo(playing);
-  } else if (my_func == 11) {
-    return;
-  } else if (my_func == 12) {
-    ex_tpose_toggle(playing, t_toggle_steps);
-  } else if (my_func == 13) {
-    ex_sec_out_toggle();
-  } else if (my_func == 14) {
-    ex_cycle_hi_mel_mute();
-  } else if (my_func == 15) {
-    ex_cycle_lo_mel_mute();
-  } else if (my_func == 16) {
-    ex_load_preset(slot);
-  } else if (my_func == 17) {
-    ex_load_save_slot(slot);
-  };
-  return;
+  ex_run_func(my_func, playing, t_toggle_steps, slot);
 };
 
 /// @brief Returns a short text label of the button's function.
@@ -106,6 +80,8 @@ String ExButton::printFunc() {
     return String("Load Preset ") + slot;
   } else if (my_func == 17) {
     return String("Load Save Slot ") + slot;
+  } else if (my_func == 18) {
+    return String("Run Macro ") + slot;
   };
 
   return String("FIX ME!!!");
@@ -166,12 +142,18 @@ bool ExButton::fn_choice_actions() {
   bool done = false;
   while (!done) {
 
-    print_menu_2("Ex Button Actions", "Open Pause Menu", "Auto-Crank");
+    String opt3 = "This Option Disabled";
+    #ifdef USE_MACROS
+    opt3 = "Run Macro";
+    #endif
+
+    print_menu_3("Ex Button Actions", "Open Pause Menu", "Auto-Crank", opt3);
     delay(150);
 
     my1Button->update();
     my2Button->update();
     my3Button->update();
+    my4Button->update();
     myXButton->update();
 
     if (my1Button->wasPressed()) {
@@ -184,7 +166,12 @@ bool ExButton::fn_choice_actions() {
       EEPROM.write(eeprom_addr,11);
       done = true;
 
-    } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
+    #ifdef USE_MACROS
+    } else if (my3Button->wasPressed()) {
+      done = fn_choice_macro();
+    #endif
+
+    } else if (my4Button->wasPressed() || myXButton->wasPressed()) {
       return false;
 
     };
@@ -193,6 +180,60 @@ bool ExButton::fn_choice_actions() {
   return true;
 };
 
+/// @brief Prompt user to select the macro an EX button runs.
+/// @return True if user chose an option, false if user chose "go back" option
+/// @version *New in 3.1.0*
+bool ExButton::fn_choice_macro() {
+
+  bool done = false;
+  while (!done) {
+
+    print_menu_6("Ex Button Macro", "Macro 1", "Macro 2", "Macro 3", "Macro 4", "Macro 5", "Macro 6");
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    my4Button->update();
+    my5Button->update();
+    my6Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      slot = 1;
+      done = true;
+
+    } else if (my2Button->wasPressed()) {
+      slot = 2;
+      done = true;
+
+    } else if (my3Button->wasPressed()) {
+      slot = 3;
+      done = true;
+
+    } else if (my4Button->wasPressed()) {
+      slot = 4;
+      done = true;
+
+    } else if (my5Button->wasPressed()) {
+      slot = 5;
+      done = true;
+
+    } else if (my6Button->wasPressed()) {
+      slot = 6;
+      done = true;
+
+    } else if (myXButton->wasPressed()) {
+      return false;
+    };
+  };
+
+  setFunc(18);
+  EEPROM.write(eeprom_addr, 18);
+  EEPROM.write(eeprom_slot_addr, slot);
+  return true;
+};
+
 /// @brief Prompt user to select an EX button string mute function.
 /// @return True if user chose an option, false if user chose "go back" option
 /// @version *New in 2.9.8*
@@ -27,6 +27,8 @@ class ExButton: public ToggleButton {
 
     void setFunc(int func);
 
+    void reload();
+
     void doFunc(bool playing);
 
     String printFunc();
@@ -34,6 +36,7 @@ class ExButton: public ToggleButton {
     bool fn_choice_screen();
 
     bool fn_choice_actions();
+    bool fn_choice_macro();
     bool fn_choice_mutes();
     bool fn_choice_tpose();
     bool fn_choice_audio();
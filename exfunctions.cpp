@@ -426,4 +426,95 @@ void ex_load_save_slot(int save_slot) {
 
 };
 
+/// @brief Mutes exactly the given strings and unmutes the rest, applying immediately if playing.
+/// @param mask Bits of the strings to mute: 1 = high melody, 2 = low melody, 4 = drone, 8 = trompette and buzz
+/// @details The mute cycles (cycle_mel_mute() etc.) carry on from the new mutes.
+/// @version *New in 3.1.0*
+void ex_set_mutes(int mask) {
+  bool hi = mask & 1;
+  bool lo = mask & 2;
+  bool drone = mask & 4;
+  bool tromp = mask & 8;
+
+  // The cycles' numbering: see cycle_mel_mute() and cycle_drone_tromp_mute().
+  mel_mode = (!hi && !lo) ? 0 : (!hi) ? 1 : (!lo) ? 2 : 3;
+  drone_mode = (!drone && !tromp) ? 0 : (drone && tromp) ? 1 : (!drone) ? 2 : 3;
+  h_mode = hi;
+  l_mode = lo;
+  t_mode = tromp;
+
+  GurdyString *strings[5] = {mystring, mylowstring, mydrone, mytromp, mybuzz};
+  bool mutes[5] = {hi, lo, drone, tromp, tromp};
+  for (int x = 0; x < 5; x++) {
+    if (strings[x]->getMute() != mutes[x]) {
+      strings[x]->setMute(mutes[x]);
+      if (strings[x]->isPlaying()) {
+        strings[x]->soundOff();
+        strings[x]->soundOn();
+      };
+    };
+  };
+
+  if (mystring->isPlaying()) {
+    draw_play_screen(mystring->getOpenNote() + tpose_offset + myoffset, play_screen_type, false);
+  } else {
+    print_display(mystring->getOpenNote(), mylowstring->getOpenNote(), mydrone->getOpenNote(), mytromp->getOpenNote(), tpose_offset, capo_offset, myoffset, mystring->getMute(), mylowstring->getMute(), mydrone->getMute(), mytromp->getMute());
+  };
+};
+
+/// @brief Runs one of the EX button functions.
+/// @param func The function:
+/// * 1 = Open the pause menu and 11 = Auto-crank.  These are handled in loop(), so do nothing here.
+/// * 2 = cycle_mel_mute(), 3 = cycle_drone_tromp_mute(), 4 = cycle_drone_mute(), 5 = cycle_tromp_mute()
+/// * 6 = turn_volume_down(), 7 = turn_volume_up()
+/// * 8 = ex_tpose_down(), 9 = ex_tpose_up(), 10 = ex_cycle_capo(), 12 = ex_tpose_toggle()
+/// * 13 = ex_sec_out_toggle(), 14 = ex_cycle_hi_mel_mute(), 15 = ex_cycle_lo_mel_mute()
+/// * 16 = ex_load_preset(), 17 = ex_load_save_slot()
+/// * 18 = Run an EX button macro (macro_start())
+/// @param playing True if currently playing sound, false otherwise.
+/// @param steps The transpose steps, for function 12
+/// @param slot The preset, save slot or macro number, for functions 16-18
+/// @version *New in 3.1.0*
+void ex_run_func(int func, bool playing, int steps, int slot) {
+  if (func == 1) {
+    return;
+  } else if (func == 2) {
+    cycle_mel_mute();
+  } else if (func == 3) {
+    cycle_drone_tromp_mute();
+  } else if (func == 4) {
+    cycle_drone_mute();
+  } else if (func == 5) {
+    cycle_tromp_mute();
+  } else if (func == 6) {
+    turn_volume_down();
+  } else if (func == 7) {
+    turn_volume_up();
+  } else if (func == 8) {
+    ex_tpose_down(playing);
+  } else if (func == 9) {
+    ex_tpose_up(playing);
+  } else if (func == 10) {
+    ex_cycle_capo(playing);
+  } else if (func == 11) {
+    return;
+  } else if (func == 12) {
+    ex_tpose_toggle(playing, steps);
+  } else if (func == 13) {
+    ex_sec_out_toggle();
+  } else if (func == 14) {
+    ex_cycle_hi_mel_mute();
+  } else if (func == 15) {
+    ex_cycle_lo_mel_mute();
+  } else if (func == 16) {
+    ex_load_preset(slot);
+  } else if (func == 17) {
+    ex_load_save_slot(slot);
+  } else if (func == 18) {
+    #ifdef USE_MACROS
+    macro_start(slot);
+    #endif
+  };
+};
+
 /// @}
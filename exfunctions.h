@@ -7,6 +7,7 @@
 #include "common.h"
 #include "usb_power.h"
 #include "bitmaps.h"
+#include "macros.h"
 
 void cycle_mel_mute();
 void cycle_drone_tromp_mute();
@@ -23,5 +24,7 @@ void ex_cycle_hi_mel_mute();
 void ex_cycle_lo_mel_mute();
 void ex_load_preset(int preset_slot);
 void ex_load_save_slot(int save_slot);
+void ex_set_mutes(int mask);
+void ex_run_func(int func, bool playing, int steps, int slot);
 
 #endif
@@ -3,24 +3,17 @@
 /// @brief GearCrank controls the cranking mechanism on geared-crank gurdies.
 /// @param v_pin The analog pin connected to the crank
 /// @param buzz_pin The analog pin of the buzz knob potentiometer
+/// @details This does the acquisition for gear-motor cranks; the events and buzz knob are CrankBase's.  There's
+/// no buzz LED.
 /// @warning A BuzzKnob object using buzz_pin is a hidden private member object of GearCrank.
-GearCrank::GearCrank(int v_pin, int buzz_pin) {
-
-  myKnob = new BuzzKnob(buzz_pin);
+GearCrank::GearCrank(int v_pin, int buzz_pin) : CrankBase<GearCrank>(buzz_pin, -1) {
 
   voltage_pin = v_pin;
   pinMode(voltage_pin, INPUT);
 
-  crank_voltage = 0;
-  spin = 0;
-  started_spinning = false;
-  stopped_spinning = false;
-  is_spinning = false;
-
-  started_buzzing = false;
-  stopped_buzzing = false;
-  is_buzzing = false;
-  buzz_countdown = BUZZ_SMOOTHING;
+  GearEstimatorParams params = {VOL_THRESHOLD, MAX_SPIN, SPIN_WEIGHT, SPIN_DECAY, SPIN_THRESHOLD,
+                                SPIN_STOP_THRESHOLD, BUZZ_SMOOTHING, BUZZ_DECAY};
+  est = new GearEstimator(params);
 };
 
 /// @brief Begins ADC sampling of the crank's voltage pin.
@@ -81,52 +74,13 @@ void GearCrank::refreshBuzz() {
     // readings, average that, and then use that.  Even smooth, the motors most digigurdies use
     // are indexed and don't generate consistent voltage.  So we employ two weighted counters
     // that increase rapidly if voltage is high and then decrese more slowly, and use *those*
-    // to actually determine whether or not to make cranking/buzzing sound.
-    if (crank_voltage > myKnob->getVoltage()) {
-      buzz_countdown = BUZZ_SMOOTHING;
-    } else if (buzz_countdown > 0) {
-      buzz_countdown -= BUZZ_DECAY;
-    };
-
-    if (buzz_countdown > 0) {
-
-      // If we weren't buzzing before this, we just started.
-      if (!is_buzzing) {
-        started_buzzing = true;
-      };
-
-      // If we were already buzzing and started_buzzing last cycle,
-      // we didn't just start buzzing anymore.
-      if (started_buzzing && is_buzzing) {
-        started_buzzing = false;
-      };
-
-      // Now that we checked, we can update this...
-      is_buzzing = true;
-
-    } else {
-
-      // If we were buzzing before, we just stopped.
-      if (is_buzzing) {
-        stopped_buzzing = true;
-      };
-
-      // If we stopped buzzing last cycle, we didn't just stop
-      // anymore.
-      if (stopped_buzzing && !is_buzzing) {
-        stopped_buzzing = false;
-      };
-
-      // Now that we're done checking if we *were* buzzing, we can set this.
-      is_buzzing = false;
-    };
+    // to actually determine whether or not to make cranking/buzzing sound.  See GearEstimator.
+    est->updateBuzz(myKnob->getVoltage());
 
   // If the crank isn't *connected*, the pin will report phantom buzzing,
   // so if the crank isn't *detected*, don't buzz at all:
   } else {
-    started_buzzing = false;
-    is_buzzing = false;
-    stopped_buzzing = false;
+    est->clearBuzz();
   };
 };
 
@@ -134,8 +88,8 @@ void GearCrank::refreshBuzz() {
 /// @details * Actually takes several hundred rapid continuous readings, averages this, and then averages that with the previous reading.
 /// * Also subtracts the average voltage detected during crank detection as a form of noise reduction.
 /// * Also calls refreshBuzz() internally.
-/// * This is intended to be run every loop() cycle.
-void GearCrank::update() {
+/// * CrankBase::update() calls this every loop() cycle.
+void GearCrank::acquire() {
   if (isDetected()) {
     // Update the knob first.
     myKnob->update();
@@ -152,103 +106,69 @@ void GearCrank::update() {
     Serial.print("Sampled: ");
     Serial.print((sample_total / SPIN_SAMPLES));
 
-    // The voltage reading we're using is the average of those.
-    crank_voltage = ((sample_total / SPIN_SAMPLES) + (crank_voltage)) / 2;
+    #ifdef CRANK_CAPTURE
+    if (crank_capturing) {
+      crank_capture_event(CAPTURE_KNOB, micros(), myKnob->getVoltage());
+      crank_capture_event(CAPTURE_ADC, micros(), sample_total / SPIN_SAMPLES);
+    };
+    #endif
+
+    // The voltage reading we're using is the average of those, averaged with the last one and
+    // less the detected "noise".  Based on that voltage, the spin counter either gets bumped up
+    // by the SPIN_WEIGHT or decays, and spinning is decided from the spin.
+    est->update(sample_total / SPIN_SAMPLES, int(sample_mean));
     sample_total = 0;
 
     Serial.print(" Smoothed: ");
-    Serial.print(crank_voltage);
-
-    // From the crank detection, we're subtracting the detected "noise" here.
-    crank_voltage = crank_voltage - int(sample_mean);
+    Serial.print(est->smoothed_voltage);
 
     Serial.print(" Adjusted: ");
-    Serial.print(crank_voltage);
+    Serial.print(est->crank_voltage);
 
     Serial.print("  Buzz: ");
     Serial.println(myKnob->getVoltage());
 
-    // Based on that voltage, we either bump up the spin by the SPIN_WEIGHT,
-    // or we let it decay.
-    if (crank_voltage > VOL_THRESHOLD) {
-      spin += SPIN_WEIGHT;
-      if (spin > MAX_SPIN) {
-        spin = MAX_SPIN;
-      };
-    } else {
-      spin -= SPIN_DECAY;
-      if (spin < 0) {
-        spin = 0;
-      };
-    };
-
-    // The crank is considered spinning if the spin is over SPIN_THRESHOLD.
-    if (spin > SPIN_THRESHOLD) {
-
-      // If we weren't spinning before this, we just started.
-      if (!is_spinning) {
-        started_spinning = true;
-      };
-
-      // If we were already spinning and started_spinning last cycle,
-      // we didn't just start spinning anymore.
-      if (started_spinning && is_spinning) {
-        started_spinning = false;
-      };
-
-      // Now that we checked, we can update this...
-      is_spinning = true;
-
-    } else if (spin < SPIN_STOP_THRESHOLD) {
-
-      // If we were spinning before, we just stopped.
-      if (is_spinning) {
-        stopped_spinning = true;
-      };
-
-      // If we stopped spinning last cycle, we didn't just stop
-      // anymore.
-      if (stopped_spinning && !is_spinning) {
-        stopped_spinning = false;
-      };
-
-      is_spinning = false;
-    };
-
   // If the crank wasn't detected, it acts like a crank that never gets spun.
   } else {
-    is_spinning = false;
-    started_spinning = false;
-    stopped_spinning = false;
+    est->clearSpin();
   };
 };
 
-/// @brief Reports if spinning has started this update() cycle.
-/// @return True if the crank began spinning this cycle, false otherwise.
-bool GearCrank::startedSpinning() {
-  return started_spinning;
+/// @brief Reports if the estimator has the crank spinning.  CrankBase uses this for its events.
+/// @version *New in 3.1.0*
+bool GearCrank::spinning() {
+  return est->is_spinning;
+};
+
+/// @brief Reports if the crank is fast enough to buzz, for the buzz knob.
+/// @version *New in 3.1.0*
+bool GearCrank::buzzOn() {
+  return est->is_buzzing;
 };
 
-/// @brief Reports if spinning has sotpped this update() cycle.
-/// @return True if the crank stopped spinning this cycle, false otherwise.
-bool GearCrank::stoppedSpinning() {
-  return stopped_spinning;
+/// @brief Reports if the crank is too slow to buzz, for the buzz knob.
+/// @version *New in 3.1.0*
+bool GearCrank::buzzOff() {
+  return !est->is_buzzing;
 };
 
-/// @brief Reports if spinning is happening.
-/// @return True if the crank is spinning (whether or not it started this cycle), false otherwise.
-bool GearCrank::isSpinning() {
-  return is_spinning;
+/// @brief Returns the average crank voltage measured by detect(), which update() treats as noise.
+/// @return The noise voltage, 0 = 0V, 1023 = 3.3V
+/// @version *New in 3.1.0*
+int GearCrank::getNoise() {
+  return int(sample_mean);
 };
 
-/// @brief Reports if buzzing has begun.
-/// @return True if buzzing started this cycle, false otherwise.
-bool GearCrank::startedBuzzing() {
-  return started_buzzing;
+/// @brief Returns the smoothed crank voltage update() last read.
+/// @return The voltage, 0 = 0V, 1023 = 3.3V
+/// @version *New in 3.1.0*
+int GearCrank::getVoltage() {
+  return est->smoothed_voltage;
 };
 
-/// @brief Reports if buzzing has stopped.
-/// @return True if buzzing stopped this cycle, false otherwise.
-bool GearCrank::stoppedBuzzing() {
-  return stopped_buzzing;
+/// @brief Returns the estimator's spin, which rises with the crank voltage and decays without it.
+/// @return The spin, 0 to MAX_SPIN
+/// @version *New in 3.1.0*
+int GearCrank::getSpin() {
+  return est->spin;
 };
@@ -3,12 +3,16 @@
 
 #include <ADC.h>
 
-#include "buzzknob.h"
 #include "config.h"
+#include "crankbase.h"
+#include "crank_estimator.h"
+#include "crank_capture.h"
 
 extern ADC* adc;
 
-class GearCrank {
+class GearCrank : public CrankBase<GearCrank> {
+  friend class CrankBase<GearCrank>;
+
   private:
     int voltage_pin;
     static const int num_samples = 500;  // This number is from the original code
@@ -18,19 +22,14 @@ class GearCrank {
     float squared_sum;
     float deviations;
 
-    int crank_voltage;
-
     long int sample_total;
-    int spin;
-    bool started_spinning;
-    bool stopped_spinning;
-    bool is_spinning;
 
-    BuzzKnob* myKnob;
-    bool started_buzzing;
-    bool stopped_buzzing;
-    bool is_buzzing;
-    int buzz_countdown;
+    GearEstimator* est;
+
+    void acquire();
+    bool spinning();
+    bool buzzOn();
+    bool buzzOff();
 
   public:
     GearCrank(int v_pin, int buzz_pin);
@@ -38,12 +37,9 @@ class GearCrank {
     void detect();
     bool isDetected();
     void refreshBuzz();
-    void update();
-    bool startedSpinning();
-    bool stoppedSpinning();
-    bool isSpinning();
-    bool startedBuzzing();
-    bool stoppedBuzzing();
+    int getNoise();
+    int getVoltage();
+    int getSpin();
 };
 
 #endif
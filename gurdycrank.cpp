@@ -1,6 +1,16 @@
 #include "gurdycrank.h"
 
+#include "idle.h"
+
 void myisr() {
+  idle_input_edge();
+
+  #ifdef CRANK_CAPTURE
+  if (crank_capturing) {
+    crank_capture_edge(micros());
+  };
+  #endif
+
   if (debounce_timer >= 1250) {
     num_events = num_events + 1;
     last_event = last_event_timer;
@@ -8,8 +18,38 @@ void myisr() {
   } 
 }
 
+/// @brief Returns the estimator settings, with the values that live in config.h filled in.
+static CrankEstimatorParams crank_params() {
+  CrankEstimatorParams params;
+  params.eval_us = CRANK_EVAL_US;
+  params.decay_us = CRANK_DECAY_US;
+  params.rise_factor = CRANK_RISE_FACTOR;
+  params.rise_bias = CRANK_RISE_BIAS;
+  params.fall_factor = CRANK_FALL_FACTOR;
+  params.decay_factor = CRANK_DECAY_FACTOR;
+  params.enc_eval_us = ENCODER_EVAL_US;
+  params.enc_decay_us = ENCODER_DECAY_US;
+  params.enc_factor = ENCODER_FACTOR;
+  params.v_threshold = V_THRESHOLD;
+  params.expression_vmax = EXPRESSION_VMAX;
+  params.expression_start = EXPRESSION_START;
+  return params;
+};
+
+/// @brief Makes the estimator for the crank this build is for (USE_ENCODER or optical).
+#ifdef USE_ENCODER
+static EncoderEstimator *new_estimator() {
+  return new EncoderEstimator(crank_params());
+};
+#else
+static OpticalEstimator *new_estimator() {
+  return new OpticalEstimator(crank_params());
+};
+#endif
+
 /// @brief Constructor.
-/// @details This class abstracts the cranking mechanism on Digi-Gurdies.
+/// @details This class abstracts the cranking mechanism on Digi-Gurdies.  It does the acquisition for optical
+/// and encoder cranks; the events, buzz knob and LED are CrankBase's.
 /// 
 /// If you are not using an LED buzz indicator, a pin for it still needs to be specified here.  The object won't touch it unless LED_KNOB is defined.
 /// @warning This is for optical-sensor cranks.  See GearCrank for a gear-motor crank version.
@@ -20,21 +60,21 @@ void myisr() {
 /// @param s_pin The digital pin coming from the optical sensor.
 /// @param buzz_pin The pin of the buzz knob.
 /// @param led_pin The pin of the LED indicator.
-GurdyCrank::GurdyCrank(int s_pin, int buzz_pin, int led_pin) {
-
-  myKnob = new BuzzKnob(buzz_pin);
-
-  #ifdef LED_KNOB
-    myLED = new SimpleLED(led_pin);
-  #endif
+GurdyCrank::GurdyCrank(int s_pin, int buzz_pin, int led_pin) : CrankBase<GurdyCrank>(buzz_pin, led_pin),
+  est(new_estimator()) {
 
   sensor_pin = s_pin;
+
+  #ifdef CRANK_SIM
+  startSim();
+  #else
   pinMode(sensor_pin, INPUT_PULLUP);
   attachInterrupt(digitalPinToInterrupt(sensor_pin), myisr, RISING);
+  #endif
 
   expression = 0;
+  expression14 = -1;
   buzz_expression = 0;
-  the_buzz_timer = 0;
 };
 
 /// @brief Constructor (2-pin encoders).
@@ -43,92 +83,81 @@ GurdyCrank::GurdyCrank(int s_pin, int buzz_pin, int led_pin) {
 /// @param buzz_pin The pin of the buzz knob.
 /// @param led_pin The pin of the LED indicator.
 /// @version *New in 2.9.5*
-GurdyCrank::GurdyCrank(int s_pin, int s_pin2, int buzz_pin, int led_pin) {
-
-  myKnob = new BuzzKnob(buzz_pin);
-
-  #ifdef LED_KNOB
-    myLED = new SimpleLED(led_pin);
-  #endif
+GurdyCrank::GurdyCrank(int s_pin, int s_pin2, int buzz_pin, int led_pin) : CrankBase<GurdyCrank>(buzz_pin, led_pin),
+  est(new_estimator()) {
 
   #ifdef USE_ENCODER
   // This automatically enabled INPUT_PULLUP, FYI.
   myEnc = new Encoder(s_pin2, s_pin);
   last_event_timer = 0;
+  #endif
 
-  last_pulse = 0;
+  #ifdef CRANK_SIM
+  startSim();
   #endif
 
   expression = 0;
+  expression14 = -1;
   buzz_expression = 0;
-  the_buzz_timer = 0;
 };
 
-/// @brief Reports if a crank is connected.
-/// @return True
-/// @note Currently this method is pointless.  Gear-motor cranks do use this, however, and this is being kept for future changes.
-/// It may be useful to expect any crank object to be able to report this in-code whether or not it's relevant...
-bool GurdyCrank::isDetected() {
-  return true;
+/// @brief Samples the crank and updates its state.  CrankBase::update() calls this.
+/// @details Also updates the buzz knob, and calls updateExpression().
+void GurdyCrank::acquire() {
+  #ifdef CRANK_SIM
+  feedSim();
+  uint32_t start_cycles = ARM_DWT_CYCCNT;
+  estimate();
+  reportSim(ARM_DWT_CYCCNT - start_cycles);
+  #else
+  estimate();
+  #endif
 };
 
-/// @brief Samples the crank and updates its state
-/// @details Also updates the buzz knob, and calls updateExpression().
-/// This should be run every loop().  It paces itself internally and expects to be run frequently.
-void GurdyCrank::update() {
+/// @brief Turns the latest crank input into a velocity estimate.  This is the body of acquire().
+/// @details The math itself is in crank_estimator.h, shared with the host tools.
+void GurdyCrank::estimate() {
 
   // Check if we need to update the knob reading...
   myKnob->update();
 
+  #ifdef CRANK_CAPTURE
+  if (crank_capturing) {
+    crank_capture_event(CAPTURE_KNOB, micros(), myKnob->getVoltage());
+  };
+  #endif
+
   #ifdef USE_ENCODER
 
+  #ifdef CRANK_SIM
+  pulse = sim->position();
+  #else
+  pulse = myEnc->read();
+  #endif
 
-  if (eval_timer > 30000) {
-    cur_vel = (cur_vel) / 2.0;
+  #ifdef CRANK_CAPTURE
+  if (crank_capturing) {
+    crank_capture_event(CAPTURE_COUNT, micros(), pulse);
+  };
+  #endif
+
+  int result = est->update(eval_timer, pulse, last_event_timer, NUM_SPOKES);
+
+  if (result == CRANK_EST_DECAYED) {
     eval_timer = 0;
     return;
+  } else if (result == CRANK_EST_SAMPLED) {
+    last_event_timer = 0;
+    eval_timer = 0;
   };
-  
-  if (eval_timer > 10000) {
-    pulse = myEnc->read();
-
-    if (last_pulse != pulse) {
-      
-      new_vel = (abs(last_pulse - pulse) * 30000000.0) / (NUM_SPOKES * last_event_timer);
-
-      cur_vel = cur_vel + (0.8 * (new_vel - cur_vel));
-      last_pulse = pulse;
-      last_event_timer = 0;
-      eval_timer = 0;
-    };
-  } 
-  
-  
 
   #else
-  if (eval_timer > 25250 && num_events > 1) {
-    double new_vel = (num_events * spoke_width * 60000000.0) / (last_event);
-//    cur_vel = cur_vel + (smoothing_factor * (new_vel - cur_vel)) + 1;
-    if (new_vel > cur_vel) {
-      cur_vel = cur_vel + (0.8 * (new_vel - cur_vel)) + 0.5;
-    }
-    else {
-      cur_vel = cur_vel + (0.75 * (new_vel - cur_vel));
-    }
+  if (est->update(eval_timer, num_events, last_event, NUM_SPOKES)) {
     num_events = 0;
     last_event = 0;
     last_event_timer = 0;
     eval_timer = 0;
-  }
-  if (eval_timer > 31250 && num_events < 2) {
-//    cur_vel = cur_vel + (smoothing_factor * ( 0 - cur_vel)) - 2;
-    cur_vel = (cur_vel) / 2.0;
-    
-    num_events = 0;
-    last_event = 0;
-    last_event_timer = 0;
-    eval_timer = 0;
-  }
+  };
   #endif
 
   updateExpression();
@@ -138,23 +167,36 @@ void GurdyCrank::update() {
 /// @details * Expression is MIDI CC11 which is usually interpreted as a volume adjustment independent of the channel volume.
 /// * Here expression is calculated based off EXPRESSION_VMAX and EXPRESSION_START along with the current crank velocity.  See config.h for those values.
 /// * The end-user effect is that the volume "swells" as the user cranks faster up to a point.
+/// * With USE_HIRES_EXPRESSION the strings get 14-bit expression (CC11 and CC43), one CC per update: a new
+///   MSB, or else the LSB once it's off by EXPRESSION_HIRES_DEADBAND or more.  The buzz string stays 7-bit.
+/// * With USE_TRIGGER_EXPRESSION the Trigger/Tsunami tracks swell too, as track gain (see
+///   GurdyString::setTriggerExpression()).
 void GurdyCrank::updateExpression() {
   // Only do anything every 50ms (20x/sec)
-  if (the_expression_timer > 50) {
+  if (the_expression_timer > CRANK_EXPRESSION_MS) {
 
     float cur_v = getVAvg();
 
-    int new_buzz_expression = int(((cur_v - myKnob->getThreshold())/(0.45 * myKnob->getThreshold())) * (42) + 85);
-    if (new_buzz_expression > 127) {
-      new_buzz_expression = 127;
+    int new_buzz_expression = crank_buzz_expression(cur_v, myKnob->getThreshold());
+
+    #ifdef USE_HIRES_EXPRESSION
+    int new_expression14 = crank_expression14(cur_v, est->p);
+    if (autocrank_toggle_on) {
+      new_expression14 = 90 << 7;
+    };
+
+    int send = crank_expression14_send(new_expression14, expression14, EXPRESSION_HIRES_DEADBAND, est->p);
+    if (send != CRANK_EXPR14_NONE) {
+      expression14 = crank_expression14_sent(new_expression14, expression14, send);
+      expression = expression14 >> 7;
+      bool msb = (send == CRANK_EXPR14_MSB);
+      mystring->setExpression14(expression14, msb);
+      mylowstring->setExpression14(expression14, msb);
+      mytromp->setExpression14(expression14, msb);
+      mydrone->setExpression14(expression14, msb);
     };
-    
-    if (cur_v > EXPRESSION_VMAX) {
-      cur_v = EXPRESSION_VMAX;
-    } else if (cur_v < V_THRESHOLD) {
-      cur_v = V_THRESHOLD;
-    }
-    int new_expression = int(((cur_v - V_THRESHOLD)/(EXPRESSION_VMAX - V_THRESHOLD)) * (127 - EXPRESSION_START) + EXPRESSION_START);
+    #else
+    int new_expression = crank_expression(cur_v, est->p);
     if (autocrank_toggle_on) {
       new_expression = 90;
     };
@@ -167,110 +209,152 @@ void GurdyCrank::updateExpression() {
       mytromp->setExpression(expression);
       mydrone->setExpression(expression);
     };
+    #endif
 
     if (buzz_expression != new_buzz_expression) {
       buzz_expression = new_buzz_expression;
       mybuzz->setExpression(buzz_expression);
     };
 
+    #ifdef USE_TRIGGER_EXPRESSION
+    // The Trigger/Tsunami tracks follow as track gain.  The strings decide when a change is worth sending, and send
+    // any they held back on a later update, so they get every update.
+    mystring->setTriggerExpression(expression);
+    mylowstring->setTriggerExpression(expression);
+    mytromp->setTriggerExpression(expression);
+    mydrone->setTriggerExpression(expression);
+    mybuzz->setTriggerExpression(buzz_expression);
+    #endif
+
     the_expression_timer = 0;
   };
 };
 
-/// @brief Reports whether the crank started spinning this update() cycle.
-/// @return True if crank started spinning this cycle, false otherwise
-bool GurdyCrank::startedSpinning() {
-  if (isSpinning()) {
-    if (!was_spinning) {
-      was_spinning = true;
-      return true;
-    } else {
-      return false;
-    }
-  } else {
-    return false;
-  }
+/// @brief Reports whether the estimator has the crank spinning.  CrankBase uses this for its events.
+/// @version *New in 3.1.0*
+bool GurdyCrank::spinning() {
+  return crank_is_spinning(est->cur_vel, est->p);
 };
 
-/// @brief Reports whether the crank stopped spinning this update() cycle.
-/// @return True if crank stopped spinning this cycle, false otherwise
-bool GurdyCrank::stoppedSpinning() {
-  if (!isSpinning()) {
-    if (was_spinning) {
-      was_spinning = false;
-      return true;
-    } else {
-      return false;
-    }
-  } else {
-    return false;
-  }
+/// @brief Reports whether the crank is fast enough to start buzzing, for the buzz knob's threshold.
+/// @version *New in 3.1.0*
+bool GurdyCrank::buzzOn() {
+  return crank_buzz_on(getVAvg(), myKnob->getThreshold());
 };
 
-/// @brief Reports whether the crank is currently spinning this update() cycle.
-/// @return True if crank is spinning, false otherwise.
-bool GurdyCrank::isSpinning() {
-  return (cur_vel > V_THRESHOLD);
-};
-
-/// @brief Reports whether buzzing began this update() cycle.
-/// @return True if buzzing started thie cycle, false otherwise.
-bool GurdyCrank::startedBuzzing() {
-  if (getVAvg() > myKnob->getThreshold()) {
-    if (!was_buzzing) {
-      was_buzzing = true;
-      the_buzz_timer = 0;
-
-      #ifdef LED_KNOB
-        myLED->on();
-      #endif
-
-      return true;
-    } else {
-      return false;
-    }
-  } else {
-    return false;
-  }
-};
-
-/// @brief Reports whether buzzing stopped this update() cycle.
-/// @return True if buzzing stopped thie cycle, false otherwise.
-bool GurdyCrank::stoppedBuzzing() {
-  if (getVAvg() <= (myKnob->getThreshold() * 0.95)) {
-    if (was_buzzing && the_buzz_timer > 50) {
-      was_buzzing = false;
-
-      #ifdef LED_KNOB
-        myLED->off();
-      #endif
-
-      return true;
-    } else {
-      return false;
-    }
-  };
-  return false;
+/// @brief Reports whether the crank is slow enough to stop buzzing, for the buzz knob's threshold.
+/// @version *New in 3.1.0*
+bool GurdyCrank::buzzOff() {
+  return crank_buzz_off(getVAvg(), myKnob->getThreshold());
 };
 
 /// @brief Returns the crank's current (heavily-adjusted) velocity.
 /// @return The crank's measured current average velocity in estimated RPMs.
 double GurdyCrank::getVAvg() {
-  return cur_vel;
+  return est->cur_vel;
 };
 
-/// @brief Disables the buzz LED indicator object.
-/// @note This does nothing if LED_KNOB is not defined.
-void GurdyCrank::disableLED() {
-  #ifdef LED_KNOB
-  myLED->disable();
+/// @brief Returns the expression (MIDI CC11) last sent for the crank speed.
+/// @return The expression, 0-127
+/// @version *New in 3.1.0*
+int GurdyCrank::getExpression() {
+  return expression;
+};
+
+#ifdef CRANK_SIM
+
+// The most synthetic edges handled per update().  At the loop's usual rate even a fast encoder
+// produces one or two.
+static const int SIM_MAX_EDGES = 32;
+
+/// @brief Sets up the synthetic crank from the CRANK_SIM_* values in config.h.
+/// @version *New in 3.1.0*
+void GurdyCrank::startSim() {
+  CrankProfile profile;
+  profile.type = (CrankProfileType)CRANK_SIM_PROFILE;
+  profile.rpm = CRANK_SIM_RPM;
+  profile.rpm2 = CRANK_SIM_RPM2;
+  profile.period_us = CRANK_SIM_PERIOD_MS * 1000;
+  profile.jitter = CRANK_SIM_JITTER;
+  profile.seed = 1;
+
+  #ifdef USE_ENCODER
+  sim = new CrankSim(profile, NUM_SPOKES * 2, micros());
+  #else
+  sim = new CrankSim(profile, NUM_SPOKES, micros());
   #endif
+
+  sim_last_edge = micros();
+  sim_cycles = 0;
+  sim_max_cycles = 0;
+  sim_updates = 0;
+  sim_report_timer = 0;
 };
 
-/// @brief Enables the buzz LED indicator object.
-/// @note This does nothing if LED_KNOB is not defined.
-void GurdyCrank::enableLED() {
-  #ifdef LED_KNOB
-  myLED->enable();
+/// @brief Runs the synthetic crank up to now.
+/// @details Encoders just read the synthetic position.  For optical cranks, each synthetic edge goes
+/// through the same debounce and bookkeeping as myisr(), timed as if the interrupt had fired then.
+/// @version *New in 3.1.0*
+void GurdyCrank::feedSim() {
+  uint32_t edge_times[SIM_MAX_EDGES];
+  uint32_t now = micros();
+
+  int count = sim->advance(now, edge_times, SIM_MAX_EDGES);
+
+  #ifndef USE_ENCODER
+  if (count > SIM_MAX_EDGES) {
+    count = SIM_MAX_EDGES;
+  };
+
+  for (int x = 0; x < count; x++) {
+    #ifdef CRANK_CAPTURE
+    if (crank_capturing) {
+      crank_capture_edge(edge_times[x]);
+    };
+    #endif
+
+    if (edge_times[x] - sim_last_edge >= 1250) {
+      uint32_t since_reset = last_event_timer;
+      uint32_t age = now - edge_times[x];
+
+      num_events = num_events + 1;
+      last_event = (age < since_reset) ? since_reset - age : 0;
+      sim_last_edge = edge_times[x];
+    };
+  };
   #endif
 };
+
+/// @brief Tracks the cost of estimate() and periodically prints it with the target and estimated speeds.
+/// @param cycles The CPU cycles the latest estimate() took
+/// @version *New in 3.1.0*
+void GurdyCrank::reportSim(uint32_t cycles) {
+  sim_cycles += cycles;
+  sim_updates++;
+  if (cycles > sim_max_cycles) {
+    sim_max_cycles = cycles;
+  };
+
+  if (sim_report_timer > CRANK_SIM_REPORT_MS) {
+    Serial.print("Crank sim (");
+    Serial.print(crank_profile_name(CRANK_SIM_PROFILE));
+    Serial.print("): target ");
+    Serial.print(sim->rpmAt(micros()));
+    Serial.print("rpm, estimate ");
+    Serial.print(est->cur_vel);
+    Serial.print("rpm, update() avg ");
+    Serial.print(sim_cycles / sim_updates);
+    Serial.print(" / max ");
+    Serial.print(sim_max_cycles);
+    Serial.print(" cycles over ");
+    Serial.print(sim_updates);
+    Serial.println(" calls.");
+
+    sim_cycles = 0;
+    sim_max_cycles = 0;
+    sim_updates = 0;
+    sim_report_timer = 0;
+  };
+};
+
+#endif
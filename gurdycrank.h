@@ -4,9 +4,15 @@
 #include <ADC.h>
 #include <Arduino.h>
 
-#include "buzzknob.h"
 #include "config.h"
-#include "simpleled.h"
+#include "crankbase.h"
+#include "crank_estimator.h"
+#include "crank_capture.h"
+#include "trace.h"
+
+#ifdef CRANK_SIM
+#include "crank_sim.h"
+#endif
 
 #ifdef USE_ENCODER
 #define ENCODER_OPTIMIZE_INTERRUPTS
@@ -18,50 +24,54 @@ extern volatile int last_event;
 extern elapsedMicros last_event_timer;
 extern elapsedMicros debounce_timer;
 
-class GurdyCrank {
+class GurdyCrank : public CrankBase<GurdyCrank> {
+  friend class CrankBase<GurdyCrank>;
+
   private:
     int sensor_pin;
-    double spoke_width = 1.0 / (NUM_SPOKES * 2.0);
-    double cur_vel;
-    bool was_spinning = false;
-    bool was_buzzing = false;
 
     #ifdef USE_ENCODER
     long pulse;
-    long last_pulse;
-    double new_vel;
     Encoder *myEnc;
+    EncoderEstimator *est;
+    #else
+    OpticalEstimator *est;
     #endif
 
     int expression;
+    int expression14;
     int buzz_expression;
 
     elapsedMicros eval_timer;
     elapsedMicros decay_timer;
     elapsedMillis the_expression_timer;
-    elapsedMillis the_buzz_timer;
 
-    BuzzKnob* myKnob;
+    #ifdef CRANK_SIM
+    CrankSim *sim;
+    uint32_t sim_last_edge;
+    uint32_t sim_cycles;
+    uint32_t sim_max_cycles;
+    uint32_t sim_updates;
+    elapsedMillis sim_report_timer;
 
-    #ifdef LED_KNOB
-      SimpleLED* myLED;
+    void startSim();
+    void feedSim();
+    void reportSim(uint32_t cycles);
     #endif
 
+    void acquire();
+    void estimate();
+    bool spinning();
+    bool buzzOn();
+    bool buzzOff();
+
   public:
     GurdyCrank(int s_pin, int buzz_pin, int led_pin);
     GurdyCrank(int s_pin, int s_pin2, int buzz_pin, int led_pin);
 
-    bool isDetected();
-    void update();
     void updateExpression();
-    bool startedSpinning();
-    bool stoppedSpinning();
-    bool isSpinning();
-    bool startedBuzzing();
-    bool stoppedBuzzing();
     double getVAvg();
-    void disableLED();
-    void enableLED();
+    int getExpression();
 };
 
 #endif
@@ -33,8 +33,21 @@ GurdyString::GurdyString(int my_channel, int my_note, String my_name, int my_mod
 /// @param my_modulation The amount of optional modulation (0-127) to apply to the sound.  This is MIDI CC1.  0 == no modulation.
 /// @warning The way this is currently written, only one note may be playing per string object.  Don't call this twice in a row without calling soundOff() first.
 void GurdyString::soundOn(int my_offset, int my_modulation) {
+  TRACE_SCOPE(TRACE_SOUND_ON);
+
+  if (one_shot) {
+    shotOn(open_note + my_offset);
+    return;
+  };
+
   note_being_played = open_note + my_offset;
 
+  // A glide may have left the channel bent.
+  if (legato_steps != 0) {
+    sendPitchBend(8192);
+    legato_steps = 0;
+  };
+
   // If user has one of the second-drone options enabled, trigger them here.
   if (gros_mode == 1) {
     soundOn(0, 0, note_being_played - 5);
@@ -45,40 +58,19 @@ void GurdyString::soundOn(int my_offset, int my_modulation) {
   };
 
   if (!mute_on) {
-
-    usbMIDI.sendNoteOn(note_being_played, midi_volume, midi_channel);
-
-    if (output_mode != 1) {
-      MIDI.sendNoteOn(note_being_played, midi_volume, midi_channel);
-    };
+    sendNoteOn(note_being_played);
 
     if (output_mode > 0) {
-      #if defined(USE_TRIGGER)
-        if (vol_array[note_being_played] != trigger_volume) {
-          trigger_obj.trackGain(note_being_played + (128 * (midi_channel - 1)), trigger_volume);
-          vol_array[note_being_played] = trigger_volume;
-        };
-
-        trigger_obj.trackPlayPoly(note_being_played + (128 * (midi_channel - 1)), true);
-        //trigger_obj.trackLoop(note_being_played + (128 * (midi_channel - 1)), true);
-      #elif defined(USE_TSUNAMI)
-        if (vol_array[note_being_played] != trigger_volume) {
-          trigger_obj.trackGain(note_being_played + (128 * (midi_channel - 1)), trigger_volume);
-          vol_array[note_being_played] = trigger_volume;
-        };
-
-        trigger_obj.trackPlayPoly(note_being_played + (128 * (midi_channel - 1)), TSUNAMI_OUT, true);
-        //trigger_obj.trackLoop(note_being_played + (128 * (midi_channel - 1)), true);
-      #endif
+      triggerPlay(note_being_played);
     };
 
     // If modulation isn't zero, send that as a MIDI CC for this channel
-    // This is meant to be configured to create a gentle vibrato.
+    // This is meant to be configured to create a gentle vibrato.  In MPE mode mpeUpdate() sends it.
     if (my_modulation > 0) {
-      usbMIDI.sendControlChange(1, my_modulation, midi_channel);
-      
-      if (output_mode != 1) {
-        MIDI.sendControlChange(1, my_modulation, midi_channel);
+      if (mpe_on) {
+        mpe_vibrato = my_modulation;
+      } else {
+        sendControlChange(1, my_modulation);
       };
     };
   };
@@ -95,59 +87,45 @@ void GurdyString::soundOn(int my_offset, int my_modulation) {
 void GurdyString::soundOn(int my_offset, int my_modulation, int note) {
   int note_to_play = note;
   if (!mute_on) {
-
-    usbMIDI.sendNoteOn(note_to_play, midi_volume, midi_channel);
-
-    if (output_mode != 1) {
-      MIDI.sendNoteOn(note_to_play, midi_volume, midi_channel);
-    };
+    sendNoteOn(note_to_play);
 
     if (output_mode > 0) {
-      #if defined(USE_TRIGGER)
-        if (vol_array[note_to_play] != trigger_volume) {
-          trigger_obj.trackGain(note_to_play + (128 * (midi_channel - 1)), trigger_volume);
-          vol_array[note_to_play] = trigger_volume;
-        };
-      
-        trigger_obj.trackPlayPoly(note_to_play + (128 * (midi_channel - 1)), true);
-        //trigger_obj.trackLoop(note_to_play + (128 * (midi_channel - 1)), true);
-      #elif defined(USE_TSUNAMI)
-        if (vol_array[note_to_play] != trigger_volume) {
-          trigger_obj.trackGain(note_to_play + (128 * (midi_channel - 1)), trigger_volume);
-          vol_array[note_to_play] = trigger_volume;
-        };
-
-        trigger_obj.trackPlayPoly(note_to_play + (128 * (midi_channel - 1)), TSUNAMI_OUT, true);
-        //trigger_obj.trackLoop(note_to_play + (128 * (midi_channel - 1)), true);
-      #endif
+      triggerPlay(note_to_play);
     };
   };
 };
 
 /// @brief  Turns off the sound currently playing for this string, nicely.
 void GurdyString::soundOff() {
+  TRACE_SCOPE(TRACE_SOUND_OFF);
 
-  // If user has one of the second-drone options enabled, trigger them here.
-  if (gros_mode == 1) {
-    soundOff(note_being_played - 5);
-  } else if (gros_mode == 2) {
-    soundOff(note_being_played - 7);
-  } else if (gros_mode == 3) {
-    soundOff(note_being_played - 12);
+  // A one-shot ends by itself; this only cuts its MIDI note short.
+  if (one_shot) {
+    if (shot_midi_on) {
+      sendNoteOff(note_being_played);
+      shot_midi_on = false;
+    };
+    is_playing = false;
+    return;
   };
 
-  usbMIDI.sendNoteOff(note_being_played, midi_volume, midi_channel);
+  // After a glide, MIDI is still sounding the note it bent away from.
+  int midi_note = (legato_note >= 0) ? legato_note : note_being_played;
+  legato_note = -1;
 
-  if (output_mode != 1) {
-    MIDI.sendNoteOff(note_being_played, midi_volume, midi_channel);
+  // If user has one of the second-drone options enabled, trigger them here.
+  int gros = grosInterval();
+  if (gros > 0) {
+    sendNoteOff(midi_note - gros);
+    if (output_mode > 0) {
+      triggerFade(note_being_played - gros);
+    };
   };
 
+  sendNoteOff(midi_note);
+
   if (output_mode > 0) {
-    if (trigger_volume > -60) {
-      trigger_obj.trackFade(note_being_played + (128 * (midi_channel - 1)), trigger_volume - 10, 200, true);
-    } else {
-      trigger_obj.trackFade(note_being_played + (128 * (midi_channel - 1)), -70, 200, true);
-    }
+    triggerFade(note_being_played);
     //trigger_obj.trackStop(note_being_played + (128 * (midi_channel - 1)));
   };
 
@@ -158,18 +136,10 @@ void GurdyString::soundOff() {
 /// @param note The specific note to stop
 void GurdyString::soundOff(int note) {
 
-  usbMIDI.sendNoteOff(note, midi_volume, midi_channel);
-
-  if (output_mode != 1) {
-    MIDI.sendNoteOff(note, midi_volume, midi_channel);
-  };
+  sendNoteOff(note);
 
   if (output_mode > 0) {
-    if (trigger_volume > -60) {
-      trigger_obj.trackFade(note + (128 * (midi_channel - 1)), trigger_volume - 10, 200, true);
-    } else {
-      trigger_obj.trackFade(note + (128 * (midi_channel - 1)), -70, 200, true);
-    };
+    triggerFade(note);
   };
 };
 
@@ -177,19 +147,200 @@ void GurdyString::soundOff(int note) {
 /// @note On Tsunami/Trigger units, this kills *all* tracks playing.  This is not meant be the regular way to turn off sound, see soundOff() which does it more gently.
 void GurdyString::soundKill() {
 
-  usbMIDI.sendControlChange(123, 0, midi_channel);
+  sendControlChange(123, 0);
 
-  if (output_mode != 1) {
-    MIDI.sendControlChange(123, 0, midi_channel);
+  if (output_mode > 0) {
+    triggerStopAll();
   };
 
-  if (output_mode > 0) {
-    trigger_obj.stopAllTracks();
+  // CC123 leaves a glide's bend in place.
+  if (legato_steps != 0) {
+    sendPitchBend(8192);
+    legato_steps = 0;
   };
+  legato_note = -1;
 
+  shot_midi_on = false;
+  shot_track_note = -1;
   is_playing = false;
 };
 
+/// @brief Moves a sounding string to a new note, the way its legato mode says.
+/// @param my_offset The offset from the string's base note to make sound
+/// @param my_modulation As for soundOn()
+/// @details A key change used to be soundOff() then soundOn(): a NoteOff and NoteOn per note, which some
+/// soundfonts play as a fresh attack.  With legato on:
+/// * LEGATO_GLIDE: MIDI keeps the note it has and bends it to the new one, one pitch bend message instead of
+///   two notes.  The synth's bend range must be LEGATO_BEND_RANGE (see setBendRange()).  A note further than that
+///   from the sounding one is struck again, unbent.  In MPE mode, whose pitch bend carries the vibrato, this is
+///   LEGATO_OVERLAP instead.
+/// * LEGATO_OVERLAP: the new note starts before the old one ends, which mono-legato synths play as a slur or a
+///   portamento.
+///
+/// The Trigger/Tsunami can do neither, so its tracks change as before.  A string that isn't sounding, and the key
+/// click, just do soundOff() and soundOn().
+/// @version *New in 3.1.0*
+void GurdyString::changeNote(int my_offset, int my_modulation) {
+  if (legato_mode == LEGATO_OFF || one_shot || mute_on || !is_playing) {
+    soundOff();
+    soundOn(my_offset, my_modulation);
+    return;
+  };
+
+  int old_note = note_being_played;
+  int new_note = open_note + my_offset;
+  if (new_note == old_note) {
+    return;
+  };
+  note_being_played = new_note;
+
+  int gros = grosInterval();
+  if (output_mode > 0) {
+    if (gros > 0) {
+      triggerFade(old_note - gros);
+    };
+    triggerFade(old_note);
+    if (gros > 0) {
+      triggerPlay(new_note - gros);
+    };
+    triggerPlay(new_note);
+  };
+
+  // The note MIDI has sounding, which differs from old_note while it's bent.
+  int midi_note = (legato_note >= 0) ? legato_note : old_note;
+
+  if (legato_mode == LEGATO_GLIDE && !mpe_on) {
+    int steps = new_note - midi_note;
+    if (abs(steps) <= LEGATO_BEND_RANGE) {
+      legato_note = midi_note;
+      legato_steps = steps;
+      int bend = 8192 + steps * 8192 / LEGATO_BEND_RANGE;
+      sendPitchBend((bend > 16383) ? 16383 : bend);
+      return;
+    };
+
+    // Too far to bend: strike the new note, unbent.
+    if (gros > 0) {
+      sendNoteOff(midi_note - gros);
+    };
+    sendNoteOff(midi_note);
+    if (legato_steps != 0) {
+      sendPitchBend(8192);
+      legato_steps = 0;
+    };
+    legato_note = -1;
+    if (gros > 0) {
+      sendNoteOn(new_note - gros);
+    };
+    sendNoteOn(new_note);
+    return;
+  };
+
+  // Mono legato: the new notes start before the old ones end.
+  legato_note = -1;
+  if (gros > 0) {
+    sendNoteOn(new_note - gros);
+  };
+  sendNoteOn(new_note);
+  if (gros > 0) {
+    sendNoteOff(midi_note - gros);
+  };
+  sendNoteOff(midi_note);
+};
+
+/// @brief Sets how this string changes notes while it's sounding.  See changeNote().
+/// @param mode LEGATO_OFF, LEGATO_GLIDE or LEGATO_OVERLAP
+/// @version *New in 3.1.0*
+void GurdyString::setLegato(LegatoMode mode) {
+  legato_mode = mode;
+};
+
+/// @brief Returns how this string changes notes while it's sounding.
+/// @version *New in 3.1.0*
+LegatoMode GurdyString::getLegato() {
+  return legato_mode;
+};
+
+/// @brief Sets the synth's pitch bend range for this string's channel (MIDI RPN 0).
+/// @param semitones The range either way
+/// @version *New in 3.1.0*
+void GurdyString::setBendRange(int semitones) {
+  // Select the parameter, set it, then deselect it ("null RPN") so stray data entry can't change it.
+  sendControlChange(101, 0);
+  sendControlChange(100, 0);
+  sendControlChange(6, semitones);
+  sendControlChange(38, 0);
+  sendControlChange(101, 127);
+  sendControlChange(100, 127);
+};
+
+/// @brief Returns how far below the string's note its gros (second drone) note is, 0 if it has none.
+int GurdyString::grosInterval() {
+  if (gros_mode == 1) {
+    return 5;
+  } else if (gros_mode == 2) {
+    return 7;
+  } else if (gros_mode == 3) {
+    return 12;
+  };
+  return 0;
+};
+
+/// @brief Puts the string in or out of one-shot mode, for the key click.
+/// @param on True for one-shot
+/// @details A one-shot string's notes end by themselves: soundOn() plays the Trigger/Tsunami track once through
+/// (see setTrackLoops()) and update() ends the MIDI note after KEYCLICK_MS.  soundOff() just cuts the MIDI note
+/// short, so a note change costs no fade.  A new note while the last one is still going stops it first.
+/// @version *New in 3.1.0*
+void GurdyString::setOneShot(bool on) {
+  if (shot_track_note >= 0 && output_mode > 0) {
+    triggerStop(shot_track_note);
+  };
+  one_shot = on;
+  shot_midi_on = false;
+  shot_track_note = -1;
+};
+
+/// @brief Ends a one-shot's MIDI note once KEYCLICK_MS is up.  Does nothing for other strings.
+/// @details Its Trigger/Tsunami track is left to play out: the string can't tell when it ends, so it's stopped by
+/// the next one-shot note or soundKill().
+/// @note This is meant to be run every loop() cycle.
+/// @version *New in 3.1.0*
+void GurdyString::update() {
+  if (shot_midi_on && millis() - shot_ms >= (uint32_t)KEYCLICK_MS) {
+    sendNoteOff(note_being_played);
+    shot_midi_on = false;
+    is_playing = false;
+  };
+};
+
+/// @brief Starts a one-shot note, first stopping the last one if it's still going.
+/// @param note The MIDI note
+void GurdyString::shotOn(int note) {
+  if (shot_midi_on) {
+    sendNoteOff(note_being_played);
+    shot_midi_on = false;
+  };
+  if (shot_track_note >= 0 && output_mode > 0) {
+    triggerStop(shot_track_note);
+  };
+  shot_track_note = -1;
+
+  note_being_played = note;
+  if (mute_on) {
+    return;
+  };
+
+  sendNoteOn(note);
+  if (output_mode > 0) {
+    triggerPlay(note);
+    shot_track_note = note;
+  };
+  shot_midi_on = true;
+  shot_ms = millis();
+  is_playing = true;
+};
+
 /// @brief Returns the string's open (base) note.
 /// @return The string's base note as a MIDI note number 0-127
 int GurdyString::getOpenNote() {
@@ -238,50 +389,141 @@ bool GurdyString::isPlaying() {
   return is_playing;
 };
 
+/// @brief Reports whether a note is one the string is sounding from live playing.
+/// @param note The MIDI note
+/// @return True if the string is playing and note is its note, the MIDI note a glide bent away from, or its gros
+/// note, false otherwise.
+/// @details Notes sent with soundOn(int, int, int) aren't counted.
+/// @version *New in 3.1.0*
+bool GurdyString::isPlayingNote(int note) {
+  if (!is_playing) {
+    return false;
+  };
+
+  int gros = grosInterval();
+  return (note == note_being_played || note == legato_note ||
+          (gros > 0 && (note == note_being_played - gros || note == legato_note - gros)));
+};
+
 /// @brief Send a MIDI Program Change to this string's MIDI channel.
 /// @param program The program change value, 0-127.
 /// @note This has no effect on Tsunami/Trigger units.
 void GurdyString::setProgram(uint8_t program) {
+  sendProgramChange(program);
+};
+
+/// @brief Sends a MIDI CC11 (Expression) value to this string's MIDI channel.
+/// @param exp The expression value, 0-127.
+/// @note This has no effect on Tsunami/Trigger units.  In MPE mode the value is sent as channel pressure by the
+/// next mpeUpdate() instead.
+void GurdyString::setExpression(int exp) {
+  if (mpe_on) {
+    mpe_pressure = exp;
+    return;
+  };
+  sendControlChange(11, exp);
+};
 
-  usbMIDI.sendProgramChange(program, midi_channel);
+/// @brief Sends any MIDI CC to this string's MIDI channel, for controllers the string has no method of its own for.
+/// @param cc The controller, 0-127.
+/// @param value The value, 0-127.
+/// @note This has no effect on Tsunami/Trigger units.
+/// @version *New in 3.1.0*
+void GurdyString::setControl(int cc, int value) {
+  sendControlChange(cc, value);
+};
 
-  if (output_mode != 1) {
-    MIDI.sendProgramChange(program, midi_channel);
+/// @brief Sends half of a 14-bit expression value to this string's MIDI channel: MIDI CC11 (MSB) or CC43 (LSB).
+/// @param exp The expression value, 0-16383.
+/// @param msb True to send the MSB (which the receiver takes as the MSB with an LSB of 0), false for the LSB.
+/// @note This has no effect on Tsunami/Trigger units.  In MPE mode the MSB is sent as channel pressure by the next
+/// mpeUpdate() instead.
+/// @version *New in 3.1.0*
+void GurdyString::setExpression14(int exp, bool msb) {
+  if (mpe_on) {
+    mpe_pressure = exp >> 7;
+    return;
+  };
+  if (msb) {
+    sendControlChange(11, exp >> 7);
+  } else {
+    sendControlChange(43, exp & 0x7F);
   };
 };
 
-/// @brief Sends a MIDI CC11 (Expression) value to this string's MIDI channel.
+/// @brief Sets the expression for this string's sounding Trigger/Tsunami tracks, which follow it as track gain.
 /// @param exp The expression value, 0-127.
-/// @note This has no effect on Tsunami/Trigger units.
-void GurdyString::setExpression(int exp) {
+/// @details MIDI expression (CC11) is a volume control, so it is applied the way a General MIDI synth applies it,
+/// as a cut of 40 * log10(exp / 127) dB below the string's volume.  The change is sent as a trackFade() over
+/// TRIGGER_EXPRESSION_MS, at most that often, and only once it's TRIGGER_EXPRESSION_DB or more.  A change that
+/// would have to wait for room on the unit's serial port waits for the next call instead, so it never delays a note.
+/// New notes start at the current gain either way.
+/// @note This has no effect on MIDI.  This is meant to be called on every crank expression update, changed or not,
+/// so that held-back changes go out.
+/// @version *New in 3.1.0*
+void GurdyString::setTriggerExpression(int exp) {
+  trigger_expression = exp;
+
+  #ifdef USE_TRIGGER_EXPRESSION
+  if (output_mode == 0 || !is_playing || mute_on || one_shot) {
+    return;
+  };
 
-  usbMIDI.sendControlChange(11, exp, midi_channel);
+  int gain = triggerGain();
+  if (abs(gain - trigger_gain_sent) < TRIGGER_EXPRESSION_DB) {
+    return;
+  };
 
-  if (output_mode != 1) {
-    MIDI.sendControlChange(11, exp, midi_channel);
+  uint32_t now = millis();
+  if (now - trigger_expression_ms < (uint32_t)TRIGGER_EXPRESSION_MS) {
+    return;
   };
+
+  // Room for two trackFade()s (12 bytes each), with a gros note.
+  #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+  if (SINK_TRIGGER_PORT.availableForWrite() < 24) {
+    return;
+  };
+  #endif
+
+  trigger_expression_ms = now;
+  trigger_gain_sent = gain;
+
+  triggerRamp(note_being_played, gain);
+  if (gros_mode == 1) {
+    triggerRamp(note_being_played - 5, gain);
+  } else if (gros_mode == 2) {
+    triggerRamp(note_being_played - 7, gain);
+  } else if (gros_mode == 3) {
+    triggerRamp(note_being_played - 12, gain);
+  };
+  #endif
+};
+
+/// @brief Returns the string's crank expression for its Trigger/Tsunami tracks.
+/// @return The expression value, 0-127
+/// @version *New in 3.1.0*
+int GurdyString::getTriggerExpression() {
+  return trigger_expression;
 };
 
 /// @brief Bends this string's sound to the specified amount.
 /// @param bend The amount of pitch bend.  0 to 16383, where 8192 = no bend.
 /// @note This has no effect on Tsunami/Trigger units.
 void GurdyString::setPitchBend(int bend) {
-  usbMIDI.sendPitchBend(bend, midi_channel);
-
-  if (output_mode != 1) {
-    MIDI.sendPitchBend(bend, midi_channel);
-  };
+  sendPitchBend(bend);
 };
 
 /// @brief Sets the amount of modulation (vibrato) on this string.
 /// @param vib The amount of modulation, 0-127.
-/// @note This is MIDI CC1, the "mod wheel".  Intended to used for a vibrato effect.
+/// @note This is MIDI CC1, the "mod wheel".  Intended to used for a vibrato effect.  In MPE mode it's sent by the
+/// next mpeUpdate() instead, if it changed.
 void GurdyString::setVibrato(int vib) {
-  usbMIDI.sendControlChange(1, vib, midi_channel);
-
-  if (output_mode != 1) {
-    MIDI.sendControlChange(1, vib, midi_channel);
+  if (mpe_on) {
+    mpe_vibrato = vib;
+    return;
   };
+  sendControlChange(1, vib);
 };
 
 /// @brief Returns the text name of this string.
@@ -300,6 +542,12 @@ void GurdyString::setOutputMode(int my_mode) {
   output_mode = my_mode;
 };
 
+/// @brief Returns the secondary output mode for this string (see setOutputMode()).
+/// @return 0-2
+int GurdyString::getOutputMode() {
+  return output_mode;
+};
+
 /// @brief Sets the "gros-mode" for this string.
 /// @details Value of this should be 0-3:
 /// * 0 = no additional sound
@@ -331,13 +579,21 @@ String GurdyString::getGrosString() {
 };
 
 /// @brief Sets the Trigger/Tsunami loop mode on all of the tracks this string may use.
+/// @note A one-shot string's tracks are left alone: they play once through.
 void GurdyString::setTrackLoops() {
+  if (one_shot) {
+    return;
+  };
+
   #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
     for (int x = 0; x <= 127; x++) {
-      trigger_obj.trackLoop(x + (128 * (midi_channel - 1)), true);
+      trigger_obj.trackLoop(trigger_track(midi_channel, x), true);
       delay(5);
     };
   #endif
+  #ifdef USE_TSUNAMI_MIDI
+    tsunami_midi.breakStatus();
+  #endif
 };
 
 void GurdyString::clearVolArray() {
@@ -345,3 +601,390 @@ void GurdyString::clearVolArray() {
     vol_array[x] = 0;
   };
 }
+
+/// @brief Switches this string in or out of MPE mode.
+/// @param on True to use MPE
+/// @details In MPE mode the string sends on the member channel one above its own (see mpe_start()), so the
+/// MPE master channel (1) is left free.  Its Trigger/Tsunami tracks don't change.
+/// @version *New in 3.1.0*
+void GurdyString::setMpe(bool on) {
+  mpe_on = on;
+  mpe_pressure_sent = -1;
+  mpe_vibrato_sent = 0;
+};
+
+/// @brief Returns true if the string is in MPE mode.
+/// @version *New in 3.1.0*
+bool GurdyString::getMpe() {
+  return mpe_on;
+};
+
+/// @brief Returns the MIDI channel the string is sending on right now.
+/// @version *New in 3.1.0*
+int GurdyString::getMidiChannel() {
+  return outChannel();
+};
+
+/// @brief Sends the string's latest expression and vibrato, if they changed, in MPE mode.
+/// @details Expression goes out as channel pressure and the vibrato amount as CC1 on the member channel, for the
+/// synth to make the vibrato from.  Each is sent only when it changed, so a steady vibrato costs nothing.
+/// @note This is meant to be run by mpe_update(), which limits how often it's called.
+/// @version *New in 3.1.0*
+void GurdyString::mpeUpdate() {
+  if (!mpe_on || mute_on) {
+    return;
+  };
+
+  if (mpe_pressure >= 0 && mpe_pressure != mpe_pressure_sent) {
+    sendChannelPressure(mpe_pressure);
+    mpe_pressure_sent = mpe_pressure;
+  };
+
+  if (mpe_vibrato != mpe_vibrato_sent) {
+    sendControlChange(1, mpe_vibrato);
+    mpe_vibrato_sent = mpe_vibrato;
+  };
+};
+
+/// @brief Returns the MIDI channel to send on: the string's own, or its MPE member channel.
+int GurdyString::outChannel() {
+  return mpe_on ? midi_channel + 1 : midi_channel;
+};
+
+// All of this string's output goes through the functions below, so there is one place to trace,
+// capture or count it.
+
+/// @brief Sends a MIDI NoteOn at this string's volume over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param note The MIDI note
+void GurdyString::sendNoteOn(int note) {
+  TRACE_MESSAGE(TRACE_NOTE_ON, outChannel(), note);
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_USB, STREAM_NOTE_ON, outChannel(), note, midi_volume);
+    if (output_mode != 1) {
+      stream_record(STREAM_SERIAL, STREAM_NOTE_ON, outChannel(), note, midi_volume);
+    };
+    return;
+  };
+  #endif
+
+  if (SINK_READY(TRAFFIC_USB)) {
+    TRAFFIC_COUNT(TRAFFIC_USB, TRAFFIC_NOTE_ON);
+    usbMIDI.sendNoteOn(note, midi_volume, outChannel());
+  };
+
+  if (output_mode != 1) {
+    TRAFFIC_COUNT(TRAFFIC_SERIAL, TRAFFIC_NOTE_ON);
+    MIDI.sendNoteOn(note, midi_volume, outChannel());
+  };
+};
+
+/// @brief Sends a MIDI NoteOff over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param note The MIDI note
+void GurdyString::sendNoteOff(int note) {
+  TRACE_MESSAGE(TRACE_NOTE_OFF, outChannel(), note);
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_USB, STREAM_NOTE_OFF, outChannel(), note, midi_volume);
+    if (output_mode != 1) {
+      stream_record(STREAM_SERIAL, STREAM_NOTE_OFF, outChannel(), note, midi_volume);
+    };
+    return;
+  };
+  #endif
+
+  if (SINK_READY(TRAFFIC_USB)) {
+    TRAFFIC_COUNT(TRAFFIC_USB, TRAFFIC_NOTE_OFF);
+    usbMIDI.sendNoteOff(note, midi_volume, outChannel());
+  };
+
+  if (output_mode != 1) {
+    TRAFFIC_COUNT(TRAFFIC_SERIAL, TRAFFIC_NOTE_OFF);
+    MIDI.sendNoteOff(note, midi_volume, outChannel());
+  };
+};
+
+/// @brief Sends a MIDI CC over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param cc The controller number
+/// @param value The controller value, 0-127
+void GurdyString::sendControlChange(int cc, int value) {
+  TRACE_MESSAGE(TRACE_CC, outChannel(), cc);
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_USB, STREAM_CC, outChannel(), cc, value);
+    if (output_mode != 1) {
+      stream_record(STREAM_SERIAL, STREAM_CC, outChannel(), cc, value);
+    };
+    return;
+  };
+  #endif
+
+  if (SINK_READY(TRAFFIC_USB)) {
+    TRAFFIC_COUNT(TRAFFIC_USB, traffic_cc_kind(cc));
+    usbMIDI.sendControlChange(cc, value, outChannel());
+  };
+
+  if (output_mode != 1) {
+    TRAFFIC_COUNT(TRAFFIC_SERIAL, traffic_cc_kind(cc));
+    MIDI.sendControlChange(cc, value, outChannel());
+  };
+};
+
+/// @brief Sends a MIDI pitch bend over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param bend The bend, 0 to 16383, where 8192 = no bend
+void GurdyString::sendPitchBend(int bend) {
+  TRACE_MESSAGE(TRACE_PITCH_BEND, outChannel(), bend);
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_USB, STREAM_PITCH_BEND, outChannel(), bend, 0);
+    if (output_mode != 1) {
+      stream_record(STREAM_SERIAL, STREAM_PITCH_BEND, outChannel(), bend, 0);
+    };
+    return;
+  };
+  #endif
+
+  if (SINK_READY(TRAFFIC_USB)) {
+    TRAFFIC_COUNT(TRAFFIC_USB, TRAFFIC_PITCH_BEND);
+    usbMIDI.sendPitchBend(bend, outChannel());
+  };
+
+  if (output_mode != 1) {
+    TRAFFIC_COUNT(TRAFFIC_SERIAL, TRAFFIC_PITCH_BEND);
+    MIDI.sendPitchBend(bend, outChannel());
+  };
+};
+
+/// @brief Sends a MIDI Program Change over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param program The program, 0-127
+void GurdyString::sendProgramChange(uint8_t program) {
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_USB, STREAM_PROGRAM, outChannel(), program, 0);
+    if (output_mode != 1) {
+      stream_record(STREAM_SERIAL, STREAM_PROGRAM, outChannel(), program, 0);
+    };
+    return;
+  };
+  #endif
+
+  if (SINK_READY(TRAFFIC_USB)) {
+    TRAFFIC_COUNT(TRAFFIC_USB, TRAFFIC_PROGRAM);
+    usbMIDI.sendProgramChange(program, outChannel());
+  };
+
+  if (output_mode != 1) {
+    TRAFFIC_COUNT(TRAFFIC_SERIAL, TRAFFIC_PROGRAM);
+    MIDI.sendProgramChange(program, outChannel());
+  };
+};
+
+/// @brief Sends a MIDI Channel Pressure over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param pressure The pressure, 0-127
+void GurdyString::sendChannelPressure(int pressure) {
+  TRACE_MESSAGE(TRACE_PRESSURE, outChannel(), pressure);
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_USB, STREAM_PRESSURE, outChannel(), pressure, 0);
+    if (output_mode != 1) {
+      stream_record(STREAM_SERIAL, STREAM_PRESSURE, outChannel(), pressure, 0);
+    };
+    return;
+  };
+  #endif
+
+  if (SINK_READY(TRAFFIC_USB)) {
+    TRAFFIC_COUNT(TRAFFIC_USB, TRAFFIC_PRESSURE);
+    usbMIDI.sendAfterTouch(pressure, outChannel());
+  };
+
+  if (output_mode != 1) {
+    TRAFFIC_COUNT(TRAFFIC_SERIAL, TRAFFIC_PRESSURE);
+    MIDI.sendAfterTouch(pressure, outChannel());
+  };
+};
+
+/// @brief Starts this string's Trigger/Tsunami track for a note, first setting its gain if that changed.
+/// @param note The MIDI note
+void GurdyString::triggerPlay(int note) {
+  int track = trigger_track(midi_channel, note);
+  int gain = triggerGain();
+  bool new_gain = (vol_array[note] != gain);
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    vol_array[note] = gain;
+    if (new_gain) {
+      stream_record(STREAM_TRIGGER, STREAM_TRACK_GAIN, midi_channel, note, gain);
+    };
+    stream_record(STREAM_TRIGGER, STREAM_TRACK_PLAY, midi_channel, note, 0);
+    return;
+  };
+  #endif
+
+  if (!SINK_READY(TRAFFIC_TRIGGER)) {
+    return;
+  };
+  vol_array[note] = gain;
+  trigger_gain_sent = gain;
+
+  #if defined(USE_TRIGGER)
+    if (new_gain) {
+      TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_GAIN);
+      trigger_obj.trackGain(track, gain);
+    };
+
+    TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_PLAY);
+    trigger_obj.trackPlayPoly(track, true);
+    //trigger_obj.trackLoop(track, true);
+  #elif defined(USE_TSUNAMI_MIDI)
+    // The gain goes with the note, as its velocity.
+    uint8_t buf[TSUNAMI_MIDI_MAX_BYTES];
+    int len = tsunami_midi.play(track, tsunami_midi_velocity(gain), buf);
+    TRAFFIC_COUNT_BYTES(TRAFFIC_TRIGGER, TRAFFIC_TRACK_PLAY, len);
+    TsunamiOut.write(buf, len);
+  #elif defined(USE_TSUNAMI)
+    if (new_gain) {
+      TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_GAIN);
+      trigger_obj.trackGain(track, gain);
+    };
+
+    TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_PLAY);
+    trigger_obj.trackPlayPoly(track, TSUNAMI_OUT, true);
+    //trigger_obj.trackLoop(track, true);
+  #endif
+};
+
+/// @brief Fades out and stops this string's Trigger/Tsunami track for a note.
+/// @param note The MIDI note
+void GurdyString::triggerFade(int note) {
+  int track = trigger_track(midi_channel, note);
+  int gain = triggerGain();
+  gain = (gain > -60) ? gain - 10 : -70;
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_TRIGGER, STREAM_TRACK_FADE, midi_channel, note, gain);
+    return;
+  };
+  #endif
+
+  if (!SINK_READY(TRAFFIC_TRIGGER)) {
+    return;
+  };
+
+  #ifdef USE_TSUNAMI_MIDI
+    // The Note-Off fades it out over the Tsunami's MIDI release time.
+    uint8_t buf[TSUNAMI_MIDI_MAX_BYTES];
+    int len = tsunami_midi.stop(track, buf);
+    TRAFFIC_COUNT_BYTES(TRAFFIC_TRIGGER, TRAFFIC_TRACK_FADE, len);
+    TsunamiOut.write(buf, len);
+  #else
+    TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_FADE);
+    trigger_obj.trackFade(track, gain, 200, true);
+  #endif
+};
+
+/// @brief Returns the gain for this string's Trigger/Tsunami tracks: its volume, less its expression.
+/// @return The gain in dB, -70 to +10
+int GurdyString::triggerGain() {
+  int gain = trigger_volume;
+
+  #ifdef USE_TRIGGER_EXPRESSION
+  if (trigger_expression <= 0) {
+    return -70;
+  } else if (trigger_expression < 127) {
+    gain += (int)lroundf(40.0f * log10f(trigger_expression / 127.0f));
+  };
+  #endif
+
+  if (gain < -70) {
+    return -70;
+  } else if (gain > 10) {
+    return 10;
+  };
+  return gain;
+};
+
+/// @brief Moves one of this string's sounding Trigger/Tsunami tracks to a new gain over TRIGGER_EXPRESSION_MS.
+/// @param note The MIDI note
+/// @param gain The gain in dB
+void GurdyString::triggerRamp(int note, int gain) {
+  if (note < 0) {
+    return;
+  };
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    vol_array[note] = gain;
+    stream_record(STREAM_TRIGGER, STREAM_TRACK_FADE, midi_channel, note, gain);
+    return;
+  };
+  #endif
+
+  if (!SINK_READY(TRAFFIC_TRIGGER)) {
+    return;
+  };
+  vol_array[note] = gain;
+
+  #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+    TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_FADE);
+    trigger_obj.trackFade(trigger_track(midi_channel, note), gain, TRIGGER_EXPRESSION_MS, false);
+  #endif
+  #ifdef USE_TSUNAMI_MIDI
+    tsunami_midi.breakStatus();
+  #endif
+};
+
+/// @brief Stops this string's Trigger/Tsunami track for a note at once, without a fade.
+/// @param note The MIDI note
+void GurdyString::triggerStop(int note) {
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_TRIGGER, STREAM_TRACK_STOP, midi_channel, note, 0);
+    return;
+  };
+  #endif
+
+  if (!SINK_READY(TRAFFIC_TRIGGER)) {
+    return;
+  };
+
+  #ifdef USE_TSUNAMI_MIDI
+    uint8_t buf[TSUNAMI_MIDI_MAX_BYTES];
+    int len = tsunami_midi.stop(trigger_track(midi_channel, note), buf);
+    TRAFFIC_COUNT_BYTES(TRAFFIC_TRIGGER, TRAFFIC_TRACK_STOP, len);
+    TsunamiOut.write(buf, len);
+  #else
+    TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_TRACK_STOP);
+    trigger_obj.trackStop(trigger_track(midi_channel, note));
+  #endif
+};
+
+/// @brief Stops every Trigger/Tsunami track.
+void GurdyString::triggerStopAll() {
+
+  #ifdef USE_STREAM_TEST
+  if (stream_capturing) {
+    stream_record(STREAM_TRIGGER, STREAM_STOP_ALL, midi_channel, 0, 0);
+    return;
+  };
+  #endif
+
+  if (!SINK_READY(TRAFFIC_TRIGGER)) {
+    return;
+  };
+
+  TRAFFIC_COUNT(TRAFFIC_TRIGGER, TRAFFIC_STOP_ALL);
+  trigger_obj.stopAllTracks();
+  #ifdef USE_TSUNAMI_MIDI
+    tsunami_midi.breakStatus();
+  #endif
+};
@@ -3,6 +3,11 @@
 
 #include "config.h"
 #include "notes.h"
+#include "trace.h"
+#include "stream_test.h"
+#include "traffic.h"
+#include "sinks.h"
+#include "tsunami_midi.h"
 
 // https://www.pjrc.com/teensy/td_midi.html
 // https://www.pjrc.com/teensy/td_libs_MIDI.html
@@ -18,9 +23,20 @@
   extern Tsunami trigger_obj;
 #endif
 
-extern MIDI_NAMESPACE::MidiInterface<MIDI_NAMESPACE::SerialMIDI<HardwareSerial>> MIDI;
+#ifdef USE_TSUNAMI_MIDI
+  extern TsunamiMidiEncoder tsunami_midi;
+#endif
+
+extern MIDI_NAMESPACE::MidiInterface<MIDI_NAMESPACE::SerialMIDI<MidiPort>> MIDI;
 
 
+// How a melody string changes notes (see GurdyString::changeNote()).
+enum LegatoMode : uint8_t {
+  LEGATO_OFF = 0,         // NoteOff, then NoteOn: every note is struck again
+  LEGATO_GLIDE,           // Pitch bend away from the sounding note, within LEGATO_BEND_RANGE
+  LEGATO_OVERLAP          // NoteOn, then NoteOff: mono-legato synths slur or glide
+};
+
 class GurdyString {
   private:
     String name;
@@ -36,6 +52,47 @@ class GurdyString {
     int gros_mode;
     int vol_array[128];
 
+    // MPE mode: the string moves up one channel to be a member channel, and sends the latest expression as
+    // channel pressure and vibrato depth as CC1 from mpeUpdate().
+    bool mpe_on = false;
+    int mpe_pressure = -1;
+    int mpe_pressure_sent = -1;
+    int mpe_vibrato = 0;
+    int mpe_vibrato_sent = 0;
+
+    // One-shot mode (the key click): the note ends itself, see update().
+    bool one_shot = false;
+    bool shot_midi_on = false;      // Its MIDI note hasn't been ended yet
+    int shot_track_note = -1;       // The note whose Trigger/Tsunami track may still be playing, -1 for none
+    uint32_t shot_ms = 0;
+
+    // Legato (see changeNote()).  While gliding, the MIDI note actually sounding and how far it's bent.
+    LegatoMode legato_mode = LEGATO_OFF;
+    int legato_note = -1;
+    int legato_steps = 0;
+
+    // Crank expression on the Trigger/Tsunami, as track gain (see setTriggerExpression()).
+    int trigger_expression = 127;
+    int trigger_gain_sent = 0;      // The gain the sounding tracks were last given
+    uint32_t trigger_expression_ms = 0;
+
+    int outChannel();
+
+    void sendNoteOn(int note);
+    void sendNoteOff(int note);
+    void sendControlChange(int cc, int value);
+    void sendPitchBend(int bend);
+    void sendProgramChange(uint8_t program);
+    void sendChannelPressure(int pressure);
+    void triggerPlay(int note);
+    void triggerFade(int note);
+    void triggerStopAll();
+    void triggerStop(int note);
+    int triggerGain();
+    void triggerRamp(int note, int gain);
+    void shotOn(int note);
+    int grosInterval();
+
   public:
     GurdyString(int my_channel, int my_note, String my_name, int my_mode, int my_vol = 70);
     void soundOn(int my_offset = 0, int my_modulation = 0);
@@ -43,6 +100,10 @@ class GurdyString {
     void soundOff();
     void soundOff(int note);
     void soundKill();
+    void changeNote(int my_offset, int my_modulation = 0);
+    void setLegato(LegatoMode mode);
+    LegatoMode getLegato();
+    void setBendRange(int semitones);
     int getOpenNote();
     void setOpenNote(int new_note);
     void setVolume(int vol);
@@ -50,17 +111,29 @@ class GurdyString {
     void setMute(bool mute);
     bool getMute();
     bool isPlaying();
+    bool isPlayingNote(int note);
     void setProgram(uint8_t program);
     void setExpression(int exp);
+    void setControl(int cc, int value);
+    void setExpression14(int exp, bool msb);
+    void setTriggerExpression(int exp);
+    int getTriggerExpression();
     void setPitchBend(int bend);
     void setVibrato(int vib);
     String getName();
     void setOutputMode(int my_mode);
+    int getOutputMode();
     void setGrosMode(int my_gros_mode);
     int getGrosMode();
     String getGrosString();
     void setTrackLoops();
     void clearVolArray();
+    void setMpe(bool on);
+    bool getMpe();
+    int getMidiChannel();
+    void mpeUpdate();
+    void setOneShot(bool on);
+    void update();
 };
 
 #endif
@@ -18,6 +18,7 @@ HurdyGurdy::HurdyGurdy(const int pin_arr[], int key_size) {
 /// @return the index of the highest key being pressed
 /// @note This is meant to be run every loop() cycle.
 int HurdyGurdy::getMaxOffset() {
+  TRACE_SCOPE(TRACE_MAX_OFFSET);
 
   higher_key_pressed = false;
   lower_key_pressed = false;
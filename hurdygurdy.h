@@ -3,6 +3,7 @@
 
 #include "config.h"
 #include "keyboxbutton.h"
+#include "trace.h"
 
 class HurdyGurdy {
   private:
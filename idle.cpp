@@ -0,0 +1,148 @@
+#include "idle.h"
+
+/// @defgroup idle Idle Mode
+/// These functions let loop() sleep while the gurdy is sitting still.
+///
+/// Once the crank has stopped and the play display has gone back to the tuning display, loop()
+/// ends each pass with a WFI ("wait for interrupt") instead of immediately running again.  The core
+/// sleeps until the next interrupt, which is at most one SysTick (1ms) away:
+///
+/// * Optical crank and encoder edges are interrupts, so cranking wakes the gurdy immediately.
+/// * Keybox and EX buttons are polled, so a press is seen within 1ms, well inside their debounce time.
+/// * USB traffic (MIDI, SysEx, Serial) is interrupt-driven and wakes it immediately, too.
+///
+/// Wake-to-first-note latency is measured from the input, not from the last wake (which is usually just a
+/// SysTick).  The optical crank's interrupt handler timestamps the first edge that comes in while idling (see
+/// idle_input_edge()), and the latency runs from there to the first note, including the time the crank
+/// estimator takes to call it spinning.  Encoder edges are counted inside the Encoder library, and keys and
+/// buttons are polled, so for these it runs from the first pass that could see the input: add at most the
+/// longest sleep for the true figure.  The last and worst latencies and the last idle period's sleep are
+/// shown on the live status screen (Other Options -> Diagnostics).
+///
+/// Idle mode does nothing on geared cranks: their ADC is polled and the spin detection is tuned
+/// to the full loop rate.  The clock is only lowered (IDLE_ARM_CLOCK) on a Teensy 4.
+/// @version *New in 3.1.0*
+/// @{
+
+IdleStats idle_stats;
+volatile bool idle_edge_armed = false;
+volatile uint32_t idle_edge_us = 0;
+
+static bool idle_on = false;
+
+// When the latest sleep ended: the first chance loop() had to see a polled input.
+static uint32_t wake_time = 0;
+static bool waiting_for_note = false;
+
+#if defined(USE_IDLE_MODE) && !defined(USE_GEARED_CRANK)
+
+static uint32_t idle_start = 0;
+static uint32_t sleep_total = 0;
+static uint32_t longest_sleep = 0;
+
+// An edge this old that hasn't started the crank was just a nudge: the next one is timed instead.
+static const uint32_t IDLE_EDGE_MAX_US = 250000;
+
+/// @brief Sets the CPU clock, on boards that can change it.
+static void idle_set_clock(uint32_t hz) {
+  #if defined(__IMXRT1062__)
+  if (IDLE_ARM_CLOCK > 0) {
+    set_arm_clock(hz);
+  };
+  #else
+  (void)hz;
+  #endif
+};
+
+/// @brief Starts idling.
+static void idle_enter() {
+  idle_on = true;
+  idle_start = micros();
+  sleep_total = 0;
+  longest_sleep = 0;
+  idle_edge_armed = true;
+
+  idle_set_clock(IDLE_ARM_CLOCK);
+};
+
+/// @brief Stops idling and keeps how the idle period went.
+static void idle_exit() {
+  idle_on = false;
+
+  idle_set_clock(F_CPU);
+
+  uint32_t idle_time = micros() - idle_start;
+  idle_stats.idle_ms = idle_time / 1000;
+  idle_stats.asleep_pct = (idle_time > 0) ? (uint32_t)((100ULL * sleep_total) / idle_time) : 0;
+  idle_stats.longest_sleep_us = longest_sleep;
+};
+
+#endif
+
+/// @brief Enters, stays in or leaves idle mode.
+/// @param can_idle True if nothing is playing and nothing is pending, i.e. the gurdy may sleep.
+/// @note This should be run at the very end of loop().
+void idle_update(bool can_idle) {
+  #if defined(USE_IDLE_MODE) && !defined(USE_GEARED_CRANK)
+
+  if (!can_idle) {
+    if (idle_on) {
+      idle_exit();
+    };
+    return;
+  };
+
+  if (!idle_on) {
+    idle_enter();
+  };
+
+  if (!idle_edge_armed && micros() - idle_edge_us > IDLE_EDGE_MAX_US) {
+    idle_edge_armed = true;
+  };
+
+  uint32_t sleep_start = micros();
+  asm volatile("wfi");
+  wake_time = micros();
+  waiting_for_note = true;
+
+  uint32_t slept = wake_time - sleep_start;
+  sleep_total += slept;
+  if (slept > longest_sleep) {
+    longest_sleep = slept;
+  };
+  #else
+  (void)can_idle;
+  #endif
+};
+
+/// @brief Records the wake-to-first-note latency, if the gurdy just woke up.
+/// @note This should be run whenever loop() starts the strings.
+void idle_note_started() {
+  if (!waiting_for_note) {
+    return;
+  };
+  waiting_for_note = false;
+
+  // An edge caught by an interrupt handler since idling began, or else the last wake.
+  noInterrupts();
+  bool from_edge = !idle_edge_armed && idle_edge_us != 0;
+  uint32_t since = from_edge ? idle_edge_us : wake_time;
+  idle_edge_armed = false;
+  idle_edge_us = 0;
+  interrupts();
+
+  uint32_t latency = micros() - since;
+  idle_stats.wake_to_note_us = latency;
+  idle_stats.from_edge = from_edge;
+  if (latency > idle_stats.worst_wake_to_note_us) {
+    idle_stats.worst_wake_to_note_us = latency;
+  };
+};
+
+/// @brief Returns whether the gurdy is idling.
+/// @return True if loop() is sleeping between passes.
+bool idle_active() {
+  return idle_on;
+};
+
+/// @}
@@ -0,0 +1,36 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// How the last idle period went, shown on the live status screen.
+struct IdleStats {
+  uint32_t idle_ms;               // How long the last idle period lasted
+  uint32_t asleep_pct;            // How much of it was spent asleep
+  uint32_t longest_sleep_us;
+  uint32_t wake_to_note_us;       // The last wake-to-first-note latency, 0 if none was measured yet
+  uint32_t worst_wake_to_note_us;
+  bool from_edge;                 // The last one was timed from a crank edge interrupt, not a polled input
+};
+
+extern IdleStats idle_stats;
+extern volatile bool idle_edge_armed;
+extern volatile uint32_t idle_edge_us;
+
+void idle_update(bool can_idle);
+void idle_note_started();
+bool idle_active();
+
+/// @brief Records when the first input edge came in while idling.
+/// @note This is meant to be run from input interrupt handlers, so it does as little as it can.
+/// @version *New in 3.1.0*
+inline void idle_input_edge() {
+  if (idle_edge_armed) {
+    idle_edge_us = micros();
+    idle_edge_armed = false;
+  };
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "live_status.h"
+
+#include "common.h"
+#include "display.h"
+#include "hurdygurdy.h"
+#include "idle.h"
+#include "sinks.h"
+#include "traffic.h"
+
+#include "crank.h"
+extern Crank *mycrank;
+
+extern HurdyGurdy *mygurdy;
+
+/// @defgroup live Live Status Screen
+/// These functions show how the gurdy is keeping up, live, in place of the play screen.
+///
+/// Once started from Other Options -> Diagnostics, the screen shows the loop() rate and the slowest loop()
+/// of the last second, the crank's speed and estimator state, which keys are down, how full the MIDI-OUT
+/// and Trigger/Tsunami send buffers are, and how many voices are sounding.  Play carries on as normal
+/// underneath it, so it can be watched while cranking.
+///
+/// Drawing the whole display in one go would take long enough to show up as a slow loop() itself, so the
+/// screen is drawn a step at a time, one step per loop(): composing the picture, then sending it to the
+/// display one 128x8 strip at a time.  The time spent in these steps is left out of the loop() figures and
+/// shown on its own as the draw cost.  A new picture starts every LIVE_STATUS_REFRESH_MS.
+/// @version *New in 3.1.0*
+/// @{
+
+bool live_status_on = false;
+
+#ifdef USE_LIVE_STATUS
+
+// Loop timing for the second in progress...
+static uint32_t last_end_cycles = 0;
+static uint32_t window_start_ms = 0;
+static uint32_t window_loops = 0;
+static uint32_t window_max_cycles = 0;
+static int window_midi_peak = 0;
+static int window_trigger_peak = 0;
+
+// ...and the last finished one.
+static uint32_t loop_hz = 0;
+static uint32_t worst_loop_us = 0;
+static int midi_queue_peak = 0;
+static int trigger_queue_peak = 0;
+
+static int midi_queue_size = 0;
+static int trigger_queue_size = 0;
+
+// Drawing: step 0 composes a picture, steps 1-8 each send one 8-pixel strip of it.
+static int draw_step = 0;
+static uint32_t last_frame_ms = 0;
+static uint32_t draw_max_cycles = 0;
+
+/// @brief Returns how many bytes are waiting in a serial port's send buffer.
+/// @param port The port
+/// @param size Set to the largest free space seen so far, which is the buffer's size when it's empty
+static int live_queue_depth(HardwareSerial &port, int *size) {
+  int free = port.availableForWrite();
+  if (free > *size) {
+    *size = free;
+  };
+  return *size - free;
+};
+
+/// @brief Returns how many bytes are waiting to go to the Trigger/Tsunami, or 0 without one.
+static int live_trigger_queue() {
+  #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+  int waiting = live_queue_depth(SINK_TRIGGER_PORT, &trigger_queue_size);
+  #ifdef USE_OUTPUT_GATING
+  waiting += trigger_port.queued();
+  #endif
+  return waiting;
+  #else
+  return 0;
+  #endif
+};
+
+/// @brief Counts the notes sounding: each playing string, and its gros note if it has one.
+/// @param trigger Count only strings sending to a Trigger/Tsunami
+static int live_voices(bool trigger) {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+  int count = 0;
+  for (int x = 0; x < 6; x++) {
+    if (strings[x]->isPlaying() && !strings[x]->getMute() && (!trigger || strings[x]->getOutputMode() > 0)) {
+      count += (strings[x]->getGrosMode() > 0) ? 2 : 1;
+    };
+  };
+  return count;
+};
+
+/// @brief Draws the status into the display buffer (without sending it).
+static void live_compose() {
+  // Lines are cut to the screen when drawn, but this fits every field at its widest (so no -Wformat-truncation).
+  char line[64];
+
+  u8g2.clearBuffer();
+  u8g2.setFontMode(1);
+  u8g2.setFont(u8g2_font_finderskeepers_tf);
+
+  snprintf(line, sizeof(line), "Loop %lu.%luk/s  worst %luus", (unsigned long)(loop_hz / 1000),
+           (unsigned long)(loop_hz % 1000 / 100), (unsigned long)worst_loop_us);
+  u8g2.drawStr(0, 8, line);
+
+  #ifdef USE_GEARED_CRANK
+  snprintf(line, sizeof(line), "Crank v%d %s", mycrank->getVoltage(), mycrank->isSpinning() ? "SPIN" : "stop");
+  u8g2.drawStr(0, 16, line);
+  snprintf(line, sizeof(line), "Spin %d  Buzz %s", mycrank->getSpin(), mycrank->isBuzzing() ? "ON" : "off");
+  #else
+  snprintf(line, sizeof(line), "Crank %.1frpm %s", mycrank->getVAvg(), mycrank->isSpinning() ? "SPIN" : "stop");
+  u8g2.drawStr(0, 16, line);
+  snprintf(line, sizeof(line), "Expr %d  Buzz %s", mycrank->getExpression(), mycrank->isBuzzing() ? "ON" : "off");
+  #endif
+  u8g2.drawStr(0, 24, line);
+
+  // One bit a key, lowest key in bit 0.
+  uint32_t mask = 0;
+  int top = 0;
+  for (int x = 0; x < num_keys; x++) {
+    if (mygurdy->keybox[x]->beingPressed()) {
+      mask |= (1UL << x);
+      top = x + 1;
+    };
+  };
+  snprintf(line, sizeof(line), "Keys %06lX  top %d", (unsigned long)mask, top);
+  u8g2.drawStr(0, 32, line);
+
+  // The fullest each send buffer got in the last second, out of its size.
+  snprintf(line, sizeof(line), "Queue MIDI %d/%d Trig %d/%d", midi_queue_peak, midi_queue_size,
+           trigger_queue_peak, trigger_queue_size);
+  u8g2.drawStr(0, 40, line);
+
+  #ifdef USE_IDLE_MODE
+  snprintf(line, sizeof(line), "Voices %d Trig %d Slept %lu%%", live_voices(false), live_voices(true),
+           (unsigned long)idle_stats.asleep_pct);
+  #else
+  snprintf(line, sizeof(line), "Voices %d  Trig %d", live_voices(false), live_voices(true));
+  #endif
+  u8g2.drawStr(0, 48, line);
+
+  #ifdef USE_TRAFFIC_STATS
+  snprintf(line, sizeof(line), "MIDI %luB/s  Trig %luB/s", (unsigned long)traffic[TRAFFIC_SERIAL].bytes_per_sec,
+           (unsigned long)traffic[TRAFFIC_TRIGGER].bytes_per_sec);
+  u8g2.drawStr(0, 56, line);
+  #endif
+
+  #ifdef USE_IDLE_MODE
+  // Idle mode is off while this screen is up, so this is the last idle period and wake before it.
+  snprintf(line, sizeof(line), "Draw %luus Wake%c %lu/%luus", (unsigned long)(draw_max_cycles / (F_CPU_ACTUAL / 1000000)),
+           idle_stats.from_edge ? '*' : ' ', (unsigned long)idle_stats.wake_to_note_us,
+           (unsigned long)idle_stats.worst_wake_to_note_us);
+  #else
+  snprintf(line, sizeof(line), "Draw %luus/step", (unsigned long)(draw_max_cycles / (F_CPU_ACTUAL / 1000000)));
+  #endif
+  u8g2.drawStr(0, 64, line);
+};
+
+/// @brief Replaces the play screen with the live status.
+void live_status_start() {
+  live_status_on = true;
+  draw_max_cycles = 0;
+  live_status_redraw();
+};
+
+/// @brief Goes back to the play screen.  The caller should redraw it.
+void live_status_stop() {
+  live_status_on = false;
+};
+
+/// @brief Starts a fresh picture on the next update, e.g. after a menu has drawn over the screen.
+void live_status_redraw() {
+  draw_step = 0;
+  last_frame_ms = millis() - LIVE_STATUS_REFRESH_MS;
+};
+
+/// @brief Marks the end of a loop() pass: times it, samples the send buffers and takes one drawing step.
+/// @note This is meant to be run every loop() cycle.
+void live_status_update() {
+  uint32_t start = ARM_DWT_CYCCNT;
+
+  // The time since the end of the last call is this pass's own work, without the drawing.
+  uint32_t cycles = start - last_end_cycles;
+  if (cycles > window_max_cycles) {
+    window_max_cycles = cycles;
+  };
+  window_loops++;
+
+  int midi_depth = live_queue_depth(Serial1, &midi_queue_size);
+  int trigger_depth = live_trigger_queue();
+  if (midi_depth > window_midi_peak) {
+    window_midi_peak = midi_depth;
+  };
+  if (trigger_depth > window_trigger_peak) {
+    window_trigger_peak = trigger_depth;
+  };
+
+  uint32_t now = millis();
+  if (now - window_start_ms >= 1000) {
+    loop_hz = window_loops * 1000 / (now - window_start_ms);
+    worst_loop_us = window_max_cycles / (F_CPU_ACTUAL / 1000000);
+    midi_queue_peak = window_midi_peak;
+    trigger_queue_peak = window_trigger_peak;
+    window_start_ms = now;
+    window_loops = 0;
+    window_max_cycles = 0;
+    window_midi_peak = midi_depth;
+    window_trigger_peak = trigger_depth;
+  };
+
+  if (live_status_on) {
+    if (draw_step == 0 && now - last_frame_ms >= (uint32_t)LIVE_STATUS_REFRESH_MS) {
+      last_frame_ms = now;
+      live_compose();
+      draw_step = 1;
+    } else if (draw_step > 0) {
+      u8g2.updateDisplayArea(0, draw_step - 1, 16, 1);
+      draw_step = (draw_step < 8) ? draw_step + 1 : 0;
+    };
+
+    uint32_t draw_cycles = ARM_DWT_CYCCNT - start;
+    if (draw_cycles > draw_max_cycles) {
+      draw_max_cycles = draw_cycles;
+    };
+  };
+
+  last_end_cycles = ARM_DWT_CYCCNT;
+};
+
+#endif
+
+/// @}
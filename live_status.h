@@ -0,0 +1,15 @@
+#ifndef LIVE_STATUS_H
+#define LIVE_STATUS_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+extern bool live_status_on;
+
+void live_status_start();
+void live_status_stop();
+void live_status_redraw();
+void live_status_update();
+
+#endif
@@ -10,6 +10,13 @@ void load_preset_tunings(int preset) {
   if (preset == 3) { tunings = PRESET3; };
   if (preset == 4) { tunings = PRESET4; };
 
+  load_tuning_values(tunings);
+}
+
+/// @brief Sets the strings, transpose and capo from a tuning array.
+/// @param tunings Seven values: hi melody, low melody, drone, trompette, buzz, transpose, capo.
+/// @details This is the same layout as the presets in `default_tunings.h`.
+void load_tuning_values(const int *tunings) {
   mystring->setOpenNote(tunings[0]);
   mylowstring->setOpenNote(tunings[1]);
   mydrone->setOpenNote(tunings[2]);
@@ -0,0 +1,223 @@
+#ifndef MACRO_VM_H
+#define MACRO_VM_H
+
+// The EX button macro engine: a tiny bytecode interpreter that strings existing gurdy actions
+// together (mute sets, transposes, loading tunings, volume ramps, auto-crank...) so one EX button
+// press can run a whole sequence.  This header is plain C++ with no Arduino dependencies so the
+// assembler in tools/ can check and run programs with exactly the same code.  macros.cpp connects
+// it to the gurdy.
+//
+// A program is at most MACRO_SIZE bytes: a list of instructions, each an opcode byte followed by its
+// operands, ending at END or at the end of the program space.  Operands are single bytes, except
+// times, which are two bytes (low byte first) of milliseconds.  The gurdy keeps MACRO_SLOTS programs
+// in EEPROM (see EEPROM_MACROS in eeprom_values.h).
+//
+// Programs never stall the gurdy: each pass through loop() runs at most a budget of instructions
+// (MACRO_BUDGET in config.h), and WAIT and RAMP hand control back to loop() until their time is up.
+
+#include <stdint.h>
+
+const int MACRO_SLOTS = 6;
+const int MACRO_SIZE = 32;
+
+// Strings, as bits of a string mask.
+const uint8_t MACRO_HI_MEL = 0x01;
+const uint8_t MACRO_LO_MEL = 0x02;
+const uint8_t MACRO_DRONE = 0x04;
+const uint8_t MACRO_TROMP = 0x08;     // For MUTE this is the trompette and buzz together
+const uint8_t MACRO_BUZZ = 0x10;
+const uint8_t MACRO_KEYCLICK = 0x20;
+const uint8_t MACRO_ALL = 0x3F;
+const int MACRO_NUM_STRINGS = 6;
+
+// The instructions.  Operands are listed after each.
+enum MacroOp : uint8_t {
+  MACRO_END = 0x00,       // Stop.
+  MACRO_FUNC = 0x01,      // func:  Run EX button function 2-10 or 13-15 (see ex_run_func()).
+  MACRO_MUTE = 0x02,      // mask:  Mute exactly the strings in the mask (HI_MEL, LO_MEL, DRONE, TROMP).
+  MACRO_TPOSE = 0x03,     // steps: Transpose by a signed number of semitones.
+  MACRO_CAPO = 0x04,      // capo:  Set the capo (0, 2 or 4).
+  MACRO_PRESET = 0x05,    // slot:  Load a preset tuning (1-4).
+  MACRO_LOAD = 0x06,      // slot:  Load a save slot (1-4).
+  MACRO_VOLUME = 0x07,    // mask, volume: Set the volume of the strings in the mask.
+  MACRO_RAMP = 0x08,      // mask, volume, ms: Move the volumes of the strings in the mask to a volume over a time.
+                          // Volumes are note-on velocities, so a sounding note doesn't follow a ramp: each step
+                          // is heard from the next note-on, and the drone and trompette are re-struck at its end.
+  MACRO_CRANK = 0x09,     // mode:  Auto-crank off (0), on (1) or toggled (2).
+  MACRO_WAIT = 0x0A,      // ms:    Do nothing for a time.
+  MACRO_NUM_OPS
+};
+
+// The byte length of each instruction, opcode included.
+const uint8_t MACRO_OP_LEN[MACRO_NUM_OPS] = {1, 2, 2, 2, 2, 2, 2, 3, 5, 2, 3};
+
+// What the engine can ask the gurdy to do.  macros.cpp fills these in on the gurdy, the assembler
+// with a simulated gurdy.  Volumes are MIDI volumes (0-127), strings are string mask bits.
+struct MacroActions {
+  void (*func)(int func);
+  void (*mute)(int mask);
+  void (*tpose)(int steps);
+  void (*capo)(int capo);
+  void (*preset)(int slot);
+  void (*load)(int slot);
+  int (*get_volume)(int string_bit);
+  void (*set_volume)(int string_bit, int volume);
+  void (*volume_done)(int mask);      // The volumes of these strings have finished changing
+  void (*crank)(int mode);
+};
+
+struct MacroVM {
+  uint8_t code[MACRO_SIZE];
+  int pc;
+  bool running;
+
+  // While waiting or ramping, the instruction at pc is in progress.
+  bool busy;
+  uint32_t start_ms;
+  uint8_t ramp_from[MACRO_NUM_STRINGS];
+};
+
+/// @brief Returns a 2-byte operand.
+inline uint32_t macro_time(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+/// @brief Checks a program before it runs.
+/// @param code The program
+/// @param len The bytes available to it (normally MACRO_SIZE)
+/// @param error Set to a description of the first problem found
+/// @param at Set to the byte offset of the first problem found
+/// @return True if the program is good
+inline bool macro_check(const uint8_t *code, int len, const char **error, int *at) {
+  int pc = 0;
+  while (pc < len && code[pc] != MACRO_END) {
+    *at = pc;
+    uint8_t op = code[pc];
+    if (op >= MACRO_NUM_OPS) {
+      *error = "unknown instruction";
+      return false;
+    }
+    if (pc + MACRO_OP_LEN[op] > len) {
+      *error = "instruction runs past the end of the program";
+      return false;
+    }
+    const uint8_t *arg = code + pc + 1;
+    // The others need an EX button's own settings (TPOSE, PRESET and LOAD do their jobs) or are loop()'s.
+    if (op == MACRO_FUNC && (arg[0] < 2 || arg[0] > 15 || arg[0] == 11 || arg[0] == 12)) {
+      *error = "EX function can't be run from a macro";
+      return false;
+    }
+    if ((op == MACRO_MUTE && arg[0] > (MACRO_HI_MEL | MACRO_LO_MEL | MACRO_DRONE | MACRO_TROMP)) ||
+        ((op == MACRO_VOLUME || op == MACRO_RAMP) && (arg[0] > MACRO_ALL || arg[1] > 127))) {
+      *error = "bad string mask or volume";
+      return false;
+    }
+    if ((op == MACRO_PRESET || op == MACRO_LOAD) && (arg[0] < 1 || arg[0] > 4)) {
+      *error = "slot must be 1-4";
+      return false;
+    }
+    if ((op == MACRO_CAPO && arg[0] != 0 && arg[0] != 2 && arg[0] != 4) || (op == MACRO_CRANK && arg[0] > 2)) {
+      *error = "bad capo or auto-crank mode";
+      return false;
+    }
+    pc += MACRO_OP_LEN[op];
+  }
+  return true;
+}
+
+/// @brief Starts a program from the beginning.  The program must have passed macro_check().
+inline void macro_begin(MacroVM &vm, const uint8_t *code) {
+  for (int x = 0; x < MACRO_SIZE; x++) {
+    vm.code[x] = code[x];
+  }
+  vm.pc = 0;
+  vm.running = true;
+  vm.busy = false;
+}
+
+/// @brief Runs the program for one pass through loop().
+/// @param vm The engine
+/// @param act What the instructions do
+/// @param now_ms The time now
+/// @param budget The most instructions to run.  A WAIT or RAMP still in progress counts as one.
+/// @return The number of instructions run
+inline int macro_run(MacroVM &vm, const MacroActions &act, uint32_t now_ms, int budget) {
+  int count = 0;
+  while (vm.running && count < budget) {
+    if (vm.pc >= MACRO_SIZE || vm.code[vm.pc] == MACRO_END) {
+      vm.running = false;
+      break;
+    }
+
+    uint8_t op = vm.code[vm.pc];
+    const uint8_t *arg = vm.code + vm.pc + 1;
+    count++;
+
+    if (op == MACRO_WAIT) {
+      if (!vm.busy) {
+        vm.busy = true;
+        vm.start_ms = now_ms;
+      }
+      if (now_ms - vm.start_ms < macro_time(arg + 0)) {
+        break;
+      }
+      vm.busy = false;
+
+    } else if (op == MACRO_RAMP) {
+      uint32_t ms = macro_time(arg + 2);
+      if (!vm.busy) {
+        vm.busy = true;
+        vm.start_ms = now_ms;
+        for (int s = 0; s < MACRO_NUM_STRINGS; s++) {
+          vm.ramp_from[s] = (arg[0] & (1 << s)) ? act.get_volume(1 << s) : 0;
+        }
+      }
+      uint32_t elapsed = now_ms - vm.start_ms;
+      if (elapsed > ms) {
+        elapsed = ms;
+      }
+      // Straight-line from each string's starting volume, only touching volumes that change.
+      for (int s = 0; s < MACRO_NUM_STRINGS; s++) {
+        if (arg[0] & (1 << s)) {
+          int from = vm.ramp_from[s];
+          int vol = (ms == 0) ? arg[1] : from + (int(arg[1]) - from) * int(elapsed) / int(ms);
+          if (vol != act.get_volume(1 << s)) {
+            act.set_volume(1 << s, vol);
+          }
+        }
+      }
+      if (elapsed < ms) {
+        break;
+      }
+      vm.busy = false;
+      act.volume_done(arg[0]);
+
+    } else if (op == MACRO_FUNC) {
+      act.func(arg[0]);
+    } else if (op == MACRO_MUTE) {
+      act.mute(arg[0]);
+    } else if (op == MACRO_TPOSE) {
+      act.tpose(int8_t(arg[0]));
+    } else if (op == MACRO_CAPO) {
+      act.capo(arg[0]);
+    } else if (op == MACRO_PRESET) {
+      act.preset(arg[0]);
+    } else if (op == MACRO_LOAD) {
+      act.load(arg[0]);
+    } else if (op == MACRO_VOLUME) {
+      for (int s = 0; s < MACRO_NUM_STRINGS; s++) {
+        if (arg[0] & (1 << s)) {
+          act.set_volume(1 << s, arg[1]);
+        }
+      }
+      act.volume_done(arg[0]);
+    } else if (op == MACRO_CRANK) {
+      act.crank(arg[0]);
+    }
+
+    vm.pc += MACRO_OP_LEN[op];
+  }
+  return count;
+}
+
+#endif
@@ -0,0 +1,180 @@
+#include "macros.h"
+
+#include <EEPROM.h>
+
+#include "common.h"
+#include "eeprom_values.h"
+#include "exfunctions.h"
+#include "macro_vm.h"
+
+/// @defgroup macros EX Button Macros
+/// These functions run EX button macros: short programs that sequence the things an EX button can do.
+///
+/// An EX button set to Run Macro starts one of the MACRO_SLOTS programs kept in EEPROM.  A program can set
+/// the mutes, transpose, capo and string volumes (at once or as a ramp), load a preset or save slot, turn
+/// auto-crank on or off, run the other EX functions and wait.  The bytecode and the engine that runs it are
+/// in macro_vm.h; programs are written as text and assembled with tools/macro_asm.cpp, then loaded onto the
+/// gurdy with a SysEx configuration load (tools/sysex_tool.cpp).
+///
+/// A macro runs a few instructions at a time, MACRO_BUDGET per loop(), so the keys and crank are
+/// handled as normal while it goes.  Starting a macro stops any macro already running.
+/// @note Volumes are MIDI note velocities, so a sounding note keeps its volume until it's played again: a ramp
+/// is heard on the melody strings as each new key is played, not as a swell of the held note.  When a volume
+/// change or ramp finishes, the drone and trompette strings are re-struck at the new volume.
+/// @version *New in 3.1.0*
+/// @{
+
+#ifdef USE_MACROS
+
+static MacroVM macro_vm;
+
+// Whether the gurdy was making sound at the start of this macro_update(), for the actions.
+static bool macro_playing = false;
+
+// The auto-crank state a CRANK instruction asked for, -1 if none.  loop() applies it.
+static int pending_crank = -1;
+
+// How long the "Not run" message stays up, and when it went up.  macro_update() takes it down.
+static const uint32_t MACRO_MESSAGE_MS = 750;
+static bool message_shown = false;
+static uint32_t message_ms = 0;
+
+/// @brief Returns the string of one string mask bit.
+static GurdyString *macro_string(int string_bit) {
+  if (string_bit == MACRO_HI_MEL) {
+    return mystring;
+  } else if (string_bit == MACRO_LO_MEL) {
+    return mylowstring;
+  } else if (string_bit == MACRO_DRONE) {
+    return mydrone;
+  } else if (string_bit == MACRO_TROMP) {
+    return mytromp;
+  } else if (string_bit == MACRO_BUZZ) {
+    return mybuzz;
+  };
+  return mykeyclick;
+};
+
+static void macro_func(int func) {
+  ex_run_func(func, macro_playing, 0, 0);
+};
+
+static void macro_tpose(int steps) {
+  int target = tpose_offset + steps;
+  if (target > max_tpose) {
+    target = max_tpose;
+  } else if (target < -max_tpose) {
+    target = -max_tpose;
+  };
+  tpose_up_x(macro_playing, target);
+};
+
+static void macro_capo(int capo) {
+  set_capo(macro_playing, capo);
+};
+
+static int macro_get_volume(int string_bit) {
+  return macro_string(string_bit)->getVolume();
+};
+
+static void macro_set_volume(int string_bit, int volume) {
+  macro_string(string_bit)->setVolume(volume);
+};
+
+/// @brief Re-strikes the sounding drone and trompette strings so they play at their new volumes.
+static void macro_volume_done(int mask) {
+  if ((mask & MACRO_DRONE) && mydrone->isPlaying()) {
+    mydrone->soundOff();
+    mydrone->soundOn();
+  };
+  if ((mask & MACRO_TROMP) && mytromp->isPlaying()) {
+    mytromp->soundOff();
+    mytromp->soundOn();
+  };
+};
+
+static void macro_crank(int mode) {
+  int current = (pending_crank >= 0) ? pending_crank : autocrank_toggle_on;
+  pending_crank = (mode == 2) ? !current : mode;
+};
+
+static const MacroActions macro_actions = {
+  macro_func, ex_set_mutes, macro_tpose, macro_capo, ex_load_preset, ex_load_save_slot,
+  macro_get_volume, macro_set_volume, macro_volume_done, macro_crank
+};
+
+/// @brief Starts a macro from EEPROM.
+/// @param macro The macro, 1 to MACRO_SLOTS
+/// @details A macro that's empty or doesn't check out isn't run; the reason is shown for MACRO_MESSAGE_MS (without
+/// holding up loop()) and sent to Serial.
+void macro_start(int macro) {
+  if (macro < 1 || macro > MACRO_SLOTS) {
+    return;
+  };
+
+  uint8_t code[MACRO_SIZE];
+  for (int x = 0; x < MACRO_SIZE; x++) {
+    code[x] = EEPROM.read(EEPROM_MACROS + (macro - 1) * MACRO_SIZE + x);
+  };
+
+  const char *error = "";
+  int at = 0;
+  bool empty = (code[0] == MACRO_END || code[0] == 0xFF);
+  if (empty || !macro_check(code, MACRO_SIZE, &error, &at)) {
+    if (!empty) {
+      Serial.print("Macro ");
+      Serial.print(macro);
+      Serial.print(": ");
+      Serial.print(error);
+      Serial.print(" at byte ");
+      Serial.println(at);
+    };
+    print_message_2(String("Macro ") + macro, empty ? "Empty" : "Not a valid program", "Not run");
+    message_shown = true;
+    message_ms = millis();
+    return;
+  };
+
+  macro_begin(macro_vm, code);
+};
+
+/// @brief Stops any running macro where it is.
+void macro_stop() {
+  macro_vm.running = false;
+};
+
+/// @brief Returns true if a macro is running.
+bool macro_running() {
+  return macro_vm.running;
+};
+
+/// @brief Runs up to MACRO_BUDGET instructions of the running macro, and takes down macro_start()'s message.
+/// @param playing True if currently playing sound, false otherwise.
+/// @note This is meant to be run every loop() cycle.
+void macro_update(bool playing) {
+  if (message_shown && millis() - message_ms >= MACRO_MESSAGE_MS) {
+    message_shown = false;
+    if (playing) {
+      draw_play_screen(mystring->getOpenNote() + tpose_offset + myoffset, play_screen_type, mybuzz->isPlaying());
+    } else {
+      print_display(mystring->getOpenNote(), mylowstring->getOpenNote(), mydrone->getOpenNote(), mytromp->getOpenNote(), tpose_offset, capo_offset, myoffset, mystring->getMute(), mylowstring->getMute(), mydrone->getMute(), mytromp->getMute());
+    };
+  };
+
+  if (!macro_vm.running) {
+    return;
+  };
+  macro_playing = playing;
+  macro_run(macro_vm, macro_actions, millis(), MACRO_BUDGET);
+};
+
+/// @brief Returns the auto-crank state a macro asked for since the last call: 0 = off, 1 = on, -1 = no change.
+int macro_take_crank() {
+  int crank = pending_crank;
+  pending_crank = -1;
+  return crank;
+};
+
+#endif
+
+/// @}
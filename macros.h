@@ -0,0 +1,14 @@
+#ifndef MACROS_H
+#define MACROS_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+void macro_start(int macro);
+void macro_stop();
+bool macro_running();
+void macro_update(bool playing);
+int macro_take_crank();
+
+#endif
@@ -0,0 +1,200 @@
+#include "midi_in.h"
+
+#include "common.h"
+
+/// @defgroup midi_in MIDI Input
+/// These functions play incoming MIDI on the strings, so a sequencer or a second controller can use the
+/// gurdy's Trigger/Tsunami (or whatever its MIDI output drives) as a sound module.
+///
+/// Notes and CCs arriving over USB or the MIDI-IN socket on one of the MIDI_IN_CHANNELS are played by the string
+/// sending on that channel: NoteOn and NoteOff through soundOn()/soundOff(), CC11 as the string's expression,
+/// CC120/CC123 by stopping the notes that came in, and other CCs passed on as they are.  They go out through the
+/// same calls as live playing, so they're counted, traced and gated per link just the same.  Only notes that came
+/// in are ever stopped, and a note the string is playing live is left alone both ways: an incoming NoteOn for it
+/// isn't played (or later stopped), and an incoming NoteOff for it can't cut it off.
+///
+/// loop() reads incoming MIDI once the keybox and crank are done, and plays at most MIDI_IN_MAX_PER_LOOP
+/// messages a pass.  A message waits at most one pass through loop() (plus one for every earlier pass that was
+/// full) before it's played.  There's no timestamp on incoming MIDI, so each message's latency is measured as an
+/// upper bound: from the start of the last pass that read every waiting message to when it has been sent on.
+/// NoteOns that waited longer than MIDI_IN_STALE_US are dropped rather than played late.
+///
+/// The counters are shown in Other Options -> Diagnostics -> MIDI Traffic.
+/// @version *New in 3.1.0*
+/// @{
+
+MidiInStats midi_in_stats;
+
+#ifdef USE_MIDI_IN
+
+static const int MIDI_IN_NOTE_OFF = 0x80;
+static const int MIDI_IN_NOTE_ON = 0x90;
+static const int MIDI_IN_CC = 0xB0;
+
+// The notes that came in and are still sounding, a bit per note for each string.
+static uint32_t held[6][4];
+
+static uint32_t pass_start_us = 0;      // When this pass started reading
+static uint32_t waiting_since_us = 0;   // Every waiting message arrived after this
+static int pass_played = 0;
+static bool pass_full = false;
+
+/// @brief Returns the string sending on a MIDI channel, and its index into held, or nullptr.
+static GurdyString *midi_in_string(int channel, int *index) {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+
+  for (int x = 0; x < 6; x++) {
+    if (strings[x]->getMidiChannel() == channel) {
+      *index = x;
+      return strings[x];
+    };
+  };
+  return nullptr;
+};
+
+/// @brief Adds one played message's latency to the counters.
+static void midi_in_measure() {
+  uint32_t waited = micros() - waiting_since_us;
+
+  midi_in_stats.latency_count += 1;
+  midi_in_stats.latency_total_us += waited;
+  if (waited > midi_in_stats.latency_max_us) {
+    midi_in_stats.latency_max_us = waited;
+  };
+};
+
+/// @brief Stops every note that came in on one string, except any the string has since started playing live.
+static void midi_in_release(GurdyString *string, int index) {
+  for (int note = 0; note < 128; note++) {
+    if ((held[index][note >> 5] & (1UL << (note & 31))) && !string->isPlayingNote(note)) {
+      string->soundOff(note);
+    };
+  };
+  memset(held[index], 0, sizeof(held[index]));
+};
+
+/// @brief Starts a pass through loop()'s reading of incoming MIDI.
+/// @details This should be run once a pass, before midi_in_room() and midi_in_play().
+void midi_in_pass_begin() {
+  uint32_t now = micros();
+
+  // If the last pass read everything waiting, what's waiting now arrived after it started.
+  if (!pass_full) {
+    waiting_since_us = pass_start_us;
+  };
+  if (pass_start_us == 0) {
+    waiting_since_us = now;
+  };
+
+  pass_start_us = now;
+  pass_played = 0;
+  pass_full = false;
+};
+
+/// @brief Reports whether this pass can play another incoming message.
+/// @return True if fewer than MIDI_IN_MAX_PER_LOOP have been played this pass, false otherwise.
+bool midi_in_room() {
+  if (pass_played < MIDI_IN_MAX_PER_LOOP) {
+    return true;
+  };
+
+  if (!pass_full) {
+    pass_full = true;
+    midi_in_stats.full_passes += 1;
+  };
+  return false;
+};
+
+/// @brief Plays one incoming MIDI message on the string sending on its channel.
+/// @param type The message type (the status byte without the channel), as MIDI.getType() and usbMIDI.getType()
+/// give it
+/// @param channel The MIDI channel, 1-16
+/// @param data1 The note or controller
+/// @param data2 The velocity or value
+/// @return True if the message was for MIDI_IN_CHANNELS and has been dealt with, false if it wasn't.
+bool midi_in_play(uint8_t type, int channel, int data1, int data2) {
+  if (type != MIDI_IN_NOTE_ON && type != MIDI_IN_NOTE_OFF && type != MIDI_IN_CC) {
+    return false;
+  };
+  if (channel < 1 || channel > 16 || !(MIDI_IN_CHANNELS & (1U << (channel - 1)))) {
+    midi_in_stats.ignored += 1;
+    return false;
+  };
+
+  int index = 0;
+  GurdyString *string = midi_in_string(channel, &index);
+  midi_in_stats.received += 1;
+  if (string == nullptr) {
+    midi_in_stats.ignored += 1;
+    return true;
+  };
+
+  int note = data1 & 127;
+  uint32_t bit = 1UL << (note & 31);
+  uint32_t *word = &held[index][note >> 5];
+
+  // The player's note wins: one MIDI note can't be sounded and stopped by two owners.
+  if (type != MIDI_IN_CC && string->isPlayingNote(note)) {
+    *word &= ~bit;
+    midi_in_stats.live += 1;
+    return true;
+  };
+
+  // A NoteOn with no velocity is a NoteOff.
+  if (type == MIDI_IN_NOTE_ON && data2 > 0) {
+    if (micros() - waiting_since_us > MIDI_IN_STALE_US) {
+      midi_in_stats.late += 1;
+      return true;
+    };
+    pass_played += 1;
+    *word |= bit;
+    string->soundOn(0, 0, note);
+    midi_in_stats.note_ons += 1;
+
+  } else if (type != MIDI_IN_CC) {
+    if (!(*word & bit)) {
+      midi_in_stats.ignored += 1;
+      return true;
+    };
+    pass_played += 1;
+    *word &= ~bit;
+    string->soundOff(note);
+    midi_in_stats.note_offs += 1;
+
+  } else {
+    pass_played += 1;
+    if (data1 == 11) {
+      string->setExpression(data2);
+      #ifdef USE_TRIGGER_EXPRESSION
+      string->setTriggerExpression(data2);
+      #endif
+    } else if (data1 == 120 || data1 == 123) {
+      midi_in_release(string, index);
+    } else {
+      string->setControl(data1, data2);
+    };
+    midi_in_stats.ccs += 1;
+  };
+
+  midi_in_measure();
+  return true;
+};
+
+/// @brief Stops every note that came in, on every string.
+/// @note This should be run before the strings change channels (see mpe_start()), while they can still stop them.
+void midi_in_release_all() {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+
+  for (int x = 0; x < 6; x++) {
+    midi_in_release(strings[x], x);
+  };
+};
+
+/// @brief Zeroes the counters.
+void midi_in_reset() {
+  memset(&midi_in_stats, 0, sizeof(midi_in_stats));
+};
+
+#endif
+
+/// @}
@@ -0,0 +1,38 @@
+#ifndef MIDI_IN_H
+#define MIDI_IN_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+struct MidiInStats {
+  uint32_t received;              // Notes and CCs read on MIDI_IN_CHANNELS
+  uint32_t note_ons;              // Played
+  uint32_t note_offs;
+  uint32_t ccs;
+  uint32_t late;                  // NoteOns dropped for waiting longer than MIDI_IN_STALE_US
+  uint32_t ignored;               // On other channels, other kinds, or NoteOffs for notes not playing
+  uint32_t live;                  // Notes left alone because the string is playing them live
+  uint32_t full_passes;           // Passes through loop() that hit MIDI_IN_MAX_PER_LOOP
+  uint32_t latency_count;
+  uint64_t latency_total_us;
+  uint32_t latency_max_us;
+};
+
+extern MidiInStats midi_in_stats;
+
+void midi_in_pass_begin();
+bool midi_in_room();
+bool midi_in_play(uint8_t type, int channel, int data1, int data2);
+void midi_in_release_all();
+void midi_in_reset();
+
+#ifdef USE_MIDI_IN
+  #define MIDI_IN_ROOM() midi_in_room()
+  #define MIDI_IN_PLAY(type, channel, data1, data2) midi_in_play(type, channel, data1, data2)
+#else
+  #define MIDI_IN_ROOM() true
+  #define MIDI_IN_PLAY(type, channel, data1, data2) false
+#endif
+
+#endif
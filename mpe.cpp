@@ -0,0 +1,114 @@
+#include "mpe.h"
+
+#include "common.h"
+#include "midi_in.h"
+#include "play_functions.h"
+#include "sinks.h"
+#include "traffic.h"
+
+/// @defgroup mpe MPE Output
+/// These functions run the MPE (MIDI Polyphonic Expression) output mode.
+///
+/// Normally every string has its own MIDI channel (1-6), crank expression goes to each of them as CC11 and
+/// vibrato as CC1, leaving the vibrato itself to the synth.  In MPE mode the gurdy is an MPE Lower Zone:
+/// channel 1 is the master channel and the strings move up one, to member channels 2-7.  Expression goes out
+/// as channel pressure, which an MPE synth treats as per-note pressure and which takes two bytes on MIDI-OUT
+/// instead of three.  The vibrato amount goes to each member channel as CC1 and the synth makes the vibrato, as
+/// it does outside MPE mode.
+///
+/// Expression and vibrato are sent from mpe_update() at most every MPE_RATE_MS, and only when they changed, so
+/// a fast-changing crank costs at most one pressure message per string per MPE_RATE_MS and a steady one nothing.
+///
+/// Trigger/Tsunami output is the same in either mode.  The choice is saved in EEPROM_MPE.
+/// @version *New in 3.1.0*
+/// @{
+
+bool mpe_on = false;
+
+#ifdef USE_MPE
+
+static uint32_t last_update_ms = 0;
+
+/// @brief Sends a Registered Parameter Number over USB and, unless Trigger/Tsunami-only, the MIDI-OUT socket.
+/// @param channel The MIDI channel
+/// @param rpn The parameter (0 = pitch bend range, 6 = MPE configuration)
+/// @param value The value (data entry MSB)
+static void mpe_send_rpn(int channel, int rpn, int value) {
+  // Select the parameter, set it, then deselect it ("null RPN") so stray data entry can't change it.
+  const int ccs[5][2] = {{101, 0}, {100, rpn}, {6, value}, {101, 127}, {100, 127}};
+  bool midi_out = (mystring->getOutputMode() != 1);
+
+  for (int x = 0; x < 5; x++) {
+    if (SINK_READY(TRAFFIC_USB)) {
+      TRAFFIC_COUNT(TRAFFIC_USB, TRAFFIC_CC_OTHER);
+      usbMIDI.sendControlChange(ccs[x][0], ccs[x][1], channel);
+    };
+    if (midi_out) {
+      TRAFFIC_COUNT(TRAFFIC_SERIAL, TRAFFIC_CC_OTHER);
+      MIDI.sendControlChange(ccs[x][0], ccs[x][1], channel);
+    };
+  };
+};
+
+/// @brief Moves the strings to their member channels and sends the zone setup.
+/// @details Any sounding notes are stopped first: they were started on the old channels.
+void mpe_start() {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+
+  all_soundOff();
+  #ifdef USE_MIDI_IN
+  midi_in_release_all();
+  #endif
+
+  // The MPE Configuration Message: a Lower Zone of one member channel per string.  This resets the members'
+  // pitch bend range to 48 semitones, so ours follows it.  It applies to every member of the zone.
+  mpe_send_rpn(1, 6, 6);
+  for (int x = 0; x < 6; x++) {
+    strings[x]->setMpe(true);
+  };
+  mpe_send_rpn(mystring->getMidiChannel(), 0, MPE_BEND_RANGE);
+
+  mpe_on = true;
+};
+
+/// @brief Turns the zone off and moves the strings back to their own channels.
+void mpe_stop() {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+
+  all_soundOff();
+  #ifdef USE_MIDI_IN
+  midi_in_release_all();
+  #endif
+
+  mpe_send_rpn(1, 6, 0);
+  for (int x = 0; x < 6; x++) {
+    strings[x]->setMpe(false);
+  };
+
+  mpe_on = false;
+};
+
+/// @brief Sends the strings' expression and vibrato, at most every MPE_RATE_MS.
+/// @note This is meant to be run every loop() cycle.
+void mpe_update() {
+  if (!mpe_on) {
+    return;
+  };
+
+  uint32_t now = millis();
+  if (now - last_update_ms < (uint32_t)MPE_RATE_MS) {
+    return;
+  };
+  last_update_ms = now;
+
+  mystring->mpeUpdate();
+  mylowstring->mpeUpdate();
+  mytromp->mpeUpdate();
+  mydrone->mpeUpdate();
+  mybuzz->mpeUpdate();
+  mykeyclick->mpeUpdate();
+};
+
+#endif
+
+/// @}
@@ -0,0 +1,14 @@
+#ifndef MPE_H
+#define MPE_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+extern bool mpe_on;
+
+void mpe_start();
+void mpe_stop();
+void mpe_update();
+
+#endif
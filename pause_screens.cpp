@@ -148,13 +148,18 @@ bool load_tuning_screen() {
   bool done = false;
   while (!done) {
 
+    #ifdef USE_SD_TUNINGS
+    print_menu_3("Load Tuning", "Preset Tuning", "Saved Tuning", "SD Card Library");
+    #else
     print_menu_2("Load Tuning", "Preset Tuning", "Saved Tuning");
+    #endif
     delay(150);
 
     // Check the 1 and 2 buttons
     my1Button->update();
     my2Button->update();
     my3Button->update();
+    my4Button->update();
     myXButton->update();
 
     if (my1Button->wasPressed()) {
@@ -167,9 +172,20 @@ bool load_tuning_screen() {
         done = true;
       };
 
+    #ifdef USE_SD_TUNINGS
+    } else if (my3Button->wasPressed()) {
+      if (load_sd_screen()) {
+        done = true;
+      };
+
+    } else if (my4Button->wasPressed() || myXButton->wasPressed()) {
+      return false;
+    };
+    #else
     } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
       return false;
     };
+    #endif
   };
 
   return true;
@@ -321,7 +337,7 @@ bool other_options_screen() {
   while (!done) {
 
     #ifndef USE_GEARED_CRANK
-    print_menu_4("Other Options", "EX Button Config", "Screen Configuration", "Input/Output Config", "About Digi-Gurdy");
+    print_menu_5("Other Options", "EX Button Config", "Screen Configuration", "Input/Output Config", "Diagnostics", "About Digi-Gurdy");
 
     delay(150);
 
@@ -330,6 +346,7 @@ bool other_options_screen() {
     my3Button->update();
     my4Button->update();
     my5Button->update();
+    my6Button->update();
     myXButton->update();
 
     if (my1Button->wasPressed()) {
@@ -342,15 +359,20 @@ bool other_options_screen() {
       io_screen();
 
     } else if (my4Button->wasPressed()) {
+      if (diagnostics_screen()) {
+        return true;
+      };
+
+    } else if (my5Button->wasPressed()) {
       options_about_screen();
 
-    } else if (my5Button->wasPressed() || myXButton->wasPressed()) {
+    } else if (my6Button->wasPressed() || myXButton->wasPressed()) {
       return false;
     };
 
     #else
 
-    print_menu_5("Other Options", "Crank Detection", "EX Button Config", "Screen Configuration", "Input/Output Config", "About Digi-Gurdy");
+    print_menu_6("Other Options", "Crank Detection", "EX Button Config", "Screen Configuration", "Input/Output Config", "Diagnostics", "About Digi-Gurdy");
     
     delay(150);
 
@@ -384,9 +406,14 @@ bool other_options_screen() {
       io_screen();
 
     } else if (my5Button->wasPressed()) {
+      if (diagnostics_screen()) {
+        return true;
+      };
+
+    } else if (my6Button->wasPressed()) {
       options_about_screen();
 
-    } else if (my6Button->wasPressed() || myXButton->wasPressed()) {
+    } else if (myXButton->wasPressed()) {
       return false;
     };
  
@@ -396,6 +423,101 @@ bool other_options_screen() {
   return true;
 };
 
+/// @brief Prompts the user to choose between the diagnostic and testing tools.
+/// @return True if a tool wants play to resume right away, false otherwise
+/// @version *New in 3.1.0*
+bool diagnostics_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    String opt1 = "This Option Disabled";
+    #ifdef CRANK_CAPTURE
+    opt1 = "Crank Capture";
+    #endif
+
+    String opt2 = "This Option Disabled";
+    #ifdef USE_TRACE
+    opt2 = "Trace Recording";
+    #endif
+
+    String opt3 = "This Option Disabled";
+    #ifdef USE_STREAM_TEST
+    opt3 = "MIDI Self-Test";
+    #endif
+
+    String opt4 = "This Option Disabled";
+    #ifdef USE_BENCH
+    opt4 = "Benchmarks";
+    #endif
+
+    String opt5 = "This Option Disabled";
+    #ifdef USE_TRAFFIC_STATS
+    opt5 = "MIDI Traffic";
+    #endif
+
+    String opt6 = "This Option Disabled";
+    #ifdef USE_LIVE_STATUS
+    opt6 = live_status_on ? "Stop Live Status" : "Live Status";
+    #endif
+
+    print_menu_6("Diagnostics", opt1, opt2, opt3, opt4, opt5, opt6);
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    my4Button->update();
+    my5Button->update();
+    my6Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      #ifdef CRANK_CAPTURE
+      if (crank_capture_screen()) {
+        return true;
+      };
+      #endif
+
+    } else if (my2Button->wasPressed()) {
+      #ifdef USE_TRACE
+      if (trace_screen()) {
+        return true;
+      };
+      #endif
+
+    } else if (my3Button->wasPressed()) {
+      #ifdef USE_STREAM_TEST
+      stream_test_screen();
+      #endif
+
+    } else if (my4Button->wasPressed()) {
+      #ifdef USE_BENCH
+      bench_screen();
+      #endif
+
+    } else if (my5Button->wasPressed()) {
+      #ifdef USE_TRAFFIC_STATS
+      traffic_screen();
+      #endif
+
+    } else if (my6Button->wasPressed()) {
+      #ifdef USE_LIVE_STATUS
+      if (live_status_on) {
+        live_status_stop();
+      } else {
+        live_status_start();
+        return true;
+      };
+      #endif
+
+    } else if (myXButton->wasPressed()) {
+      done = true;
+    };
+  };
+  return false;
+};
+
 /// @brief Saves the current tuning/volume to the given save slot.
 /// @param slot 1-4, the EEPROM save slot to write to.
 void save_tunings(int slot) {
@@ -471,6 +593,16 @@ void reset_eeprom() {
   mydrone->setOutputMode(0);
   mykeyclick->setOutputMode(0);
   mybuzz->setOutputMode(0);  
+
+  #ifdef USE_MPE
+  if (mpe_on) {
+    mpe_stop();
+  };
+  #endif
+
+  #ifdef USE_LEGATO
+  set_legato(0);
+  #endif
 };
 
 /// @brief Prompts the user to choose a saved tuning slot, and calls view_slot_screen() for that slot.
@@ -746,9 +878,7 @@ void led_screen() {
     if (my1Button->wasPressed()) {
       EEPROM.write(EEPROM_BUZZ_LED, 1);
 
-      #ifndef USE_GEARED_CRANK
-        mycrank->enableLED();
-      #endif
+      mycrank->enableLED();
 
       print_message_2("Buzz LED On/Off", "Buzz LED On", "Saved to EEPROM");
       delay(1000);
@@ -758,9 +888,7 @@ void led_screen() {
     } else if (my2Button->wasPressed()) {
       EEPROM.write(EEPROM_BUZZ_LED, 0);
 
-      #ifndef USE_GEARED_CRANK
-        mycrank->disableLED();
-      #endif
+      mycrank->disableLED();
       
       print_message_2("Buzz LED On/Off", "Buzz LED Off", "Saved to EEPROM");
       delay(1000);
@@ -774,6 +902,95 @@ void led_screen() {
   };
 };
 
+#ifdef USE_MPE
+/// @brief Prompts user to turn the MPE output mode on or off.
+/// @details See the MPE Output group (mpe.cpp) for what changes.
+void mpe_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    print_menu_2("MPE Output On/Off", "Enable MPE (On)", "Disable MPE (Off)");
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      EEPROM.write(EEPROM_MPE, 1);
+      mpe_start();
+
+      print_message_2("MPE Output On/Off", "MPE Output On", "Saved to EEPROM");
+      delay(1000);
+
+      done = true;
+
+    } else if (my2Button->wasPressed()) {
+      EEPROM.write(EEPROM_MPE, 0);
+      if (mpe_on) {
+        mpe_stop();
+      };
+
+      print_message_2("MPE Output On/Off", "MPE Output Off", "Saved to EEPROM");
+      delay(1000);
+
+      done = true;
+
+    } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
+      done = true;
+
+    };
+  };
+};
+#endif
+
+#ifdef USE_LEGATO
+/// @brief Prompts user to choose how the melody strings change notes.
+/// @details See GurdyString::changeNote() for what each choice sends.
+void legato_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    print_menu_3("Legato Key Changes", "Off (Strike Each Note)", "Pitch Bend Glide", "Mono Legato (Overlap)");
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    my4Button->update();
+    myXButton->update();
+
+    int choice = -1;
+    String msg;
+    if (my1Button->wasPressed()) {
+      choice = 0;
+      msg = "Legato Off";
+    } else if (my2Button->wasPressed()) {
+      choice = 1;
+      msg = "Pitch Bend Glide";
+    } else if (my3Button->wasPressed()) {
+      choice = 2;
+      msg = "Mono Legato";
+    } else if (my4Button->wasPressed() || myXButton->wasPressed()) {
+      done = true;
+    };
+
+    if (choice >= 0) {
+      EEPROM.write(EEPROM_LEGATO, choice);
+      set_legato(choice);
+
+      print_message_2("Legato Key Changes", msg, "Saved to EEPROM");
+      delay(1000);
+
+      done = true;
+    };
+  };
+};
+#endif
+
 /// @brief This menu screen is for enabling/disabling the accessory/vibrato pedal.
 void vib_screen() {
 
@@ -915,19 +1132,23 @@ void io_screen() {
 
     String opt2 = "This Option Disabled";
     String opt3 = "This Option Disabled";
+    String opt4 = "This Option Disabled";
+    String opt5 = "This Option Disabled";
     #ifdef USE_PEDAL
     opt2 = "Vibrato Pedal On/Off";
     #endif
     #ifdef LED_KNOB
     opt3 = "Buzz LED On/Off";
     #endif
-
-    #ifndef USE_GEARED_CRANK
-    print_menu_4("Input/Output Options", "Secondary Output", "MIDI Melody Vibrato", opt2, opt3);
-    #else
-    print_menu_4("Input/Output Options", "Secondary Output", "MIDI Melody Vibrato", opt2, opt3);
+    #ifdef USE_MPE
+    opt4 = "MPE Output On/Off";
+    #endif
+    #ifdef USE_LEGATO
+    opt5 = "Legato Key Changes";
     #endif
 
+    print_menu_6("Input/Output Options", "Secondary Output", "MIDI Melody Vibrato", opt2, opt3, opt4, opt5);
+
     delay(150);
 
     my1Button->update();
@@ -935,6 +1156,7 @@ void io_screen() {
     my3Button->update();
     my4Button->update();
     my5Button->update();
+    my6Button->update();
     myXButton->update();
 
     if (my1Button->wasPressed()) {
@@ -953,7 +1175,17 @@ void io_screen() {
       led_screen();
       #endif
 
-    } else if (my5Button->wasPressed() || myXButton->wasPressed()) {
+    } else if (my5Button->wasPressed()) {
+      #ifdef USE_MPE
+      mpe_screen();
+      #endif
+
+    } else if (my6Button->wasPressed()) {
+      #ifdef USE_LEGATO
+      legato_screen();
+      #endif
+
+    } else if (myXButton->wasPressed()) {
       done = true;
     };
   };
@@ -20,25 +20,29 @@
 #include "usb_power.h"
 #include "load_tunings.h"
 
-#ifdef USE_GEARED_CRANK
-  #include "gearcrank.h"
-#else
-  #include "gurdycrank.h"
+#ifdef USE_SD_TUNINGS
+  #include "sd_tunings.h"
 #endif
 
+#include "crank.h"
+
 #include "vibknob.h"
+#include "crank_capture.h"
+#include "trace.h"
+#include "stream_test.h"
+#include "benchmarks.h"
+#include "traffic.h"
+#include "live_status.h"
+#include "mpe.h"
 
-#ifdef USE_GEARED_CRANK
-  extern GearCrank *mycrank;
-#else
-  extern GurdyCrank *mycrank;
-#endif
+extern Crank *mycrank;
 
 extern VibKnob *myvibknob;
 
 void pause_screen();
 void options_about_screen();
 bool other_options_screen();
+bool diagnostics_screen();
 void save_tunings(int slot);
 bool load_tuning_screen();
 bool check_save_tuning(int slot);
@@ -56,6 +60,8 @@ void sec_output_screen();
 void options_screen();
 void welcome_screen();
 void led_screen();
+void mpe_screen();
+void legato_screen();
 void vib_screen();
 void playing_config_screen();
 void notation_config_screen();
@@ -1,5 +1,7 @@
 #include "play_functions.h"
 
+#include "mpe.h"
+
 /// @ingroup play
 /// @{
 
@@ -181,11 +183,20 @@ void tpose_down_1(bool playing) {
 /// @param playing True if currently playing sound, false otherwise.
 /// @version *New in  2.3.7*
 void cycle_capo(bool playing) {
-  capo_offset += 2;
+  int capo = capo_offset + 2;
+  if (capo > max_capo) {
+    capo = 0;
+  };
+  set_capo(playing, capo);
+};
 
-    if (capo_offset > max_capo ) {
-      capo_offset = 0;
-    };
+/// @brief Adjusts the transpose by a given number of steps
+/// @param playing True if currently playing sound, false otherwise.
+/// @param steps Number of semitones to move (signed)
+/// @version *New in  2.5.7*
+void tpose_up_x(bool playing, int steps) {
+  if (max_tpose + steps >= 0) {
+      tpose_offset = steps;
 
     if (playing) {
       no_buzz_soundOff();
@@ -199,17 +210,18 @@ void cycle_capo(bool playing) {
       draw_play_screen(mystring->getOpenNote() + tpose_offset + myoffset, play_screen_type, false);
     } else {
       print_display(mystring->getOpenNote(), mylowstring->getOpenNote(), mydrone->getOpenNote(), mytromp->getOpenNote(),
-                 tpose_offset, capo_offset, myoffset, mystring->getMute(), mylowstring->getMute(), mydrone->getMute(), mytromp->getMute());
+                  tpose_offset, capo_offset, myoffset, mystring->getMute(), mylowstring->getMute(), mydrone->getMute(), mytromp->getMute());
     };
+  };
 };
 
-/// @brief Adjusts the transpose by a given number of steps
+/// @brief Sets the capo, and adjusts any playing notes.
 /// @param playing True if currently playing sound, false otherwise.
-/// @param steps Number of semitones to move (signed)
-/// @version *New in  2.5.7*
-void tpose_up_x(bool playing, int steps) {
-  if (max_tpose + steps >= 0) {
-      tpose_offset = steps;
+/// @param capo The capo: 0, 2 or up to max_capo
+/// @version *New in 3.1.0*
+void set_capo(bool playing, int capo) {
+  if (capo >= 0 && capo <= max_capo) {
+    capo_offset = capo;
 
     if (playing) {
       no_buzz_soundOff();
@@ -228,4 +240,47 @@ void tpose_up_x(bool playing, int steps) {
   };
 };
 
+/// @brief Moves the melody strings to the key now pressed, with a key click.
+/// @details Normally the old notes are turned off and the new ones on.  With a legato mode set (see set_legato())
+/// the melody strings glide or slur to the new note instead.  The drone and trompette are left alone.
+/// @version *New in 3.1.0*
+void key_change() {
+  #ifdef USE_LEGATO
+  if (mystring->getLegato() != LEGATO_OFF) {
+    mykeyclick->soundOff();
+
+    mystring->changeNote(myoffset + tpose_offset, mel_vibrato);
+    mylowstring->changeNote(myoffset + tpose_offset, mel_vibrato);
+    mykeyclick->soundOn(tpose_offset);
+    return;
+  };
+  #endif
+
+  mystring->soundOff();
+  mylowstring->soundOff();
+  mykeyclick->soundOff();
+
+  mystring->soundOn(myoffset + tpose_offset, mel_vibrato);
+  mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
+  mykeyclick->soundOn(tpose_offset);
+};
+
+/// @brief Sets how the melody strings change notes.  See GurdyString::changeNote().
+/// @param mode 0 (off), 1 (pitch bend glide) or 2 (mono legato), as saved in EEPROM_LEGATO
+/// @details Choosing glide also sets the melody channels' pitch bend range to LEGATO_BEND_RANGE, unless MPE (which
+/// sets its own) is on.
+/// @version *New in 3.1.0*
+void set_legato(int mode) {
+  if (mode < LEGATO_OFF || mode > LEGATO_OVERLAP) {
+    mode = LEGATO_OFF;
+  };
+  mystring->setLegato((LegatoMode)mode);
+  mylowstring->setLegato((LegatoMode)mode);
+
+  if (mode == LEGATO_GLIDE && !mpe_on) {
+    mystring->setBendRange(LEGATO_BEND_RANGE);
+    mylowstring->setBendRange(LEGATO_BEND_RANGE);
+  };
+};
+
 /// @}
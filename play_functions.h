@@ -15,5 +15,8 @@ void tpose_up_1(bool playing);
 void tpose_down_1(bool playing);
 void cycle_capo(bool playing);
 void tpose_up_x(bool playing, int steps);
+void set_capo(bool playing, int capo);
+void set_legato(int mode);
+void key_change();
 
 #endif
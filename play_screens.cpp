@@ -128,6 +128,14 @@ void print_note(String note_str, int x_offset) {
 /// @param screen_type The arrangement to display.  See the code itself to know what they mean: this is a magic number.
 /// @param draw_buzz If true, draw the on-screen buzz indicator.
 void draw_play_screen(int note, int screen_type, bool draw_buzz) {
+  TRACE_SCOPE(TRACE_DISPLAY);
+
+  // The live status screen has the display.
+  #ifdef USE_LIVE_STATUS
+  if (live_status_on) {
+    return;
+  };
+  #endif
 
   u8g2.clearBuffer();
   u8g2.setBitmapMode(1); // this lets you overlay bitmaps transparently
@@ -172,6 +180,14 @@ void draw_play_screen(int note, int screen_type, bool draw_buzz) {
 /// @param tromp_mute True if trompette is muted
 void print_display(int mel1, int mel2, int drone, int tromp, int tpose, int cap, int offset, bool hi_mute, bool lo_mute, bool drone_mute, bool tromp_mute) {
 
+  // The live status screen has the display, but whatever was on it (e.g. a menu) needs replacing.
+  #ifdef USE_LIVE_STATUS
+  if (live_status_on) {
+    live_status_redraw();
+    return;
+  };
+  #endif
+
   u8g2.clearBuffer();
   u8g2.setFontMode(1);
   u8g2.setFont(u8g2_font_finderskeepers_tf);
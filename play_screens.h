@@ -5,6 +5,8 @@
 #include "note_bitmaps.h"
 #include "staff_bitmaps.h"
 #include "notes.h"
+#include "trace.h"
+#include "live_status.h"
 
 // true = G/C tuning, false = D/G.  For the menus.
 extern bool gc_or_dg;
@@ -0,0 +1,225 @@
+#ifndef SD_CATALOG_H
+#define SD_CATALOG_H
+
+// The SD card tuning catalog: reading and parsing tuning files and building the sorted, de-duplicated list the
+// load menu browses.  sd_tunings.cpp opens the files on the card and hands them to these.  This header is plain
+// C++ with no Arduino dependencies so tools/sd_tunings.cpp can index a copy of the card exactly as the gurdy does.
+//
+// A tuning line is:
+//
+//     name,hi_mel,lo_mel,drone,tromp,buzz,tpose,capo
+//
+// Notes are MIDI note numbers (0-127), tpose is -12 to +12 and capo is 0, 2 or 4, as cycle_capo() steps it.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @brief The longest SD tuning name kept.  Longer names are cut off to fit the screen.
+const int SD_TUNING_NAME_LEN = 23;
+
+// One entry in the in-RAM catalog of SD card tunings.  The tuning values themselves stay on the
+// card: the catalog only remembers where to find them, so loading one is a single seek + line read.
+struct SDTuningEntry {
+  uint32_t name_hash;    // FNV-1a hash of the name
+  uint32_t value_hash;   // FNV-1a hash of the seven values, to tell same-named tunings apart
+  uint32_t offset;       // Byte offset of the tuning's line within its file
+  uint16_t line;         // The line number (from 1), for reporting
+  uint8_t file_idx;      // Index into the catalog's file table
+  uint8_t key;           // The high melody open note, used to group tunings by key
+  char name[SD_TUNING_NAME_LEN + 1];
+};
+
+// What sd_catalog_add() did with a tuning.
+enum SDAddResult : uint8_t {
+  SD_ADDED = 0,
+  SD_ADDED_SAME_NAME,    // Added, but an earlier tuning has the same name and different values
+  SD_SKIPPED_SAME,       // Not added: an earlier tuning has the same name and values
+  SD_SKIPPED_FULL,       // Not added: the catalog is full
+  SD_SKIPPED_BAD         // Not a tuning (and not blank or a comment)
+};
+
+/// @brief Hashes bytes (32-bit FNV-1a).
+inline uint32_t sd_hash(const uint8_t *data, int len, uint32_t hash = 2166136261UL) {
+  for (int x = 0; x < len; x++) {
+    hash ^= data[x];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/// @brief Reads one line from an open file into buf, without the line ending.
+/// @param f The file to read from: anything whose read() returns the next byte, or -1 at the end
+/// @param buf The buffer to fill.  Over-long lines are truncated but still fully consumed.
+/// @param len The size of buf
+/// @return The number of characters stored, or -1 at end of file.
+template <class Source>
+int sd_read_line(Source &f, char *buf, int len) {
+  int count = 0;
+  int c = f.read();
+
+  if (c < 0) {
+    return -1;
+  }
+
+  while (c >= 0 && c != '\n') {
+    if (c != '\r' && count < len - 1) {
+      buf[count++] = (char)c;
+    }
+    c = f.read();
+  }
+  buf[count] = '\0';
+  return count;
+}
+
+/// @brief Splits a tuning line into its name and values.
+/// @param line The line, modified in place
+/// @param name Set to point at the name within line
+/// @param tunings Filled with the seven tuning values (see `default_tunings.h` for the order)
+/// @return True if the line is a valid tuning, false otherwise.
+inline bool sd_parse_line(char *line, char **name, int *tunings) {
+  if (line[0] == '\0' || line[0] == '#') {
+    return false;
+  }
+
+  char *field = strtok(line, ",");
+  if (field == NULL) {
+    return false;
+  }
+  *name = field;
+
+  for (int x = 0; x < 7; x++) {
+    field = strtok(NULL, ",");
+    if (field == NULL) {
+      return false;
+    }
+    tunings[x] = atoi(field);
+  }
+
+  for (int x = 0; x < 5; x++) {
+    if (tunings[x] < 0 || tunings[x] > 127) {
+      return false;
+    }
+  }
+
+  return (tunings[5] >= -12 && tunings[5] <= 12 && (tunings[6] == 0 || tunings[6] == 2 || tunings[6] == 4));
+}
+
+/// @brief Adds a parsed tuning to the catalog, unless it's already there.
+/// @details The same tuning showing up twice (the same name and values, e.g. in two files) is listed once.
+/// Different tunings with the same name are both listed, and the caller is told so it can report them.
+/// @param catalog The catalog
+/// @param count The number of entries in it, increased if the tuning is added
+/// @param max The catalog's size
+/// @param name The tuning's name, cut off at SD_TUNING_NAME_LEN
+/// @param tunings The seven tuning values
+/// @param file_idx The index of the tuning's file in the file table
+/// @param line The tuning's line number in its file
+/// @param offset The byte offset of the line in its file
+/// @param other Set to the earlier entry for SD_ADDED_SAME_NAME and SD_SKIPPED_SAME, -1 otherwise
+/// @return What was done with the tuning
+inline SDAddResult sd_catalog_add(SDTuningEntry *catalog, int *count, int max, const char *name, const int *tunings,
+                                  uint8_t file_idx, uint16_t line, uint32_t offset, int *other) {
+  char kept[SD_TUNING_NAME_LEN + 1];
+  strncpy(kept, name, SD_TUNING_NAME_LEN);
+  kept[SD_TUNING_NAME_LEN] = '\0';
+
+  uint8_t values[7];
+  for (int x = 0; x < 7; x++) {
+    values[x] = (uint8_t)tunings[x];
+  }
+  uint32_t name_hash = sd_hash((const uint8_t *)kept, strlen(kept));
+  uint32_t value_hash = sd_hash(values, sizeof(values));
+
+  SDAddResult result = SD_ADDED;
+  *other = -1;
+  for (int x = 0; x < *count; x++) {
+    if (catalog[x].name_hash == name_hash && strcmp(catalog[x].name, kept) == 0) {
+      *other = x;
+      if (catalog[x].value_hash == value_hash) {
+        return SD_SKIPPED_SAME;
+      }
+      result = SD_ADDED_SAME_NAME;
+    }
+  }
+
+  if (*count >= max) {
+    *other = -1;
+    return SD_SKIPPED_FULL;
+  }
+
+  SDTuningEntry *entry = &catalog[(*count)++];
+  entry->name_hash = name_hash;
+  entry->value_hash = value_hash;
+  entry->offset = offset;
+  entry->line = line;
+  entry->file_idx = file_idx;
+  entry->key = tunings[0];
+  memcpy(entry->name, kept, sizeof(kept));
+  return result;
+}
+
+/// @brief Adds every tuning in an open file to the catalog.
+/// @tparam LineLen The longest line read, including its terminator
+/// @param f The file: anything with read() as sd_read_line() wants and position(), the offset of the next byte
+/// @param file_idx The file's index in the file table
+/// @param catalog The catalog
+/// @param count The number of entries in it
+/// @param max The catalog's size
+/// @param report Called as report(line, result, other) for every line that isn't simply added, blank or a
+/// comment, with sd_catalog_add()'s result (or SD_SKIPPED_BAD) and earlier entry.
+template <int LineLen, class Source, class Report>
+void sd_catalog_index(Source &f, uint8_t file_idx, SDTuningEntry *catalog, int *count, int max, Report report) {
+  char line[LineLen];
+  char *name;
+  int tunings[7];
+  uint16_t line_num = 1;
+
+  uint32_t offset = f.position();
+  int len = sd_read_line(f, line, LineLen);
+
+  while (len >= 0 && *count < max) {
+    int other = -1;
+    SDAddResult added = SD_ADDED;
+
+    if (line[0] != '\0' && line[0] != '#') {
+      if (sd_parse_line(line, &name, tunings)) {
+        added = sd_catalog_add(catalog, count, max, name, tunings, file_idx, line_num, offset, &other);
+      } else {
+        added = SD_SKIPPED_BAD;
+      }
+    }
+    if (added != SD_ADDED) {
+      report(line_num, added, other);
+    }
+
+    offset = f.position();
+    len = sd_read_line(f, line, LineLen);
+    line_num++;
+  }
+}
+
+/// @brief Catalog sort order: by key, then by name, then by where on the card it is.
+inline int sd_compare_entries(const void *a, const void *b) {
+  const SDTuningEntry *ea = (const SDTuningEntry *)a;
+  const SDTuningEntry *eb = (const SDTuningEntry *)b;
+
+  if (ea->key != eb->key) {
+    return (int)ea->key - (int)eb->key;
+  }
+  int by_name = strcmp(ea->name, eb->name);
+  if (by_name != 0) {
+    return by_name;
+  }
+  if (ea->file_idx != eb->file_idx) {
+    return (int)ea->file_idx - (int)eb->file_idx;
+  }
+  return (int)ea->line - (int)eb->line;
+}
+
+/// @brief Sorts the catalog for browsing.
+inline void sd_catalog_sort(SDTuningEntry *catalog, int count) {
+  qsort(catalog, count, sizeof(SDTuningEntry), sd_compare_entries);
+}
+
+#endif
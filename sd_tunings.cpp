@@ -0,0 +1,257 @@
+#include "sd_tunings.h"
+
+/// @defgroup sd SD Card Tuning Library
+/// These functions index and load tunings kept on the Teensy's SD card.
+///
+/// Tunings live in text files inside SD_TUNING_DIR.  Each line of a file is one tuning:
+///
+///     name,hi_mel,lo_mel,drone,tromp,buzz,tpose,capo
+///
+/// * Notes are MIDI note numbers (0-127), the same values as the presets in `default_tunings.h`.
+/// * tpose is -12 to +12, capo is 0, 2 or 4.
+/// * Blank lines and lines starting with '#' are ignored.
+///
+/// The directory is scanned once at startup into a catalog in RAM, sorted by key and then name (see
+/// sd_catalog.h).  A tuning found twice is listed once; different tunings with the same name are both listed,
+/// and reported over Serial.  Browsing the catalog never touches the card, and loading a tuning seeks straight
+/// to its line.  tools/sd_tunings.cpp checks a copy of the card the same way.
+/// @version *New in 3.1.0*
+/// @{
+
+static SDTuningEntry sd_catalog[SD_MAX_TUNINGS];
+static char sd_files[SD_MAX_TUNING_FILES][SD_TUNING_FILENAME_LEN + 1];
+static int sd_num_tunings = 0;
+static int sd_num_files = 0;
+
+/// @brief Adds every tuning in the given file to the catalog, reporting same-named tunings over Serial.
+/// @param f The open file
+/// @param file_idx The file's index in the file table
+static void sd_index_file(File &f, uint8_t file_idx) {
+  auto report = [file_idx](uint16_t line, SDAddResult result, int other) {
+    if (result == SD_ADDED_SAME_NAME) {
+      Serial.print("SD tuning ");
+      Serial.print(sd_files[file_idx]);
+      Serial.print(":");
+      Serial.print(line);
+      Serial.print(" has the same name as ");
+      Serial.print(sd_files[sd_catalog[other].file_idx]);
+      Serial.print(":");
+      Serial.print(sd_catalog[other].line);
+      Serial.println(", both are listed.");
+    };
+  };
+
+  sd_catalog_index<SD_TUNING_LINE_LEN>(f, file_idx, sd_catalog, &sd_num_tunings, SD_MAX_TUNINGS, report);
+};
+
+/// @brief Mounts the SD card and builds the tuning catalog.
+/// @details This scans SD_TUNING_DIR once.  If there is no card or no directory, the catalog is simply empty.
+/// @note This should be run once from setup().
+void sd_tunings_begin() {
+  sd_num_tunings = 0;
+  sd_num_files = 0;
+
+  if (!SD.begin(BUILTIN_SDCARD)) {
+    Serial.println("No SD card found.");
+    return;
+  };
+
+  File dir = SD.open(SD_TUNING_DIR);
+  if (!dir || !dir.isDirectory()) {
+    Serial.println("No SD tuning directory found.");
+    return;
+  };
+
+  elapsedMillis scan_timer;
+
+  File f = dir.openNextFile();
+  while (f && sd_num_files < SD_MAX_TUNING_FILES && sd_num_tunings < SD_MAX_TUNINGS) {
+    if (!f.isDirectory() && strlen(f.name()) <= SD_TUNING_FILENAME_LEN && f.name()[0] != '.') {
+      strcpy(sd_files[sd_num_files], f.name());
+      sd_index_file(f, sd_num_files);
+      sd_num_files++;
+    };
+    f.close();
+    f = dir.openNextFile();
+  };
+  dir.close();
+
+  sd_catalog_sort(sd_catalog, sd_num_tunings);
+
+  Serial.print("Indexed ");
+  Serial.print(sd_num_tunings);
+  Serial.print(" SD tunings from ");
+  Serial.print(sd_num_files);
+  Serial.print(" files in ");
+  Serial.print((uint32_t)scan_timer);
+  Serial.println("ms.");
+};
+
+/// @brief Returns the number of tunings in the catalog.
+/// @return The number of tunings, 0 if there is no card.
+int sd_tuning_count() {
+  return sd_num_tunings;
+};
+
+/// @brief Returns the name of a catalogued tuning.
+/// @param idx The catalog index, 0 to sd_tuning_count() - 1
+/// @return The tuning's name
+String sd_tuning_name(int idx) {
+  return String(sd_catalog[idx].name);
+};
+
+/// @brief Reads a catalogued tuning's values from the card.
+/// @param idx The catalog index, 0 to sd_tuning_count() - 1
+/// @param tunings Filled with the seven tuning values (see `default_tunings.h` for the order)
+/// @return True if the tuning was read, false if the card or file changed since startup.
+bool sd_read_tuning(int idx, int *tunings) {
+  if (idx < 0 || idx >= sd_num_tunings) {
+    return false;
+  };
+
+  SDTuningEntry *entry = &sd_catalog[idx];
+  String path = String(SD_TUNING_DIR) + "/" + sd_files[entry->file_idx];
+
+  File f = SD.open(path.c_str(), FILE_READ);
+  if (!f) {
+    return false;
+  };
+
+  char line[SD_TUNING_LINE_LEN];
+  char *name;
+  bool ok = f.seek(entry->offset) && sd_read_line(f, line, SD_TUNING_LINE_LEN) >= 0 && sd_parse_line(line, &name, tunings);
+  f.close();
+
+  return ok;
+};
+
+/// @brief Loads a catalogued tuning onto the strings.
+/// @param idx The catalog index, 0 to sd_tuning_count() - 1
+/// @return True if the tuning was loaded, false if it could not be read.
+bool load_sd_tuning(int idx) {
+  int tunings[7];
+
+  if (!sd_read_tuning(idx, tunings)) {
+    return false;
+  };
+
+  load_tuning_values(tunings);
+  return true;
+};
+
+/// @brief Displays a catalogued tuning and prompts user to accept.
+/// @param idx The catalog index, 0 to sd_tuning_count() - 1
+/// @return True if the user loaded the tuning, false if the user rejected it.
+bool view_sd_tuning_screen(int idx) {
+  int tunings[7];
+
+  if (!sd_read_tuning(idx, tunings)) {
+    print_message_2("SD Card Tuning", "Could not read tuning,", "check the SD card.");
+    delay(1000);
+    return false;
+  };
+
+  String t_str = "";
+  if (tunings[5] > 0) { t_str += "+"; };
+  t_str = t_str + tunings[5];
+
+  String cap_str = "";
+  if (tunings[6] > 0) { cap_str += "+"; };
+  cap_str = cap_str + tunings[6];
+
+  print_tuning(sd_tuning_name(idx),
+               getLongNoteNum(tunings[0]),
+               getLongNoteNum(tunings[1]),
+               getLongNoteNum(tunings[2]),
+               getLongNoteNum(tunings[3]),
+               t_str, cap_str);
+  delay(150);
+
+  bool done = false;
+  while (!done) {
+
+    my1Button->update();
+    my2Button->update();
+    myAButton->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed() || myAButton->wasPressed()) {
+      load_tuning_values(tunings);
+
+      // Zero indexed, the first 8 are reserved for presets and save slots.
+      if (idx + 8 < 128) {
+        signal_scene_change(idx + 8);
+      };
+      done = true;
+
+    } else if (my2Button->wasPressed() || myXButton->wasPressed()) {
+      return false;
+    };
+  };
+  return true;
+};
+
+/// @brief Prompts the user to browse the SD card tuning catalog, four tunings at a time.
+/// @return True if the user loaded a tuning, false otherwise.
+bool load_sd_screen() {
+
+  if (sd_num_tunings == 0) {
+    print_message_2("SD Card Tunings", "No tunings found.", String("See ") + SD_TUNING_DIR);
+    delay(1000);
+    return false;
+  };
+
+  int pages = (sd_num_tunings + 3) / 4;
+  int page = 0;
+
+  bool done = false;
+  while (!done) {
+
+    String opts[4];
+    for (int x = 0; x < 4; x++) {
+      if (page * 4 + x < sd_num_tunings) {
+        opts[x] = sd_tuning_name(page * 4 + x);
+      } else {
+        opts[x] = "";
+      };
+    };
+
+    print_menu_6(String("SD Tunings ") + (page + 1) + "/" + pages,
+                 opts[0], opts[1], opts[2], opts[3], "Next Page", "Prev. Page");
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    my4Button->update();
+    my5Button->update();
+    my6Button->update();
+    myXButton->update();
+
+    int choice = -1;
+    if (my1Button->wasPressed()) {
+      choice = 0;
+    } else if (my2Button->wasPressed()) {
+      choice = 1;
+    } else if (my3Button->wasPressed()) {
+      choice = 2;
+    } else if (my4Button->wasPressed()) {
+      choice = 3;
+    } else if (my5Button->wasPressed()) {
+      page = (page + 1) % pages;
+    } else if (my6Button->wasPressed()) {
+      page = (page + pages - 1) % pages;
+    } else if (myXButton->wasPressed()) {
+      return false;
+    };
+
+    if (choice >= 0 && page * 4 + choice < sd_num_tunings) {
+      if (view_sd_tuning_screen(page * 4 + choice)) {
+        done = true;
+      };
+    };
+  };
+  return true;
+};
+
+/// @}
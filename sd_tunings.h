@@ -0,0 +1,23 @@
+#ifndef SD_TUNINGS_H
+#define SD_TUNINGS_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include "common.h"
+#include "config.h"
+#include "display.h"
+#include "notes.h"
+#include "load_tunings.h"
+#include "sd_catalog.h"
+
+void sd_tunings_begin();
+int sd_tuning_count();
+String sd_tuning_name(int idx);
+bool sd_read_tuning(int idx, int *tunings);
+bool load_sd_tuning(int idx);
+
+bool view_sd_tuning_screen(int idx);
+bool load_sd_screen();
+
+#endif
@@ -0,0 +1,375 @@
+#include "sinks.h"
+
+#include "common.h"
+
+#include <EventResponder.h>
+
+// Set by the Teensy core's USB code once a host has configured the device (usb_dev.h).
+extern "C" volatile uint8_t usb_configuration;
+
+/// @defgroup sinks Output Link Gating
+/// These functions keep track of whether each output link is alive, and keep a dead one from slowing the others.
+///
+/// Every send used to go out whether anything was listening or not: usbMIDI with no USB host, MIDI-OUT with
+/// nothing plugged in or a Bluetooth transmitter switched off, the Trigger/Tsunami unplugged.  A serial port
+/// whose send buffer is full makes the sender wait for room, so one backed-up link held up every link after it.
+///
+/// Each link is checked every loop():
+/// * USB is alive while a host has it configured.
+/// * The Trigger/Tsunami is alive while it answers: it's asked for its version every SINK_PROBE_MS, and two
+///   unanswered asks in a row make it dead.  One that has never answered may just have its TX unwired, so it's
+///   only judged dead if TRIGGER_CHECK_REPLIES says it must answer.
+/// * MIDI-OUT can't answer: a 5-pin socket has no way back.  It counts as dead only when its send buffer has held
+///   data for SINK_STALL_MS without sending any.  A UART always drains, so an unplugged cable can't be seen;
+///   what the gate does for MIDI-OUT is make sure a send never waits.
+///
+/// MIDI-OUT and the Trigger/Tsunami both go through a GatedSerial, which never waits: what the port can't take is
+/// queued and sent as room appears, and what doesn't fit is dropped, a whole message at a time.  The queue is sent
+/// from yield() as well as loop(), so it keeps going out while a menu or delay() holds loop() up.  Once the MIDI socket is dead its messages
+/// are kept or thrown away as MIDI_OUT_DROP_POLICY says.  Sends to a dead USB or Trigger/Tsunami link are dropped.
+/// A Trigger/Tsunami that comes back has its string gains (and, in Tsunami MIDI mode, its MIDI bank) re-sent with
+/// the next notes.
+/// @version *New in 3.1.0*
+/// @{
+
+SinkStatus sinks[TRAFFIC_SINK_COUNT] = {{true, 0}, {true, 0}, {true, 0}};
+
+#ifdef USE_OUTPUT_GATING
+
+GatedSerial midi_port(Serial1, TRAFFIC_SERIAL, (MIDI_OUT_DROP_POLICY == 1) ? SINK_DROP_ALL : SINK_DROP_OLDEST);
+
+#if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+GatedSerial trigger_port(SINK_TRIGGER_PORT, TRAFFIC_TRIGGER, SINK_DROP_ALL);
+#endif
+
+static const char *sink_names[TRAFFIC_SINK_COUNT] = {"USB", "MIDI-OUT", "Trigger"};
+
+// Runs from yield() while a queue has something it can send.  See sink_pump_queued().
+static EventResponder sink_pump_event;
+
+/// @brief Sends what the gated ports have queued, from yield(), and asks to run again while any is left.
+/// @details The Teensy calls yield() between passes through loop() and all through delay(), so messages queued
+/// before a menu or a pause screen still go out while it waits.
+static void sink_pump_queued(EventResponderRef) {
+  midi_port.pump();
+  bool more = midi_port.pumping();
+  #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+  trigger_port.pump();
+  more = more || trigger_port.pumping();
+  #endif
+  if (more) {
+    sink_pump_event.triggerEvent();
+  };
+};
+
+/// @brief Returns the total length of a MIDI message from its status byte, or 0 for SysEx (ended by F7).
+static int sink_midi_length(uint8_t status) {
+  if (status < 0xF0) {
+    return ((status & 0xE0) == 0xC0) ? 2 : 3;   // Program change and channel pressure have one data byte
+  };
+  if (status == 0xF0) {
+    return 0;
+  };
+  return (status == 0xF2) ? 3 : ((status == 0xF1 || status == 0xF3) ? 2 : 1);
+};
+
+/// @brief Constructor.
+/// @param p The port to send on
+/// @param s Which link this is
+/// @param pol What to drop while it's dead
+GatedSerial::GatedSerial(HardwareSerial &p, TrafficSink s, SinkPolicy pol) {
+  port = &p;
+  sink = s;
+  policy = pol;
+};
+
+/// @brief Starts the port.  The MIDI library calls this from MIDI.begin().
+void GatedSerial::begin(unsigned long baud) {
+  port->begin(baud);
+  started = true;
+  count = 0;
+  messages = 0;
+  part_len = 0;
+  last_progress_ms = millis();
+  sink_pump_event.attach(sink_pump_queued);
+};
+
+int GatedSerial::available() {
+  return port->available();
+};
+
+int GatedSerial::read() {
+  return port->read();
+};
+
+/// @brief Takes one byte from the MIDI library, sending or queueing it once its message is whole.
+/// @return 1, even if the byte was dropped: the MIDI library has nothing to do about it.
+size_t GatedSerial::write(uint8_t b) {
+  // Real-time messages are a byte each, and may come in the middle of another.
+  if (b >= 0xF8) {
+    message(&b, 1);
+    return 1;
+  };
+
+  if (b == 0xF7) {
+    // The end of a SysEx: anything else open is cut short, and one too long to hold is over.
+    if (part_len == 0 || part_need != 0) {
+      part_len = 0;
+      part_dropped = false;
+      return 1;
+    };
+  } else if (b & 0x80) {
+    if (part_len > 0) {
+      sinks[sink].dropped++;
+    };
+    part_len = 0;
+    part_need = sink_midi_length(b);
+    part_dropped = false;
+    last_status = (b < 0xF0) ? b : 0;
+  } else if (part_len == 0 && !part_dropped) {
+    // Running status: the data of another message like the last one.
+    if (last_status == 0) {
+      return 1;
+    };
+    part_need = sink_midi_length(last_status) - 1;
+  };
+
+  if (part_dropped) {
+    return 1;
+  };
+  if (part_len >= SINK_MESSAGE_MAX) {
+    sinks[sink].dropped++;
+    part_len = 0;
+    part_dropped = true;
+    return 1;
+  };
+  part[part_len++] = b;
+
+  if ((part_need > 0 && part_len >= part_need) || b == 0xF7) {
+    message(part, part_len);
+    part_len = 0;
+  };
+  return 1;
+};
+
+/// @brief Sends one whole message from the Trigger/Tsunami library, or queues it if the port has no room.
+/// @details The message is dropped if the queue can't take all of it.  The link being dead doesn't stop it: the
+/// Trigger/Tsunami's callers have already checked that, and its version asks must go out to see if it's back.
+/// @return len, even if the message was dropped.
+size_t GatedSerial::write(const uint8_t *buf, size_t len) {
+  if (started) {
+    send(buf, (int)len, false);
+  };
+  return len;
+};
+
+/// @brief Sends, queues or drops one whole message from the MIDI library, as the link's state and policy say.
+void GatedSerial::message(const uint8_t *buf, int len) {
+  if (!started || (!sinks[sink].alive && policy == SINK_DROP_ALL)) {
+    sinks[sink].dropped++;
+  } else if (!sinks[sink].alive) {
+    push(buf, len, true);
+  } else {
+    send(buf, len, true);
+  };
+};
+
+/// @brief Sends one whole message if nothing is queued ahead of it and the port has room, or queues it.
+/// @param drop_oldest What to drop if the queue is full: the oldest messages, or this one
+void GatedSerial::send(const uint8_t *buf, int len, bool drop_oldest) {
+  pump();
+  if (messages == 0 && port->availableForWrite() >= len) {
+    port->write(buf, len);
+  } else {
+    push(buf, len, drop_oldest);
+  };
+};
+
+/// @brief Adds one whole message to the queue.
+/// @param drop_oldest True to drop the oldest messages to make room, false to drop this one if there's none
+/// @return True if it was queued.
+bool GatedSerial::push(const uint8_t *buf, int len, bool drop_oldest) {
+  if (len > SINK_QUEUE_SIZE || len > 255) {
+    sinks[sink].dropped++;
+    return false;
+  };
+  while (drop_oldest && count + len > SINK_QUEUE_SIZE) {
+    dropOldest();
+  };
+  if (count + len > SINK_QUEUE_SIZE) {
+    sinks[sink].dropped++;
+    return false;
+  };
+
+  for (int x = 0; x < len; x++) {
+    queue[(head + count) % SINK_QUEUE_SIZE] = buf[x];
+    count++;
+  };
+  lengths[(first + messages) % SINK_QUEUE_SIZE] = (uint8_t)len;
+  messages++;
+  sink_pump_event.triggerEvent();
+  return true;
+};
+
+/// @brief Drops the message at the front of the queue.
+void GatedSerial::dropOldest() {
+  int len = lengths[first];
+  head = (head + len) % SINK_QUEUE_SIZE;
+  count -= len;
+  first = (first + 1) % SINK_QUEUE_SIZE;
+  messages--;
+  sinks[sink].dropped++;
+};
+
+/// @brief Sends as many whole messages from the front of the queue as the port has room for.
+/// @details While the link is dead the queue is held, if the policy keeps messages for when it's back.
+void GatedSerial::pump() {
+  if (!pumping()) {
+    return;
+  };
+  int room = port->availableForWrite();
+  while (messages > 0 && lengths[first] <= room) {
+    int len = lengths[first];
+    for (int x = 0; x < len; x++) {
+      port->write(queue[head]);
+      head = (head + 1) % SINK_QUEUE_SIZE;
+    };
+    count -= len;
+    room -= len;
+    first = (first + 1) % SINK_QUEUE_SIZE;
+    messages--;
+  };
+};
+
+/// @brief Reports whether pump() has anything it may send now.
+bool GatedSerial::pumping() {
+  return started && messages > 0 && (sinks[sink].alive || policy != SINK_DROP_OLDEST);
+};
+
+/// @brief Checks that the port's send buffer is draining.
+/// @param now millis()
+/// @return False if it has held data for SINK_STALL_MS without sending any (or was never started).
+bool GatedSerial::check(uint32_t now) {
+  if (!started) {
+    return false;
+  };
+  int free = port->availableForWrite();
+  if (free > tx_size) {
+    tx_size = free;
+  };
+  if (free > last_free || free == tx_size) {
+    last_progress_ms = now;
+  };
+  last_free = free;
+  return (now - last_progress_ms < (uint32_t)SINK_STALL_MS);
+};
+
+/// @brief Returns how many bytes are queued.
+int GatedSerial::queued() {
+  return count;
+};
+
+#if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+
+// Version asks.
+static uint32_t trigger_probe_ms = 0;
+static bool trigger_asked = false;
+static bool trigger_answered = false;   // It has answered since startup
+static int trigger_missed = 0;
+
+/// @brief Checks the Trigger/Tsunami by asking for its version and seeing whether the last ask was answered.
+/// @return False after two unanswered asks in a row, if it has answered before or TRIGGER_CHECK_REPLIES is on.
+static bool sink_check_trigger(uint32_t now) {
+  if (now - trigger_probe_ms >= (uint32_t)SINK_PROBE_MS) {
+    trigger_probe_ms = now;
+
+    char version[24];
+    if (trigger_asked) {
+      if (trigger_obj.getVersion(version, sizeof(version))) {
+        trigger_answered = true;
+        trigger_missed = 0;
+      } else {
+        trigger_missed++;
+      };
+    };
+
+    trigger_obj.requestVersion();
+    trigger_asked = true;
+  };
+
+  return trigger_missed < 2 || !(trigger_answered || TRIGGER_CHECK_REPLIES);
+};
+
+#endif
+
+/// @brief Records a link's new state, and says so on Serial when it changes.
+static void sink_set(int sink, bool alive) {
+  if (alive == sinks[sink].alive) {
+    return;
+  };
+  sinks[sink].alive = alive;
+  if (alive) {
+    sink_pump_event.triggerEvent();
+  };
+
+  Serial.print(sink_names[sink]);
+  Serial.print(alive ? " is back, " : " is dead, ");
+  Serial.print(sinks[sink].dropped);
+  Serial.println(" messages dropped so far");
+
+  #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+  if (sink == TRAFFIC_TRIGGER && alive) {
+    // It may have been restarted while it was away, so send the gains again.
+    mystring->clearVolArray();
+    mylowstring->clearVolArray();
+    mytromp->clearVolArray();
+    mydrone->clearVolArray();
+    mybuzz->clearVolArray();
+    mykeyclick->clearVolArray();
+    #ifdef USE_TSUNAMI_MIDI
+      tsunami_midi.forgetBank();
+    #endif
+  };
+  #endif
+};
+
+/// @brief Returns true if a send to a link should go ahead, or counts it as dropped.
+/// @details MIDI-OUT messages are always handed to midi_port, which makes its own choice.
+bool sink_ready(TrafficSink sink) {
+  if (sinks[sink].alive || sink == TRAFFIC_SERIAL) {
+    return true;
+  };
+  sinks[sink].dropped++;
+  return false;
+};
+
+/// @brief Checks every link and sends what's queued for MIDI-OUT.
+/// @note This is meant to be run every loop() cycle.
+void sink_update() {
+  uint32_t now = millis();
+
+  sink_set(TRAFFIC_USB, usb_configuration != 0);
+
+  if (mystring->getOutputMode() != 1) {
+    sink_set(TRAFFIC_SERIAL, midi_port.check(now));
+    midi_port.pump();
+  };
+
+  #if defined(USE_TRIGGER) || defined(USE_TSUNAMI)
+  if (mystring->getOutputMode() > 0) {
+    sink_set(TRAFFIC_TRIGGER, sink_check_trigger(now));
+    trigger_port.pump();
+  };
+  #endif
+};
+
+/// @brief Zeroes the dropped-message counts.
+void sink_reset() {
+  for (int s = 0; s < TRAFFIC_SINK_COUNT; s++) {
+    sinks[s].dropped = 0;
+  };
+};
+
+#endif
+
+/// @}
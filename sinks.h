@@ -0,0 +1,105 @@
+#ifndef SINKS_H
+#define SINKS_H
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "traffic.h"
+
+// What a link's sends do while it's dead.
+enum SinkPolicy : uint8_t {
+  SINK_DROP_OLDEST = 0,   // Hold the newest messages, send them if it comes back
+  SINK_DROP_ALL           // Throw everything away
+};
+
+struct SinkStatus {
+  bool alive;
+  uint32_t dropped;       // Messages thrown away since the last reset
+};
+
+extern SinkStatus sinks[TRAFFIC_SINK_COUNT];
+
+// The longest message the MIDI library's bytes are gathered into.  Channel messages are 3 bytes; longer SysEx
+// on MIDI-OUT is dropped.
+const int SINK_MESSAGE_MAX = 32;
+
+/// @brief A serial port that never makes the sender wait, for the MIDI library and the Trigger/Tsunami library.
+/// @details Messages the port can't take right now are held in a queue and sent by pump(), which runs from every
+/// send, from sink_update() and from yield() (so delay() and the menus' waits keep the queue moving).  The queue
+/// holds whole messages and only ever sends or drops a whole one, so the far end never sees part of a message.
+/// The MIDI library writes a byte at a time: the bytes are gathered into a message by its status byte before
+/// it's sent or queued, and when the queue is full or the link is dead the policy decides what's dropped.  The
+/// Trigger/Tsunami library writes a message at a time, which is dropped if it doesn't fit; its callers check the
+/// link with SINK_READY().
+class GatedSerial {
+  private:
+    HardwareSerial *port;
+    TrafficSink sink;
+    SinkPolicy policy;
+    bool started = false;
+
+    // The queued bytes, and the length of each queued message.
+    uint8_t queue[SINK_QUEUE_SIZE];
+    int head = 0;
+    int count = 0;
+    uint8_t lengths[SINK_QUEUE_SIZE];
+    int first = 0;
+    int messages = 0;
+
+    // The message the MIDI library is part way through writing.
+    uint8_t part[SINK_MESSAGE_MAX];
+    int part_len = 0;
+    int part_need = 0;          // Its whole length, or 0 for SysEx (ended by F7)
+    bool part_dropped = false;  // Too long to hold: its bytes are thrown away up to the next status byte
+    uint8_t last_status = 0;    // For messages sent with running status
+
+    // The port's send buffer: its size (the most free space seen) and how full it was last time.
+    int tx_size = 0;
+    int last_free = 0;
+    uint32_t last_progress_ms = 0;
+
+    void message(const uint8_t *buf, int len);
+    void send(const uint8_t *buf, int len, bool drop_oldest);
+    bool push(const uint8_t *buf, int len, bool drop_oldest);
+    void dropOldest();
+
+  public:
+    GatedSerial(HardwareSerial &p, TrafficSink s, SinkPolicy pol);
+    void begin(unsigned long baud);
+    int available();
+    int read();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t *buf, size_t len);
+    void pump();
+    bool check(uint32_t now);
+    int queued();
+    bool pumping();
+};
+
+#ifdef USE_OUTPUT_GATING
+  extern GatedSerial midi_port;
+  typedef GatedSerial MidiPort;
+  #define MIDI_PORT midi_port
+  #define SINK_READY(sink) sink_ready(sink)
+#else
+  typedef HardwareSerial MidiPort;
+  #define MIDI_PORT Serial1
+  #define SINK_READY(sink) true
+#endif
+
+// The Trigger/Tsunami's serial port (from wavTrigger.h or Tsunami.h), and the gated port its library sends on.
+#if defined(USE_TRIGGER)
+  #define SINK_TRIGGER_PORT WTSerial
+#elif defined(USE_TSUNAMI)
+  #define SINK_TRIGGER_PORT TsunamiSerial
+#endif
+
+#if defined(USE_OUTPUT_GATING) && (defined(USE_TRIGGER) || defined(USE_TSUNAMI))
+  extern GatedSerial trigger_port;
+#endif
+
+bool sink_ready(TrafficSink sink);
+void sink_update();
+void sink_reset();
+
+#endif
@@ -0,0 +1,539 @@
+#include "stream_test.h"
+
+#include <SD.h>
+
+#include "common.h"
+#include "display.h"
+#include "exfunctions.h"
+#include "load_tunings.h"
+#include "play_functions.h"
+
+/// @defgroup streamtest MIDI Stream Self-Test
+/// These functions play scripted sessions through the real play functions and check what comes out.
+///
+/// While a session runs, everything GurdyString would send (over USB MIDI, the MIDI-OUT socket and to a
+/// Trigger/Tsunami unit) is captured instead of sent, so the test is silent.  Each captured stream is
+/// checked two ways:
+/// * Against a per-session budget of messages and bytes.  This catches a change that quietly doubles the
+///   traffic of a key press, even when the new stream is otherwise "correct".
+/// * Against a golden copy of the stream on the SD card (STREAM_TEST_DIR/<session>.txt), one message per line:
+///
+///       U NoteOn 1 67 70
+///       S NoteOn 1 67 70
+///       T Gain 1 67 -26
+///       T Play 1 67 0
+///
+///   (the start of selftest/crank.txt).  A run reports the first line that differs.  A session with no golden
+///   file fails.  The goldens for the default config.h are in the repository's selftest/ directory, to copy to
+///   the card; "Record Golden Files" replaces them with this build's streams, for a change meant to alter them.
+///   tools/gurdy_host.cpp runs the same sessions on a computer, to check and record the goldens there.
+///
+/// Every session starts from the same tuning, volume, output, legato, MPE and expression settings with nothing
+/// sounding and nothing bent, and the gurdy's own settings are put back afterwards.
+/// @version *New in 3.1.0*
+/// @{
+
+bool stream_capturing = false;
+
+#ifdef USE_STREAM_TEST
+
+static const char *stream_kind_names[STREAM_KIND_COUNT] = {
+  "NoteOn", "NoteOff", "CC", "Bend", "Program", "Gain", "Play", "Fade", "StopAll", "Pressure", "Stop"
+};
+
+struct StreamEvent {
+  int16_t a;
+  int16_t b;
+  uint8_t channel;
+  uint8_t kind;
+  char sink;
+};
+
+DMAMEM static StreamEvent stream_buf[STREAM_TEST_EVENTS];
+static int stream_len = 0;
+static int stream_bytes = 0;
+static bool stream_overflow = false;
+
+/// @brief Returns how many bytes a message takes on the wire.
+static int stream_wire_bytes(char sink, StreamKind kind) {
+  if (sink == STREAM_USB) {
+    return 4;   // USB MIDI sends every message as a 4-byte packet
+  };
+  if (sink == STREAM_SERIAL) {
+    return (kind == STREAM_PROGRAM || kind == STREAM_PRESSURE) ? 2 : 3;
+  };
+
+  #ifdef USE_TSUNAMI_MIDI
+  // Tsunami MIDI: the gain goes with the Note-On, which takes 2 bytes with running status, 3 without and 5 with a
+  // bank change.  Count the middle case.
+  if (kind == STREAM_TRACK_GAIN) {
+    return 0;
+  } else if (kind != STREAM_STOP_ALL) {
+    return 3;
+  };
+  #endif
+
+  if (kind == STREAM_TRACK_GAIN) {
+    return 9;
+  } else if (kind == STREAM_TRACK_FADE) {
+    return 12;
+  } else if (kind == STREAM_STOP_ALL) {
+    return 5;
+  };
+
+  #ifdef USE_TSUNAMI
+  return 10;    // Tsunami track control, with output and lock
+  #else
+  return (kind == STREAM_TRACK_STOP) ? 8 : 9;     // WAV Trigger track control, with lock for play
+  #endif
+};
+
+/// @brief Captures one outbound message.  GurdyString calls this instead of sending while stream_capturing is set.
+/// @param sink STREAM_USB, STREAM_SERIAL or STREAM_TRIGGER
+/// @param kind The kind of message
+/// @param channel The string's MIDI channel
+/// @param a The note, controller, bend or program
+/// @param b The velocity, controller value or track gain
+void stream_record(char sink, StreamKind kind, int channel, int a, int b) {
+  stream_bytes += stream_wire_bytes(sink, kind);
+
+  if (stream_len >= STREAM_TEST_EVENTS) {
+    stream_overflow = true;
+    return;
+  };
+
+  StreamEvent *e = &stream_buf[stream_len++];
+  e->sink = sink;
+  e->kind = kind;
+  e->channel = channel;
+  e->a = a;
+  e->b = b;
+};
+
+static int stream_format(const StreamEvent *e, char *line, int size) {
+  return snprintf(line, size, "%c %s %d %d %d\n", e->sink, stream_kind_names[e->kind], e->channel, e->a, e->b);
+};
+
+// The gurdy's settings, saved before the sessions run and put back afterwards.
+struct StreamState {
+  int note[6];
+  int volume[6];
+  bool mute[6];
+  int gros[6];
+  int output[6];
+  LegatoMode legato[6];
+  bool mpe[6];
+  int trigger_expression[6];
+  int tpose;
+  int capo;
+  int mel;
+  int drone;
+  int vibrato;
+  int offset;
+  bool autocrank;
+};
+
+static GurdyString **stream_strings() {
+  static GurdyString *strings[6];
+  strings[0] = mystring;
+  strings[1] = mylowstring;
+  strings[2] = mykeyclick;
+  strings[3] = mytromp;
+  strings[4] = mydrone;
+  strings[5] = mybuzz;
+  return strings;
+};
+
+static void stream_save_state(StreamState *st) {
+  GurdyString **s = stream_strings();
+  for (int x = 0; x < 6; x++) {
+    st->note[x] = s[x]->getOpenNote();
+    st->volume[x] = s[x]->getVolume();
+    st->mute[x] = s[x]->getMute();
+    st->gros[x] = s[x]->getGrosMode();
+    st->output[x] = s[x]->getOutputMode();
+    st->legato[x] = s[x]->getLegato();
+    st->mpe[x] = s[x]->getMpe();
+    st->trigger_expression[x] = s[x]->getTriggerExpression();
+  };
+  st->tpose = tpose_offset;
+  st->capo = capo_offset;
+  st->mel = mel_mode;
+  st->drone = drone_mode;
+  st->vibrato = mel_vibrato;
+  st->offset = myoffset;
+  st->autocrank = autocrank_toggle_on;
+};
+
+static void stream_restore_state(const StreamState *st) {
+  GurdyString **s = stream_strings();
+
+  // The strings were silenced and unbent for real before the sessions, so they should think so again.
+  stream_capturing = true;
+  all_soundKill();
+  stream_capturing = false;
+
+  for (int x = 0; x < 6; x++) {
+    s[x]->setOpenNote(st->note[x]);
+    s[x]->setVolume(st->volume[x]);
+    s[x]->setMute(st->mute[x]);
+    s[x]->setGrosMode(st->gros[x]);
+    s[x]->setOutputMode(st->output[x]);
+    s[x]->setLegato(st->legato[x]);
+    s[x]->setMpe(st->mpe[x]);
+    s[x]->setTriggerExpression(st->trigger_expression[x]);
+  };
+  tpose_offset = st->tpose;
+  capo_offset = st->capo;
+  mel_mode = st->mel;
+  drone_mode = st->drone;
+  mel_vibrato = st->vibrato;
+  myoffset = st->offset;
+  autocrank_toggle_on = st->autocrank;
+
+  // The captured sessions marked their notes' Trigger/Tsunami gain as sent without sending it.
+  all_clearVolArray();
+};
+
+/// @brief Puts the gurdy in the fixed state every session starts from.
+/// @note This sends, so it should be run while capturing, and what it sends thrown away.
+static void stream_setup() {
+  GurdyString **s = stream_strings();
+
+  // Nothing left sounding or bent by the last session, no key click track still to stop.
+  all_soundKill();
+
+  for (int x = 0; x < 6; x++) {
+    s[x]->setVolume(STREAM_TEST_VOLUME);
+    s[x]->setMute(false);
+    s[x]->setGrosMode(0);
+    s[x]->setOutputMode(2);
+    s[x]->setLegato(LEGATO_OFF);
+    s[x]->setMpe(false);
+    s[x]->setTriggerExpression(127);
+  };
+  load_preset_tunings(1);
+  mel_mode = 0;
+  drone_mode = 0;
+  mel_vibrato = 0;
+  myoffset = 0;
+  autocrank_toggle_on = false;
+  all_clearVolArray();
+};
+
+// These do what loop() does when the crank starts and stops and when the key changes.
+
+static void stream_crank_start() {
+  mystring->soundOn(myoffset + tpose_offset, mel_vibrato);
+  mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
+  mytromp->soundOn(tpose_offset + capo_offset);
+  mydrone->soundOn(tpose_offset + capo_offset);
+};
+
+static void stream_crank_stop() {
+  all_soundOff();
+};
+
+static void stream_key(int offset) {
+  myoffset = offset;
+  key_change();
+};
+
+static void stream_key_run(int keys) {
+  for (int x = 1; x <= keys; x++) {
+    stream_key(x);
+  };
+  for (int x = keys - 1; x >= 0; x--) {
+    stream_key(x);
+  };
+};
+
+// The sessions.
+
+static void session_crank() {
+  stream_crank_start();
+  mybuzz->soundOn(tpose_offset + capo_offset);
+  mybuzz->soundOff();
+  stream_crank_stop();
+};
+
+static void session_keys() {
+  stream_crank_start();
+  stream_key_run(12);
+  stream_crank_stop();
+};
+
+static void session_keys_gros() {
+  mystring->setGrosMode(1);
+  mylowstring->setGrosMode(2);
+  mytromp->setGrosMode(3);
+  stream_crank_start();
+  stream_key_run(6);
+  stream_crank_stop();
+};
+
+static void session_keys_glide() {
+  mystring->setLegato(LEGATO_GLIDE);
+  mylowstring->setLegato(LEGATO_GLIDE);
+  stream_crank_start();
+  stream_key_run(12);
+  stream_crank_stop();
+};
+
+static void session_keys_overlap() {
+  mystring->setLegato(LEGATO_OVERLAP);
+  mylowstring->setLegato(LEGATO_OVERLAP);
+  stream_crank_start();
+  stream_key_run(12);
+  stream_crank_stop();
+};
+
+// A trill, the ornament glides help most.
+static void session_trill_glide() {
+  mystring->setLegato(LEGATO_GLIDE);
+  mylowstring->setLegato(LEGATO_GLIDE);
+  stream_crank_start();
+  for (int x = 0; x < 8; x++) {
+    stream_key(1);
+    stream_key(2);
+  };
+  stream_crank_stop();
+};
+
+static void session_mutes() {
+  stream_crank_start();
+  for (int x = 0; x < 4; x++) {
+    cycle_mel_mute();
+  };
+  for (int x = 0; x < 4; x++) {
+    cycle_drone_tromp_mute();
+  };
+  stream_crank_stop();
+};
+
+static void session_transpose() {
+  stream_crank_start();
+  for (int x = 0; x < 3; x++) {
+    tpose_up_1(true);
+  };
+  for (int x = 0; x < 3; x++) {
+    tpose_down_1(true);
+  };
+  for (int x = 0; x < 3; x++) {
+    cycle_capo(true);
+  };
+  stream_crank_stop();
+};
+
+static void session_volume() {
+  stream_crank_start();
+  vol_up();
+  vol_up();
+  vol_down();
+  vol_down();
+  stream_crank_stop();
+};
+
+static void session_preset() {
+  stream_crank_start();
+  ex_load_preset(2);
+  stream_crank_start();
+  stream_crank_stop();
+};
+
+struct StreamSession {
+  const char *name;
+  void (*run)();
+  int max_messages;
+  int max_bytes;
+};
+
+// The budgets are about 15% over each session's stream in selftest/ (e.g. "keys" is 487 messages and 2836 bytes),
+// with the default config.h.  If a change needs more, raise the budget on purpose.
+static const StreamSession stream_sessions[] = {
+  {"crank", session_crank, 44, 275},
+  {"keys", session_keys, 560, 3260},
+  {"keys_gros", session_keys_gros, 500, 2965},
+  {"keys_glide", session_keys_glide, 525, 3135},
+  {"keys_overlap", session_keys_overlap, 560, 3260},
+  {"trill_glide", session_trill_glide, 300, 1870},
+  {"mutes", session_mutes, 98, 600},
+  {"transpose", session_transpose, 366, 2175},
+  {"volume", session_volume, 165, 1035},
+  {"preset", session_preset, 69, 430},
+};
+
+const int STREAM_SESSION_COUNT = sizeof(stream_sessions) / sizeof(stream_sessions[0]);
+
+/// @brief Compares the captured stream to a golden file.
+/// @return 0 if they match, otherwise the first line (1-based) that differs
+static int stream_compare(File &f) {
+  char want[64];
+  char line[64];
+
+  for (int x = 0; x <= stream_len; x++) {
+    int len = 0;
+    int c;
+    while ((c = f.read()) >= 0 && c != '\n' && len < (int)sizeof(want) - 2) {
+      want[len++] = c;
+    };
+    if (c == '\n') {
+      want[len++] = '\n';
+    };
+    want[len] = 0;
+
+    if (x == stream_len) {
+      // The golden file should end here, too.
+      return (len == 0) ? 0 : x + 1;
+    };
+
+    stream_format(&stream_buf[x], line, sizeof(line));
+    if (strcmp(want, line) != 0) {
+      return x + 1;
+    };
+  };
+  return 0;
+};
+
+static bool stream_write(const char *path) {
+  if (SD.exists(path)) {
+    SD.remove(path);
+  };
+  File f = SD.open(path, FILE_WRITE);
+  if (!f) {
+    return false;
+  };
+
+  char block[512];
+  char line[64];
+  int used = 0;
+  for (int x = 0; x < stream_len; x++) {
+    int len = stream_format(&stream_buf[x], line, sizeof(line));
+    if (used + len > (int)sizeof(block)) {
+      f.write((const uint8_t *)block, used);
+      used = 0;
+    };
+    memcpy(block + used, line, len);
+    used += len;
+  };
+  f.write((const uint8_t *)block, used);
+  f.close();
+  return true;
+};
+
+/// @brief Runs every session and checks its budget and golden file.  Results are printed over Serial.
+/// @param record True to save every stream as the new golden file instead of comparing
+/// @return True if every session passed.
+bool stream_test_run(bool record) {
+  bool have_card = SD.begin(BUILTIN_SDCARD);
+  if (have_card && record && !SD.exists(STREAM_TEST_DIR)) {
+    SD.mkdir(STREAM_TEST_DIR);
+  };
+
+  StreamState saved;
+  stream_save_state(&saved);
+  all_soundOff();
+  all_soundKill();
+
+  int failed = 0;
+  String first_failure = "";
+
+  for (int x = 0; x < STREAM_SESSION_COUNT; x++) {
+    const StreamSession *session = &stream_sessions[x];
+
+    stream_capturing = true;
+    stream_setup();
+    stream_len = 0;
+    stream_bytes = 0;
+    stream_overflow = false;
+
+    session->run();
+    stream_capturing = false;
+
+    String result = "ok";
+
+    if (stream_overflow) {
+      result = String("over ") + STREAM_TEST_EVENTS + " messages";
+    } else if (stream_len > session->max_messages) {
+      result = String("messages ") + stream_len + " > " + session->max_messages;
+    } else if (stream_bytes > session->max_bytes) {
+      result = String("bytes ") + stream_bytes + " > " + session->max_bytes;
+    } else if (have_card) {
+      char path[48];
+      snprintf(path, sizeof(path), "%s/%s.txt", STREAM_TEST_DIR, session->name);
+
+      if (record) {
+        result = stream_write(path) ? "recorded" : "could not save";
+      } else if (!SD.exists(path)) {
+        result = "no golden file";
+      } else {
+        File f = SD.open(path, FILE_READ);
+        int diff = stream_compare(f);
+        f.close();
+        if (diff > 0) {
+          result = String("differs at line ") + diff;
+        };
+      };
+    };
+
+    bool passed = (result == "ok" || result == "recorded");
+    if (!passed) {
+      failed++;
+      if (first_failure == "") {
+        first_failure = String(session->name) + ": " + result;
+      };
+    };
+
+    Serial.print("MIDI self-test ");
+    Serial.print(session->name);
+    Serial.print(": ");
+    Serial.print(stream_len);
+    Serial.print(" messages, ");
+    Serial.print(stream_bytes);
+    Serial.print(" bytes, ");
+    Serial.println(result);
+  };
+
+  stream_restore_state(&saved);
+
+  if (failed == 0) {
+    print_message_2("MIDI Self-Test", String(STREAM_SESSION_COUNT) + " sessions passed", have_card ? "" : "(no SD card)");
+  } else {
+    print_message_2("MIDI Self-Test", String(failed) + " of " + STREAM_SESSION_COUNT + " failed", first_failure);
+  };
+  delay(3000);
+
+  return failed == 0;
+};
+
+/// @brief Prompts the user to run the MIDI self-test or record new golden files.
+void stream_test_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    print_menu_2("MIDI Self-Test", "Run Tests", "Record Golden Files");
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      print_message_2("MIDI Self-Test", "Running,", "Please wait...");
+      stream_test_run(false);
+
+    } else if (my2Button->wasPressed()) {
+      print_message_2("MIDI Self-Test", "Recording,", "Please wait...");
+      stream_test_run(true);
+
+    } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
+      done = true;
+    };
+  };
+};
+
+#endif
+
+/// @}
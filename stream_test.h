@@ -0,0 +1,36 @@
+#ifndef STREAM_TEST_H
+#define STREAM_TEST_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// Where a captured message was headed.  These are also the first letter of each line in a golden file.
+const char STREAM_USB = 'U';        // usbMIDI
+const char STREAM_SERIAL = 'S';     // The MIDI-OUT socket
+const char STREAM_TRIGGER = 'T';    // A Trigger/Tsunami unit
+
+// The kinds of captured messages.
+enum StreamKind : uint8_t {
+  STREAM_NOTE_ON = 0,
+  STREAM_NOTE_OFF,
+  STREAM_CC,
+  STREAM_PITCH_BEND,
+  STREAM_PROGRAM,
+  STREAM_TRACK_GAIN,
+  STREAM_TRACK_PLAY,
+  STREAM_TRACK_FADE,
+  STREAM_STOP_ALL,
+  STREAM_PRESSURE,
+  STREAM_TRACK_STOP,
+  STREAM_KIND_COUNT
+};
+
+extern bool stream_capturing;
+
+void stream_record(char sink, StreamKind kind, int channel, int a, int b);
+
+bool stream_test_run(bool record);
+void stream_test_screen();
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+// The saturation stress test: plays a trill on the keybox at rising rates, with every string sounding (gros notes
+// on the melody strings and trompette, the buzz on), and finds the rate at which the outputs stop keeping up.  The
+// gurdy runs it for real (Diagnostics -> Benchmarks -> Saturation Test, see benchmarks.cpp), tools/gurdy_host.cpp runs
+// the same code on a computer, and tools/stress_host.cpp estimates it from a model.  This header is plain C++ so
+// they all judge and print the steps the same way:
+//
+//   rate   6/s  keys   11  USB   220B/s MIDI   165B/s Trig   539B/s  voices 17/18  loop 34/6000us  backlog +0/+0B  ok
+//
+// A step fails when:
+// * a slow link's backlog (what's waiting to go out on MIDI-OUT or to the Trigger/Tsunami) grows by more than
+//   STRESS_BACKLOG_GROWTH over the step: it's being sent faster than the link can carry it,
+// * messages were dropped (USE_OUTPUT_GATING),
+// * the Trigger/Tsunami needed more voices than it has: some notes didn't sound,
+// * the slowest loop() pass went over the loop budget, or
+// * fewer than 90% of the key changes were made: the passes that send them take longer than the time between them.
+//
+// The ceiling is the last rate before the first failure.
+
+#include <stdint.h>
+#include <stdio.h>
+
+// The trill rates tried, in key changes a second.
+const int STRESS_RATES[] = {2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128};
+const int STRESS_NUM_RATES = sizeof(STRESS_RATES) / sizeof(STRESS_RATES[0]);
+
+// How much a link's backlog may grow over a step, in bytes, before the step fails.
+const int STRESS_BACKLOG_GROWTH = 32;
+
+// How long a faded-out Trigger/Tsunami track keeps its voice (GurdyString::triggerFade() fades over 200ms).
+const uint32_t STRESS_FADE_MS = 200;
+
+// The slow links, for the backlog.
+enum StressLink : uint8_t {
+  STRESS_MIDI_OUT = 0,
+  STRESS_TRIGGER,
+  STRESS_NUM_LINKS
+};
+
+struct StressStep {
+  int rate;                               // Key changes a second
+  uint32_t ms;                            // How long it played
+  uint32_t keys;                          // Key changes made
+  uint32_t bytes_per_sec[3];              // USB, MIDI-OUT, Trigger/Tsunami (as TrafficSink)
+  uint32_t dropped;                       // Messages dropped by gated links
+  int peak_voices;
+  uint32_t loop_avg_us;
+  uint32_t loop_max_us;
+  int backlog_start[STRESS_NUM_LINKS];    // The fewest bytes waiting in the step's second quarter
+  int backlog_end[STRESS_NUM_LINKS];      // The fewest bytes waiting in its last quarter
+};
+
+struct StressLimits {
+  int voices;                             // The Trigger/Tsunami's voices, 0 if there's none
+  uint32_t loop_budget_us;                // 0 to not judge loop time (the host model can't)
+};
+
+/// @brief Counts the Trigger/Tsunami voices in use.
+/// @details Voices aren't told apart: a play takes one and a fade gives one back STRESS_FADE_MS later.  Each
+/// string only ever fades its own last note, so the count is exact.  The key click is a one-shot: it takes a voice
+/// until it's stopped (the next click stops it) or it has played through.
+class StressVoices {
+  private:
+    static const int MAX_RELEASING = 64;
+    uint32_t release_ms[MAX_RELEASING];   // When each fading voice ends
+    int releasing = 0;
+    int sounding = 0;                     // Voices not fading
+    bool shot_on = false;
+    uint32_t shot_end_ms = 0;
+
+    void takeVoice() {
+      int n = sounding + releasing + (shot_on ? 1 : 0);
+      if (n > peak) {
+        peak = n;
+      }
+    }
+
+  public:
+    int peak = 0;
+
+    void reset() {
+      releasing = 0;
+      sounding = 0;
+      shot_on = false;
+      peak = 0;
+    }
+
+    /// @brief Frees the voices whose fades have finished.
+    void update(uint32_t now) {
+      int kept = 0;
+      for (int x = 0; x < releasing; x++) {
+        if ((int32_t)(now - release_ms[x]) < 0) {
+          release_ms[kept++] = release_ms[x];
+        }
+      }
+      releasing = kept;
+      if (shot_on && (int32_t)(now - shot_end_ms) >= 0) {
+        shot_on = false;
+      }
+    }
+
+    void play(uint32_t now) {
+      update(now);
+      sounding++;
+      takeVoice();
+    }
+
+    /// @brief Plays a one-shot.
+    /// @param length_ms How long it plays for
+    void shot(uint32_t now, uint32_t length_ms) {
+      update(now);
+      shot_on = true;
+      shot_end_ms = now + length_ms;
+      takeVoice();
+    }
+
+    void fade(uint32_t now) {
+      if (sounding == 0) {
+        return;
+      }
+      sounding--;
+      if (releasing < MAX_RELEASING) {
+        release_ms[releasing++] = now + STRESS_FADE_MS;
+      }
+    }
+
+    /// @brief Stops the one-shot.  Only the key click is ever stopped rather than faded.
+    void stop() {
+      shot_on = false;
+    }
+
+    int count(uint32_t now) {
+      update(now);
+      return sounding + releasing + (shot_on ? 1 : 0);
+    }
+};
+
+/// @brief Records how many bytes are waiting on a link, for the backlog.
+/// @param elapsed_ms How far into the step it is
+/// @param step_ms How long the step is
+/// @details Every key change fills the link's send buffer for a moment, so the backlog is the fewest bytes seen
+/// waiting over a quarter of the step: the part that never gets sent before the next key change.  Start the step
+/// with both backlogs at -1.
+inline void stress_sample_backlog(StressStep *s, int link, int waiting, uint32_t elapsed_ms, uint32_t step_ms) {
+  int quarter = (int)(elapsed_ms * 4 / step_ms);
+  int *low = nullptr;
+  if (quarter == 1) {
+    low = &s->backlog_start[link];
+  } else if (quarter == 3) {
+    low = &s->backlog_end[link];
+  }
+  if (low && (*low < 0 || waiting < *low)) {
+    *low = waiting;
+  }
+}
+
+/// @brief Returns how much a link's backlog grew over a step, 0 if it wasn't sampled in both quarters.
+inline int stress_growth(const StressStep &s, int link) {
+  if (s.backlog_start[link] < 0 || s.backlog_end[link] < 0) {
+    return 0;
+  }
+  return s.backlog_end[link] - s.backlog_start[link];
+}
+
+/// @brief Judges a step.
+/// @return Why it failed, or nullptr if it didn't.
+inline const char *stress_verdict(const StressStep &s, const StressLimits &lim) {
+  for (int x = 0; x < STRESS_NUM_LINKS; x++) {
+    if (stress_growth(s, x) > STRESS_BACKLOG_GROWTH) {
+      return (x == STRESS_MIDI_OUT) ? "MIDI-OUT backlog" : "Trigger backlog";
+    }
+  }
+  if (s.dropped > 0) {
+    return "dropped";
+  }
+  if (lim.voices > 0 && s.peak_voices > lim.voices) {
+    return "voices";
+  }
+  if (lim.loop_budget_us > 0 && s.loop_max_us > lim.loop_budget_us) {
+    return "loop time";
+  }
+  // The first key change comes one interval in, so a step on time makes one less than rate * ms.
+  if ((s.keys + 1) * 10 < (uint32_t)s.rate * s.ms / 1000 * 9) {
+    return "keys late";
+  }
+  return nullptr;
+}
+
+/// @brief Formats a step as one line (without a newline).
+/// @return The length of the line, as snprintf()
+inline int stress_format(const StressStep &s, const StressLimits &lim, char *line, int size) {
+  const char *why = stress_verdict(s, lim);
+  return snprintf(line, size,
+                  "rate %3d/s  keys %4lu  USB %5luB/s MIDI %5luB/s Trig %5luB/s  voices %2d/%-2d  loop %lu/%luus  "
+                  "backlog %+d/%+dB  %s",
+                  s.rate, (unsigned long)s.keys, (unsigned long)s.bytes_per_sec[0], (unsigned long)s.bytes_per_sec[1],
+                  (unsigned long)s.bytes_per_sec[2], s.peak_voices, lim.voices, (unsigned long)s.loop_avg_us,
+                  (unsigned long)s.loop_max_us, stress_growth(s, STRESS_MIDI_OUT), stress_growth(s, STRESS_TRIGGER),
+                  why ? why : "ok");
+}
+
+/// @brief Formats the ceiling found by a run (without a newline).
+/// @param steps The steps run, in rate order, up to and including the first failure
+/// @param count How many
+inline int stress_format_ceiling(const StressStep *steps, int count, const StressLimits &lim, char *line, int size) {
+  for (int x = 0; x < count; x++) {
+    const char *why = stress_verdict(steps[x], lim);
+    if (why) {
+      if (x == 0) {
+        return snprintf(line, size, "ceiling: below %d key changes/s (%s)", steps[x].rate, why);
+      }
+      return snprintf(line, size, "ceiling: %d key changes/s (%s at %d/s)", steps[x - 1].rate, why, steps[x].rate);
+    }
+  }
+  return snprintf(line, size, "ceiling: at least %d key changes/s", count > 0 ? steps[count - 1].rate : 0);
+}
+
+#endif
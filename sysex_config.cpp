@@ -0,0 +1,202 @@
+#include "sysex_config.h"
+
+#include "crank.h"
+extern Crank *mycrank;
+
+/// @defgroup sysex SysEx Configuration Transfer
+/// These functions send and receive the whole EEPROM configuration as SysEx over usbMIDI.
+///
+/// See `sysex_protocol.h` for the message format and `tools/sysex_tool.cpp` for building and
+/// checking dump files on a computer.
+///
+/// * Sending a DUMP_REQUEST makes the gurdy answer with its configuration as DUMP_CHUNK messages.
+/// * Sending DUMP_CHUNK messages loads a configuration.  Each good chunk is ACK'd and one that doesn't
+///   fit this firmware is NAK'd.  A damaged chunk is never ACK'd, and may simply be re-sent.  Once
+///   every chunk is in, the configuration is saved and a final ACK (with the chunk index equal to the
+///   chunk count) is sent.
+///
+/// Nothing here blocks, so a transfer can happen mid-tune: at most one chunk is sent per loop(), and a load
+/// is saved a few changed bytes at a time (SYSEX_SAVE_WRITES), since each write to a Teensy 4's flash-emulated
+/// EEPROM can stall.  Tunings saved in slots, EX button setup, display and scene settings take effect as soon
+/// as the load is saved.  A change to the secondary output (EEPROM_SEC_OUT) takes effect on restart.
+/// @version *New in 3.1.0*
+/// @{
+
+static constexpr int SYSEX_NUM_CHUNKS = sysex_chunk_count(EEPROM_CONFIG_LEN);
+
+static uint8_t sysex_msg[SYSEX_MAX_MSG_LEN];
+
+// The next chunk of an outgoing dump, -1 if none is being sent.
+static int dump_chunk = -1;
+
+// Incoming chunks are staged here until all of them have arrived, so a broken transfer never
+// leaves a half-written configuration behind.
+static uint8_t load_image[EEPROM_CONFIG_LEN];
+static bool load_received[SYSEX_NUM_CHUNKS];
+static int load_num_received = 0;
+
+// The next staged byte to write to EEPROM, -1 if none is being saved.
+static int save_at = -1;
+
+// The most bytes written to EEPROM per loop(), and the most compared to see if they need it.
+static const int SYSEX_SAVE_WRITES = 4;
+static const int SYSEX_SAVE_READS = SYSEX_CHUNK_SIZE;
+
+/// @brief Returns the length of the given chunk of the configuration.
+static int sysex_chunk_len(int idx) {
+  int len = EEPROM_CONFIG_LEN - idx * SYSEX_CHUNK_SIZE;
+  return (len > SYSEX_CHUNK_SIZE) ? SYSEX_CHUNK_SIZE : len;
+};
+
+/// @brief Sends a message with no payload (ACK/NAK).
+static void sysex_send_reply(uint8_t cmd, uint8_t idx) {
+  int len = sysex_build(cmd, idx, SYSEX_NUM_CHUNKS, NULL, 0, sysex_msg);
+  usbMIDI.sendSysEx(len, sysex_msg, true);
+};
+
+/// @brief Puts the newly-saved configuration into effect.
+/// @details This re-reads the same settings that loop() reads on its first pass.
+static void sysex_apply_config() {
+  play_screen_type = EEPROM.read(EEPROM_DISPLY_TYPE);
+  scene_signal_type = EEPROM.read(EEPROM_SCENE_SIGNALLING);
+  use_solfege = EEPROM.read(EEPROM_USE_SOLFEGE);
+  mel_vibrato = EEPROM.read(EEPROM_MEL_VIBRATO);
+
+  ex1Button->reload();
+  ex2Button->reload();
+  ex3Button->reload();
+  ex4Button->reload();
+  ex5Button->reload();
+  ex6Button->reload();
+
+  #ifdef REV4_MODE
+  ex7Button->reload();
+  ex8Button->reload();
+  ex9Button->reload();
+  ex10Button->reload();
+  #endif
+
+  bigButton->reload();
+
+  #ifdef LED_KNOB
+  if (EEPROM.read(EEPROM_BUZZ_LED) == 1) {
+    mycrank->enableLED();
+  } else {
+    mycrank->disableLED();
+  };
+  #endif
+
+  #ifdef USE_MPE
+  bool want_mpe = (EEPROM.read(EEPROM_MPE) == 1);
+  if (want_mpe && !mpe_on) {
+    mpe_start();
+  } else if (!want_mpe && mpe_on) {
+    mpe_stop();
+  };
+  #endif
+
+  #ifdef USE_LEGATO
+  set_legato(EEPROM.read(EEPROM_LEGATO));
+  #endif
+};
+
+/// @brief Handles one incoming SysEx message.
+/// @param msg The complete message, F0 to F7, as given by usbMIDI.getSysExArray()
+/// @param len The message length
+/// @details Messages that aren't ours, or fail their checksum, are ignored.  A damaged chunk of
+/// ours can't be told apart from someone else's message, so it is simply never ACK'd.
+void sysex_receive(const uint8_t *msg, int len) {
+  uint8_t cmd, idx, count;
+  uint8_t raw[SYSEX_CHUNK_SIZE];
+
+  int raw_len = sysex_parse(msg, len, &cmd, &idx, &count, raw);
+  if (raw_len < 0) {
+    return;
+  };
+
+  if (cmd == SYSEX_DUMP_REQUEST) {
+    dump_chunk = 0;
+
+  } else if (cmd == SYSEX_DUMP_CHUNK) {
+
+    // Chunks from a different-sized configuration (i.e. another firmware version) are refused whole.
+    if (count != SYSEX_NUM_CHUNKS || idx >= SYSEX_NUM_CHUNKS || raw_len != sysex_chunk_len(idx) || save_at >= 0) {
+      sysex_send_reply(SYSEX_NAK, idx);
+      return;
+    };
+
+    // The first chunk starts a new transfer.
+    if (idx == 0) {
+      for (int x = 0; x < SYSEX_NUM_CHUNKS; x++) {
+        load_received[x] = false;
+      };
+      load_num_received = 0;
+    };
+
+    memcpy(load_image + idx * SYSEX_CHUNK_SIZE, raw, raw_len);
+    if (!load_received[idx]) {
+      load_received[idx] = true;
+      load_num_received++;
+    };
+    sysex_send_reply(SYSEX_ACK, idx);
+
+    if (load_num_received == SYSEX_NUM_CHUNKS) {
+      save_at = 0;
+      load_num_received = 0;
+    };
+  };
+};
+
+/// @brief Advances any transfer in progress by one chunk, or by a few bytes of a save.
+/// @note This should be run once per loop().
+void sysex_update() {
+
+  if (save_at >= 0) {
+
+    // Only bytes that changed are written, which spares the EEPROM and the time.
+    int writes = 0;
+    int end = save_at + SYSEX_SAVE_READS;
+    if (end > EEPROM_CONFIG_LEN) {
+      end = EEPROM_CONFIG_LEN;
+    };
+    while (save_at < end && writes < SYSEX_SAVE_WRITES) {
+      if (EEPROM.read(save_at) != load_image[save_at]) {
+        EEPROM.write(save_at, load_image[save_at]);
+        writes++;
+      };
+      save_at++;
+    };
+
+    if (save_at == EEPROM_CONFIG_LEN) {
+      save_at = -1;
+      sysex_apply_config();
+      sysex_send_reply(SYSEX_ACK, SYSEX_NUM_CHUNKS);
+      Serial.println("SysEx configuration loaded.");
+    };
+
+  } else if (dump_chunk >= 0) {
+    uint8_t raw[SYSEX_CHUNK_SIZE];
+    int start = dump_chunk * SYSEX_CHUNK_SIZE;
+    int len = sysex_chunk_len(dump_chunk);
+
+    for (int x = 0; x < len; x++) {
+      raw[x] = EEPROM.read(start + x);
+    };
+
+    int msg_len = sysex_build(SYSEX_DUMP_CHUNK, dump_chunk, SYSEX_NUM_CHUNKS, raw, len, sysex_msg);
+    usbMIDI.sendSysEx(msg_len, sysex_msg, true);
+
+    dump_chunk++;
+    if (dump_chunk == SYSEX_NUM_CHUNKS) {
+      dump_chunk = -1;
+    };
+  };
+};
+
+/// @brief Returns whether a dump or save is in progress.
+/// @return True if sysex_update() still has work to do.
+bool sysex_busy() {
+  return (dump_chunk >= 0 || save_at >= 0);
+};
+
+/// @}
@@ -0,0 +1,19 @@
+#ifndef SYSEX_CONFIG_H
+#define SYSEX_CONFIG_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "common.h"
+#include "config.h"
+#include "eeprom_values.h"
+#include "ex_screens.h"
+#include "notes.h"
+#include "sysex_protocol.h"
+#include "mpe.h"
+
+void sysex_receive(const uint8_t *msg, int len);
+void sysex_update();
+bool sysex_busy();
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef SYSEX_PROTOCOL_H
+#define SYSEX_PROTOCOL_H
+
+// The SysEx bulk configuration protocol.  This header is plain C++ with no Arduino
+// dependencies so the host-side tool in tools/ can build and check dumps with the exact same code.
+//
+// A configuration is the first EEPROM_CONFIG_LEN bytes of EEPROM (see eeprom_values.h), sent as
+// a series of chunks.  Every message looks like:
+//
+//   F0 7D 44 47 <version> <command> <chunk index> <chunk count> <payload...> <checksum> F7
+//
+// * 7D is the MIDI "non-commercial" manufacturer ID, 44 47 is "DG".
+// * The payload is up to SYSEX_CHUNK_SIZE raw bytes packed 7 bytes to 8 (one byte of high bits
+//   followed by the seven low-7-bit bytes), so EEPROM values above 127 survive.
+// * The checksum is Roland-style: the sum of everything from <version> to the end of the payload,
+//   plus the checksum, is a multiple of 128.
+
+#include <stdint.h>
+
+const uint8_t SYSEX_START = 0xF0;
+const uint8_t SYSEX_END = 0xF7;
+const uint8_t SYSEX_MANUFACTURER = 0x7D;
+const uint8_t SYSEX_DEVICE_1 = 0x44;
+const uint8_t SYSEX_DEVICE_2 = 0x47;
+const uint8_t SYSEX_VERSION = 1;
+
+// Commands:
+// * DUMP_REQUEST - host asks for the configuration.  No payload.
+// * DUMP_CHUNK   - one chunk of configuration, in either direction.
+// * ACK          - the gurdy accepted a chunk.  <chunk index> is the chunk, or <chunk count> once the whole load is saved.
+// * NAK          - the gurdy rejected a chunk.  <chunk index> is the bad chunk.
+const uint8_t SYSEX_DUMP_REQUEST = 0x01;
+const uint8_t SYSEX_DUMP_CHUNK = 0x02;
+const uint8_t SYSEX_ACK = 0x03;
+const uint8_t SYSEX_NAK = 0x04;
+
+const int SYSEX_CHUNK_SIZE = 32;
+const int SYSEX_HEADER_LEN = 8;
+
+/// @brief The packed size of a raw payload.
+constexpr int sysex_packed_len(int raw_len) {
+  return raw_len + (raw_len + 6) / 7;
+}
+
+const int SYSEX_MAX_MSG_LEN = SYSEX_HEADER_LEN + sysex_packed_len(SYSEX_CHUNK_SIZE) + 2;
+
+/// @brief Packs raw 8-bit bytes into 7-bit SysEx data.
+/// @return The number of bytes written to out.
+inline int sysex_pack(const uint8_t *in, int len, uint8_t *out) {
+  int o = 0;
+  for (int i = 0; i < len; i += 7) {
+    int group = (len - i < 7) ? len - i : 7;
+    uint8_t high_bits = 0;
+    for (int j = 0; j < group; j++) {
+      if (in[i + j] & 0x80) {
+        high_bits |= (1 << j);
+      }
+    }
+    out[o++] = high_bits;
+    for (int j = 0; j < group; j++) {
+      out[o++] = in[i + j] & 0x7F;
+    }
+  }
+  return o;
+}
+
+/// @brief Unpacks 7-bit SysEx data back into raw bytes.
+/// @return The number of bytes written to out, or -1 if the data is malformed.
+inline int sysex_unpack(const uint8_t *in, int len, uint8_t *out) {
+  int o = 0;
+  for (int i = 0; i < len; i += 8) {
+    int group = (len - i < 8) ? len - i - 1 : 7;
+    if (group < 1) {
+      return -1;
+    }
+    uint8_t high_bits = in[i];
+    for (int j = 0; j < group; j++) {
+      if (in[i + 1 + j] & 0x80) {
+        return -1;
+      }
+      out[o++] = in[i + 1 + j] | (((high_bits >> j) & 1) << 7);
+    }
+  }
+  return o;
+}
+
+/// @brief Computes the Roland-style checksum of a run of SysEx data bytes.
+inline uint8_t sysex_checksum(const uint8_t *data, int len) {
+  unsigned int sum = 0;
+  for (int i = 0; i < len; i++) {
+    sum += data[i];
+  }
+  return (128 - (sum % 128)) % 128;
+}
+
+/// @brief Builds a complete message, F0 to F7.
+/// @param out Must hold at least SYSEX_MAX_MSG_LEN bytes.
+/// @return The message length.
+inline int sysex_build(uint8_t cmd, uint8_t idx, uint8_t count, const uint8_t *raw, int raw_len, uint8_t *out) {
+  out[0] = SYSEX_START;
+  out[1] = SYSEX_MANUFACTURER;
+  out[2] = SYSEX_DEVICE_1;
+  out[3] = SYSEX_DEVICE_2;
+  out[4] = SYSEX_VERSION;
+  out[5] = cmd;
+  out[6] = idx;
+  out[7] = count;
+  int len = SYSEX_HEADER_LEN + sysex_pack(raw, raw_len, out + SYSEX_HEADER_LEN);
+  out[len] = sysex_checksum(out + 4, len - 4);
+  out[len + 1] = SYSEX_END;
+  return len + 2;
+}
+
+/// @brief Parses and validates a complete message, F0 to F7.
+/// @param raw Filled with the unpacked payload, must hold SYSEX_CHUNK_SIZE bytes.
+/// @return The payload length, or -1 if the message is not ours, is malformed, or fails its checksum.
+inline int sysex_parse(const uint8_t *msg, int len, uint8_t *cmd, uint8_t *idx, uint8_t *count, uint8_t *raw) {
+  if (len < SYSEX_HEADER_LEN + 2 || len > SYSEX_MAX_MSG_LEN) {
+    return -1;
+  }
+  if (msg[0] != SYSEX_START || msg[len - 1] != SYSEX_END || msg[1] != SYSEX_MANUFACTURER ||
+      msg[2] != SYSEX_DEVICE_1 || msg[3] != SYSEX_DEVICE_2 || msg[4] != SYSEX_VERSION) {
+    return -1;
+  }
+  if (sysex_checksum(msg + 4, len - 6) != msg[len - 2]) {
+    return -1;
+  }
+  *cmd = msg[5];
+  *idx = msg[6];
+  *count = msg[7];
+
+  int packed = len - SYSEX_HEADER_LEN - 2;
+  if (packed == 0) {
+    return 0;
+  }
+  return sysex_unpack(msg + SYSEX_HEADER_LEN, packed, raw);
+}
+
+/// @brief The number of chunks a configuration of the given length is sent in.
+constexpr int sysex_chunk_count(int config_len) {
+  return (config_len + SYSEX_CHUNK_SIZE - 1) / SYSEX_CHUNK_SIZE;
+}
+
+#endif
@@ -0,0 +1,111 @@
+// bench_host: runs the benchmarks that can run on a computer, with the same harness (bench.h) and
+// output format as the gurdy's Diagnostics -> Benchmarks.
+//
+// Build with:
+//
+//   g++ -std=c++17 -O2 -o bench_host tools/bench_host.cpp
+//
+// Usage:
+//
+//   bench_host [filter] > results.txt
+//
+// Only benchmarks whose name contains filter are run.  The host can run the plain-C++ parts of the gurdy:
+// the crank estimators, the synthetic crank and the SysEx packing.  Everything that touches hardware
+// (strings, keys, the display) is benchmarked on the gurdy itself.  Compare two result files with diff or
+// side by side; the columns line up.
+
+#include <cstring>
+#include <string>
+
+#include "../bench.h"
+#include "../crank_estimator.h"
+#include "../crank_sim.h"
+#include "../sysex_protocol.h"
+
+// Keeps the compiler from optimizing away a benchmark's result.
+static volatile double bench_sink;
+
+static const char *bench_filter = nullptr;
+
+template <class F>
+static void bench(const char *name, uint32_t iterations, F fn) {
+  if (bench_filter && !strstr(name, bench_filter)) {
+    return;
+  }
+  char line[160];
+  bench_format(bench_run(name, iterations, fn), line, sizeof(line));
+  puts(line);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    bench_filter = argv[1];
+  }
+
+  printf("# host cycles are time-stamp counter ticks\n");
+
+  // Crank estimators, fed a steady ~60 RPM crank.
+  OpticalEstimator optical(CRANK_ESTIMATOR_DEFAULTS);
+  uint32_t since_eval = 0;
+  bench("OpticalEstimator::update", 1000000, [&]() {
+    since_eval += 10;
+    if (optical.update(since_eval, 34, since_eval - 300, 80)) {
+      since_eval = 0;
+    }
+    bench_sink = optical.cur_vel;
+  });
+
+  EncoderEstimator encoder(CRANK_ESTIMATOR_DEFAULTS);
+  long pulse = 0;
+  uint32_t enc_eval = 0;
+  bench("EncoderEstimator::update", 1000000, [&]() {
+    enc_eval += 10;
+    pulse += 2;
+    if (encoder.update(enc_eval, pulse, enc_eval, 1200) != CRANK_EST_NONE) {
+      enc_eval = 0;
+    }
+    bench_sink = encoder.cur_vel;
+  });
+
+  GearEstimator gear(GEAR_ESTIMATOR_DEFAULTS);
+  int adc = 0;
+  bench("GearEstimator::update", 1000000, [&]() {
+    adc = (adc + 7) % 40;
+    gear.update(adc, 3);
+    gear.updateBuzz(20);
+    bench_sink = gear.spin;
+  });
+
+  double v = 0;
+  bench("crank_expression", 1000000, [&]() {
+    v = (v < 6.0) ? v + 0.01 : 0;
+    bench_sink = crank_expression(v, CRANK_ESTIMATOR_DEFAULTS) + crank_buzz_expression(v * 40, crank_buzz_threshold(512));
+  });
+
+  // The synthetic crank.
+  CrankProfile profile = {CRANK_COUPS, 60.0, 120.0, 500000, 0.05, 1};
+  CrankSim sim(profile, 80, 0);
+  uint32_t now = 0;
+  uint32_t edges[16];
+  bench("CrankSim::advance", 1000000, [&]() {
+    now += 10;
+    bench_sink = sim.advance(now, edges, 16);
+  });
+
+  // SysEx chunks.
+  uint8_t raw[32];
+  uint8_t msg[64];
+  for (int x = 0; x < 32; x++) {
+    raw[x] = x * 37;
+  }
+  bench("sysex_build", 100000, [&]() {
+    bench_sink = sysex_build(2, 1, 5, raw, 32, msg);
+  });
+  uint8_t cmd, idx, count;
+  uint8_t out[32];
+  bench("sysex_parse", 100000, [&]() {
+    bench_sink = sysex_parse(msg, sysex_build(2, 1, 5, raw, 32, msg), &cmd, &idx, &count, out);
+  });
+
+  return 0;
+}
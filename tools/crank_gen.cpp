@@ -0,0 +1,121 @@
+// crank_gen: writes a synthetic crank session, using the same CrankSim the gurdy uses with CRANK_SIM.
+//
+// Build with:
+//
+//   g++ -std=c++17 -O2 -o crank_gen tools/crank_gen.cpp
+//
+// Usage:
+//
+//   crank_gen <profile> <rpm> <rpm2> <period_ms> <length_ms> [options] > session.txt
+//
+//   profile is steady, ramp, coups or stop-start (see CRANK_SIM_PROFILE in config.h).
+//
+//   --encoder      Encoder counts (2 * spokes per revolution) instead of optical edges.
+//   --spokes N     NUM_SPOKES, default 80 (optical) or 1200 (encoder), as in config.h.
+//   --jitter F     Random speed wobble as a fraction of the speed, default 0.
+//   --seed N       Jitter seed, default 1.
+//   --step US      Simulation step in microseconds, default 100.
+//
+// Output is one event per line, times in microseconds:
+//
+//   # kind=optical edges_per_rev=80 profile=coups rpm=3 rpm2=6 period_ms=1000 length_ms=5000
+//   E <time>              an optical rising edge
+//   C <time> <count>      an encoder position change
+//
+// Lines starting with '#' are comments.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../crank_sim.h"
+
+static void usage() {
+  fprintf(stderr, "usage: crank_gen <steady|ramp|coups|stop-start> <rpm> <rpm2> <period_ms> <length_ms>\n"
+                  "                 [--encoder] [--spokes N] [--jitter F] [--seed N] [--step US]\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 6) {
+    usage();
+    return 2;
+  }
+
+  CrankProfile profile;
+  profile.type = CRANK_STEADY;
+  bool found = false;
+  for (int x = 0; x < CRANK_NUM_PROFILES; x++) {
+    if (strcmp(argv[1], crank_profile_name(x)) == 0) {
+      profile.type = (CrankProfileType)x;
+      found = true;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "Unknown profile %s\n", argv[1]);
+    return 2;
+  }
+
+  profile.rpm = atof(argv[2]);
+  profile.rpm2 = atof(argv[3]);
+  profile.period_us = atoi(argv[4]) * 1000;
+  profile.jitter = 0.0;
+  profile.seed = 1;
+  uint32_t length_us = atoi(argv[5]) * 1000;
+
+  bool encoder = false;
+  int spokes = 0;
+  uint32_t step = 100;
+
+  for (int x = 6; x < argc; x++) {
+    std::string opt = argv[x];
+    if (opt == "--encoder") {
+      encoder = true;
+    } else if (opt == "--spokes" && x + 1 < argc) {
+      spokes = atoi(argv[++x]);
+    } else if (opt == "--jitter" && x + 1 < argc) {
+      profile.jitter = atof(argv[++x]);
+    } else if (opt == "--seed" && x + 1 < argc) {
+      profile.seed = atoi(argv[++x]);
+    } else if (opt == "--step" && x + 1 < argc) {
+      step = atoi(argv[++x]);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  if (spokes <= 0) {
+    spokes = encoder ? 1200 : 80;
+  }
+  if (step == 0) {
+    step = 1;
+  }
+  int edges_per_rev = encoder ? spokes * 2 : spokes;
+
+  printf("# kind=%s edges_per_rev=%d profile=%s rpm=%g rpm2=%g period_ms=%u length_ms=%u\n",
+         encoder ? "encoder" : "optical", edges_per_rev, crank_profile_name(profile.type),
+         profile.rpm, profile.rpm2, profile.period_us / 1000, length_us / 1000);
+
+  CrankSim sim(profile, edges_per_rev, 0);
+  const int max_edges = 256;
+  uint32_t edge_times[max_edges];
+
+  for (uint32_t t = step; t <= length_us; t += step) {
+    int count = sim.advance(t, edge_times, max_edges);
+    if (count > max_edges) {
+      fprintf(stderr, "More than %d edges in one %uus step, use a smaller --step.\n", max_edges, step);
+      return 1;
+    }
+
+    long pos = sim.position() - count;
+    for (int x = 0; x < count; x++) {
+      if (encoder) {
+        printf("C %u %ld\n", edge_times[x], ++pos);
+      } else {
+        printf("E %u\n", edge_times[x]);
+      }
+    }
+  }
+  return 0;
+}
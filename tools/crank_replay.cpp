@@ -0,0 +1,244 @@
+// crank_replay: replays recorded crank sessions through the gurdy's crank estimators.
+//
+// Build with:
+//
+//   g++ -std=c++17 -O2 -o crank_replay tools/crank_replay.cpp
+//
+// Usage:
+//
+//   crank_replay [options] session.txt...
+//
+//   --set NAME=VALUE      Override an estimator value (see below), e.g. --set rise_factor=0.7
+//   --loop-us N           Simulated loop() period for optical/encoder cranks, default 10
+//   --gap-ms N            Quiet time that counts as the crank stopping, default 300
+//   --knob N              Buzz knob reading (0-1023) until a session records one, default 512
+//   --deadband N          EXPRESSION_HIRES_DEADBAND for the 14-bit expression count, default 32
+//   --trace FILE          Write a CSV trace of every session (every 50ms; every update for gear)
+//   --summary FILE        Write one summary line per session
+//   --baseline FILE       Compare against an earlier --summary and fail on regressions
+//   --tolerance-ms N      Latency increase allowed against the baseline, default 5
+//
+// Sessions are crank captures saved by the gurdy (Other Options -> Diagnostics -> Crank Capture)
+// or crank_gen output.  For each one this reports how many times sound started and stopped, how long
+// after the crank started/stopped moving it did so, stutters (false starts), buzz transitions,
+// expression smoothness, the MIDI bytes of expression sent to a string (7-bit and 14-bit) and the host
+// time per update.
+//
+// Keep a directory of captures and a summary of them as a regression suite: re-run with
+// --baseline after every change to crank_estimator.h or the crank settings in config.h.
+//
+// Values for --set (see CRANK_PARAMS in crank_replay.h for their config.h names): eval_us decay_us
+// rise_factor rise_bias fall_factor decay_factor enc_eval_us enc_decay_us enc_factor v_threshold
+// expression_vmax expression_start (optical/encoder), and vol_threshold max_spin spin_weight spin_decay
+// spin_threshold spin_stop_threshold buzz_smoothing buzz_decay (gear).
+
+#include <cmath>
+#include <iostream>
+#include <map>
+
+#include "crank_replay.h"
+
+static std::string summary_line(const std::string &name, const ReplayResult &r) {
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "%s motions=%d starts=%d stops=%d missed=%d false=%d start_avg_ms=%.1f start_max_ms=%.1f "
+           "stop_avg_ms=%.1f stop_max_ms=%.1f buzz_on=%d buzz_off=%d expr_jitter=%.2f expr_bytes=%d expr14_bytes=%d "
+           "ns_per_update=%.1f",
+           name.c_str(), r.motions, r.starts, r.stops, r.missed_starts, r.false_starts,
+           r.start_latency_avg_ms, r.start_latency_max_ms, r.stop_latency_avg_ms, r.stop_latency_max_ms,
+           r.buzz_starts, r.buzz_stops, r.expression_jitter, r.expression_bytes, r.expression14_bytes,
+           r.ns_per_update);
+  return buf;
+}
+
+static std::map<std::string, double> parse_summary(const std::string &line, std::string &name) {
+  std::map<std::string, double> values;
+  std::istringstream words(line);
+  words >> name;
+  std::string word;
+  while (words >> word) {
+    size_t eq = word.find('=');
+    if (eq != std::string::npos) {
+      values[word.substr(0, eq)] = atof(word.c_str() + eq + 1);
+    }
+  }
+  return values;
+}
+
+// Compares one session's summary to its baseline.  Returns the number of regressions.
+static int compare(const std::string &name, const std::map<std::string, double> &now,
+                   const std::map<std::string, double> &base, double tolerance_ms) {
+  int regressions = 0;
+  auto get = [](const std::map<std::string, double> &m, const char *key) {
+    auto it = m.find(key);
+    return it == m.end() ? 0.0 : it->second;
+  };
+
+  const char *counts[] = {"missed", "false"};
+  for (const char *key : counts) {
+    if (get(now, key) > get(base, key)) {
+      printf("REGRESSION %s: %s %g -> %g\n", name.c_str(), key, get(base, key), get(now, key));
+      regressions++;
+    }
+  }
+
+  const char *latencies[] = {"start_max_ms", "stop_max_ms"};
+  for (const char *key : latencies) {
+    if (get(now, key) > get(base, key) + tolerance_ms) {
+      printf("REGRESSION %s: %s %g -> %g\n", name.c_str(), key, get(base, key), get(now, key));
+      regressions++;
+    }
+  }
+
+  const char *changes[] = {"starts", "stops", "buzz_on", "buzz_off"};
+  for (const char *key : changes) {
+    if (get(now, key) != get(base, key)) {
+      printf("CHANGED %s: %s %g -> %g\n", name.c_str(), key, get(base, key), get(now, key));
+    }
+  }
+  return regressions;
+}
+
+int main(int argc, char **argv) {
+  CrankEstimatorParams params = CRANK_ESTIMATOR_DEFAULTS;
+  GearEstimatorParams gear_params = GEAR_ESTIMATOR_DEFAULTS;
+  ReplayOptions opt;
+  std::string trace_path, summary_path, baseline_path;
+  double tolerance_ms = 5.0;
+  std::vector<std::string> paths;
+
+  for (int x = 1; x < argc; x++) {
+    std::string arg = argv[x];
+    bool has_val = x + 1 < argc;
+
+    if (arg == "--set" && has_val) {
+      std::string kv = argv[++x];
+      size_t eq = kv.find('=');
+      int index = (eq == std::string::npos) ? -1 : crank_find_param(kv.substr(0, eq));
+      if (index < 0) {
+        fprintf(stderr, "Unknown setting %s\n", kv.c_str());
+        return 2;
+      }
+      crank_set_param(params, gear_params, index, atof(kv.c_str() + eq + 1));
+    } else if (arg == "--loop-us" && has_val) {
+      opt.loop_us = std::max(1, atoi(argv[++x]));
+    } else if (arg == "--gap-ms" && has_val) {
+      opt.gap_us = atoi(argv[++x]) * 1000;
+    } else if (arg == "--knob" && has_val) {
+      opt.knob = atof(argv[++x]);
+    } else if (arg == "--deadband" && has_val) {
+      opt.deadband = std::max(1, atoi(argv[++x]));
+    } else if (arg == "--trace" && has_val) {
+      trace_path = argv[++x];
+    } else if (arg == "--summary" && has_val) {
+      summary_path = argv[++x];
+    } else if (arg == "--baseline" && has_val) {
+      baseline_path = argv[++x];
+    } else if (arg == "--tolerance-ms" && has_val) {
+      tolerance_ms = atof(argv[++x]);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return 2;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.empty()) {
+    fprintf(stderr, "usage: crank_replay [options] session.txt...\n");
+    return 2;
+  }
+
+  std::map<std::string, std::map<std::string, double>> baseline;
+  if (!baseline_path.empty()) {
+    std::ifstream in(baseline_path);
+    if (!in) {
+      fprintf(stderr, "Can't open %s\n", baseline_path.c_str());
+      return 2;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty() && line[0] != '#') {
+        std::string name;
+        auto values = parse_summary(line, name);
+        baseline[name] = values;
+      }
+    }
+  }
+
+  FILE *trace = nullptr;
+  if (!trace_path.empty()) {
+    trace = fopen(trace_path.c_str(), "w");
+    if (!trace) {
+      fprintf(stderr, "Can't write %s\n", trace_path.c_str());
+      return 2;
+    }
+    // For gear sessions, velocity is the spin counter, expression the adjusted voltage and
+    // buzz_expression the buzz countdown.
+    fprintf(trace, "session,time_ms,velocity,spinning,buzzing,expression,buzz_expression\n");
+  }
+
+  std::vector<std::string> summaries;
+  int regressions = 0;
+  int failures = 0;
+
+  for (const std::string &path : paths) {
+    CrankSession session;
+    std::string err;
+    if (!crank_load_session(path, session, err)) {
+      fprintf(stderr, "%s\n", err.c_str());
+      failures++;
+      continue;
+    }
+
+    ReplayResult r = crank_replay(session, params, gear_params, opt, trace != nullptr);
+
+    printf("%s (%s, %zu events):\n", session.name.c_str(), session.kind.c_str(), session.events.size());
+    printf("  motions %d, sound started %d / stopped %d times, %d missed, %d false starts\n",
+           r.motions, r.starts, r.stops, r.missed_starts, r.false_starts);
+    printf("  start latency avg %.1fms max %.1fms, stop latency avg %.1fms max %.1fms\n",
+           r.start_latency_avg_ms, r.start_latency_max_ms, r.stop_latency_avg_ms, r.stop_latency_max_ms);
+    printf("  buzz on %d / off %d, expression jitter %.2f, %llu updates at %.1fns each\n",
+           r.buzz_starts, r.buzz_stops, r.expression_jitter, (unsigned long long)r.updates, r.ns_per_update);
+    printf("  expression sent to each string: %d bytes 7-bit, %d bytes 14-bit\n",
+           r.expression_bytes, r.expression14_bytes);
+
+    if (trace) {
+      for (const TracePoint &tp : r.trace) {
+        fprintf(trace, "%s,%.3f,%.3f,%d,%d,%d,%d\n", session.name.c_str(), tp.time / 1000.0, tp.velocity,
+                tp.spinning, tp.buzzing, tp.expression, tp.buzz_expression);
+      }
+    }
+
+    std::string line = summary_line(session.name, r);
+    summaries.push_back(line);
+
+    if (!baseline.empty()) {
+      std::string name;
+      auto now = parse_summary(line, name);
+      auto it = baseline.find(name);
+      if (it == baseline.end()) {
+        printf("NEW %s: not in the baseline\n", name.c_str());
+      } else {
+        regressions += compare(name, now, it->second, tolerance_ms);
+      }
+    }
+  }
+
+  if (trace) {
+    fclose(trace);
+  }
+
+  if (!summary_path.empty()) {
+    std::ofstream out(summary_path);
+    for (const std::string &line : summaries) {
+      out << line << "\n";
+    }
+  }
+
+  if (regressions > 0) {
+    printf("%d regression(s) against %s\n", regressions, baseline_path.c_str());
+    return 1;
+  }
+  return failures > 0 ? 1 : 0;
+}
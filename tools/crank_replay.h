@@ -0,0 +1,507 @@
+// Crank session loading and replay, shared by the host tools.
+//
+// A session is a crank capture (see crank_capture.cpp) or a crank_gen output.  Replaying one runs
+// its raw input through the same estimators and event stage GurdyCrank and GearCrank use
+// (crank_estimator.h), with the same timing rules as the gurdy's loop(), and measures how the crank
+// logic behaved.
+
+#ifndef CRANK_REPLAY_H
+#define CRANK_REPLAY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../crank_estimator.h"
+
+struct CrankEvent {
+  char kind;
+  uint32_t time;
+  int32_t value;
+};
+
+struct CrankSession {
+  std::string name;
+  std::string kind = "optical";   // optical, encoder or gear
+  int spokes = 80;                // NUM_SPOKES
+  int noise = 0;                  // Gear crank detection noise
+  std::vector<CrankEvent> events;
+};
+
+struct ReplayOptions {
+  uint32_t loop_us = 10;          // Simulated loop() period for optical/encoder cranks
+  uint32_t tail_us = 2000000;     // Keep running this long after the last event
+  uint32_t gap_us = 300000;       // Input quiet for this long counts as the crank stopping
+  uint32_t debounce_us = 1250;    // As in myisr()
+  float knob = 512;               // Buzz knob reading until the session has one
+  int deadband = 32;              // EXPRESSION_HIRES_DEADBAND
+};
+
+struct TracePoint {
+  uint32_t time;
+  double velocity;
+  bool spinning;
+  bool buzzing;
+  int expression;
+  int buzz_expression;
+};
+
+struct ReplayResult {
+  int motions = 0;                // Stretches of crank input
+  int starts = 0;                 // Times spinning started
+  int stops = 0;
+  int missed_starts = 0;          // Motions that never made sound
+  int false_starts = 0;           // Spinning that started without any motion
+  double start_latency_avg_ms = 0;
+  double start_latency_max_ms = 0;
+  double stop_latency_avg_ms = 0;
+  double stop_latency_max_ms = 0;
+  int buzz_starts = 0;
+  int buzz_stops = 0;
+  double expression_jitter = 0;   // Mean absolute change of expression per update while playing
+  int expression_bytes = 0;       // MIDI bytes of expression one string is sent, 7-bit (CC11)
+  int expression14_bytes = 0;     // The same with USE_HIRES_EXPRESSION (CC11 and CC43)
+  uint64_t updates = 0;
+  double ns_per_update = 0;
+  std::vector<TracePoint> trace;
+};
+
+/// @brief Reads a session file.
+inline bool crank_load_session(const std::string &path, CrankSession &s, std::string &err) {
+  std::ifstream in(path);
+  if (!in) {
+    err = "can't open " + path;
+    return false;
+  }
+
+  s.name = path;
+  size_t slash = path.find_last_of('/');
+  if (slash != std::string::npos) {
+    s.name = path.substr(slash + 1);
+  }
+
+  bool spokes_given = false;
+  int edges_per_rev = 0;
+  std::string line;
+  int line_num = 0;
+
+  while (std::getline(in, line)) {
+    line_num++;
+    if (line.empty()) {
+      continue;
+    }
+
+    if (line[0] == '#') {
+      std::istringstream words(line.substr(1));
+      std::string word;
+      while (words >> word) {
+        size_t eq = word.find('=');
+        if (eq == std::string::npos) {
+          continue;
+        }
+        std::string key = word.substr(0, eq);
+        std::string val = word.substr(eq + 1);
+        if (key == "kind") {
+          s.kind = val;
+        } else if (key == "spokes") {
+          s.spokes = atoi(val.c_str());
+          spokes_given = true;
+        } else if (key == "edges_per_rev") {
+          edges_per_rev = atoi(val.c_str());
+        } else if (key == "noise") {
+          s.noise = atoi(val.c_str());
+        }
+      }
+      continue;
+    }
+
+    CrankEvent e;
+    unsigned long t = 0;
+    long v = 0;
+    int got = sscanf(line.c_str(), "%c %lu %ld", &e.kind, &t, &v);
+    if (got < 2 || (e.kind != 'E' && e.kind != 'C' && e.kind != 'A' && e.kind != 'K')) {
+      err = path + ":" + std::to_string(line_num) + ": bad event line";
+      return false;
+    }
+    e.time = t;
+    e.value = v;
+    s.events.push_back(e);
+  }
+
+  // crank_gen output only gives edges per revolution.
+  if (!spokes_given && edges_per_rev > 0) {
+    s.spokes = (s.kind == "encoder") ? edges_per_rev / 2 : edges_per_rev;
+  }
+
+  std::stable_sort(s.events.begin(), s.events.end(),
+                   [](const CrankEvent &a, const CrankEvent &b) { return a.time < b.time; });
+  return true;
+}
+
+// Finds the stretches of real crank motion: input events no more than gap_us apart.
+inline void crank_find_motions(const CrankSession &s, const GearEstimatorParams &gp, const ReplayOptions &opt,
+                               std::vector<std::pair<uint32_t, uint32_t>> &motions) {
+  bool in_motion = false;
+  uint32_t start = 0, last = 0;
+  long last_count = 0;
+  bool have_count = false;
+
+  for (const CrankEvent &e : s.events) {
+    bool moving = false;
+    if (s.kind == "gear") {
+      moving = (e.kind == 'A' && e.value - s.noise > gp.vol_threshold);
+    } else if (s.kind == "encoder") {
+      moving = (e.kind == 'C' && have_count && e.value != last_count);
+      if (e.kind == 'C') {
+        last_count = e.value;
+        have_count = true;
+      }
+    } else {
+      moving = (e.kind == 'E');
+    }
+    if (!moving) {
+      continue;
+    }
+
+    if (in_motion && e.time - last > opt.gap_us) {
+      motions.push_back({start, last});
+      in_motion = false;
+    }
+    if (!in_motion) {
+      start = e.time;
+      in_motion = true;
+    }
+    last = e.time;
+  }
+  if (in_motion) {
+    motions.push_back({start, last});
+  }
+}
+
+// Scores spin transitions against the motions.
+inline void crank_score(const std::vector<std::pair<uint32_t, uint32_t>> &motions,
+                        const std::vector<uint32_t> &spin_starts, const std::vector<uint32_t> &spin_stops,
+                        const ReplayOptions &opt, ReplayResult &r) {
+  r.motions = motions.size();
+  r.starts = spin_starts.size();
+  r.stops = spin_stops.size();
+
+  std::vector<bool> explained(spin_starts.size(), false);
+  double start_total = 0, stop_total = 0;
+  int start_n = 0, stop_n = 0;
+
+  for (const auto &m : motions) {
+    // The first start at or after the motion began, before it was over.
+    int found = -1;
+    for (size_t x = 0; x < spin_starts.size(); x++) {
+      if (spin_starts[x] >= m.first && spin_starts[x] <= m.second + opt.gap_us) {
+        found = x;
+        break;
+      }
+    }
+    if (found < 0) {
+      r.missed_starts++;
+      continue;
+    }
+
+    double start_ms = (spin_starts[found] - m.first) / 1000.0;
+    start_total += start_ms;
+    start_n++;
+    r.start_latency_max_ms = std::max(r.start_latency_max_ms, start_ms);
+
+    // Every start within the motion is part of it (stutters show up as extra starts/stops).
+    for (size_t x = found; x < spin_starts.size() && spin_starts[x] <= m.second + opt.gap_us; x++) {
+      explained[x] = true;
+    }
+
+    // The first stop after the motion ended.
+    for (uint32_t stop : spin_stops) {
+      if (stop >= m.second) {
+        double stop_ms = (stop - m.second) / 1000.0;
+        stop_total += stop_ms;
+        stop_n++;
+        r.stop_latency_max_ms = std::max(r.stop_latency_max_ms, stop_ms);
+        break;
+      }
+    }
+  }
+
+  for (bool e : explained) {
+    if (!e) {
+      r.false_starts++;
+    }
+  }
+  r.start_latency_avg_ms = start_n ? start_total / start_n : 0;
+  r.stop_latency_avg_ms = stop_n ? stop_total / stop_n : 0;
+}
+
+/// @brief Asks the event stage for its events after an update, as loop() does, and records them.
+/// @details loop() only asks about buzzing while playing.
+inline void crank_replay_events(CrankEvents &events, uint32_t t, bool spinning, bool buzz_on, bool buzz_off,
+                                std::vector<uint32_t> &spin_starts, std::vector<uint32_t> &spin_stops,
+                                ReplayResult &r) {
+  if (events.startedSpinning(spinning)) {
+    spin_starts.push_back(t);
+  } else if (events.stoppedSpinning(spinning)) {
+    spin_stops.push_back(t);
+  }
+
+  if (spinning) {
+    if (events.startedBuzzing(buzz_on, t / 1000)) {
+      r.buzz_starts++;
+    }
+    if (events.stoppedBuzzing(buzz_off, t / 1000)) {
+      r.buzz_stops++;
+    }
+  }
+}
+
+/// @brief Replays an optical or encoder session the way GurdyCrank::update() sees it.
+inline ReplayResult crank_replay_spin(const CrankSession &s, const CrankEstimatorParams &p, const ReplayOptions &opt,
+                                      bool keep_trace) {
+  ReplayResult r;
+  bool encoder = (s.kind == "encoder");
+
+  OpticalEstimator optical(p);
+  EncoderEstimator enc(p);
+
+  // The interrupt's state (see myisr()).
+  int num_events = 0;
+  uint32_t last_event = 0;
+  uint32_t last_event_start = 0;
+  bool accepted_any = false;
+  uint32_t last_accept = 0;
+
+  long pulse = 0;
+  uint32_t eval_start = 0;
+  uint32_t expression_start = 0;
+  float knob = opt.knob;
+
+  CrankEvents events;
+  int last_expression = -1;
+  int last_expression14 = -1;
+  double jitter_total = 0;
+  int jitter_n = 0;
+
+  std::vector<uint32_t> spin_starts, spin_stops;
+
+  // The gurdy's encoder has been counting since power-on, so start from the first recorded position.
+  for (const CrankEvent &e : s.events) {
+    if (e.kind == 'C') {
+      pulse = e.value;
+      enc.last_pulse = e.value;
+      break;
+    }
+  }
+
+  uint32_t end = s.events.empty() ? opt.tail_us : s.events.back().time + opt.tail_us;
+  size_t next = 0;
+
+  auto clock_start = std::chrono::steady_clock::now();
+
+  for (uint32_t t = 0; t <= end; t += opt.loop_us) {
+    while (next < s.events.size() && s.events[next].time <= t) {
+      const CrankEvent &e = s.events[next++];
+      if (e.kind == 'E') {
+        if (!accepted_any || e.time - last_accept >= opt.debounce_us) {
+          num_events++;
+          last_event = e.time - last_event_start;
+          last_accept = e.time;
+          accepted_any = true;
+        }
+      } else if (e.kind == 'C') {
+        pulse = e.value;
+      } else if (e.kind == 'K') {
+        knob = e.value;
+      }
+    }
+
+    double v;
+    bool skip_expression = false;
+    if (encoder) {
+      int result = enc.update(t - eval_start, pulse, t - last_event_start, s.spokes);
+      if (result == CRANK_EST_DECAYED) {
+        eval_start = t;
+        skip_expression = true;
+      } else if (result == CRANK_EST_SAMPLED) {
+        last_event_start = t;
+        eval_start = t;
+      }
+      v = enc.cur_vel;
+    } else {
+      if (optical.update(t - eval_start, num_events, last_event, s.spokes)) {
+        num_events = 0;
+        last_event = 0;
+        last_event_start = t;
+        eval_start = t;
+      }
+      v = optical.cur_vel;
+    }
+    r.updates++;
+
+    float threshold = crank_buzz_threshold(knob);
+    bool spinning = crank_is_spinning(v, p);
+
+    if (!skip_expression && (t - expression_start) / 1000 > CRANK_EXPRESSION_MS) {
+      int expression = crank_expression(v, p);
+      if (spinning && last_expression >= 0) {
+        jitter_total += abs(expression - last_expression);
+        jitter_n++;
+      }
+      if (expression != last_expression) {
+        r.expression_bytes += 3;
+      }
+      last_expression = expression;
+
+      int expression14 = crank_expression14(v, p);
+      int send = crank_expression14_send(expression14, last_expression14, opt.deadband, p);
+      if (send != CRANK_EXPR14_NONE) {
+        r.expression14_bytes += 3;
+        last_expression14 = crank_expression14_sent(expression14, last_expression14, send);
+      }
+      if (keep_trace) {
+        r.trace.push_back({t, v, spinning, events.was_buzzing, expression, crank_buzz_expression(v, threshold)});
+      }
+      expression_start = t;
+    }
+
+    crank_replay_events(events, t, spinning, crank_buzz_on(v, threshold), crank_buzz_off(v, threshold),
+                        spin_starts, spin_stops, r);
+  }
+
+  auto clock_end = std::chrono::steady_clock::now();
+  r.ns_per_update = std::chrono::duration<double, std::nano>(clock_end - clock_start).count() / std::max<uint64_t>(r.updates, 1);
+  r.expression_jitter = jitter_n ? jitter_total / jitter_n : 0;
+
+  std::vector<std::pair<uint32_t, uint32_t>> motions;
+  crank_find_motions(s, GEAR_ESTIMATOR_DEFAULTS, opt, motions);
+  crank_score(motions, spin_starts, spin_stops, opt, r);
+  return r;
+}
+
+/// @brief Replays a gear-crank session the way GearCrank::update() sees it: one update per ADC event.
+/// @details Its events come from the same CrankEvents stage as the optical and encoder cranks'.
+inline ReplayResult crank_replay_gear(const CrankSession &s, const GearEstimatorParams &gp, const ReplayOptions &opt,
+                                      bool keep_trace) {
+  ReplayResult r;
+  GearEstimator est(gp);
+  CrankEvents events;
+  float knob = opt.knob;
+
+  std::vector<uint32_t> spin_starts, spin_stops;
+
+  auto clock_start = std::chrono::steady_clock::now();
+
+  for (const CrankEvent &e : s.events) {
+    if (e.kind == 'K') {
+      knob = e.value;
+      continue;
+    }
+    if (e.kind != 'A') {
+      continue;
+    }
+
+    est.updateBuzz(knob);
+    est.update(e.value, s.noise);
+    r.updates++;
+
+    crank_replay_events(events, e.time, est.is_spinning, est.is_buzzing, !est.is_buzzing, spin_starts, spin_stops, r);
+    if (keep_trace) {
+      r.trace.push_back({e.time, (double)est.spin, est.is_spinning, est.is_buzzing, est.crank_voltage, est.buzz_countdown});
+    }
+  }
+
+  auto clock_end = std::chrono::steady_clock::now();
+  r.ns_per_update = std::chrono::duration<double, std::nano>(clock_end - clock_start).count() / std::max<uint64_t>(r.updates, 1);
+
+  std::vector<std::pair<uint32_t, uint32_t>> motions;
+  crank_find_motions(s, gp, opt, motions);
+  crank_score(motions, spin_starts, spin_stops, opt, r);
+  return r;
+}
+
+inline ReplayResult crank_replay(const CrankSession &s, const CrankEstimatorParams &p, const GearEstimatorParams &gp,
+                                 const ReplayOptions &opt, bool keep_trace) {
+  if (s.kind == "gear") {
+    return crank_replay_gear(s, gp, opt, keep_trace);
+  }
+  return crank_replay_spin(s, p, opt, keep_trace);
+}
+
+// The estimator values the tools can change, by the names used on their command lines, with the
+// config.h constant each one comes from.
+struct CrankParamInfo {
+  const char *name;
+  const char *config_name;
+  const char *type;   // Its type in config.h
+  bool gear;          // A GearEstimatorParams value (else CrankEstimatorParams)
+};
+
+const CrankParamInfo CRANK_PARAMS[] = {
+  {"eval_us", "CRANK_EVAL_US", "uint32_t", false},
+  {"decay_us", "CRANK_DECAY_US", "uint32_t", false},
+  {"rise_factor", "CRANK_RISE_FACTOR", "float", false},
+  {"rise_bias", "CRANK_RISE_BIAS", "float", false},
+  {"fall_factor", "CRANK_FALL_FACTOR", "float", false},
+  {"decay_factor", "CRANK_DECAY_FACTOR", "float", false},
+  {"enc_eval_us", "ENCODER_EVAL_US", "uint32_t", false},
+  {"enc_decay_us", "ENCODER_DECAY_US", "uint32_t", false},
+  {"enc_factor", "ENCODER_FACTOR", "float", false},
+  {"v_threshold", "V_THRESHOLD", "float", false},
+  {"expression_vmax", "EXPRESSION_VMAX", "float", false},
+  {"expression_start", "EXPRESSION_START", "int", false},
+  {"vol_threshold", "VOL_THRESHOLD", "int", true},
+  {"max_spin", "MAX_SPIN", "int", true},
+  {"spin_weight", "SPIN_WEIGHT", "int", true},
+  {"spin_decay", "SPIN_DECAY", "int", true},
+  {"spin_threshold", "SPIN_THRESHOLD", "int", true},
+  {"spin_stop_threshold", "SPIN_STOP_THRESHOLD", "int", true},
+  {"buzz_smoothing", "BUZZ_SMOOTHING", "int", true},
+  {"buzz_decay", "BUZZ_DECAY", "int", true},
+};
+
+const int CRANK_PARAM_COUNT = sizeof(CRANK_PARAMS) / sizeof(CRANK_PARAMS[0]);
+
+/// @brief Finds an estimator value by name.  Returns its index in CRANK_PARAMS, or -1.
+inline int crank_find_param(const std::string &name) {
+  for (int x = 0; x < CRANK_PARAM_COUNT; x++) {
+    if (name == CRANK_PARAMS[x].name) {
+      return x;
+    }
+  }
+  return -1;
+}
+
+/// @brief Sets an estimator value by its index in CRANK_PARAMS.
+inline void crank_set_param(CrankEstimatorParams &p, GearEstimatorParams &gp, int index, double v) {
+  switch (index) {
+    case 0: p.eval_us = v; break;
+    case 1: p.decay_us = v; break;
+    case 2: p.rise_factor = v; break;
+    case 3: p.rise_bias = v; break;
+    case 4: p.fall_factor = v; break;
+    case 5: p.decay_factor = v; break;
+    case 6: p.enc_eval_us = v; break;
+    case 7: p.enc_decay_us = v; break;
+    case 8: p.enc_factor = v; break;
+    case 9: p.v_threshold = v; break;
+    case 10: p.expression_vmax = v; break;
+    case 11: p.expression_start = v; break;
+    case 12: gp.vol_threshold = v; break;
+    case 13: gp.max_spin = v; break;
+    case 14: gp.spin_weight = v; break;
+    case 15: gp.spin_decay = v; break;
+    case 16: gp.spin_threshold = v; break;
+    case 17: gp.spin_stop_threshold = v; break;
+    case 18: gp.buzz_smoothing = v; break;
+    case 19: gp.buzz_decay = v; break;
+  }
+}
+
+#endif
@@ -0,0 +1,246 @@
+// crank_sweep: tunes the crank estimators by replaying recorded sessions with many parameter sets.
+//
+// Build with:
+//
+//   g++ -std=c++17 -O2 -pthread -o crank_sweep tools/crank_sweep.cpp
+//
+// Usage:
+//
+//   crank_sweep --vary NAME=LOW:HIGH:STEPS [--vary ...] [options] session.txt...
+//
+//   --vary NAME=LOW:HIGH:STEPS   Try STEPS evenly spaced values of an estimator value (names as crank_replay --set)
+//   --set NAME=VALUE             Fix a value for every set
+//   --threads N                  Worker threads, default all cores
+//   --loop-us N, --gap-ms N      As crank_replay
+//   --csv FILE                   Write every set's scores
+//
+// Every combination of the --vary values is replayed over every session, spread across the cores with a
+// work-stealing thread pool.  Each set is scored on four things, all lower-is-better, averaged over the
+// sessions:
+//
+//   start_ms   how long after the crank starts moving the sound starts
+//   stop_ms    how long after the crank stops the sound stops
+//   errors     motions that made no sound plus sound with no motion (stutters)
+//   jitter     how much expression wobbles while playing
+//
+// There is rarely one best set, so the output is the Pareto front: the sets that no other set beats on
+// all four.  Each is printed as config.h lines, ready to paste over the current values.
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "crank_replay.h"
+#include "pool.h"
+
+struct SweepAxis {
+  int param;
+  std::vector<double> values;
+};
+
+struct SweepScore {
+  double start_ms = 0;
+  double stop_ms = 0;
+  double errors = 0;
+  double jitter = 0;
+};
+
+static bool dominates(const SweepScore &a, const SweepScore &b) {
+  bool no_worse = a.start_ms <= b.start_ms && a.stop_ms <= b.stop_ms && a.errors <= b.errors && a.jitter <= b.jitter;
+  bool better = a.start_ms < b.start_ms || a.stop_ms < b.stop_ms || a.errors < b.errors || a.jitter < b.jitter;
+  return no_worse && better;
+}
+
+static void print_value(FILE *out, int param, double v) {
+  if (!strcmp(CRANK_PARAMS[param].type, "float")) {
+    fprintf(out, "%g", v);
+  } else {
+    fprintf(out, "%ld", lround(v));
+  }
+}
+
+int main(int argc, char **argv) {
+  CrankEstimatorParams base = CRANK_ESTIMATOR_DEFAULTS;
+  GearEstimatorParams gear_base = GEAR_ESTIMATOR_DEFAULTS;
+  ReplayOptions opt;
+  std::vector<SweepAxis> axes;
+  std::vector<std::string> paths;
+  std::string csv_path;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int x = 1; x < argc; x++) {
+    std::string arg = argv[x];
+    bool has_val = x + 1 < argc;
+
+    if ((arg == "--vary" || arg == "--set") && has_val) {
+      std::string kv = argv[++x];
+      size_t eq = kv.find('=');
+      int param = (eq == std::string::npos) ? -1 : crank_find_param(kv.substr(0, eq));
+      if (param < 0) {
+        fprintf(stderr, "Unknown value %s\n", kv.c_str());
+        return 2;
+      }
+
+      if (arg == "--set") {
+        crank_set_param(base, gear_base, param, atof(kv.c_str() + eq + 1));
+        continue;
+      }
+
+      double low, high;
+      int steps;
+      if (sscanf(kv.c_str() + eq + 1, "%lf:%lf:%d", &low, &high, &steps) != 3 || steps < 1) {
+        fprintf(stderr, "--vary wants NAME=LOW:HIGH:STEPS, not %s\n", kv.c_str());
+        return 2;
+      }
+      SweepAxis axis;
+      axis.param = param;
+      for (int s = 0; s < steps; s++) {
+        axis.values.push_back(steps == 1 ? low : low + (high - low) * s / (steps - 1));
+      }
+      axes.push_back(axis);
+
+    } else if (arg == "--threads" && has_val) {
+      threads = std::max(1, atoi(argv[++x]));
+    } else if (arg == "--loop-us" && has_val) {
+      opt.loop_us = std::max(1, atoi(argv[++x]));
+    } else if (arg == "--gap-ms" && has_val) {
+      opt.gap_us = atoi(argv[++x]) * 1000;
+    } else if (arg == "--csv" && has_val) {
+      csv_path = argv[++x];
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return 2;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  if (paths.empty() || axes.empty()) {
+    fprintf(stderr, "usage: crank_sweep --vary NAME=LOW:HIGH:STEPS [...] session.txt...\n");
+    return 2;
+  }
+
+  std::vector<CrankSession> sessions(paths.size());
+  for (size_t x = 0; x < paths.size(); x++) {
+    std::string err;
+    if (!crank_load_session(paths[x], sessions[x], err)) {
+      fprintf(stderr, "%s\n", err.c_str());
+      return 1;
+    }
+  }
+
+  size_t set_count = 1;
+  for (const SweepAxis &a : axes) {
+    set_count *= a.values.size();
+  }
+
+  // Set number -> the value of each axis, counting like an odometer.
+  auto set_values = [&](size_t set, std::vector<double> &values) {
+    values.resize(axes.size());
+    for (size_t a = axes.size(); a-- > 0;) {
+      values[a] = axes[a].values[set % axes[a].values.size()];
+      set /= axes[a].values.size();
+    }
+  };
+
+  fprintf(stderr, "Replaying %zu parameter sets over %zu sessions on %zu threads...\n", set_count, sessions.size(), threads);
+
+  // One task per (set, session), each with its own result slot, so the workers share nothing.
+  std::vector<ReplayResult> results(set_count * sessions.size());
+  std::atomic<size_t> done(0);
+  size_t total = results.size();
+
+  StealingPool pool(threads);
+  pool.run(total, [&](size_t task) {
+    size_t set = task / sessions.size();
+    size_t session = task % sessions.size();
+
+    CrankEstimatorParams p = base;
+    GearEstimatorParams gp = gear_base;
+    std::vector<double> values;
+    set_values(set, values);
+    for (size_t a = 0; a < axes.size(); a++) {
+      crank_set_param(p, gp, axes[a].param, values[a]);
+    }
+
+    results[task] = crank_replay(sessions[session], p, gp, opt, false);
+
+    size_t n = ++done;
+    if (n % 256 == 0 || n == total) {
+      fprintf(stderr, "\r%zu/%zu", n, total);
+    }
+  });
+  fprintf(stderr, "\n");
+
+  std::vector<SweepScore> scores(set_count);
+  for (size_t set = 0; set < set_count; set++) {
+    SweepScore &sc = scores[set];
+    for (size_t s = 0; s < sessions.size(); s++) {
+      const ReplayResult &r = results[set * sessions.size() + s];
+      sc.start_ms += r.start_latency_avg_ms;
+      sc.stop_ms += r.stop_latency_avg_ms;
+      sc.errors += r.missed_starts + r.false_starts;
+      sc.jitter += r.expression_jitter;
+    }
+    sc.start_ms /= sessions.size();
+    sc.stop_ms /= sessions.size();
+    sc.jitter /= sessions.size();
+  }
+
+  if (!csv_path.empty()) {
+    FILE *csv = fopen(csv_path.c_str(), "w");
+    if (!csv) {
+      fprintf(stderr, "Can't write %s\n", csv_path.c_str());
+      return 1;
+    }
+    for (const SweepAxis &a : axes) {
+      fprintf(csv, "%s,", CRANK_PARAMS[a.param].name);
+    }
+    fprintf(csv, "start_ms,stop_ms,errors,jitter\n");
+    std::vector<double> values;
+    for (size_t set = 0; set < set_count; set++) {
+      set_values(set, values);
+      for (size_t a = 0; a < axes.size(); a++) {
+        print_value(csv, axes[a].param, values[a]);
+        fprintf(csv, ",");
+      }
+      fprintf(csv, "%.2f,%.2f,%g,%.3f\n", scores[set].start_ms, scores[set].stop_ms, scores[set].errors, scores[set].jitter);
+    }
+    fclose(csv);
+  }
+
+  std::vector<size_t> front;
+  for (size_t a = 0; a < set_count; a++) {
+    bool beaten = false;
+    for (size_t b = 0; b < set_count && !beaten; b++) {
+      beaten = dominates(scores[b], scores[a]);
+    }
+    if (!beaten) {
+      front.push_back(a);
+    }
+  }
+
+  std::sort(front.begin(), front.end(), [&](size_t a, size_t b) {
+    if (scores[a].errors != scores[b].errors) {
+      return scores[a].errors < scores[b].errors;
+    }
+    return scores[a].start_ms < scores[b].start_ms;
+  });
+
+  printf("// Pareto front: %zu of %zu parameter sets, fewest errors first.\n", front.size(), set_count);
+  std::vector<double> values;
+  for (size_t x = 0; x < front.size(); x++) {
+    const SweepScore &sc = scores[front[x]];
+    printf("\n// Set %zu: start %.1fms, stop %.1fms, %g errors, jitter %.2f\n", x + 1, sc.start_ms, sc.stop_ms, sc.errors, sc.jitter);
+    set_values(front[x], values);
+    for (size_t a = 0; a < axes.size(); a++) {
+      const CrankParamInfo &info = CRANK_PARAMS[axes[a].param];
+      printf("const %s %s = ", info.type, info.config_name);
+      print_value(stdout, axes[a].param, values[a]);
+      printf(";\n");
+    }
+  }
+
+  return 0;
+}
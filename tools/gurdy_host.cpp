@@ -0,0 +1,427 @@
+// gurdy_host: runs the sketch itself on a computer, for the checks that need the real firmware rather than a model.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  It builds every file of the
+// sketch against the Teensy stand-ins in tools/host/: a virtual clock, serial ports that send at their baud rates
+// and a directory for the SD card (see tools/host/Arduino.h).  From the repository's top directory:
+//
+//   g++ -std=gnu++17 -O1 -DUSE_STREAM_TEST -DUSE_BENCH -Itools/host -I. -o gurdy_host tools/gurdy_host.cpp tools/gurdy_host_model.cpp tools/host/host.cpp *.cpp -x c++ digigurdy-baz.ino
+//
+// Usage:
+//
+//   gurdy_host selftest [DIR]    Run the MIDI self-test (stream_test.cpp) against the golden files in DIR
+//                                (default selftest, the goldens for the default config.h)
+//   gurdy_host record [DIR]      Record the self-test's golden files into DIR
+//   gurdy_host stress            Run the saturation test (benchmarks.cpp) and print each rate and the ceiling
+//   gurdy_host check-model session.play...
+//                                Play each session script (see tools/stress_model.h) on the sketch and on the
+//                                host tools' model, and compare the bytes sent on each link
+//   gurdy_host test              Check that the goldens pass and that the self-test catches what it should, that
+//                                the saturation test finds a ceiling and a silent Trigger fails it, and that the
+//                                model sends what the sketch does
+//
+// The gurdy starts as it would with a cleared EEPROM set to send to both MIDI-OUT and a WAV Trigger: setup() runs,
+// and loop() doesn't (its first pass waits at the welcome screen for a button).  The WAV Trigger is a stand-in on
+// its serial port that answers the version checks (see host_wav_trigger()).  The build is config.h's, so the
+// goldens are only good for the config they were recorded with.  Add -DUSE_OUTPUT_GATING to the build line to
+// test the gated outputs (sinks.cpp) too: a Trigger that stops answering, and MIDI-OUT's queue.
+//
+// The saturation test's messages, bytes, backlogs and voices are the firmware's own, sent over ports that carry
+// them at their baud rates.  Its loop times aren't: the clock only moves when the sketch reads it or waits on a
+// port, so they count those waits and nothing of the Teensy's speed.
+//
+// check-model plays a session a pass a millisecond, with the strings set as the saturation test sets them, and
+// counts what the strings send (traffic.cpp) rather than what gets through, as the model does.  Sessions for the
+// unit the sketch isn't built for are skipped.  Its exit code is 1 if any session differs.
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "host.h"
+
+#include "../benchmarks.h"
+#include "../common.h"
+#include "../eeprom_values.h"
+#include "../mpe.h"
+#include "../play_functions.h"
+#include "../sinks.h"
+#include "../stress.h"
+#include "../stream_test.h"
+#include "../traffic.h"
+#include "gurdy_host_model.h"
+#include "tool_test.h"
+
+namespace fs = std::filesystem;
+
+void setup();
+
+// Starts the gurdy once, with a card at card_dir.
+static void gurdy_start(const std::string &card_dir) {
+  static bool started = false;
+
+  host_sd_root = card_dir;
+  if (!started) {
+    EEPROM.write(EEPROM_SEC_OUT, 2);
+    host_wav_trigger(SINK_TRIGGER_PORT);
+
+    bool quiet = host_serial_quiet;
+    host_serial_quiet = true;
+    setup();
+    host_serial_quiet = quiet;
+    started = true;
+  }
+}
+
+// Runs the self-test with a card at card_dir.  What it printed is left in host_serial_log.
+static bool selftest_run(const std::string &card_dir, bool record) {
+  gurdy_start(card_dir);
+  host_serial_log.clear();
+  return stream_test_run(record);
+}
+
+// Puts a copy of the goldens in dir on a new card.
+static bool card_with_goldens(const std::string &dir, const std::string &card) {
+  std::error_code ec;
+  fs::copy(dir, card + STREAM_TEST_DIR, fs::copy_options::recursive, ec);
+  if (ec) {
+    std::cerr << "can't copy " << dir << ": " << ec.message() << "\n";
+  }
+  return !ec;
+}
+
+static int cmd_selftest(const std::string &dir) {
+  ToolTest t;
+  std::string card = t.tempDir("gurdy_host");
+  if (card.empty() || !card_with_goldens(dir, card)) {
+    return 1;
+  }
+  return selftest_run(card, false) ? 0 : 1;
+}
+
+static int cmd_record(const std::string &dir) {
+  ToolTest t;
+  std::string card = t.tempDir("gurdy_host");
+  if (card.empty() || !selftest_run(card, true)) {
+    return 1;
+  }
+
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  fs::copy(card + STREAM_TEST_DIR, dir, fs::copy_options::recursive | fs::copy_options::overwrite_existing, ec);
+  if (ec) {
+    std::cerr << "can't copy to " << dir << ": " << ec.message() << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+static int cmd_stress() {
+  gurdy_start("");
+  return (stress_run() > 0) ? 0 : 1;
+}
+
+// Plays a session on the firmware, a pass a millisecond as play_session_run() plays it on the model, with the
+// strings set as the saturation test sets them.  bytes is given what each link was sent, by TrafficSink.
+static void check_model_play(const CheckSession &s, uint32_t *bytes) {
+  GurdyString *strings[6] = {mystring, mylowstring, mytromp, mydrone, mybuzz, mykeyclick};
+  int gros[6];
+  int output[6];
+  bool mute[6];
+  LegatoMode legato = mystring->getLegato();
+
+  all_soundKill();
+  all_clearVolArray();
+  for (int x = 0; x < 6; x++) {
+    gros[x] = strings[x]->getGrosMode();
+    output[x] = strings[x]->getOutputMode();
+    mute[x] = strings[x]->getMute();
+    strings[x]->setGrosMode(0);
+    strings[x]->setOutputMode(2);
+    strings[x]->setMute(false);
+  }
+  if (s.gros) {
+    mystring->setGrosMode(1);
+    mylowstring->setGrosMode(2);
+    mytromp->setGrosMode(3);
+  }
+  set_legato(s.legato);
+  myoffset = 0;
+
+  // Let all that go out, and a Trigger that was dropped come back, before counting.
+  for (int ms = 0; ms < 500 || (!SINK_READY(TRAFFIC_TRIGGER) && ms < 10000); ms++) {
+    host_advance_us(1000);
+    #ifdef USE_OUTPUT_GATING
+    sink_update();
+    #endif
+  }
+  traffic_reset();
+
+  uint32_t end = s.events.empty() ? 0 : s.events.back().ms + 500;
+  bool cranking = false;
+  size_t next = 0;
+  for (uint32_t now = 0; now < end; now++) {
+    while (next < s.events.size() && s.events[next].ms <= now) {
+      const CheckEvent &e = s.events[next++];
+      if (e.kind == 1 && !cranking) {
+        mystring->soundOn(myoffset + tpose_offset, mel_vibrato);
+        mylowstring->soundOn(myoffset + tpose_offset, mel_vibrato);
+        mytromp->soundOn(tpose_offset + capo_offset);
+        mydrone->soundOn(tpose_offset + capo_offset);
+        mybuzz->soundOn(tpose_offset + capo_offset);
+        cranking = true;
+      } else if (e.kind == 2 && cranking) {
+        all_soundOff();
+        cranking = false;
+      } else if (e.kind == 0 && myoffset != e.offset) {
+        myoffset = e.offset;
+        if (cranking) {
+          key_change();
+        }
+      }
+    }
+    mykeyclick->update();
+    #ifdef USE_OUTPUT_GATING
+    sink_update();
+    #endif
+    traffic_loop_end();
+    host_advance_us(1000);
+  }
+
+  for (int x = 0; x < TRAFFIC_SINK_COUNT; x++) {
+    bytes[x] = traffic[x].bytes;
+  }
+  all_soundKill();
+  for (int x = 0; x < 6; x++) {
+    strings[x]->setGrosMode(gros[x]);
+    strings[x]->setOutputMode(output[x]);
+    strings[x]->setMute(mute[x]);
+  }
+  set_legato(legato);
+  myoffset = 0;
+}
+
+// Plays each session on the firmware and on the model and compares the bytes sent on each link.
+// @return The number of sessions where they differ, or -1 if a session can't be read.
+static int check_model(const std::vector<std::string> &paths, bool quiet) {
+  static const char *link_names[3] = {"USB", "MIDI", "Trig"};
+  gurdy_start("");
+
+  int differ = 0;
+  for (const std::string &path : paths) {
+    CheckSession s;
+    std::string err;
+    if (!check_model_load(path, s, err)) {
+      std::cerr << err << "\n";
+      return -1;
+    }
+    #ifdef USE_TSUNAMI
+    bool fits = s.tsunami;
+    #else
+    bool fits = !s.tsunami;
+    #endif
+    if (!fits) {
+      if (!quiet) {
+        printf("%s: skipped, the build's unit is the other one\n", path.c_str());
+      }
+      continue;
+    }
+
+    uint32_t bytes[TRAFFIC_SINK_COUNT];
+    check_model_play(s, bytes);
+    bool same = true;
+    std::string line = path + ":";
+    for (int x = 0; x < 3; x++) {
+      same = same && bytes[x] == s.model_bytes[x];
+      line += " " + std::string(link_names[x]) + " " + std::to_string(bytes[x]) + "/" +
+              std::to_string(s.model_bytes[x]);
+    }
+    differ += same ? 0 : 1;
+    if (!quiet) {
+      printf("%s  %s\n", line.c_str(), same ? "same" : "DIFFERS");
+    }
+  }
+  return differ;
+}
+
+static int cmd_check_model(int argc, char **argv) {
+  std::vector<std::string> paths(argv + 2, argv + argc);
+  int differ = check_model(paths, false);
+  if (differ > 0) {
+    printf("%d sessions differ (firmware/model bytes).\n", differ);
+  }
+  return (differ == 0) ? 0 : 1;
+}
+
+static bool log_has(const std::string &text) {
+  return host_serial_log.find(text) != std::string::npos;
+}
+
+static std::string read_file(const std::string &path) {
+  std::string text;
+  FILE *f = fopen(path.c_str(), "rb");
+  if (f) {
+    int c;
+    while ((c = fgetc(f)) >= 0) {
+      text += (char)c;
+    }
+    fclose(f);
+  }
+  return text;
+}
+
+// The known cases for "gurdy_host test".
+static int cmd_test() {
+  ToolTest t;
+  host_serial_quiet = true;
+
+  std::string card = t.tempDir("gurdy_host");
+  if (card.empty() || !card_with_goldens("selftest", card)) {
+    return 1;
+  }
+  std::string goldens = card + STREAM_TEST_DIR;
+
+  t.expect(selftest_run(card, false), "the committed goldens pass");
+  t.expect(selftest_run(card, false), "and again: a run leaves nothing behind for the next");
+
+  // Leave the strings as play might: mid-glide, expression down, MPE on.  None of it may reach the sessions.
+  mystring->setLegato(LEGATO_GLIDE);
+  mystring->soundOn(0, 0);
+  myoffset = 2;
+  key_change();
+  all_soundOff();
+  for (GurdyString *s : {mystring, mylowstring, mytromp, mydrone, mybuzz}) {
+    s->setTriggerExpression(40);
+  }
+  mpe_start();
+  bool passed = selftest_run(card, false);
+  t.expect(passed, "a bend, expression and MPE left by play don't change the sessions");
+  t.expect(mystring->getMpe() && mystring->getTriggerExpression() == 40 && mystring->getLegato() == LEGATO_GLIDE,
+           "and are put back afterwards");
+  mpe_stop();
+  mystring->setLegato(LEGATO_OFF);
+  for (GurdyString *s : {mystring, mylowstring, mytromp, mydrone, mybuzz}) {
+    s->setTriggerExpression(127);
+  }
+  myoffset = 0;
+
+  // A changed stream.
+  {
+    std::string path = goldens + "/keys.txt";
+    std::string text = read_file(path);
+    size_t at = text.find("NoteOn 1 68");
+    FILE *f = fopen(path.c_str(), "wb");
+    if (at != std::string::npos && f) {
+      text.replace(at, 11, "NoteOn 1 69");
+      fwrite(text.data(), 1, text.size(), f);
+    }
+    if (f) {
+      fclose(f);
+    }
+    t.expect(at != std::string::npos && !selftest_run(card, false) && log_has("keys: ") && log_has("differs at line"),
+             "a changed message fails its session, at its line");
+  }
+
+  // A missing golden is a failure, not a new golden.
+  fs::remove(goldens + "/crank.txt");
+  t.expect(!selftest_run(card, false) && log_has("crank: ") && log_has("no golden file") &&
+               !fs::exists(goldens + "/crank.txt"),
+           "a session with no golden file fails and records nothing");
+
+  // Recording gives back the committed goldens.
+  std::string fresh = t.tempDir("gurdy_host");
+  bool same = selftest_run(fresh, true);
+  int files = 0;
+  for (const auto &e : fs::directory_iterator("selftest")) {
+    same = same && read_file(e.path().string()) == read_file(fresh + STREAM_TEST_DIR + "/" +
+                                                              e.path().filename().string());
+    files++;
+  }
+  t.expect(same && files > 0, "recording makes the committed goldens again");
+
+  // The saturation test.  At 2 key changes a second everything keeps up, so it goes on to a faster rate.
+  host_serial_log.clear();
+  int rates = stress_run();
+  t.expect(rates > 1 && log_has("rate   2/s") && log_has("ceiling: "), "the saturation test runs to a ceiling");
+  t.expect(rates < STRESS_NUM_RATES, "which the MIDI-OUT and Trigger links reach before the last rate");
+
+  #ifdef USE_OUTPUT_GATING
+  // A Trigger that stops answering is dropped, and its messages with it.
+  host_wav_trigger(SINK_TRIGGER_PORT, false);
+  host_serial_log.clear();
+  t.expect(stress_run() == 1 && log_has("dropped"), "a silent Trigger fails the first rate");
+  host_wav_trigger(SINK_TRIGGER_PORT);
+
+  // A burst of MIDI-OUT too big for the port and its queue: only whole messages go out, and what's queued keeps
+  // going out through a delay(), with no loop() to send it.
+  {
+    std::vector<uint8_t> wire;
+    Serial1.device = [&wire](HardwareSerial &, uint8_t b) { wire.push_back(b); };
+    delay(100);
+    wire.clear();
+    sink_reset();
+    for (int x = 0; x < 200; x++) {
+      MIDI.sendNoteOn(60 + x % 12, 100, 1);
+    }
+    bool queued = midi_port.queued() > 0;
+    delay(1000);
+    t.expect(queued && midi_port.queued() == 0, "queued MIDI-OUT goes out during a delay()");
+    Serial1.waiting();
+
+    bool whole = wire.size() % 3 == 0;
+    for (size_t x = 0; x < wire.size(); x++) {
+      whole = whole && ((x % 3 == 0) == ((wire[x] & 0x80) != 0));
+    }
+    t.expect(whole && sinks[TRAFFIC_SERIAL].dropped > 0 && wire.size() == (200 - sinks[TRAFFIC_SERIAL].dropped) * 3,
+             "a full queue drops whole messages, and every message sent is whole");
+    Serial1.device = nullptr;
+  }
+  #endif
+
+  // The host tools' model (tools/stress_model.h), given the same playing.  A glide bends from the note it struck
+  // and stays bent until the crank next starts a note, and each string's gros note is its own interval below.
+  std::vector<std::string> sessions;
+  for (const char *legato : {"off", "glide", "overlap"}) {
+    for (const char *gros : {"", "no-gros\n"}) {
+      sessions.push_back(t.tempFile("gurdy_host", std::string("legato ") + legato + "\n" + gros +
+                                                      "crank 0 on\nkey 100 1\nkey 200 2\nkey 300 3\nkey 400 14\n"
+                                                      "key 500 2\nkey 550 3\ncrank 600 off\ncrank 1000 on\n"
+                                                      "trill 1100 2100 20 4 5\ncrank 2200 off\n"));
+    }
+  }
+  t.expect(check_model(sessions, true) == 0, "the model gives each link the firmware's bytes, in every legato mode");
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: gurdy_host selftest [DIR]\n"
+               "       gurdy_host record [DIR]\n"
+               "       gurdy_host stress\n"
+               "       gurdy_host check-model session.play...\n"
+               "       gurdy_host test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+  std::string dir = (argc > 2) ? argv[2] : "selftest";
+
+  if (cmd == "selftest" && argc <= 3) {
+    return cmd_selftest(dir);
+  } else if (cmd == "record" && argc <= 3) {
+    return cmd_record(dir);
+  } else if (cmd == "stress" && argc == 2) {
+    return cmd_stress();
+  } else if (cmd == "check-model" && argc > 2) {
+    return cmd_check_model(argc, argv);
+  } else if (cmd == "test" && argc == 2) {
+    return cmd_test();
+  }
+  usage();
+  return 2;
+}
@@ -0,0 +1,26 @@
+// The model's side of "gurdy_host check-model".  See gurdy_host_model.h.
+
+#include "gurdy_host_model.h"
+
+#include "stress_model.h"
+
+bool check_model_load(const std::string &path, CheckSession &s, std::string &err) {
+  PlaySession play;
+  if (!play_load_session(path, play, err)) {
+    return false;
+  }
+
+  s.tsunami = play.opt.tsunami;
+  s.legato = play.opt.legato;
+  s.gros = play.opt.gros;
+  s.events.clear();
+  for (const PlayEvent &e : play.events) {
+    s.events.push_back({e.ms, e.kind, e.offset});
+  }
+
+  PlayResult r = play_session_run(play);
+  for (int x = 0; x < 3; x++) {
+    s.model_bytes[x] = r.bytes[x];
+  }
+  return true;
+}
@@ -0,0 +1,33 @@
+// The model's side of "gurdy_host check-model" (see tools/gurdy_host.cpp).
+//
+// stress_model.h has its own copies of config.h's constants, so it can't be built together with the sketch.
+// gurdy_host_model.cpp reads and plays the sessions on the model, and only what's here passes between them.
+
+#ifndef GURDY_HOST_MODEL_H
+#define GURDY_HOST_MODEL_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// A session script's event, as stress_model.h's PlayEvent.
+struct CheckEvent {
+  uint32_t ms;
+  int kind;                 // 0 key, 1 crank on, 2 crank off
+  int offset;
+};
+
+struct CheckSession {
+  bool tsunami = false;
+  int legato = 0;           // 0 off, 1 glide, 2 overlap
+  bool gros = true;
+  std::vector<CheckEvent> events;
+  uint32_t model_bytes[3] = {0, 0, 0};  // What the model sent: USB, MIDI-OUT, Trigger/Tsunami
+};
+
+/// @brief Reads a session script and plays it on the model.
+/// @return False (with err set) if the script can't be read.
+bool check_model_load(const std::string &path, CheckSession &s, std::string &err);
+
+#endif
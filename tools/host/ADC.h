@@ -0,0 +1,30 @@
+// The Teensy ADC library, reading 0 from every pin.  See Arduino.h.
+
+#ifndef HOST_ADC_H
+#define HOST_ADC_H
+
+#include <Arduino.h>
+
+enum class ADC_CONVERSION_SPEED { VERY_LOW_SPEED, LOW_SPEED, MED_SPEED, HIGH_SPEED, VERY_HIGH_SPEED };
+enum class ADC_SAMPLING_SPEED { VERY_LOW_SPEED, LOW_SPEED, MED_SPEED, HIGH_SPEED, VERY_HIGH_SPEED };
+
+class ADC_Module {
+  public:
+    void setAveraging(int) {}
+    void setResolution(int) {}
+    void setConversionSpeed(ADC_CONVERSION_SPEED) {}
+    void setSamplingSpeed(ADC_SAMPLING_SPEED) {}
+    bool startContinuous(int) { return true; }
+    int analogReadContinuous() { return 0; }
+    int analogRead(int) { return 0; }
+    void stopContinuous() {}
+};
+
+class ADC {
+  public:
+    ADC_Module module0, module1;
+    ADC_Module *adc0 = &module0;
+    ADC_Module *adc1 = &module1;
+};
+
+#endif
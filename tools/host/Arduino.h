@@ -0,0 +1,324 @@
+// The Arduino/Teensyduino API, for building the sketch on a computer (see tools/gurdy_host.cpp).
+//
+// Only what the sketch uses is here.  Time is virtual: it passes when the sketch calls delay(), when it waits on
+// a full serial port, and by HOST_CALL_US every time it reads the clock, so a busy-wait always ends.  Serial
+// prints to stdout.  The serial ports send at their baud rates, a byte at a time, through a 64-byte send buffer
+// that makes the sender wait when it's full, as the Teensy's do.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+typedef uint8_t byte;
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define HIGH 1
+#define LOW 0
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+#define DEC 10
+#define HEX 16
+#define BUILTIN_SDCARD 254
+#define PROGMEM
+#define DMAMEM
+#define U8X8_PROGMEM
+#define F_CPU_ACTUAL 600000000
+#define F_CPU 600000000
+
+// The cycle counter follows the clock, at F_CPU.
+uint32_t host_cycles();
+#define ARM_DWT_CYCCNT host_cycles()
+extern volatile uint32_t ARM_DEMCR;
+extern volatile uint32_t ARM_DWT_CTRL;
+#define ARM_DEMCR_TRCENA 1
+#define ARM_DWT_CTRL_CYCCNTENA 1
+extern "C" volatile uint8_t usb_configuration;
+
+// Time.
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+class elapsedMillis {
+  private:
+    uint32_t start;
+
+  public:
+    elapsedMillis() : start(millis()) {}
+    elapsedMillis(uint32_t v) : start(millis() - v) {}
+    operator uint32_t() const { return millis() - start; }
+    elapsedMillis &operator=(uint32_t v) {
+      start = millis() - v;
+      return *this;
+    }
+};
+
+class elapsedMicros {
+  private:
+    uint32_t start;
+
+  public:
+    elapsedMicros() : start(micros()) {}
+    elapsedMicros(uint32_t v) : start(micros() - v) {}
+    operator uint32_t() const { return micros() - start; }
+    elapsedMicros &operator=(uint32_t v) {
+      start = micros() - v;
+      return *this;
+    }
+};
+
+// Pins.  Every input reads HIGH (a button not pressed) and every analog input reads 0.
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+int analogRead(int pin);
+int digitalPinToInterrupt(int pin);
+void attachInterrupt(int irq, void (*isr)(), int mode);
+void detachInterrupt(int irq);
+void noInterrupts();
+void interrupts();
+void set_arm_clock(uint32_t hz);
+
+template <class T> T min(T a, T b) { return a < b ? a : b; }
+template <class T> T max(T a, T b) { return a > b ? a : b; }
+template <class T, class U, class V> T constrain(T a, U lo, V hi) { return a < lo ? lo : (a > hi ? hi : a); }
+
+// Strings.
+
+class String {
+  public:
+    std::string s;
+
+    String() {}
+    String(const char *c) : s(c ? c : "") {}
+    String(const std::string &c) : s(c) {}
+    String(char c) : s(1, c) {}
+    String(int v, int base = DEC) : s(number(v, base)) {}
+    String(unsigned v, int base = DEC) : s(number(v, base)) {}
+    String(long v, int base = DEC) : s(number(v, base)) {}
+    String(unsigned long v, int base = DEC) : s(number(v, base)) {}
+    String(float v, int places = 2) : s(decimal(v, places)) {}
+    String(double v, int places = 2) : s(decimal(v, places)) {}
+
+    static std::string number(long long v, int base) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), (base == HEX) ? "%llX" : "%lld", v);
+      return buf;
+    }
+    static std::string decimal(double v, int places) {
+      char buf[48];
+      snprintf(buf, sizeof(buf), "%.*f", places, v);
+      return buf;
+    }
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned length() const { return s.size(); }
+    char charAt(unsigned i) const { return (i < s.size()) ? s[i] : 0; }
+    char operator[](unsigned i) const { return charAt(i); }
+    int indexOf(char c, unsigned from = 0) const { return find(s.find(c, from)); }
+    int indexOf(const String &t, unsigned from = 0) const { return find(s.find(t.s, from)); }
+    int lastIndexOf(char c) const { return find(s.rfind(c)); }
+    String substring(unsigned from) const { return (from < s.size()) ? String(s.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const {
+      if (from > to) {
+        std::swap(from, to);
+      }
+      return (from < s.size()) ? String(s.substr(from, to - from)) : String();
+    }
+    void remove(unsigned index) {
+      if (index < s.size()) {
+        s.erase(index);
+      }
+    }
+    void remove(unsigned index, unsigned count) {
+      if (index < s.size()) {
+        s.erase(index, count);
+      }
+    }
+    long toInt() const { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+    void trim() {
+      size_t a = s.find_first_not_of(" \t\r\n");
+      size_t b = s.find_last_not_of(" \t\r\n");
+      s = (a == std::string::npos) ? "" : s.substr(a, b - a + 1);
+    }
+    bool startsWith(const String &t) const { return s.compare(0, t.s.size(), t.s) == 0; }
+    bool endsWith(const String &t) const {
+      return s.size() >= t.s.size() && s.compare(s.size() - t.s.size(), t.s.size(), t.s) == 0;
+    }
+    void toLowerCase() {
+      for (char &c : s) {
+        c = tolower(c);
+      }
+    }
+    void toUpperCase() {
+      for (char &c : s) {
+        c = toupper(c);
+      }
+    }
+
+    String &operator+=(const String &o) {
+      s += o.s;
+      return *this;
+    }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    bool operator<(const String &o) const { return s < o.s; }
+
+  private:
+    static int find(size_t at) { return (at == std::string::npos) ? -1 : (int)at; }
+};
+
+inline String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+inline String operator+(const String &a, const char *b) { return String(a.s + b); }
+inline String operator+(const char *a, const String &b) { return String(a + b.s); }
+inline String operator+(const String &a, char b) { return String(a.s + b); }
+inline String operator+(const String &a, int b) { return a + String(b); }
+inline String operator+(const String &a, unsigned b) { return a + String(b); }
+inline String operator+(const String &a, long b) { return a + String(b); }
+inline String operator+(const String &a, unsigned long b) { return a + String(b); }
+inline String operator+(const String &a, float b) { return a + String(b); }
+inline String operator+(const String &a, double b) { return a + String(b); }
+
+// Output.
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len) {
+      for (size_t x = 0; x < len; x++) {
+        write(buf[x]);
+      }
+      return len;
+    }
+    size_t write(const char *buf, size_t len) { return write((const uint8_t *)buf, len); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *t) { return write((const uint8_t *)t, strlen(t)); }
+    size_t print(const String &t) { return print(t.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v, int base = DEC) { return print(String(v, base)); }
+    size_t print(unsigned v, int base = DEC) { return print(String(v, base)); }
+    size_t print(long v, int base = DEC) { return print(String(v, base)); }
+    size_t print(unsigned long v, int base = DEC) { return print(String(v, base)); }
+    size_t print(double v, int places = 2) { return print(String(v, places)); }
+    size_t println() { return print("\n"); }
+    template <class T> size_t println(const T &v) { return print(v) + println(); }
+    template <class T> size_t println(const T &v, int fmt) { return print(v, fmt) + println(); }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    size_t readBytes(char *buf, size_t len) {
+      size_t n = 0;
+      int c;
+      while (n < len && (c = read()) >= 0) {
+        buf[n++] = (char)c;
+      }
+      return n;
+    }
+};
+
+// A hardware serial port.  Bytes written go into a 64-byte send buffer that empties at the baud rate as time
+// passes; a write to a full buffer waits (time passes) until there's room.  A device on the far end can be given
+// every byte sent and can answer with reply().  A port that hasn't been begun throws what's written away.
+class HardwareSerial : public Stream {
+  public:
+    static const int TX_BUFFER = 64;
+
+    uint32_t baud = 0;
+    uint64_t sent = 0;            // Bytes written since begin()
+    int begins = 0;               // How many times begin() was called
+    std::function<void(HardwareSerial &port, uint8_t b)> device;   // Given each byte as it's sent
+
+    void begin(uint32_t rate);
+    void end() {}
+    void setTX(int) {}
+    void setRX(int) {}
+    operator bool() { return true; }
+
+    size_t write(uint8_t b) override;
+    using Print::write;
+    int availableForWrite() override;
+    int available() override { return (int)rx.size(); }
+    int read() override;
+    int peek() override { return rx.empty() ? -1 : rx.front(); }
+
+    void reply(const uint8_t *buf, size_t len) { rx.insert(rx.end(), buf, buf + len); }
+    int waiting();                // Bytes still in the send buffer
+
+  private:
+    std::deque<uint8_t> rx;
+    std::deque<uint8_t> tx;
+    uint64_t tx_us = 0;           // When the first byte in tx started going out
+
+    void drain();
+};
+
+// The USB serial port: prints go to stdout, unless host_serial_quiet is set.
+class usb_serial_class : public Stream {
+  public:
+    void begin(uint32_t) {}
+    operator bool() { return true; }
+    int dtr() { return 1; }
+    size_t write(uint8_t b) override;
+    using Print::write;
+    int availableForWrite() override { return 4096; }
+};
+
+extern usb_serial_class Serial;
+extern HardwareSerial Serial1, Serial2, Serial3, Serial4, Serial5, Serial6, Serial7, Serial8;
+
+// USB MIDI: messages are counted, nothing is received.
+class usb_midi_class {
+  public:
+    enum {
+      NoteOff = 0x80, NoteOn = 0x90, AfterTouchPoly = 0xA0, ControlChange = 0xB0, ProgramChange = 0xC0,
+      AfterTouchChannel = 0xD0, PitchBend = 0xE0, SystemExclusive = 0xF0
+    };
+
+    uint64_t messages = 0;
+
+    void sendNoteOn(uint8_t, uint8_t, uint8_t, uint8_t = 0) { messages++; }
+    void sendNoteOff(uint8_t, uint8_t, uint8_t, uint8_t = 0) { messages++; }
+    void sendControlChange(uint8_t, uint8_t, uint8_t, uint8_t = 0) { messages++; }
+    void sendProgramChange(uint8_t, uint8_t, uint8_t = 0) { messages++; }
+    void sendPitchBend(int, uint8_t, uint8_t = 0) { messages++; }
+    void sendAfterTouch(uint8_t, uint8_t, uint8_t = 0) { messages++; }
+    void sendAfterTouchPoly(uint8_t, uint8_t, uint8_t, uint8_t = 0) { messages++; }
+    void sendSysEx(uint32_t, const uint8_t *, bool = false, uint8_t = 0) { messages++; }
+    void send_now() {}
+    bool read(uint8_t = 0) { return false; }
+    uint8_t getType() { return 0; }
+    uint8_t getChannel() { return 0; }
+    uint8_t getData1() { return 0; }
+    uint8_t getData2() { return 0; }
+    const uint8_t *getSysExArray() { return nullptr; }
+    uint16_t getSysExArrayLength() { return 0; }
+};
+
+extern usb_midi_class usbMIDI;
+
+#endif
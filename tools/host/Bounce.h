@@ -0,0 +1,15 @@
+// A button that is never pressed.  See Arduino.h.
+
+#ifndef HOST_BOUNCE_H
+#define HOST_BOUNCE_H
+
+class Bounce {
+  public:
+    Bounce(int, unsigned long) {}
+    int update() { return 0; }
+    int fallingEdge() { return 0; }
+    int risingEdge() { return 0; }
+    int read() { return 1; }
+};
+
+#endif
@@ -0,0 +1,33 @@
+// The Teensy 4's emulated EEPROM, in RAM, starting out all zeros as after a clear.  See Arduino.h.
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass {
+  public:
+    static const int SIZE = 4284;
+    uint8_t data[SIZE] = {};
+
+    uint8_t read(int at) { return (at >= 0 && at < SIZE) ? data[at] : 0; }
+    void write(int at, uint8_t v) {
+      if (at >= 0 && at < SIZE) {
+        data[at] = v;
+      }
+    }
+    void update(int at, uint8_t v) { write(at, v); }
+    int length() { return SIZE; }
+    template <class T> T &get(int at, T &t) {
+      memcpy(&t, data + at, sizeof(T));
+      return t;
+    }
+    template <class T> const T &put(int at, const T &t) {
+      memcpy(data + at, &t, sizeof(T));
+      return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,15 @@
+// A crank encoder that never turns.  See Arduino.h.
+
+#ifndef HOST_ENCODER_H
+#define HOST_ENCODER_H
+
+#include <stdint.h>
+
+class Encoder {
+  public:
+    Encoder(int, int) {}
+    int32_t read() { return 0; }
+    void write(int32_t) {}
+};
+
+#endif
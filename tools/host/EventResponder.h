@@ -0,0 +1,49 @@
+// The Teensy's EventResponder, for functions run from yield() (see Arduino.h).  Only attach() is here: a
+// triggered responder runs once, at the next yield() or during delay(), as the Teensy runs one a yield().
+
+#ifndef HOST_EVENTRESPONDER_H
+#define HOST_EVENTRESPONDER_H
+
+#include <Arduino.h>
+
+#include <deque>
+
+class EventResponder;
+typedef EventResponder &EventResponderRef;
+typedef void (*EventResponderFunction)(EventResponderRef);
+
+class EventResponder {
+  private:
+    EventResponderFunction function = nullptr;
+    bool triggered = false;
+
+    static std::deque<EventResponder *> &waiting() {
+      static std::deque<EventResponder *> w;
+      return w;
+    }
+
+  public:
+    void attach(EventResponderFunction f) { function = f; }
+    void triggerEvent(int = 0, void * = nullptr) {
+      if (function && !triggered) {
+        triggered = true;
+        waiting().push_back(this);
+      }
+    }
+
+    // Runs the first responder waiting.  yield() and delay() call this.
+    static void runFromYield() {
+      static bool running = false;
+      if (running || waiting().empty()) {
+        return;
+      }
+      running = true;
+      EventResponder *e = waiting().front();
+      waiting().pop_front();
+      e->triggered = false;
+      e->function(*e);
+      running = false;
+    }
+};
+
+#endif
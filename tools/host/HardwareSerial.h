@@ -0,0 +1,2 @@
+// See Arduino.h.
+#include <Arduino.h>
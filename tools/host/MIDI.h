@@ -0,0 +1,81 @@
+// The Arduino MIDI library, sending only.  Messages go out on the port as the library sends them, three bytes
+// (two for a program change) with no running status.  Nothing is ever received.  See Arduino.h.
+
+#ifndef HOST_MIDI_H
+#define HOST_MIDI_H
+
+#include <Arduino.h>
+
+#define MIDI_CHANNEL_OMNI 0
+#define MIDI_NAMESPACE midi
+
+namespace midi {
+
+enum MidiType {
+  InvalidType = 0, NoteOff = 0x80, NoteOn = 0x90, AfterTouchPoly = 0xA0, ControlChange = 0xB0, ProgramChange = 0xC0,
+  AfterTouchChannel = 0xD0, PitchBend = 0xE0, SystemExclusive = 0xF0
+};
+
+template <class S> class SerialMIDI {
+  public:
+    S &port;
+    SerialMIDI(S &p) : port(p) {}
+};
+
+template <class T> class MidiInterface {
+  private:
+    T &transport;
+
+    void out(int status, int channel, int d1) {
+      uint8_t m[2] = {(uint8_t)(status | ((channel - 1) & 15)), (uint8_t)(d1 & 127)};
+      transport.port.write(m[0]);
+      transport.port.write(m[1]);
+    }
+    void out(int status, int channel, int d1, int d2) {
+      out(status, channel, d1);
+      transport.port.write((uint8_t)(d2 & 127));
+    }
+
+  public:
+    MidiInterface(T &t) : transport(t) {}
+    void begin(int = 1) { transport.port.begin(31250); }
+    void setInputChannel(int) {}
+    void turnThruOff() {}
+    void sendNoteOn(int note, int vel, int channel) { out(NoteOn, channel, note, vel); }
+    void sendNoteOff(int note, int vel, int channel) { out(NoteOff, channel, note, vel); }
+    void sendControlChange(int cc, int value, int channel) { out(ControlChange, channel, cc, value); }
+    void sendProgramChange(int program, int channel) { out(ProgramChange, channel, program); }
+    void sendAfterTouch(int pressure, int channel) { out(AfterTouchChannel, channel, pressure); }
+    void sendAfterTouch(int note, int pressure, int channel) { out(AfterTouchPoly, channel, note, pressure); }
+    void sendPitchBend(int bend, int channel) {
+      int v = bend + 8192;
+      out(PitchBend, channel, v & 127, (v >> 7) & 127);
+    }
+    void sendSysEx(unsigned len, const uint8_t *data, bool = false) {
+      transport.port.write((uint8_t)0xF0);
+      for (unsigned x = 0; x < len; x++) {
+        transport.port.write(data[x]);
+      }
+      transport.port.write((uint8_t)0xF7);
+    }
+    void send(MidiType type, int d1, int d2, int channel) {
+      if (type == ProgramChange || type == AfterTouchChannel) {
+        out(type, channel, d1);
+      } else {
+        out(type, channel, d1, d2);
+      }
+    }
+    bool read() { return false; }
+    MidiType getType() { return InvalidType; }
+    int getChannel() { return 0; }
+    int getData1() { return 0; }
+    int getData2() { return 0; }
+};
+
+}
+
+#define MIDI_CREATE_INSTANCE(Type, SerialPort, Name) \
+  midi::SerialMIDI<Type> serial##Name(SerialPort);   \
+  midi::MidiInterface<midi::SerialMIDI<Type>> Name((midi::SerialMIDI<Type> &)serial##Name);
+
+#endif
@@ -0,0 +1,79 @@
+// The SD card, as a directory on the computer (host_sd_root).  See Arduino.h.
+
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <Arduino.h>
+
+#include <memory>
+#include <vector>
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+#define O_RDONLY 0
+
+// An open file or directory on the card.  Copies share it, as the Teensy's do.
+class File : public Stream {
+  private:
+    struct Open {
+      FILE *f = nullptr;
+      std::string path;
+      std::string name;
+      bool dir = false;
+      std::vector<std::string> entries;
+      size_t next = 0;
+      ~Open() {
+        if (f) {
+          fclose(f);
+        }
+      }
+    };
+    std::shared_ptr<Open> open;
+
+  public:
+    File() {}
+    static File openPath(const std::string &card_path, int mode);
+
+    operator bool() { return open != nullptr; }
+    const char *name() { return open ? open->name.c_str() : ""; }
+    bool isDirectory() { return open && open->dir; }
+    File openNextFile(int mode = FILE_READ);
+    void rewindDirectory() {
+      if (open) {
+        open->next = 0;
+      }
+    }
+    void close() { open.reset(); }
+    bool seek(uint32_t at) { return open && open->f && fseek(open->f, at, SEEK_SET) == 0; }
+    uint32_t position() { return (open && open->f) ? (uint32_t)ftell(open->f) : 0; }
+    uint32_t size();
+    int available() override { return size() - position(); }
+    int read() override { return (open && open->f) ? fgetc(open->f) : -1; }
+    int peek() override;
+    size_t read(void *buf, size_t len) { return (open && open->f) ? fread(buf, 1, len, open->f) : 0; }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t len) override {
+      return (open && open->f) ? fwrite(buf, 1, len, open->f) : 0;
+    }
+    using Print::write;
+    void flush() override {
+      if (open && open->f) {
+        fflush(open->f);
+      }
+    }
+};
+
+class SDClass {
+  public:
+    bool begin(int);
+    File open(const char *path, int mode = FILE_READ);
+    bool exists(const char *path);
+    bool mkdir(const char *path);
+    bool remove(const char *path);
+
+    bool inserted = true;
+};
+
+extern SDClass SD;
+
+#endif
@@ -0,0 +1,45 @@
+// A display that draws nothing.  See Arduino.h.
+
+#ifndef HOST_U8G2LIB_H
+#define HOST_U8G2LIB_H
+
+#include <Arduino.h>
+
+extern const uint8_t u8g2_font_finderskeepers_tf[], u8g2_font_elispe_tr[], u8g2_font_timB14_tf[],
+    u8g2_font_crox4hb_tf[];
+#define U8G2_R0 0
+
+class U8G2 {
+  public:
+    void begin() {}
+    void clearBuffer() {}
+    void sendBuffer() {}
+    void setFontMode(int) {}
+    void setFont(const uint8_t *) {}
+    int getStrWidth(const char *t) { return 6 * strlen(t); }
+    void drawStr(int, int, const char *) {}
+    void drawHLine(int, int, int) {}
+    void drawVLine(int, int, int) {}
+    void drawXBM(int, int, int, int, const uint8_t *) {}
+    void drawBitmap(int, int, int, int, const uint8_t *) {}
+    void setBitmapMode(int) {}
+    void drawBox(int, int, int, int) {}
+    void drawFrame(int, int, int, int) {}
+    void setDrawColor(int) {}
+    void updateDisplayArea(int, int, int, int) {}
+};
+
+class U8G2_SH1106_128X64_NONAME_F_3RD_4W_HW_SPI : public U8G2 {
+  public:
+    U8G2_SH1106_128X64_NONAME_F_3RD_4W_HW_SPI(int, int, int, int) {}
+};
+class U8G2_SH1106_128X64_NONAME_F_4W_HW_SPI : public U8G2 {
+  public:
+    U8G2_SH1106_128X64_NONAME_F_4W_HW_SPI(int, int, int, int) {}
+};
+class U8G2_SSD1306_128X64_NONAME_F_4W_HW_SPI : public U8G2 {
+  public:
+    U8G2_SSD1306_128X64_NONAME_F_4W_HW_SPI(int, int, int, int) {}
+};
+
+#endif
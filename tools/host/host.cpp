@@ -0,0 +1,272 @@
+// The definitions behind the computer-side Teensy headers in this directory.  See Arduino.h and host.h.
+
+#include "host.h"
+
+#include <EEPROM.h>
+#include <EventResponder.h>
+#include <SD.h>
+#include <U8g2lib.h>
+#include <imxrt.h>
+
+#include <algorithm>
+#include <filesystem>
+
+static uint64_t now_us = 0;
+
+std::string host_sd_root;
+bool host_serial_quiet = false;
+std::string host_serial_log;
+
+volatile uint32_t ARM_DEMCR;
+volatile uint32_t ARM_DWT_CTRL;
+extern "C" {
+volatile uint8_t usb_configuration = 1;
+}
+volatile uint32_t GPIO8_GDIR, GPIO8_DR_SET, GPIO8_DR_CLEAR;
+
+const uint8_t u8g2_font_finderskeepers_tf[1] = {}, u8g2_font_elispe_tr[1] = {}, u8g2_font_timB14_tf[1] = {},
+              u8g2_font_crox4hb_tf[1] = {};
+
+usb_serial_class Serial;
+HardwareSerial Serial1, Serial2, Serial3, Serial4, Serial5, Serial6, Serial7, Serial8;
+usb_midi_class usbMIDI;
+EEPROMClass EEPROM;
+SDClass SD;
+
+// Time.
+
+uint64_t host_now_us() {
+  return now_us;
+}
+
+void host_advance_us(uint64_t us) {
+  now_us += us;
+}
+
+uint32_t micros() {
+  now_us += HOST_CALL_US;
+  return (uint32_t)now_us;
+}
+
+uint32_t millis() {
+  now_us += HOST_CALL_US;
+  return (uint32_t)(now_us / 1000);
+}
+
+uint32_t host_cycles() {
+  return (uint32_t)(now_us * (F_CPU / 1000000));
+}
+
+// The Teensy runs yield() all through a delay(); here it's every 100us.
+void delay(uint32_t ms) {
+  uint64_t end = now_us + (uint64_t)ms * 1000;
+  while (now_us < end) {
+    now_us = std::min(end, now_us + 100);
+    EventResponder::runFromYield();
+  }
+}
+
+void delayMicroseconds(uint32_t us) {
+  now_us += us;
+}
+
+void yield() {
+  now_us += HOST_CALL_US;
+  EventResponder::runFromYield();
+}
+
+// Pins.
+
+void pinMode(int, int) {}
+void digitalWrite(int, int) {}
+int digitalRead(int) { return HIGH; }
+int analogRead(int) { return 0; }
+int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(int, void (*)(), int) {}
+void detachInterrupt(int) {}
+void noInterrupts() {}
+void interrupts() {}
+void set_arm_clock(uint32_t) {}
+
+// Serial ports.
+
+size_t usb_serial_class::write(uint8_t b) {
+  host_serial_log += (char)b;
+  if (!host_serial_quiet) {
+    putchar(b);
+  }
+  return 1;
+}
+
+void HardwareSerial::begin(uint32_t rate) {
+  drain();
+  baud = rate;
+  begins++;
+  tx_us = now_us;
+}
+
+// Sends what has had time to go out since the last look, handing each byte to the device.
+void HardwareSerial::drain() {
+  if (baud == 0) {
+    return;
+  }
+  uint64_t byte_us = 10000000ULL / baud;
+  while (!tx.empty() && now_us - tx_us >= byte_us) {
+    uint8_t b = tx.front();
+    tx.pop_front();
+    tx_us += byte_us;
+    if (device) {
+      device(*this, b);
+    }
+  }
+  if (tx.empty()) {
+    tx_us = now_us;
+  }
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+  if (baud == 0) {
+    return 1;
+  }
+  drain();
+  while ((int)tx.size() >= TX_BUFFER) {
+    // The Teensy waits for room, too.
+    now_us += 10000000ULL / baud;
+    drain();
+  }
+  tx.push_back(b);
+  sent++;
+  return 1;
+}
+
+int HardwareSerial::availableForWrite() {
+  drain();
+  return TX_BUFFER - (int)tx.size();
+}
+
+int HardwareSerial::read() {
+  drain();
+  if (rx.empty()) {
+    return -1;
+  }
+  uint8_t b = rx.front();
+  rx.pop_front();
+  return b;
+}
+
+int HardwareSerial::waiting() {
+  drain();
+  return (int)tx.size();
+}
+
+// The WAV Trigger's serial protocol (see wavTrigger.h): f0 aa len cmd ... 55, where len counts every byte.
+void host_wav_trigger(HardwareSerial &port, bool answer) {
+  auto msg = std::make_shared<std::vector<uint8_t>>();
+
+  port.device = [msg, answer](HardwareSerial &p, uint8_t b) {
+    std::vector<uint8_t> &m = *msg;
+    if ((m.empty() && b != 0xf0) || (m.size() == 1 && b != 0xaa)) {
+      m.clear();
+      return;
+    }
+    m.push_back(b);
+    if (m.size() < 3 || m.size() < m[2]) {
+      return;
+    }
+
+    uint8_t cmd = m[3];
+    m.clear();
+    if (!answer) {
+      return;
+    }
+    if (cmd == 1) {
+      // Version: 0x81 and a 20-character string.
+      uint8_t reply[25] = {0xf0, 0xaa, 25, 0x81};
+      memcpy(reply + 4, "WAV Trigger v1.40   ", 20);
+      reply[24] = 0x55;
+      p.reply(reply, sizeof(reply));
+    } else if (cmd == 2) {
+      // System info: 0x82, 14 voices, 4096 tracks.
+      uint8_t reply[8] = {0xf0, 0xaa, 8, 0x82, 14, 0x00, 0x10, 0x55};
+      p.reply(reply, sizeof(reply));
+    }
+  };
+}
+
+// The SD card.
+
+static std::string card_path(const char *path) {
+  return host_sd_root + ((path[0] == '/') ? "" : "/") + path;
+}
+
+File File::openPath(const std::string &path, int mode) {
+  std::error_code ec;
+  File file;
+  auto o = std::make_shared<Open>();
+  o->path = path;
+  o->name = std::filesystem::path(path).filename().string();
+
+  if (std::filesystem::is_directory(path, ec)) {
+    o->dir = true;
+    for (const auto &e : std::filesystem::directory_iterator(path, ec)) {
+      o->entries.push_back(e.path().filename().string());
+    }
+    std::sort(o->entries.begin(), o->entries.end());
+  } else {
+    o->f = fopen(path.c_str(), (mode == FILE_WRITE) ? "a+b" : "rb");
+    if (!o->f) {
+      return file;
+    }
+  }
+  file.open = o;
+  return file;
+}
+
+File File::openNextFile(int mode) {
+  if (!open || !open->dir || open->next >= open->entries.size()) {
+    return File();
+  }
+  return openPath(open->path + "/" + open->entries[open->next++], mode);
+}
+
+uint32_t File::size() {
+  if (!open || !open->f) {
+    return 0;
+  }
+  long at = ftell(open->f);
+  fseek(open->f, 0, SEEK_END);
+  long end = ftell(open->f);
+  fseek(open->f, at, SEEK_SET);
+  return (uint32_t)end;
+}
+
+int File::peek() {
+  int c = read();
+  if (c >= 0) {
+    ungetc(c, open->f);
+  }
+  return c;
+}
+
+File SDClass::open(const char *path, int mode) {
+  return (inserted && !host_sd_root.empty()) ? File::openPath(card_path(path), mode) : File();
+}
+
+bool SDClass::exists(const char *path) {
+  std::error_code ec;
+  return inserted && !host_sd_root.empty() && std::filesystem::exists(card_path(path), ec);
+}
+
+bool SDClass::mkdir(const char *path) {
+  std::error_code ec;
+  return inserted && !host_sd_root.empty() && std::filesystem::create_directories(card_path(path), ec);
+}
+
+bool SDClass::remove(const char *path) {
+  std::error_code ec;
+  return inserted && !host_sd_root.empty() && std::filesystem::remove(card_path(path), ec);
+}
+
+bool SDClass::begin(int) {
+  return inserted && !host_sd_root.empty();
+}
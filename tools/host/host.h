@@ -0,0 +1,33 @@
+// What tools/gurdy_host.cpp controls of the computer-side Teensy (see Arduino.h): the clock, the card and the
+// devices on the serial ports.
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <Arduino.h>
+
+#include <string>
+
+// How far the clock moves every time the sketch reads it.
+const uint32_t HOST_CALL_US = 1;
+
+/// @brief Returns the virtual time, in microseconds since the start.
+uint64_t host_now_us();
+
+/// @brief Moves the virtual clock forward, sending what the serial ports have buffered meanwhile.
+void host_advance_us(uint64_t us);
+
+/// @brief Puts a WAV Trigger on a serial port: it answers version and system info requests as the real one does,
+/// and doesn't if answer is false.
+void host_wav_trigger(HardwareSerial &port, bool answer = true);
+
+/// @brief The directory that stands in for the SD card.  SD.begin() fails while it's empty.
+extern std::string host_sd_root;
+
+/// @brief True to drop what the sketch prints to Serial.
+extern bool host_serial_quiet;
+
+/// @brief Everything the sketch printed to Serial, whether it was shown or not.
+extern std::string host_serial_log;
+
+#endif
@@ -0,0 +1,10 @@
+// The Teensy 4's registers the sketch touches, as plain variables.  See Arduino.h.
+
+#ifndef HOST_IMXRT_H
+#define HOST_IMXRT_H
+
+#include <stdint.h>
+
+extern volatile uint32_t GPIO8_GDIR, GPIO8_DR_SET, GPIO8_DR_CLEAR;
+
+#endif
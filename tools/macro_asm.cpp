@@ -0,0 +1,723 @@
+// macro_asm: assembles, checks and runs digigurdy-baz EX button macros on a computer.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -o macro_asm tools/macro_asm.cpp
+//
+// Usage:
+//
+//   macro_asm asm <in.mac> [out.txt]                Assemble macros into sysex_tool configuration lines.
+//   macro_asm disasm <config.txt>                   Turn "sysex_tool print" output back into macro source.
+//   macro_asm run <in.mac> <macro> [options]        Run one macro on a simulated gurdy and print what it does.
+//   macro_asm test                                  Check the assembler and the macro engine against known cases.
+//
+//   --budget N      Instructions per loop(), default MACRO_BUDGET's default (2)
+//   --loop-us N     Simulated loop() period, default 10
+//   --verbose       Also print every volume change during a ramp
+//
+// A macro file holds up to six macros, each starting with a "macro <1-6>" line.  One instruction a line,
+// '#' starts a comment:
+//
+//   macro 1
+//   mute drone+tromp        # Mute exactly these strings ("mute none" unmutes everything)
+//   tpose -2                # Transpose by a number of semitones
+//   capo 2                  # Set the capo: 0, 2 or 4
+//   preset 3                # Load preset tuning 1-4
+//   load 1                  # Load save slot 1-4
+//   volume mel 90           # Set string volumes, 0-127
+//   ramp all 0 1500         # Move string volumes to a volume over a time in ms (heard from each next note)
+//   crank on                # Auto-crank on, off or toggle
+//   wait 250                # Wait a time in ms
+//   func sec_out            # Run an EX function, by name or number (see EX_FUNCS below)
+//   end                     # Optional
+//
+// Strings are hi, lo, drone, tromp, buzz and click, joined with '+', or mel (hi+lo) or all.  mute only
+// takes hi, lo, drone and tromp (which mutes the buzz with it).
+//
+// The assembled output uses sysex_tool's @<address> form, one line per byte of every macro in the file.
+// Add it to a configuration and load it onto the gurdy with sysex_tool, e.g.:
+//
+//   sysex_tool build macros.txt new.syx current.syx
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../eeprom_values.h"
+#include "../macro_vm.h"
+#include "tool_test.h"
+
+static const char *OP_NAMES[MACRO_NUM_OPS] = {"end", "func", "mute", "tpose", "capo", "preset", "load",
+                                              "volume", "ramp", "crank", "wait"};
+
+struct NamedValue {
+  const char *name;
+  int value;
+};
+
+// EX functions a macro can run (see ex_run_func() in exfunctions.cpp).
+static const NamedValue EX_FUNCS[] = {
+  {"mel_mutes", 2}, {"drone_tromp_mutes", 3}, {"drone_mute", 4}, {"tromp_mute", 5}, {"vol_down", 6},
+  {"vol_up", 7}, {"tpose_down", 8}, {"tpose_up", 9}, {"cycle_capo", 10}, {"sec_out", 13},
+  {"hi_mute", 14}, {"lo_mute", 15}
+};
+
+static const NamedValue STRINGS[] = {
+  {"hi", MACRO_HI_MEL}, {"lo", MACRO_LO_MEL}, {"drone", MACRO_DRONE}, {"tromp", MACRO_TROMP},
+  {"buzz", MACRO_BUZZ}, {"click", MACRO_KEYCLICK}, {"mel", MACRO_HI_MEL | MACRO_LO_MEL}, {"all", MACRO_ALL},
+  {"none", 0}
+};
+
+static const NamedValue CRANK_MODES[] = {{"off", 0}, {"on", 1}, {"toggle", 2}};
+
+struct Program {
+  int macro = 0;                  // 1-MACRO_SLOTS
+  std::vector<uint8_t> code;
+};
+
+// ---------------------------------------------------------------------------------------------------
+// Assembling and disassembling
+
+static bool parse_int(const std::string &s, int lo, int hi, int &out) {
+  char *end;
+  long v = strtol(s.c_str(), &end, 10);
+  if (s.empty() || *end != '\0' || v < lo || v > hi) {
+    return false;
+  }
+  out = int(v);
+  return true;
+}
+
+static bool parse_named(const std::string &s, const NamedValue *table, int count, int &out) {
+  for (int x = 0; x < count; x++) {
+    if (s == table[x].name) {
+      out = table[x].value;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parse_strings(const std::string &s, int &mask) {
+  mask = 0;
+  std::stringstream ss(s);
+  std::string part;
+  while (std::getline(ss, part, '+')) {
+    int bits;
+    if (!parse_named(part, STRINGS, sizeof(STRINGS) / sizeof(STRINGS[0]), bits)) {
+      return false;
+    }
+    mask |= bits;
+  }
+  return true;
+}
+
+static std::string strings_name(int mask) {
+  if (mask == 0) {
+    return "none";
+  } else if (mask == MACRO_ALL) {
+    return "all";
+  }
+  std::string out;
+  if ((mask & (MACRO_HI_MEL | MACRO_LO_MEL)) == (MACRO_HI_MEL | MACRO_LO_MEL)) {
+    out = "mel";
+    mask &= ~(MACRO_HI_MEL | MACRO_LO_MEL);
+  }
+  for (int x = 0; x < 6; x++) {
+    if (mask & STRINGS[x].value) {
+      out += (out.empty() ? "" : "+") + std::string(STRINGS[x].name);
+    }
+  }
+  return out;
+}
+
+// Assembles one instruction.  Returns an error message, or "" if it assembled.
+static std::string assemble_line(const std::vector<std::string> &words, std::vector<uint8_t> &code) {
+  const std::string &op = words[0];
+  int n = int(words.size()) - 1;
+  int a = 0, b = 0, c = 0;
+
+  auto want = [&](int count) { return n == count; };
+
+  if (op == "end" && want(0)) {
+    code.push_back(MACRO_END);
+  } else if (op == "func" && want(1)) {
+    if (!parse_named(words[1], EX_FUNCS, sizeof(EX_FUNCS) / sizeof(EX_FUNCS[0]), a) && !parse_int(words[1], 0, 255, a)) {
+      return "unknown EX function " + words[1];
+    }
+    code.insert(code.end(), {MACRO_FUNC, uint8_t(a)});
+  } else if (op == "mute" && want(1)) {
+    if (!parse_strings(words[1], a)) {
+      return "bad strings " + words[1];
+    }
+    code.insert(code.end(), {MACRO_MUTE, uint8_t(a)});
+  } else if (op == "tpose" && want(1)) {
+    if (!parse_int(words[1], -24, 24, a)) {
+      return "transpose must be -24 to 24";
+    }
+    code.insert(code.end(), {MACRO_TPOSE, uint8_t(int8_t(a))});
+  } else if ((op == "capo" || op == "preset" || op == "load") && want(1)) {
+    if (!parse_int(words[1], 0, 255, a)) {
+      return "bad number " + words[1];
+    }
+    code.insert(code.end(), {uint8_t(op == "capo" ? MACRO_CAPO : op == "preset" ? MACRO_PRESET : MACRO_LOAD), uint8_t(a)});
+  } else if (op == "volume" && want(2)) {
+    if (!parse_strings(words[1], a) || !parse_int(words[2], 0, 127, b)) {
+      return "expected: volume <strings> <0-127>";
+    }
+    code.insert(code.end(), {MACRO_VOLUME, uint8_t(a), uint8_t(b)});
+  } else if (op == "ramp" && want(3)) {
+    if (!parse_strings(words[1], a) || !parse_int(words[2], 0, 127, b) || !parse_int(words[3], 0, 65535, c)) {
+      return "expected: ramp <strings> <0-127> <0-65535 ms>";
+    }
+    code.insert(code.end(), {MACRO_RAMP, uint8_t(a), uint8_t(b), uint8_t(c & 0xFF), uint8_t(c >> 8)});
+  } else if (op == "crank" && want(1)) {
+    if (!parse_named(words[1], CRANK_MODES, 3, a)) {
+      return "expected: crank on|off|toggle";
+    }
+    code.insert(code.end(), {MACRO_CRANK, uint8_t(a)});
+  } else if (op == "wait" && want(1)) {
+    if (!parse_int(words[1], 0, 65535, a)) {
+      return "wait must be 0-65535 ms";
+    }
+    code.insert(code.end(), {MACRO_WAIT, uint8_t(a & 0xFF), uint8_t(a >> 8)});
+  } else {
+    return "can't understand \"" + op + "\" with " + std::to_string(n) + " operand(s)";
+  }
+  return "";
+}
+
+// Assembles macro source.  Problems are added to errors as "line: message".
+static std::vector<Program> assemble(std::istream &in, std::vector<std::string> &errors) {
+  std::vector<Program> programs;
+  std::string line;
+  int line_num = 0;
+
+  while (std::getline(in, line)) {
+    line_num++;
+    size_t hash = line.find('#');
+    if (hash != std::string::npos) {
+      line.erase(hash);
+    }
+    std::stringstream ss(line);
+    std::vector<std::string> words;
+    std::string w;
+    while (ss >> w) {
+      words.push_back(w);
+    }
+    if (words.empty()) {
+      continue;
+    }
+
+    std::string where = std::to_string(line_num) + ": ";
+    if (words[0] == "macro") {
+      Program p;
+      if (words.size() != 2 || !parse_int(words[1], 1, MACRO_SLOTS, p.macro)) {
+        errors.push_back(where + "expected: macro <1-" + std::to_string(MACRO_SLOTS) + ">");
+        continue;
+      }
+      for (const Program &other : programs) {
+        if (other.macro == p.macro) {
+          errors.push_back(where + "macro " + words[1] + " is defined twice");
+        }
+      }
+      programs.push_back(p);
+      continue;
+    }
+    if (programs.empty()) {
+      errors.push_back(where + "instruction before the first \"macro\" line");
+      continue;
+    }
+
+    Program &p = programs.back();
+    size_t start = p.code.size();
+    std::string err = assemble_line(words, p.code);
+    if (!err.empty()) {
+      errors.push_back(where + err);
+      continue;
+    }
+
+    // Check each instruction as it's added, so problems point at the right line.
+    const char *check_err;
+    int at;
+    if (!macro_check(p.code.data(), int(p.code.size()), &check_err, &at) && at >= int(start)) {
+      errors.push_back(where + check_err);
+      p.code.resize(start);
+    } else if (p.code.size() > size_t(MACRO_SIZE)) {
+      errors.push_back(where + "macro " + std::to_string(p.macro) + " is longer than " + std::to_string(MACRO_SIZE) + " bytes");
+      p.code.resize(start);
+    }
+  }
+
+  return programs;
+}
+
+// Disassembles one program, as macro source.
+static std::string disassemble(const Program &p) {
+  std::ostringstream out;
+  out << "macro " << p.macro << "\n";
+  const uint8_t *code = p.code.data();
+  int len = int(p.code.size());
+  int pc = 0;
+  while (pc < len && code[pc] != MACRO_END) {
+    uint8_t op = code[pc];
+    if (op >= MACRO_NUM_OPS || pc + MACRO_OP_LEN[op] > len) {
+      out << "# bad instruction at byte " << pc << "\n";
+      break;
+    }
+    const uint8_t *arg = code + pc + 1;
+    out << OP_NAMES[op];
+    if (op == MACRO_FUNC) {
+      std::string name = std::to_string(arg[0]);
+      for (const NamedValue &f : EX_FUNCS) {
+        if (f.value == arg[0]) {
+          name = f.name;
+        }
+      }
+      out << " " << name;
+    } else if (op == MACRO_MUTE) {
+      out << " " << strings_name(arg[0]);
+    } else if (op == MACRO_TPOSE) {
+      int steps = int8_t(arg[0]);
+      out << " " << (steps > 0 ? "+" : "") << steps;
+    } else if (op == MACRO_VOLUME) {
+      out << " " << strings_name(arg[0]) << " " << int(arg[1]);
+    } else if (op == MACRO_RAMP) {
+      out << " " << strings_name(arg[0]) << " " << int(arg[1]) << " " << macro_time(arg + 2);
+    } else if (op == MACRO_CRANK) {
+      out << " " << (arg[0] < 3 ? CRANK_MODES[arg[0]].name : "?");
+    } else if (op == MACRO_WAIT) {
+      out << " " << macro_time(arg);
+    } else {
+      out << " " << int(arg[0]);
+    }
+    out << "\n";
+    pc += MACRO_OP_LEN[op];
+  }
+  return out.str();
+}
+
+// The EEPROM image of a program: its code, padded with END.
+static std::vector<uint8_t> program_image(const Program &p) {
+  std::vector<uint8_t> image = p.code;
+  image.resize(MACRO_SIZE, MACRO_END);
+  return image;
+}
+
+// ---------------------------------------------------------------------------------------------------
+// The simulated gurdy
+
+struct SimGurdy {
+  uint32_t now_ms = 0;
+  int tpose = 0;
+  int capo = 0;
+  int mutes = 0;
+  int volumes[MACRO_NUM_STRINGS] = {100, 100, 100, 100, 100, 100};
+  bool autocrank = false;
+  int volume_done_calls = 0;
+  bool verbose = false;
+  std::ostringstream log;
+};
+
+static SimGurdy *sim = nullptr;
+
+static void sim_say(const std::string &what) {
+  char stamp[32];
+  snprintf(stamp, sizeof(stamp), "%9.3fms  ", sim->now_ms / 1.0);
+  sim->log << stamp << what << "\n";
+}
+
+static int sim_string_index(int bit) {
+  int s = 0;
+  while (bit > 1) {
+    bit >>= 1;
+    s++;
+  }
+  return s;
+}
+
+static void sim_func(int func) {
+  // The ones with an effect the simulation tracks.
+  if (func == 8) {
+    sim->tpose = std::max(sim->tpose - 1, -12);
+  } else if (func == 9) {
+    sim->tpose = std::min(sim->tpose + 1, 12);
+  } else if (func == 10) {
+    sim->capo = (sim->capo + 2 > 4) ? 0 : sim->capo + 2;
+  }
+  sim_say("func " + std::to_string(func));
+}
+
+static void sim_mute(int mask) {
+  sim->mutes = mask;
+  sim_say("mute " + strings_name(mask));
+}
+
+static void sim_tpose(int steps) {
+  sim->tpose = std::max(-12, std::min(12, sim->tpose + steps));
+  sim_say("tpose " + std::to_string(steps) + " -> " + std::to_string(sim->tpose));
+}
+
+static void sim_capo(int capo) {
+  sim->capo = capo;
+  sim_say("capo " + std::to_string(capo));
+}
+
+static void sim_preset(int slot) {
+  sim->autocrank = false;
+  sim_say("load preset " + std::to_string(slot));
+}
+
+static void sim_load(int slot) {
+  sim->autocrank = false;
+  sim_say("load save slot " + std::to_string(slot));
+}
+
+static int sim_get_volume(int bit) {
+  return sim->volumes[sim_string_index(bit)];
+}
+
+static void sim_set_volume(int bit, int volume) {
+  sim->volumes[sim_string_index(bit)] = volume;
+  if (sim->verbose) {
+    sim_say("  volume " + std::string(STRINGS[sim_string_index(bit)].name) + " = " + std::to_string(volume));
+  }
+}
+
+static void sim_volume_done(int mask) {
+  sim->volume_done_calls++;
+  std::string vols;
+  for (int s = 0; s < MACRO_NUM_STRINGS; s++) {
+    if (mask & (1 << s)) {
+      vols += " " + std::string(STRINGS[s].name) + "=" + std::to_string(sim->volumes[s]);
+    }
+  }
+  sim_say("volumes" + vols);
+}
+
+static void sim_crank(int mode) {
+  sim->autocrank = (mode == 2) ? !sim->autocrank : (mode == 1);
+  sim_say(std::string("auto-crank ") + (sim->autocrank ? "on" : "off"));
+}
+
+static const MacroActions SIM_ACTIONS = {
+  sim_func, sim_mute, sim_tpose, sim_capo, sim_preset, sim_load,
+  sim_get_volume, sim_set_volume, sim_volume_done, sim_crank
+};
+
+struct RunResult {
+  bool finished = false;
+  uint32_t loops = 0;
+  int most_per_loop = 0;
+  uint32_t end_us = 0;
+};
+
+// Runs a program the way loop() does: macro_run() once a loop, loop_us apart.
+static RunResult simulate(SimGurdy &g, const std::vector<uint8_t> &image, int budget, uint32_t loop_us,
+                          uint32_t limit_ms = 600000) {
+  RunResult r;
+  MacroVM vm;
+  sim = &g;
+  macro_begin(vm, image.data());
+
+  uint64_t now_us = 0;
+  while (vm.running && now_us / 1000 < limit_ms) {
+    g.now_ms = uint32_t(now_us / 1000);
+    int ran = macro_run(vm, SIM_ACTIONS, g.now_ms, budget);
+    r.most_per_loop = std::max(r.most_per_loop, ran);
+    r.loops++;
+    now_us += loop_us;
+  }
+  r.finished = !vm.running;
+  r.end_us = uint32_t(now_us);
+  sim = nullptr;
+  return r;
+}
+
+// ---------------------------------------------------------------------------------------------------
+// Commands
+
+static bool load_source(const std::string &path, std::vector<Program> &programs) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Can't open " << path << "\n";
+    return false;
+  }
+  std::vector<std::string> errors;
+  programs = assemble(in, errors);
+  for (const std::string &e : errors) {
+    std::cerr << path << ":" << e << "\n";
+  }
+  return errors.empty();
+}
+
+static int cmd_asm(const std::string &in_path, const std::string &out_path) {
+  std::vector<Program> programs;
+  if (!load_source(in_path, programs)) {
+    return 1;
+  }
+
+  std::ostringstream out;
+  out << "# EX button macros from " << in_path << " (macro_asm)\n";
+  for (const Program &p : programs) {
+    std::vector<uint8_t> image = program_image(p);
+    out << "# macro " << p.macro << ": " << p.code.size() << " of " << MACRO_SIZE << " bytes\n";
+    int base = EEPROM_MACROS + (p.macro - 1) * MACRO_SIZE;
+    for (int x = 0; x < MACRO_SIZE; x++) {
+      out << "@" << base + x << " = " << int(image[x]) << "\n";
+    }
+  }
+
+  if (out_path.empty()) {
+    std::cout << out.str();
+  } else {
+    std::ofstream f(out_path);
+    if (!f) {
+      std::cerr << "Can't write " << out_path << "\n";
+      return 1;
+    }
+    f << out.str();
+    std::cerr << "Wrote " << programs.size() << " macro(s) to " << out_path << "\n";
+  }
+  return 0;
+}
+
+static int cmd_disasm(const std::string &in_path) {
+  std::ifstream in(in_path);
+  if (!in) {
+    std::cerr << "Can't open " << in_path << "\n";
+    return 1;
+  }
+
+  // Only the @<address> lines can hold macro bytes; anything unset is 0 (END).
+  std::vector<uint8_t> eeprom(EEPROM_CONFIG_LEN, 0);
+  std::string line;
+  while (std::getline(in, line)) {
+    int addr, value;
+    if (sscanf(line.c_str(), " @%d = %d", &addr, &value) == 2 && addr >= 0 && addr < EEPROM_CONFIG_LEN) {
+      eeprom[addr] = uint8_t(value);
+    }
+  }
+
+  for (int m = 1; m <= MACRO_SLOTS; m++) {
+    Program p;
+    p.macro = m;
+    p.code.assign(eeprom.begin() + EEPROM_MACROS + (m - 1) * MACRO_SIZE,
+                  eeprom.begin() + EEPROM_MACROS + m * MACRO_SIZE);
+    if (p.code[0] == MACRO_END || p.code[0] == 0xFF) {
+      continue;
+    }
+    const char *error;
+    int at;
+    if (!macro_check(p.code.data(), MACRO_SIZE, &error, &at)) {
+      std::cout << "# macro " << m << " won't run: " << error << " at byte " << at << "\n";
+    }
+    std::cout << disassemble(p) << "\n";
+  }
+  return 0;
+}
+
+static int cmd_run(const std::string &in_path, int macro, int budget, uint32_t loop_us, bool verbose) {
+  std::vector<Program> programs;
+  if (!load_source(in_path, programs)) {
+    return 1;
+  }
+  for (const Program &p : programs) {
+    if (p.macro == macro) {
+      SimGurdy g;
+      g.verbose = verbose;
+      RunResult r = simulate(g, program_image(p), budget, loop_us);
+      std::cout << g.log.str();
+      std::cout << (r.finished ? "Finished" : "Still running") << " after " << r.end_us / 1000.0 << "ms, "
+                << r.loops << " loop()s, at most " << r.most_per_loop << " instruction(s) in one.\n";
+      std::cout << "End state: tpose " << g.tpose << ", capo " << g.capo << ", mutes " << strings_name(g.mutes)
+                << ", auto-crank " << (g.autocrank ? "on" : "off") << "\n";
+      return 0;
+    }
+  }
+  std::cerr << "Macro " << macro << " isn't in " << in_path << "\n";
+  return 1;
+}
+
+// The known cases for "macro_asm test".
+static int cmd_test() {
+  ToolTest t;
+
+  // Every instruction assembles, disassembles to the same source and reassembles to the same bytes.
+  {
+    std::string src = "macro 2\nfunc sec_out\nfunc 6\nmute hi+drone\ntpose -3\ntpose +12\ncapo 4\npreset 1\n"
+                      "load 4\nvolume mel 90\nramp all 0 1500\ncrank toggle\nwait 65535\n";
+    std::istringstream in(src);
+    std::vector<std::string> errors;
+    std::vector<Program> p = assemble(in, errors);
+    t.expect(errors.empty() && p.size() == 1, "every instruction assembles");
+    if (!p.empty()) {
+      const uint8_t tpose_bytes[] = {MACRO_TPOSE, 0xFD};
+      t.expect(memcmp(p[0].code.data() + 6, tpose_bytes, 2) == 0, "negative transpose is a signed byte");
+      std::string text = disassemble(p[0]);
+      std::istringstream again(text);
+      std::vector<Program> p2 = assemble(again, errors);
+      t.expect(errors.empty() && p2.size() == 1 && p2[0].code == p[0].code,
+               "disassembly reassembles to the same bytes");
+      t.expect(text.find("func vol_down") != std::string::npos, "EX function numbers disassemble to names");
+    }
+  }
+
+  // Bad source is rejected with the right line.
+  {
+    const char *bad[][2] = {
+      {"macro 1\nfunc 1\n", "2: EX function can't be run from a macro"},
+      {"macro 1\nfunc tpose_toggle\n", "2: unknown EX function tpose_toggle"},
+      {"macro 1\n\nmute buzz\n", "3: bad string mask or volume"},
+      {"macro 1\ncapo 3\n", "2: bad capo or auto-crank mode"},
+      {"macro 1\nload 5\n", "2: slot must be 1-4"},
+      {"macro 1\nvolume all 128\n", "2: expected: volume <strings> <0-127>"},
+      {"macro 7\n", "1: expected: macro <1-6>"},
+      {"wait 5\n", "1: instruction before the first \"macro\" line"},
+      {"macro 1\nramp all 0\n", "2: can't understand \"ramp\" with 2 operand(s)"},
+    };
+    for (auto &c : bad) {
+      std::istringstream in(c[0]);
+      std::vector<std::string> errors;
+      assemble(in, errors);
+      t.expect(errors.size() == 1 && errors[0] == c[1], std::string("rejects: ") + c[1]);
+    }
+
+    std::string big = "macro 1\n";
+    for (int x = 0; x < 7; x++) {
+      big += "ramp all 0 10\n";
+    }
+    std::istringstream in(big);
+    std::vector<std::string> errors;
+    assemble(in, errors);
+    t.expect(errors.size() == 1 && errors[0].find("8: macro 1 is longer than") == 0, "rejects a macro over MACRO_SIZE");
+  }
+
+  // The engine refuses what the gurdy could find in EEPROM.
+  {
+    const char *error;
+    int at;
+    uint8_t blank[MACRO_SIZE];
+    memset(blank, 0xFF, sizeof(blank));
+    t.expect(!macro_check(blank, MACRO_SIZE, &error, &at) && at == 0, "erased EEPROM doesn't check out");
+    uint8_t cut[MACRO_SIZE];
+    for (int x = 0; x < MACRO_SIZE - 2; x += 2) {
+      cut[x] = MACRO_FUNC;
+      cut[x + 1] = 9;
+    }
+    cut[MACRO_SIZE - 2] = MACRO_RAMP;
+    cut[MACRO_SIZE - 1] = MACRO_ALL;
+    t.expect(!macro_check(cut, MACRO_SIZE, &error, &at), "an instruction cut off by the end doesn't check out");
+    uint8_t slot_func[] = {MACRO_FUNC, 17, MACRO_END};
+    t.expect(!macro_check(slot_func, 3, &error, &at), "EX functions needing a button's slot don't check out");
+  }
+
+  // The budget: instant instructions run at most budget a loop().
+  {
+    Program p;
+    for (int x = 0; x < 10; x++) {
+      p.code.insert(p.code.end(), {MACRO_FUNC, 9});
+    }
+    SimGurdy g;
+    RunResult r = simulate(g, program_image(p), 2, 10);
+    t.expect(r.finished && r.most_per_loop == 2 && r.loops == 6 && g.tpose == 10,
+             "10 instructions at budget 2 take 5 loop()s and finish on the 6th");
+    SimGurdy g1;
+    RunResult r1 = simulate(g1, program_image(p), 1, 10);
+    t.expect(r1.most_per_loop == 1 && r1.loops == 11, "budget 1 runs one instruction a loop()");
+  }
+
+  // WAIT hands back to loop() and resumes on time.
+  {
+    std::istringstream in("macro 1\ncrank on\nwait 500\ncrank off\n");
+    std::vector<std::string> errors;
+    std::vector<Program> p = assemble(in, errors);
+    SimGurdy g;
+    RunResult r = simulate(g, program_image(p[0]), 2, 1000);
+    t.expect(r.finished && !g.autocrank && r.most_per_loop <= 2 && r.loops == 502,
+             "wait 500 at 1ms loop()s resumes at 500ms");
+    t.expect(g.log.str().find("  500.000ms  auto-crank off") != std::string::npos, "auto-crank turns off at 500ms");
+  }
+
+  // RAMP moves in a straight line, finishes exactly on the target and re-strikes once.
+  {
+    std::istringstream in("macro 1\nvolume drone 100\nramp drone+tromp 0 1000\n");
+    std::vector<std::string> errors;
+    std::vector<Program> p = assemble(in, errors);
+    SimGurdy g;
+    g.volumes[3] = 50;
+    simulate(g, program_image(p[0]), 2, 1000, 501);
+    t.expect(g.volumes[2] == 50 && g.volumes[3] == 25, "halfway through a ramp each string is halfway");
+    SimGurdy g2;
+    RunResult r2 = simulate(g2, program_image(p[0]), 2, 1000);
+    t.expect(r2.finished && g2.volumes[2] == 0 && g2.volumes[3] == 0 && g2.volume_done_calls == 2,
+             "a ramp ends on its volume and re-strikes once");
+    t.expect(r2.end_us == 1001000, "a 1000ms ramp ends at 1000ms");
+  }
+
+  // A zero-length ramp is an immediate volume change.
+  {
+    uint8_t code[] = {MACRO_RAMP, MACRO_ALL, 64, 0, 0};
+    Program p;
+    p.code.assign(code, code + sizeof(code));
+    SimGurdy g;
+    RunResult r = simulate(g, program_image(p), 2, 10);
+    t.expect(r.finished && r.loops == 1 && g.volumes[5] == 64, "ramp over 0ms is immediate");
+  }
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: macro_asm asm <in.mac> [out.txt]\n"
+               "       macro_asm disasm <config.txt>\n"
+               "       macro_asm run <in.mac> <macro> [--budget N] [--loop-us N] [--verbose]\n"
+               "       macro_asm test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  if (cmd == "asm" && argc >= 3) {
+    return cmd_asm(argv[2], argc >= 4 ? argv[3] : "");
+  } else if (cmd == "disasm" && argc >= 3) {
+    return cmd_disasm(argv[2]);
+  } else if (cmd == "test") {
+    return cmd_test();
+  } else if (cmd == "run" && argc >= 4) {
+    int budget = 2;
+    uint32_t loop_us = 10;
+    bool verbose = false;
+    for (int x = 4; x < argc; x++) {
+      std::string a = argv[x];
+      if (a == "--budget" && x + 1 < argc) {
+        budget = atoi(argv[++x]);
+      } else if (a == "--loop-us" && x + 1 < argc) {
+        loop_us = strtoul(argv[++x], nullptr, 10);
+      } else if (a == "--verbose") {
+        verbose = true;
+      } else {
+        usage();
+        return 2;
+      }
+    }
+    if (budget < 1 || loop_us < 1) {
+      usage();
+      return 2;
+    }
+    return cmd_run(argv[2], atoi(argv[3]), budget, loop_us, verbose);
+  }
+
+  usage();
+  return 2;
+}
@@ -0,0 +1,70 @@
+// The work-stealing thread pool shared by the host tools that run many independent jobs (crank_sweep,
+// stress_batch).
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A work-stealing pool.  Each worker takes tasks from the back of its own queue and, when that runs dry,
+// steals from the front of the others'.  Tasks are small and uneven (sessions differ in length), so this
+// keeps every core busy until the end without one shared queue becoming a bottleneck.
+class StealingPool {
+  private:
+    struct Worker {
+      std::mutex lock;
+      std::deque<size_t> tasks;
+    };
+    std::vector<Worker> workers;
+
+    bool pop(size_t self, size_t &task) {
+      {
+        std::lock_guard<std::mutex> g(workers[self].lock);
+        if (!workers[self].tasks.empty()) {
+          task = workers[self].tasks.back();
+          workers[self].tasks.pop_back();
+          return true;
+        }
+      }
+      for (size_t x = 1; x < workers.size(); x++) {
+        Worker &victim = workers[(self + x) % workers.size()];
+        std::lock_guard<std::mutex> g(victim.lock);
+        if (!victim.tasks.empty()) {
+          task = victim.tasks.front();
+          victim.tasks.pop_front();
+          return true;
+        }
+      }
+      return false;
+    }
+
+  public:
+    StealingPool(size_t threads) : workers(threads) {}
+
+    /// @brief Runs fn(task) for every task in 0..count-1, handed out in contiguous blocks.
+    template <class F>
+    void run(size_t count, F fn) {
+      size_t n = workers.size();
+      for (size_t t = 0; t < count; t++) {
+        workers[t * n / count].tasks.push_back(t);
+      }
+
+      std::vector<std::thread> threads;
+      for (size_t w = 0; w < n; w++) {
+        threads.emplace_back([this, w, &fn]() {
+          size_t task;
+          while (pop(w, task)) {
+            fn(task);
+          }
+        });
+      }
+      for (std::thread &t : threads) {
+        t.join();
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,308 @@
+// sd_tunings: checks a copy of the SD card tuning library the way the gurdy indexes it at startup.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -o sd_tunings tools/sd_tunings.cpp
+//
+// Usage:
+//
+//   sd_tunings check DIR [--list]   Index the tuning files in DIR (a copy of the card's /tunings) and report
+//                                   lines that aren't tunings, tunings listed once for being in twice, and
+//                                   different tunings sharing a name.  --list prints the catalog in menu order.
+//   sd_tunings test                 Index a generated 1,000-tuning library and load every tuning back from it
+//
+// Indexing, de-duplication and sorting are sd_catalog.h, the code the gurdy runs.  The gurdy takes the files in
+// the card's directory order and this takes them in name order, so when the same tuning is in two files the
+// copy kept may differ.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../sd_catalog.h"
+#include "tool_test.h"
+
+// As config.h.
+const int SD_MAX_TUNINGS = 1024;
+const int SD_MAX_TUNING_FILES = 32;
+const int SD_TUNING_FILENAME_LEN = 31;
+const int SD_TUNING_LINE_LEN = 80;
+
+// A file as sd_catalog.h reads it.
+struct HostFile {
+  FILE *f;
+
+  int read() {
+    return fgetc(f);
+  }
+
+  uint32_t position() {
+    return (uint32_t)ftell(f);
+  }
+};
+
+// The library, as the gurdy holds it.
+struct Library {
+  std::vector<SDTuningEntry> catalog = std::vector<SDTuningEntry>(SD_MAX_TUNINGS);
+  int count = 0;
+  std::vector<std::string> files;
+  std::vector<std::string> problems;
+  int skipped_same = 0;
+};
+
+static const char *problem_text(SDAddResult result) {
+  switch (result) {
+    case SD_ADDED_SAME_NAME:
+      return "has the same name as";
+    case SD_SKIPPED_SAME:
+      return "is listed once, the same as";
+    case SD_SKIPPED_FULL:
+      return "is left out: the catalog is full";
+    default:
+      return "isn't a tuning";
+  }
+}
+
+// Indexes the files in dir as sd_tunings_begin() does.
+static bool index_dir(const std::string &dir, Library &lib, std::string &err) {
+  std::error_code ec;
+  std::vector<std::string> names;
+  for (const auto &e : std::filesystem::directory_iterator(dir, ec)) {
+    std::string name = e.path().filename().string();
+    if (!e.is_directory() && (int)name.size() <= SD_TUNING_FILENAME_LEN && name[0] != '.') {
+      names.push_back(name);
+    }
+  }
+  if (ec) {
+    err = "can't read " + dir;
+    return false;
+  }
+  std::sort(names.begin(), names.end());
+
+  for (const std::string &name : names) {
+    if ((int)lib.files.size() >= SD_MAX_TUNING_FILES || lib.count >= SD_MAX_TUNINGS) {
+      lib.problems.push_back(name + " is left out: the gurdy reads " + std::to_string(SD_MAX_TUNING_FILES) +
+                             " files and " + std::to_string(SD_MAX_TUNINGS) + " tunings");
+      continue;
+    }
+    HostFile f = {fopen((dir + "/" + name).c_str(), "rb")};
+    if (!f.f) {
+      err = "can't open " + dir + "/" + name;
+      return false;
+    }
+    uint8_t file_idx = (uint8_t)lib.files.size();
+    lib.files.push_back(name);
+
+    auto report = [&](uint16_t line, SDAddResult result, int other) {
+      if (result == SD_SKIPPED_SAME) {
+        lib.skipped_same++;
+      }
+      std::string text = name + ":" + std::to_string(line) + " " + problem_text(result);
+      if (other >= 0) {
+        text += " " + lib.files[lib.catalog[other].file_idx] + ":" + std::to_string(lib.catalog[other].line);
+      }
+      lib.problems.push_back(text);
+    };
+    sd_catalog_index<SD_TUNING_LINE_LEN>(f, file_idx, lib.catalog.data(), &lib.count, SD_MAX_TUNINGS, report);
+    fclose(f.f);
+  }
+
+  sd_catalog_sort(lib.catalog.data(), lib.count);
+  return true;
+}
+
+// Loads a catalogued tuning from its file, as sd_read_tuning() does.
+static bool load_tuning(const std::string &dir, const Library &lib, int idx, int *tunings, std::string &name) {
+  const SDTuningEntry &e = lib.catalog[idx];
+  HostFile f = {fopen((dir + "/" + lib.files[e.file_idx]).c_str(), "rb")};
+  if (!f.f) {
+    return false;
+  }
+  char line[SD_TUNING_LINE_LEN];
+  char *parsed;
+  bool ok = fseek(f.f, e.offset, SEEK_SET) == 0 && sd_read_line(f, line, SD_TUNING_LINE_LEN) >= 0 &&
+            sd_parse_line(line, &parsed, tunings);
+  fclose(f.f);
+  if (ok) {
+    name = parsed;
+  }
+  return ok;
+}
+
+static int cmd_check(const std::string &dir, bool list) {
+  Library lib;
+  std::string err;
+  if (!index_dir(dir, lib, err)) {
+    std::cerr << err << "\n";
+    return 1;
+  }
+
+  for (const std::string &p : lib.problems) {
+    std::cout << p << "\n";
+  }
+  if (list) {
+    for (int x = 0; x < lib.count; x++) {
+      const SDTuningEntry &e = lib.catalog[x];
+      printf("%4d  %-23s  %s:%d\n", x + 1, e.name, lib.files[e.file_idx].c_str(), e.line);
+    }
+  }
+  printf("%d tunings from %d files.\n", lib.count, (int)lib.files.size());
+  return 0;
+}
+
+// A random tuning line for the generated library.
+static std::string random_tuning(std::mt19937 &rng, const std::string &name, int *values) {
+  std::uniform_int_distribution<int> note(36, 84), tpose(-12, 12), capo(0, 2);
+  for (int x = 0; x < 5; x++) {
+    values[x] = note(rng);
+  }
+  values[5] = tpose(rng);
+  values[6] = capo(rng) * 2;
+
+  std::string line = name;
+  for (int x = 0; x < 7; x++) {
+    line += "," + std::to_string(values[x]);
+  }
+  return line;
+}
+
+// The known cases for "sd_tunings test".
+static int cmd_test() {
+  ToolTest t;
+
+  // The line format.
+  {
+    char ok_line[] = "Test,67,55,50,62,50,-2,4";
+    char odd_capo[] = "Test,67,55,50,62,50,0,3";
+    char high_note[] = "Test,128,55,50,62,50,0,0";
+    char short_line[] = "Test,67,55,50,62,50,0";
+    char *name;
+    int v[7];
+    t.expect(sd_parse_line(ok_line, &name, v) && std::string(name) == "Test" && v[0] == 67 && v[5] == -2 && v[6] == 4,
+             "a tuning line parses");
+    t.expect(!sd_parse_line(odd_capo, &name, v), "an odd capo is rejected, as cycle_capo() never sets one");
+    t.expect(!sd_parse_line(high_note, &name, v), "a note over 127 is rejected");
+    t.expect(!sd_parse_line(short_line, &name, v), "a line missing a value is rejected");
+  }
+
+  // A generated 1,000-tuning library in 10 files, with a comment, a blank line, a CRLF line and an over-long
+  // line in each, one tuning repeated in a second file and one name shared by two different tunings.
+  std::string dir = t.tempDir("sd_tunings");
+  if (dir.empty()) {
+    return 1;
+  }
+  const int files = 10;
+  const int per_file = 100;
+  std::mt19937 rng(76);
+  std::vector<std::vector<int>> want(files * per_file, std::vector<int>(7));
+  std::vector<std::string> want_names(files * per_file);
+  for (int f = 0; f < files; f++) {
+    char path[300];
+    snprintf(path, sizeof(path), "%s/library%02d.txt", dir.c_str(), f);
+    FILE *out = fopen(path, "wb");
+    fprintf(out, "# Generated tunings %d\n\n", f);
+    for (int x = 0; x < per_file; x++) {
+      int idx = f * per_file + x;
+      char name[32];
+      snprintf(name, sizeof(name), "Tuning %04d", idx);
+      want_names[idx] = name;
+      fprintf(out, "%s%s", random_tuning(rng, name, want[idx].data()).c_str(), (x == 50) ? "\r\n" : "\n");
+    }
+    fprintf(out, "%s,67,55,50,62,50,0,0\n", std::string(90, 'x').c_str());
+    fclose(out);
+  }
+  {
+    FILE *out = fopen((dir + "/library10.txt").c_str(), "wb");
+    std::string repeat = want_names[5];
+    for (int x = 0; x < 7; x++) {
+      repeat += "," + std::to_string(want[5][x]);
+    }
+    fprintf(out, "%s\n", repeat.c_str());
+    fprintf(out, "%s,%d,55,50,62,50,0,0\n", want_names[7].c_str(), (want[7][0] == 60) ? 61 : 60);
+    fclose(out);
+  }
+
+  Library lib;
+  std::string err;
+  auto start = std::chrono::steady_clock::now();
+  bool indexed = index_dir(dir, lib, err);
+  double index_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  t.expect(indexed, "the library indexes");
+  t.expect(lib.count == files * per_file + 1, "every tuning is listed, and the renamed one too");
+  t.expect(lib.skipped_same == 1, "a tuning repeated in another file is listed once");
+
+  int bad = 0;
+  bool same_name = false;
+  for (const std::string &p : lib.problems) {
+    bad += p.find("isn't a tuning") != std::string::npos;
+    same_name = same_name || p == "library10.txt:2 has the same name as library00.txt:10";
+  }
+  t.expect(bad == files, "a line cut off at the line length is reported, not listed");
+  t.expect(same_name, "different tunings with the same name are reported by file and line");
+
+  bool sorted = true;
+  for (int x = 1; x < lib.count; x++) {
+    sorted = sorted && sd_compare_entries(&lib.catalog[x - 1], &lib.catalog[x]) < 0;
+  }
+  t.expect(sorted, "the catalog is in key, then name order");
+
+  // Every tuning loads back from its offset with the values it was written with.
+  start = std::chrono::steady_clock::now();
+  bool loaded = true;
+  int found = 0;
+  for (int x = 0; x < lib.count; x++) {
+    int v[7];
+    std::string name;
+    loaded = loaded && load_tuning(dir, lib, x, v, name);
+    int idx = atoi(name.c_str() + 7);
+    if (loaded && lib.catalog[x].file_idx < files) {
+      found++;
+      loaded = name == want_names[idx] && std::equal(v, v + 7, want[idx].begin());
+    }
+  }
+  double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  t.expect(loaded && found == files * per_file, "every tuning loads back from its offset unchanged");
+  printf("        indexed in %.1fms, %d loads in %.1fms\n", index_ms, lib.count, load_ms);
+
+  // More than the catalog holds.
+  {
+    FILE *out = fopen((dir + "/library11.txt").c_str(), "wb");
+    for (int x = 0; x < 100; x++) {
+      int v[7];
+      fprintf(out, "%s\n", random_tuning(rng, "Extra " + std::to_string(x), v).c_str());
+    }
+    fclose(out);
+    Library full;
+    index_dir(dir, full, err);
+    t.expect(full.count == SD_MAX_TUNINGS, "the catalog stops at SD_MAX_TUNINGS");
+  }
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: sd_tunings check DIR [--list]\n"
+               "       sd_tunings test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  if (cmd == "check" && (argc == 3 || (argc == 4 && std::string(argv[3]) == "--list"))) {
+    return cmd_check(argv[2], argc == 4);
+  } else if (cmd == "test" && argc == 2) {
+    return cmd_test();
+  }
+  usage();
+  return 2;
+}
@@ -0,0 +1,769 @@
+// sf2_wavpack: renders a soundfont into a WAV Trigger or Tsunami sound pack.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread -o sf2_wavpack tools/sf2_wavpack.cpp
+//
+// Usage:
+//
+//   sf2_wavpack --list soundfont.sf2
+//   sf2_wavpack [options] soundfont.sf2 outdir
+//
+//   --format trigger|tsunami   File naming for the unit, default trigger
+//   --tunings FILE             Tunings to cover, in the SD card tuning format (repeatable).  Default: the
+//                              four built-in presets
+//   --preset CH=BANK:PROG      The soundfont preset for a string's channel.  Default: program CH-1 of
+//                              bank 0 if there is one, otherwise the soundfont's first preset
+//   --keys N                   Keybox keys, default 24 (num_keys in config.h)
+//   --no-gros                  Leave out the notes only the gros (second drone) modes play
+//   --all-notes                Render every note 1-127 on every channel instead
+//   --seconds S                About how long each file is, default 4
+//   --fade CH=MS               Fade a channel's sound in, default 5=50 (soften the buzz attack)
+//   --gain DB                  Output gain, default 0
+//   --mono                     Mono files, for Tsunami mono firmware
+//   --threads N                Worker threads, default all cores
+//
+// The gurdy plays note N of the string on MIDI channel C as track N + 128 * (C - 1) (see GurdyString), and
+// the units find a track by the number at the start of its file name: 067_hi_melody_G4.wav on a WAV Trigger,
+// 0067_hi_melody_G4.wav on a Tsunami.  Copy the files to the root of the unit's microSD card.
+//
+// Only the notes each string can reach are rendered.  For each tuning that is the open note, plus any key
+// for the melody strings, plus any transpose (+/-12) and, for the drone, trompette and buzz, capo (0-4), plus
+// an octave below for the gros modes.  The key click only ever plays its fixed note, transposed.
+//
+// Each file plays the note's attack and then its sustain loop, repeated to fill the length, with a 'smpl'
+// chunk marking the loop.  The loop is resampled to a whole number of frames (nudging the pitch by a
+// fraction of a cent), so it repeats without a click.  The gurdy loops every track, which restarts the file
+// from its attack on these units; a longer --seconds makes that less frequent.  Volume envelopes and
+// filters are not rendered: the gurdy fades notes out itself.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The strings, by MIDI channel (as created in digigurdy-baz.ino).
+struct StringInfo {
+  int channel;
+  const char *name;       // For file names
+  bool melody;            // Plays with the keybox
+  bool capo;              // Follows the capo
+};
+
+const StringInfo STRINGS[] = {
+  {1, "hi_melody", true, false},
+  {2, "low_melody", true, false},
+  {3, "trompette", false, true},
+  {4, "drone", false, true},
+  {5, "buzz", false, true},
+  {6, "key_click", false, false},
+};
+
+const int STRING_COUNT = 6;
+const int KEYCLICK_NOTE = 83;    // B5, the key click's fixed note
+const int MAX_TPOSE = 12;        // max_tpose in digigurdy-baz.ino
+const int MAX_CAPO = 4;          // max_capo in digigurdy-baz.ino
+const int GROS_DROP = 12;        // The lowest gros mode sounds an octave below
+const int OUT_RATE = 44100;      // Both units play 44.1kHz, 16-bit files
+
+// One tuning: hi_mel, lo_mel, drone, tromp, buzz, tpose, capo, as default_tunings.h.
+struct Tuning {
+  std::string name;
+  int v[7];
+};
+
+// A copy of the presets in default_tunings.h, which can't be included here.
+const Tuning DEFAULT_TUNINGS[] = {
+  {"G/C-Sol/Do, G-Sol Drone", {67, 55, 43, 55, 67, 0, 0}},
+  {"G/C-Sol/Do, C-Do Drone", {67, 55, 36, 60, 60, 0, 0}},
+  {"D/G-Re/Sol, D-Re Drone", {74, 62, 50, 62, 62, 0, 0}},
+  {"D/G-Re/Sol, G-Sol Drone", {74, 62, 43, 62, 62, 0, 0}},
+};
+
+// ---- Soundfont reading ----
+
+// The generators this tool uses, by their SF2 numbers.
+enum SF2Gen {
+  GEN_START_OFS = 0,
+  GEN_END_OFS = 1,
+  GEN_LOOP_START_OFS = 2,
+  GEN_LOOP_END_OFS = 3,
+  GEN_START_COARSE_OFS = 4,
+  GEN_END_COARSE_OFS = 12,
+  GEN_PAN = 17,
+  GEN_INSTRUMENT = 41,
+  GEN_KEY_RANGE = 43,
+  GEN_VEL_RANGE = 44,
+  GEN_LOOP_START_COARSE_OFS = 45,
+  GEN_ATTENUATION = 48,
+  GEN_LOOP_END_COARSE_OFS = 50,
+  GEN_COARSE_TUNE = 51,
+  GEN_FINE_TUNE = 52,
+  GEN_SAMPLE_ID = 53,
+  GEN_SAMPLE_MODES = 54,
+  GEN_SCALE_TUNING = 56,
+  GEN_ROOT_KEY = 58,
+  GEN_COUNT = 61
+};
+
+// A zone's generators.  set[] says which were given; unset ones fall back to the global zone.
+struct SF2Zone {
+  int16_t gen[GEN_COUNT];
+  bool set[GEN_COUNT];
+
+  SF2Zone() {
+    memset(gen, 0, sizeof(gen));
+    memset(set, 0, sizeof(set));
+  }
+
+  int lo(int g) const { return (uint16_t)gen[g] & 0xFF; }
+  int hi(int g) const { return ((uint16_t)gen[g] >> 8) & 0xFF; }
+};
+
+struct SF2Sample {
+  std::string name;
+  uint32_t start, end, loop_start, loop_end, rate;
+  int root;
+  int correction;    // Cents
+};
+
+struct SF2Preset {
+  std::string name;
+  int bank, program;
+  std::vector<SF2Zone> zones;    // Global zone (if any) merged into the others
+};
+
+struct SF2Instrument {
+  std::string name;
+  std::vector<SF2Zone> zones;
+};
+
+struct SoundFont {
+  std::vector<int16_t> data;
+  std::vector<SF2Sample> samples;
+  std::vector<SF2Instrument> instruments;
+  std::vector<SF2Preset> presets;
+};
+
+static uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t rd32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static std::string rdname(const uint8_t *p) {
+  return std::string((const char *)p, strnlen((const char *)p, 20));
+}
+
+// Builds the zones of one preset or instrument from its bag range.  A first zone without the terminal
+// generator (instrument or sample) is the global zone: its values become the defaults of the others.
+static std::vector<SF2Zone> sf2_zones(const std::vector<uint8_t> &bag, const std::vector<uint8_t> &gen,
+                                      int bag_first, int bag_last, int terminal) {
+  std::vector<SF2Zone> zones;
+  SF2Zone global;
+
+  for (int b = bag_first; b < bag_last; b++) {
+    int g0 = rd16(&bag[b * 4]);
+    int g1 = rd16(&bag[(b + 1) * 4]);
+    SF2Zone z;
+    for (int g = g0; g < g1 && (size_t)(g + 1) * 4 <= gen.size(); g++) {
+      int oper = rd16(&gen[g * 4]);
+      if (oper < GEN_COUNT) {
+        z.gen[oper] = (int16_t)rd16(&gen[g * 4 + 2]);
+        z.set[oper] = true;
+      }
+    }
+
+    if (!z.set[terminal]) {
+      if (b == bag_first) {
+        global = z;
+      }
+      continue;
+    }
+
+    for (int g = 0; g < GEN_COUNT; g++) {
+      if (!z.set[g] && global.set[g]) {
+        z.gen[g] = global.gen[g];
+        z.set[g] = true;
+      }
+    }
+    zones.push_back(z);
+  }
+  return zones;
+}
+
+static bool sf2_load(const std::string &path, SoundFont &sf, std::string &err) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    err = "can't open " + path;
+    return false;
+  }
+  std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) || memcmp(&file[8], "sfbk", 4)) {
+    err = path + " isn't a soundfont";
+    if (file.size() < 1024 && file.size() > 7 && !memcmp(&file[0], "version", 7)) {
+      err += " (it's a Git LFS pointer: run git lfs pull)";
+    }
+    return false;
+  }
+
+  std::map<std::string, std::vector<uint8_t>> chunks;
+  size_t pos = 12;
+  while (pos + 8 <= file.size()) {
+    std::string id((const char *)&file[pos], 4);
+    uint32_t len = rd32(&file[pos + 4]);
+    if (id == "LIST") {
+      pos += 12;    // Step into the list
+      continue;
+    }
+    if (pos + 8 + len > file.size()) {
+      break;
+    }
+    chunks[id].assign(file.begin() + pos + 8, file.begin() + pos + 8 + len);
+    pos += 8 + len + (len & 1);
+  }
+
+  const char *needed[] = {"smpl", "phdr", "pbag", "pgen", "inst", "ibag", "igen", "shdr"};
+  for (const char *id : needed) {
+    if (!chunks.count(id)) {
+      err = path + " has no " + id + " chunk";
+      return false;
+    }
+  }
+
+  const std::vector<uint8_t> &smpl = chunks["smpl"];
+  sf.data.resize(smpl.size() / 2);
+  for (size_t x = 0; x < sf.data.size(); x++) {
+    sf.data[x] = (int16_t)rd16(&smpl[x * 2]);
+  }
+
+  const std::vector<uint8_t> &shdr = chunks["shdr"];
+  for (size_t x = 0; x + 1 < shdr.size() / 46; x++) {    // The last record is the terminal "EOS"
+    const uint8_t *r = &shdr[x * 46];
+    SF2Sample s;
+    s.name = rdname(r);
+    s.start = rd32(r + 20);
+    s.end = rd32(r + 24);
+    s.loop_start = rd32(r + 28);
+    s.loop_end = rd32(r + 32);
+    s.rate = rd32(r + 36);
+    s.root = (r[40] > 127) ? 60 : r[40];
+    s.correction = (int8_t)r[41];
+    sf.samples.push_back(s);
+  }
+
+  const std::vector<uint8_t> &inst = chunks["inst"];
+  for (size_t x = 0; x + 1 < inst.size() / 22; x++) {
+    const uint8_t *r = &inst[x * 22];
+    SF2Instrument i;
+    i.name = rdname(r);
+    i.zones = sf2_zones(chunks["ibag"], chunks["igen"], rd16(r + 20), rd16(r + 22 + 20), GEN_SAMPLE_ID);
+    sf.instruments.push_back(i);
+  }
+
+  const std::vector<uint8_t> &phdr = chunks["phdr"];
+  for (size_t x = 0; x + 1 < phdr.size() / 38; x++) {
+    const uint8_t *r = &phdr[x * 38];
+    SF2Preset p;
+    p.name = rdname(r);
+    p.program = rd16(r + 20);
+    p.bank = rd16(r + 22);
+    p.zones = sf2_zones(chunks["pbag"], chunks["pgen"], rd16(r + 24), rd16(r + 38 + 24), GEN_INSTRUMENT);
+    sf.presets.push_back(p);
+  }
+  return true;
+}
+
+// ---- Rendering ----
+
+// One sample playing within a note: where it reads, how fast, and its level.
+struct Voice {
+  const SF2Sample *sample;
+  int64_t start, end, loop_start, loop_end;
+  bool loops;
+  double ratio;        // Input frames per output frame
+  double gain_l, gain_r;
+  int64_t loop_frame;  // First output frame inside the loop
+};
+
+static bool in_range(const SF2Zone &z, int g, int v) {
+  return !z.set[g] || (v >= z.lo(g) && v <= z.hi(g));
+}
+
+// Sets up the voices a preset plays for a note at velocity 127, as a synth would.
+static std::vector<Voice> note_voices(const SoundFont &sf, const SF2Preset &preset, int note) {
+  std::vector<Voice> voices;
+  const int vel = 127;
+
+  for (const SF2Zone &pz : preset.zones) {
+    if (!in_range(pz, GEN_KEY_RANGE, note) || !in_range(pz, GEN_VEL_RANGE, vel) ||
+        pz.gen[GEN_INSTRUMENT] >= (int)sf.instruments.size()) {
+      continue;
+    }
+    for (const SF2Zone &iz : sf.instruments[pz.gen[GEN_INSTRUMENT]].zones) {
+      if (!in_range(iz, GEN_KEY_RANGE, note) || !in_range(iz, GEN_VEL_RANGE, vel) ||
+          iz.gen[GEN_SAMPLE_ID] >= (int)sf.samples.size()) {
+        continue;
+      }
+      const SF2Sample &s = sf.samples[iz.gen[GEN_SAMPLE_ID]];
+
+      // Preset generators add to instrument ones.
+      auto sum = [&](int g) { return iz.gen[g] + (pz.set[g] ? pz.gen[g] : 0); };
+
+      Voice v;
+      v.sample = &s;
+      v.start = s.start + iz.gen[GEN_START_OFS] + 32768 * iz.gen[GEN_START_COARSE_OFS];
+      v.end = s.end + iz.gen[GEN_END_OFS] + 32768 * iz.gen[GEN_END_COARSE_OFS];
+      v.loop_start = s.loop_start + iz.gen[GEN_LOOP_START_OFS] + 32768 * iz.gen[GEN_LOOP_START_COARSE_OFS];
+      v.loop_end = s.loop_end + iz.gen[GEN_LOOP_END_OFS] + 32768 * iz.gen[GEN_LOOP_END_COARSE_OFS];
+      v.end = std::min<int64_t>(v.end, sf.data.size());
+      v.loops = (iz.gen[GEN_SAMPLE_MODES] & 1) && v.loop_start >= v.start && v.loop_end <= v.end &&
+                v.loop_end - v.loop_start >= 8;
+
+      int root = (iz.set[GEN_ROOT_KEY] && iz.gen[GEN_ROOT_KEY] >= 0) ? iz.gen[GEN_ROOT_KEY] : s.root;
+      int scale = iz.set[GEN_SCALE_TUNING] ? iz.gen[GEN_SCALE_TUNING] : 100;
+      double cents = (note - root) * scale + sum(GEN_COARSE_TUNE) * 100.0 + sum(GEN_FINE_TUNE) + s.correction;
+      v.ratio = pow(2.0, cents / 1200.0) * s.rate / OUT_RATE;
+
+      double atten_db = std::max(0, sum(GEN_ATTENUATION)) / 10.0;
+      double pan = std::clamp(sum(GEN_PAN) / 1000.0, -0.5, 0.5);    // -0.5 left .. 0.5 right
+      double level = pow(10.0, -atten_db / 20.0);
+      v.gain_l = level * cos((pan + 0.5) * M_PI / 2);
+      v.gain_r = level * sin((pan + 0.5) * M_PI / 2);
+      v.loop_frame = 0;
+      voices.push_back(v);
+    }
+  }
+  return voices;
+}
+
+// Reads a voice's sample at a whole input frame.  Inside the loop, frames either side wrap around it.
+static double voice_at(const SoundFont &sf, const Voice &v, int64_t i, bool looping) {
+  if (looping) {
+    int64_t len = v.loop_end - v.loop_start;
+    if (i < v.loop_start) {
+      i += len;
+    } else if (i >= v.loop_end) {
+      i -= len;
+    }
+  }
+  if (i < v.start || i >= v.end) {
+    return 0;
+  }
+  return sf.data[i] / 32768.0;
+}
+
+// Reads a voice at a fractional input position, with 4-point Hermite interpolation.  A looping voice wraps
+// positions past its loop back into it.
+static double voice_read(const SoundFont &sf, const Voice &v, double pos) {
+  bool looping = v.loops && pos >= v.loop_start;
+  if (looping) {
+    pos = v.loop_start + fmod(pos - v.loop_start, double(v.loop_end - v.loop_start));
+  }
+  int64_t i = (int64_t)floor(pos);
+  double f = pos - i;
+  double y0 = voice_at(sf, v, i - 1, looping), y1 = voice_at(sf, v, i, looping);
+  double y2 = voice_at(sf, v, i + 1, looping), y3 = voice_at(sf, v, i + 2, looping);
+  double c1 = 0.5 * (y2 - y0);
+  double c2 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+  double c3 = 0.5 * (y3 - y0) + 1.5 * (y1 - y2);
+  return ((c3 * f + c2) * f + c1) * f + y1;
+}
+
+struct RenderOptions {
+  double seconds = 4.0;
+  double gain = 1.0;
+  bool mono = false;
+};
+
+struct Rendered {
+  std::vector<int16_t> frames;    // Interleaved if stereo
+  int64_t loop_start = -1;        // Output frames, or -1 for no loop
+  int64_t loop_end = -1;          // Last frame of the loop
+  int clipped = 0;
+};
+
+// Renders one note.  If it loops, every voice is retuned (by well under a cent) so a whole number of its
+// loop cycles fills exactly the same number of output frames: the rendered loop then repeats seamlessly.
+static Rendered render_note(const SoundFont &sf, std::vector<Voice> voices, const RenderOptions &opt, int fade_frames) {
+  Rendered r;
+  int channels = opt.mono ? 1 : 2;
+  int64_t target = (int64_t)(opt.seconds * OUT_RATE);
+
+  int64_t loop_frames = 0;
+  for (Voice &v : voices) {
+    if (!v.loops) {
+      continue;
+    }
+    double cycle = (v.loop_end - v.loop_start) / v.ratio;
+    if (loop_frames == 0) {
+      double attack = (v.loop_start - v.start) / v.ratio;
+      double cycles = std::max(1.0, round((target - attack) / cycle));
+      loop_frames = std::max<int64_t>(1, llround(cycles * cycle));
+    }
+    double cycles = std::max(1.0, round(loop_frames / cycle));
+    v.ratio = cycles * (v.loop_end - v.loop_start) / loop_frames;
+    v.loop_frame = (int64_t)ceil((v.loop_start - v.start) / v.ratio);
+  }
+
+  int64_t length = 0;
+  if (loop_frames > 0) {
+    int64_t loop_from = 0;
+    for (const Voice &v : voices) {
+      if (v.loops) {
+        loop_from = std::max(loop_from, v.loop_frame);
+      }
+    }
+    r.loop_start = loop_from;
+    r.loop_end = loop_from + loop_frames - 1;
+    length = loop_from + loop_frames;
+  } else {
+    for (const Voice &v : voices) {
+      length = std::max<int64_t>(length, (int64_t)ceil((v.end - v.start) / v.ratio));
+    }
+    length = std::min(length, target);
+  }
+
+  r.frames.resize(length * channels);
+  for (int64_t f = 0; f < length; f++) {
+    double left = 0, right = 0;
+    for (const Voice &v : voices) {
+      double s = voice_read(sf, v, v.start + f * v.ratio);
+      left += s * v.gain_l;
+      right += s * v.gain_r;
+    }
+    double g = opt.gain;
+    if (f < fade_frames) {
+      g *= double(f) / fade_frames;
+    }
+
+    double out[2] = {left * g, right * g};
+    if (opt.mono) {
+      out[0] = (left + right) * 0.5 * M_SQRT2 * g;
+    }
+    for (int c = 0; c < channels; c++) {
+      double v = round(out[c] * 32767.0);
+      if (v > 32767 || v < -32768) {
+        r.clipped++;
+        v = std::clamp(v, -32768.0, 32767.0);
+      }
+      r.frames[f * channels + c] = (int16_t)v;
+    }
+  }
+  return r;
+}
+
+static void put16(std::string &b, uint16_t v) { b += char(v & 0xFF); b += char(v >> 8); }
+static void put32(std::string &b, uint32_t v) { put16(b, v & 0xFFFF); put16(b, v >> 16); }
+
+// Writes a 16-bit PCM WAV, with a 'smpl' chunk if the note loops.
+static bool write_wav(const std::string &path, const Rendered &r, int channels, int note) {
+  std::string fmt, smpl, out;
+  put16(fmt, 1);
+  put16(fmt, channels);
+  put32(fmt, OUT_RATE);
+  put32(fmt, OUT_RATE * channels * 2);
+  put16(fmt, channels * 2);
+  put16(fmt, 16);
+
+  if (r.loop_start >= 0) {
+    put32(smpl, 0);                                // Manufacturer
+    put32(smpl, 0);                                // Product
+    put32(smpl, 1000000000u / OUT_RATE);           // Sample period, ns
+    put32(smpl, note);                             // MIDI unity note
+    put32(smpl, 0);                                // Pitch fraction
+    put32(smpl, 0);                                // SMPTE format
+    put32(smpl, 0);                                // SMPTE offset
+    put32(smpl, 1);                                // Loops
+    put32(smpl, 0);                                // Sampler data
+    put32(smpl, 0);                                // Loop ID
+    put32(smpl, 0);                                // Forward loop
+    put32(smpl, r.loop_start);
+    put32(smpl, r.loop_end);
+    put32(smpl, 0);                                // Fraction
+    put32(smpl, 0);                                // Play count: forever
+  }
+
+  uint32_t data_len = r.frames.size() * 2;
+  uint32_t riff_len = 4 + 8 + fmt.size() + 8 + data_len + (smpl.empty() ? 0 : 8 + smpl.size());
+  out = "RIFF";
+  put32(out, riff_len);
+  out += "WAVEfmt ";
+  put32(out, fmt.size());
+  out += fmt;
+  if (!smpl.empty()) {
+    out += "smpl";
+    put32(out, smpl.size());
+    out += smpl;
+  }
+  out += "data";
+  put32(out, data_len);
+
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) {
+    return false;
+  }
+  for (int16_t s : r.frames) {
+    put16(out, s);
+  }
+  bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+  return fclose(f) == 0 && ok;
+}
+
+// ---- Note ranges ----
+
+static bool load_tunings(const std::string &path, std::vector<Tuning> &tunings, std::string &err) {
+  std::ifstream in(path);
+  if (!in) {
+    err = "can't open " + path;
+    return false;
+  }
+  std::string line;
+  int lineno = 0;
+  while (std::getline(in, line)) {
+    lineno++;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::stringstream ss(line);
+    Tuning t;
+    std::string field;
+    std::getline(ss, t.name, ',');
+    int n = 0;
+    while (n < 7 && std::getline(ss, field, ',')) {
+      t.v[n++] = atoi(field.c_str());
+    }
+    if (n < 7) {
+      err = path + ":" + std::to_string(lineno) + ": a tuning needs a name and seven values";
+      return false;
+    }
+    tunings.push_back(t);
+  }
+  return true;
+}
+
+// Adds every note a string can sound under a tuning.
+static void reachable_notes(const StringInfo &s, const Tuning &t, int keys, bool gros, std::set<int> &notes) {
+  int open;
+  switch (s.channel) {
+    case 1: open = t.v[0]; break;
+    case 2: open = t.v[1]; break;
+    case 3: open = t.v[3]; break;
+    case 4: open = t.v[2]; break;
+    case 5: open = t.v[4]; break;
+    default: open = KEYCLICK_NOTE; break;
+  }
+
+  int low = open - MAX_TPOSE;
+  int high = open + MAX_TPOSE + (s.melody ? keys : 0) + (s.capo ? MAX_CAPO : 0);
+  if (gros && s.channel != 6) {
+    low -= GROS_DROP;
+  }
+  for (int n = std::max(low, 1); n <= std::min(high, 127); n++) {
+    notes.insert(n);
+  }
+}
+
+static std::string note_name(int note) {
+  const char *names[] = {"C", "Cs", "D", "Ds", "E", "F", "Fs", "G", "Gs", "A", "As", "B"};
+  return names[note % 12] + std::to_string(note / 12 - 1);
+}
+
+struct Job {
+  int string;
+  int note;
+};
+
+int main(int argc, char **argv) {
+  std::vector<std::string> args;
+  std::vector<Tuning> tunings;
+  std::map<int, std::pair<int, int>> preset_for;
+  std::map<int, int> fade_ms = {{5, 50}};
+  RenderOptions opt;
+  bool list = false, tsunami = false, gros = true, all_notes = false;
+  int keys = 24;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int x = 1; x < argc; x++) {
+    std::string arg = argv[x];
+    bool has_val = x + 1 < argc;
+    int ch, a, b;
+
+    if (arg == "--list") {
+      list = true;
+    } else if (arg == "--format" && has_val) {
+      std::string f = argv[++x];
+      if (f != "trigger" && f != "tsunami") {
+        fprintf(stderr, "--format is trigger or tsunami\n");
+        return 2;
+      }
+      tsunami = (f == "tsunami");
+    } else if (arg == "--tunings" && has_val) {
+      std::string err;
+      if (!load_tunings(argv[++x], tunings, err)) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+      }
+    } else if (arg == "--preset" && has_val && sscanf(argv[x + 1], "%d=%d:%d", &ch, &a, &b) == 3) {
+      preset_for[ch] = {a, b};
+      x++;
+    } else if (arg == "--fade" && has_val && sscanf(argv[x + 1], "%d=%d", &ch, &a) == 2) {
+      fade_ms[ch] = a;
+      x++;
+    } else if (arg == "--keys" && has_val) {
+      keys = atoi(argv[++x]);
+    } else if (arg == "--no-gros") {
+      gros = false;
+    } else if (arg == "--all-notes") {
+      all_notes = true;
+    } else if (arg == "--seconds" && has_val) {
+      opt.seconds = std::max(0.1, atof(argv[++x]));
+    } else if (arg == "--gain" && has_val) {
+      opt.gain = pow(10.0, atof(argv[++x]) / 20.0);
+    } else if (arg == "--mono") {
+      opt.mono = true;
+    } else if (arg == "--threads" && has_val) {
+      threads = std::max(1, atoi(argv[++x]));
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "Unknown or incomplete option %s\n", arg.c_str());
+      return 2;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != (list ? 1u : 2u)) {
+    fprintf(stderr, "usage: sf2_wavpack --list soundfont.sf2\n"
+                    "       sf2_wavpack [options] soundfont.sf2 outdir\n");
+    return 2;
+  }
+
+  SoundFont sf;
+  std::string err;
+  if (!sf2_load(args[0], sf, err)) {
+    fprintf(stderr, "%s\n", err.c_str());
+    return 1;
+  }
+  if (sf.presets.empty()) {
+    fprintf(stderr, "%s has no presets\n", args[0].c_str());
+    return 1;
+  }
+
+  if (list) {
+    for (const SF2Preset &p : sf.presets) {
+      printf("%3d:%-3d  %s\n", p.bank, p.program, p.name.c_str());
+    }
+    return 0;
+  }
+
+  if (tunings.empty()) {
+    tunings.assign(std::begin(DEFAULT_TUNINGS), std::end(DEFAULT_TUNINGS));
+  }
+
+  // Choose each string's preset.
+  const SF2Preset *presets[STRING_COUNT];
+  for (int s = 0; s < STRING_COUNT; s++) {
+    int ch = STRINGS[s].channel;
+    std::pair<int, int> want = preset_for.count(ch) ? preset_for[ch] : std::make_pair(0, ch - 1);
+    presets[s] = nullptr;
+    for (const SF2Preset &p : sf.presets) {
+      if (p.bank == want.first && p.program == want.second) {
+        presets[s] = &p;
+      }
+    }
+    if (!presets[s]) {
+      if (preset_for.count(ch)) {
+        fprintf(stderr, "No preset %d:%d in %s (see --list)\n", want.first, want.second, args[0].c_str());
+        return 1;
+      }
+      presets[s] = &sf.presets[0];
+    }
+  }
+
+  std::vector<Job> jobs;
+  for (int s = 0; s < STRING_COUNT; s++) {
+    std::set<int> notes;
+    if (all_notes) {
+      for (int n = 1; n < 128; n++) {
+        notes.insert(n);
+      }
+    } else {
+      for (const Tuning &t : tunings) {
+        reachable_notes(STRINGS[s], t, keys, gros, notes);
+      }
+    }
+    printf("Channel %d %-11s %3zu notes (%s to %s) from %d:%d %s\n", STRINGS[s].channel, STRINGS[s].name, notes.size(),
+           note_name(*notes.begin()).c_str(), note_name(*notes.rbegin()).c_str(), presets[s]->bank,
+           presets[s]->program, presets[s]->name.c_str());
+    for (int n : notes) {
+      jobs.push_back({s, n});
+    }
+  }
+
+  std::filesystem::create_directories(args[1]);
+
+  // Notes take very different times (long attacks, slow loops), so workers take the next one as they
+  // free up rather than each getting a fixed share.
+  std::atomic<size_t> next(0);
+  std::atomic<uint64_t> bytes(0);
+  std::atomic<int> clipped(0), failed(0), silent(0);
+  std::mutex print_lock;
+
+  auto worker = [&]() {
+    for (size_t j = next++; j < jobs.size(); j = next++) {
+      const StringInfo &s = STRINGS[jobs[j].string];
+      int note = jobs[j].note;
+      int track = note + 128 * (s.channel - 1);
+
+      std::vector<Voice> voices = note_voices(sf, *presets[jobs[j].string], note);
+      if (voices.empty()) {
+        silent++;
+        continue;
+      }
+      int fade = fade_ms.count(s.channel) ? fade_ms[s.channel] * OUT_RATE / 1000 : 0;
+      Rendered r = render_note(sf, voices, opt, fade);
+
+      char name[96];
+      snprintf(name, sizeof(name), tsunami ? "%04d_%s_%s.wav" : "%03d_%s_%s.wav", track, s.name, note_name(note).c_str());
+      std::string path = (std::filesystem::path(args[1]) / name).string();
+      if (!write_wav(path, r, opt.mono ? 1 : 2, note)) {
+        std::lock_guard<std::mutex> g(print_lock);
+        fprintf(stderr, "Can't write %s\n", path.c_str());
+        failed++;
+        continue;
+      }
+      bytes += r.frames.size() * 2;
+      if (r.clipped) {
+        clipped++;
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; t++) {
+    pool.emplace_back(worker);
+  }
+  for (std::thread &t : pool) {
+    t.join();
+  }
+
+  printf("%zu files, %.1f MB, on %zu threads\n", jobs.size() - silent - failed, bytes / 1048576.0, threads);
+  if (silent) {
+    printf("%d notes have no sample in their preset and were skipped\n", (int)silent);
+  }
+  if (clipped) {
+    printf("%d files clipped: try a lower --gain\n", (int)clipped);
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,333 @@
+// stress_batch: plays many scripted sessions on modelled gurdies (stress_model.h) at once, across every core,
+// and sums up how the outputs kept up.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -pthread -o stress_batch tools/stress_batch.cpp
+//
+// Usage:
+//
+//   stress_batch run [options] session.play...   Play every session and print the totals
+//   stress_batch gen N DIR [--seed S]            Write N random sessions to DIR, for overnight runs
+//   stress_batch test                            Check that a batch gives the same results as one at a time
+//
+//   --threads N      Worker threads, default all cores
+//   --repeat N       Play each session N times (the model is deterministic; this is for timing)
+//   --csv FILE       Write each session's results
+//
+// The results are the model's (stress_model.h), not the firmware's.  "gurdy_host check-model" plays the same
+// sessions on the sketch's own code and compares the bytes each link is given, which is how drift between the
+// two shows up; the totals here are for trying many sessions, options and units quickly.
+//
+// The session format is in stress_model.h.  Each session gets its own StressModel, so the workers share
+// nothing and a session's results don't depend on what else is running.  Time in the model is virtual, so a
+// session plays as fast as a core can run it: the totals say how many times faster than real time that was.
+//
+// A key change's latency is from the key press until its last byte has gone out on MIDI-OUT and the
+// Trigger/Tsunami: the time spent waiting for the links, plus what was still queued ahead of it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pool.h"
+#include "stress_model.h"
+#include "tool_test.h"
+
+// The links' rates in bytes a second, as traffic.cpp has them.
+static const uint32_t link_rate[3] = {0, 31250 / 10, 57600 / 10};
+static const char *link_names[3] = {"USB", "MIDI", "Trig"};
+
+static uint32_t percentile(std::vector<uint32_t> &v, int pct) {
+  if (v.empty()) {
+    return 0;
+  }
+  size_t n = (v.size() - 1) * pct / 100;
+  std::nth_element(v.begin(), v.begin() + n, v.end());
+  return v[n];
+}
+
+static std::vector<PlayResult> run_all(const std::vector<PlaySession> &sessions, size_t repeat, size_t threads) {
+  std::vector<PlayResult> results(sessions.size() * repeat);
+  std::atomic<size_t> done(0);
+  size_t total = results.size();
+
+  StealingPool pool(threads);
+  pool.run(total, [&](size_t task) {
+    results[task] = play_session_run(sessions[task % sessions.size()]);
+    size_t n = ++done;
+    if (n % 256 == 0 || n == total) {
+      fprintf(stderr, "\r%zu/%zu", n, total);
+    }
+  });
+  fprintf(stderr, "\n");
+  return results;
+}
+
+static int cmd_run(int argc, char **argv) {
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t repeat = 1;
+  std::string csv_path;
+  std::vector<PlaySession> sessions;
+
+  for (int x = 2; x < argc; x++) {
+    std::string arg = argv[x];
+    bool has_val = x + 1 < argc;
+    if (arg == "--threads" && has_val) {
+      threads = std::max(1, atoi(argv[++x]));
+    } else if (arg == "--repeat" && has_val) {
+      repeat = std::max(1, atoi(argv[++x]));
+    } else if (arg == "--csv" && has_val) {
+      csv_path = argv[++x];
+    } else {
+      PlaySession s;
+      std::string err;
+      if (!play_load_session(arg, s, err)) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+      }
+      sessions.push_back(s);
+    }
+  }
+  if (sessions.empty()) {
+    fprintf(stderr, "No sessions.\n");
+    return 2;
+  }
+
+  fprintf(stderr, "Playing %zu sessions on %zu threads...\n", sessions.size() * repeat, threads);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<PlayResult> results = run_all(sessions, repeat, threads);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // The totals.
+  uint64_t played_ms = 0;
+  uint64_t keys = 0;
+  uint64_t bytes[3] = {0, 0, 0};
+  uint64_t dropped = 0;
+  uint64_t over_voices = 0;
+  int peak_voices = 0;
+  uint32_t loop_max_us = 0;
+  std::vector<uint32_t> latency;
+  for (const PlayResult &r : results) {
+    played_ms += r.ms;
+    keys += r.keys;
+    for (int l = 0; l < 3; l++) {
+      bytes[l] += r.bytes[l];
+    }
+    dropped += r.dropped;
+    over_voices += r.over_voices;
+    peak_voices = std::max(peak_voices, r.peak_voices);
+    loop_max_us = std::max(loop_max_us, r.loop_max_us);
+    latency.insert(latency.end(), r.latency_us.begin(), r.latency_us.end());
+  }
+
+  printf("%zu sessions, %.1f minutes of playing in %.2fs on %zu threads (%.0fx real time)\n", results.size(),
+         played_ms / 60000.0, wall, threads, played_ms / 1000.0 / std::max(wall, 1e-6));
+  printf("key changes %llu: latency p50 %.1fms p95 %.1fms p99 %.1fms max %.1fms\n", (unsigned long long)keys,
+         percentile(latency, 50) / 1000.0, percentile(latency, 95) / 1000.0, percentile(latency, 99) / 1000.0,
+         percentile(latency, 100) / 1000.0);
+  printf("traffic");
+  for (int l = 0; l < 3; l++) {
+    uint64_t per_sec = played_ms ? bytes[l] * 1000 / played_ms : 0;
+    printf(" %s %lluB/s", link_names[l], (unsigned long long)per_sec);
+    if (link_rate[l]) {
+      printf(" (%llu%%)", (unsigned long long)(per_sec * 100 / link_rate[l]));
+    }
+  }
+  printf("\n");
+  printf("dropped %llu, peak voices %d, key changes over the voice limit %llu, slowest pass %.1fms\n",
+         (unsigned long long)dropped, peak_voices, (unsigned long long)over_voices, loop_max_us / 1000.0);
+
+  if (!csv_path.empty()) {
+    FILE *csv = fopen(csv_path.c_str(), "w");
+    if (!csv) {
+      fprintf(stderr, "Can't write %s\n", csv_path.c_str());
+      return 1;
+    }
+    fprintf(csv, "session,ms,keys,latency_p50_us,latency_p95_us,latency_max_us,usb_bytes,midi_bytes,trigger_bytes,"
+                 "dropped,peak_voices,over_voices,loop_max_us\n");
+    for (size_t x = 0; x < results.size(); x++) {
+      PlayResult &r = results[x];
+      fprintf(csv, "%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%d,%u\n", sessions[x % sessions.size()].name.c_str(), r.ms,
+              r.keys, percentile(r.latency_us, 50), percentile(r.latency_us, 95), percentile(r.latency_us, 100),
+              r.bytes[0], r.bytes[1], r.bytes[2], r.dropped, r.peak_voices, r.over_voices, r.loop_max_us);
+    }
+    fclose(csv);
+  }
+  return 0;
+}
+
+// Writes a random session: the crank starting and stopping, with single keys and trills of every speed between.
+static std::string random_session(std::mt19937 &rng) {
+  auto pick = [&](int low, int high) { return std::uniform_int_distribution<int>(low, high)(rng); };
+  std::string s;
+  if (pick(0, 1)) {
+    s += "tsunami\n";
+  }
+  if (pick(0, 3) == 0) {
+    s += "gated\n";
+  }
+  if (pick(0, 2) == 0) {
+    s += "no-gros\n";
+  }
+  const char *legato[3] = {"off", "glide", "overlap"};
+  s += std::string("legato ") + legato[pick(0, 2)] + "\n";
+
+  uint32_t t = 0;
+  for (int phrase = pick(2, 6); phrase > 0; phrase--) {
+    s += "crank " + std::to_string(t) + " on\n";
+    t += pick(100, 500);
+    for (int figure = pick(3, 12); figure > 0; figure--) {
+      if (pick(0, 2) == 0) {
+        uint32_t len = pick(200, 2000);
+        int a = pick(0, 20);
+        s += "trill " + std::to_string(t) + " " + std::to_string(t + len) + " " + std::to_string(pick(4, 40)) + " " +
+             std::to_string(a) + " " + std::to_string(a + pick(1, 2)) + "\n";
+        t += len;
+      } else {
+        s += "key " + std::to_string(t) + " " + std::to_string(pick(0, 23)) + "\n";
+        t += pick(60, 600);
+      }
+    }
+    s += "crank " + std::to_string(t) + " off\n";
+    t += pick(200, 1500);
+  }
+  return s;
+}
+
+static int cmd_gen(int argc, char **argv) {
+  if (argc < 4) {
+    return 2;
+  }
+  int count = atoi(argv[2]);
+  std::string dir = argv[3];
+  unsigned seed = 1;
+  if (argc >= 6 && std::string(argv[4]) == "--seed") {
+    seed = (unsigned)strtoul(argv[5], nullptr, 10);
+  }
+
+  std::mt19937 rng(seed);
+  for (int x = 0; x < count; x++) {
+    char name[32];
+    snprintf(name, sizeof(name), "/session%05d.play", x);
+    FILE *f = fopen((dir + name).c_str(), "w");
+    if (!f) {
+      fprintf(stderr, "Can't write %s%s\n", dir.c_str(), name);
+      return 1;
+    }
+    fputs(random_session(rng).c_str(), f);
+    fclose(f);
+  }
+  return 0;
+}
+
+// The known cases for "stress_batch test".  These check the batch runner and the session format; whether the
+// model's messages are the firmware's is for "gurdy_host check-model".
+static int cmd_test() {
+  ToolTest t;
+
+  // A batch gives each session the result it gets alone.
+  {
+    const int count = 64;
+    std::mt19937 rng(7);
+    std::vector<PlaySession> sessions(count);
+    bool loaded = true;
+    for (int x = 0; x < count && loaded; x++) {
+      std::string path = t.tempFile("stress_batch", random_session(rng));
+      std::string err;
+      loaded = !path.empty() && play_load_session(path, sessions[x], err);
+    }
+    t.expect(loaded, "random sessions load");
+
+    std::vector<PlayResult> alone;
+    for (const PlaySession &s : sessions) {
+      alone.push_back(play_session_run(s));
+    }
+    std::vector<PlayResult> batch = run_all(sessions, 2, 8);
+    bool same = true;
+    for (size_t x = 0; x < batch.size(); x++) {
+      const PlayResult &a = alone[x % count];
+      const PlayResult &b = batch[x];
+      same = same && a.ms == b.ms && a.keys == b.keys && a.latency_us == b.latency_us && a.bytes[1] == b.bytes[1] &&
+             a.bytes[2] == b.bytes[2] && a.peak_voices == b.peak_voices && a.loop_max_us == b.loop_max_us;
+    }
+    t.expect(same, "a batch on 8 threads gives every session the same results as playing it alone");
+  }
+
+  // One session, worked through.
+  {
+    PlaySession s;
+    s.opt.gros = false;
+    s.events = {{0, 1, 0}, {1000, 0, 2}, {2000, 0, 0}, {3000, 2, 0}, {3500, 0, 5}};
+    PlayResult r = play_session_run(s);
+    t.expect(r.keys == 2, "keys pressed with the crank stopped don't count");
+    t.expect(r.ms == 4000, "the session ends 500ms after its last event");
+    t.expect(r.latency_us.size() == 2 && r.latency_us[0] > 0 && r.latency_us[0] < 20000,
+             "a lone key change goes out within 20ms");
+    t.expect(r.peak_voices <= 8, "no gros notes: at most 8 voices");
+
+    PlaySession fast = s;
+    fast.events = {{0, 1, 0}};
+    for (uint32_t ms = 500; ms < 2500; ms += 8) {
+      fast.events.push_back({ms, 0, (int)((ms / 8) % 2) + 1});
+    }
+    fast.opt.gros = true;
+    PlayResult f = play_session_run(fast);
+    std::vector<uint32_t> lat = f.latency_us;
+    t.expect(percentile(lat, 95) > percentile(r.latency_us, 95), "a 125/s trill with gros notes comes out later");
+    t.expect(f.over_voices > 0, "and needs more voices than a WAV Trigger has");
+  }
+
+  // The session format.
+  {
+    std::string path = t.tempFile("stress_batch", "# test\ntsunami\nlegato glide\ncrank 0 on\n"
+                                                  "trill 100 600 10 1 2\nkey 50 3\ncrank 700 off\n");
+    PlaySession s;
+    std::string err;
+    bool ok = play_load_session(path, s, err);
+    t.expect(ok && s.opt.tsunami && s.opt.legato == 1 && s.opt.gros, "options are read");
+    t.expect(ok && s.events.size() == 8 && s.events[1].ms == 50 && s.events[2].offset == 1 &&
+                 s.events[3].offset == 2,
+             "a trill is its key presses, in time order");
+
+    PlaySession bad;
+    path = t.tempFile("stress_batch", "crank 0 sideways\n");
+    t.expect(!play_load_session(path, bad, err) && err.find(":1:") != std::string::npos, "bad lines are reported");
+  }
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: stress_batch run [--threads N] [--repeat N] [--csv FILE] session.play...\n"
+               "       stress_batch gen N DIR [--seed S]\n"
+               "       stress_batch test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  int rc = 2;
+  if (cmd == "run") {
+    rc = cmd_run(argc, argv);
+  } else if (cmd == "gen") {
+    rc = cmd_gen(argc, argv);
+  } else if (cmd == "test") {
+    rc = cmd_test();
+  }
+  if (rc == 2) {
+    usage();
+  }
+  return rc;
+}
@@ -0,0 +1,217 @@
+// stress_host: estimates the gurdy's saturation test (Diagnostics -> Benchmarks -> Saturation Test) from a model.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -o stress_host tools/stress_host.cpp
+//
+// Usage:
+//
+//   stress_host run [options]    Model the test and print each rate and the ceiling, as the gurdy does
+//   stress_host test             Check the voice counting and verdicts, and the model against known link limits
+//
+// Options for run:
+//
+//   --tsunami          A Tsunami (18 voices, 10-byte commands) instead of a WAV Trigger (14 voices)
+//   --voices N         The unit's voices, e.g. 32 for the mono Tsunami firmware
+//   --gated            MIDI-OUT goes through the USE_OUTPUT_GATING queue instead of waiting for room
+//   --legato MODE      off, glide or overlap (see GurdyString::changeNote())
+//   --no-gros          No gros notes
+//   --all              Run every rate, not just up to the first failure
+//
+// The model (stress_model.h) sends the messages each key change makes, as GurdyString and key_change() send
+// them, then lets the links carry them at their baud rates a millisecond at a time: MIDI-OUT at 31250 baud, the
+// Trigger/Tsunami at 57600, each with the Teensy's 64-byte send buffer.  A full buffer makes the sender wait, and
+// that wait is the loop time reported: the rest of loop() isn't modelled, so run the test on the gurdy for the
+// real loop time.  Voices and verdicts come from stress.h, the code the gurdy runs.
+//
+// The result is an estimate: the messages are the model's idea of what the firmware sends, not the firmware's
+// ("gurdy_host check-model" compares the two).  It's quick to try options the gurdy would need rebuilding for.  For the firmware's own result, run the test on
+// the gurdy, or "gurdy_host stress", which runs it from the sketch's code on a computer.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "stress_model.h"
+#include "tool_test.h"
+
+struct Options : ModelOptions {
+  bool all = false;
+};
+
+static int cmd_run(const Options &opt) {
+  StressLimits lim = stress_model_limits(opt);
+  StressStep steps[STRESS_NUM_RATES];
+  int count = 0;
+  char line[200];
+
+  puts("Model estimate (stress_model.h), not the firmware's own test: see gurdy_host stress.");
+
+  int first_fail = -1;
+  for (int x = 0; x < STRESS_NUM_RATES; x++) {
+    steps[count++] = stress_model_rate(opt, STRESS_RATES[x]);
+    stress_format(steps[x], lim, line, sizeof(line));
+    puts(line);
+    if (stress_verdict(steps[x], lim) && first_fail < 0) {
+      first_fail = x;
+      if (!opt.all) {
+        break;
+      }
+    }
+  }
+  stress_format_ceiling(steps, (first_fail >= 0) ? first_fail + 1 : count, lim, line, sizeof(line));
+  puts(line);
+  return 0;
+}
+
+// The known cases for "stress_host test": the voice counts and verdicts are shared with the gurdy, so a slip
+// there misjudges the real test too, and the model's ceilings are checked against what the links can carry.
+static int cmd_test() {
+  ToolTest t;
+
+  // Voices.
+  {
+    StressVoices v;
+    v.play(0);
+    v.play(0);
+    v.fade(10);
+    t.expect(v.count(10) == 2, "a fading voice still counts");
+    t.expect(v.count(10 + STRESS_FADE_MS) == 1, "and is given back when the fade is done");
+    v.shot(300, 40);
+    t.expect(v.count(320) == 2, "a one-shot takes a voice");
+    t.expect(v.count(340) == 1, "until it has played through");
+    v.shot(400, 40);
+    v.stop();
+    t.expect(v.count(401) == 1, "or is stopped");
+    t.expect(v.peak == 2, "the peak is kept");
+    v.fade(500);
+    v.fade(500);
+    t.expect(v.count(500) == 1 && v.count(700) == 0, "fading more than are sounding does nothing");
+  }
+
+  // Verdicts.
+  {
+    StressLimits lim = {14, 1000};
+    StressStep s;
+    memset(&s, 0, sizeof(s));
+    s.rate = 8;
+    s.ms = 2000;
+    s.keys = 15;
+    s.peak_voices = 14;
+    s.loop_max_us = 1000;
+    s.backlog_end[STRESS_TRIGGER] = STRESS_BACKLOG_GROWTH;
+    t.expect(stress_verdict(s, lim) == nullptr, "at every limit, it passes");
+    s.backlog_start[STRESS_MIDI_OUT] = 100;
+    s.backlog_end[STRESS_MIDI_OUT] = 100 + STRESS_BACKLOG_GROWTH + 1;
+    t.expect(stress_verdict(s, lim) && !strcmp(stress_verdict(s, lim), "MIDI-OUT backlog"), "a growing backlog fails");
+    s.backlog_end[STRESS_MIDI_OUT] = 0;
+    s.peak_voices = 15;
+    t.expect(stress_verdict(s, lim) && !strcmp(stress_verdict(s, lim), "voices"), "too many voices fails");
+    s.peak_voices = 0;
+    s.loop_max_us = 1001;
+    t.expect(stress_verdict(s, lim) && !strcmp(stress_verdict(s, lim), "loop time"), "a slow pass fails");
+    lim.loop_budget_us = 0;
+    t.expect(stress_verdict(s, lim) == nullptr, "unless loop time isn't judged");
+    s.keys = 13;
+    t.expect(stress_verdict(s, lim) && !strcmp(stress_verdict(s, lim), "keys late"), "too few key changes fails");
+
+    StressStep steps[3];
+    memset(steps, 0, sizeof(steps));
+    steps[0].rate = 2;
+    steps[1].rate = 4;
+    steps[2].rate = 6;
+    steps[2].dropped = 1;
+    char line[100];
+    stress_format_ceiling(steps, 3, lim, line, sizeof(line));
+    t.expect(std::string(line) == "ceiling: 4 key changes/s (dropped at 6/s)", "the ceiling is the rate before");
+    stress_format_ceiling(steps, 2, lim, line, sizeof(line));
+    t.expect(std::string(line) == "ceiling: at least 4 key changes/s", "with no failure, it's at least the last");
+  }
+
+  // The model: slow trills pass, fast ones don't, and gating turns waiting into a backlog.
+  {
+    Options opt;
+    StressLimits lim = stress_model_limits(opt);
+    StressStep slow = stress_model_rate(opt, 2);
+    t.expect(stress_verdict(slow, lim) == nullptr, "2 key changes/s passes");
+    StressStep fast = stress_model_rate(opt, 64);
+    t.expect(stress_verdict(fast, lim) != nullptr, "64 key changes/s fails");
+    t.expect(fast.loop_max_us > STRESS_LOOP_BUDGET_US, "without gating, a full link makes the loop wait");
+
+    Options gated;
+    gated.gated = true;
+    StressStep g = stress_model_rate(gated, 64);
+    t.expect(g.bytes_per_sec[1] == fast.bytes_per_sec[1], "gating sends the same messages");
+
+    Options plain;
+    plain.gros = false;
+    plain.voices = 64;
+    StressStep p = stress_model_rate(plain, 128);
+    t.expect(p.keys < 128 * STRESS_STEP_MS / 1000 && p.bytes_per_sec[2] > 5700,
+             "at 128/s without gros notes the Trigger link is full and key changes fall behind");
+    const char *why = stress_verdict(p, stress_model_limits(plain));
+    t.expect(why && !strcmp(why, "keys late"), "which fails as keys late");
+
+    Options glide;
+    glide.legato = 1;
+    StressStep gl = stress_model_rate(glide, 16);
+    StressStep off = stress_model_rate(opt, 16);
+    t.expect(gl.bytes_per_sec[1] < off.bytes_per_sec[1], "glide sends less MIDI than note changes");
+  }
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: stress_host run [--tsunami] [--voices N] [--gated] [--legato off|glide|overlap] [--no-gros] [--all]\n"
+               "       stress_host test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  if (cmd == "test") {
+    return cmd_test();
+  } else if (cmd != "run") {
+    usage();
+    return 2;
+  }
+
+  Options opt;
+  for (int x = 2; x < argc; x++) {
+    std::string a = argv[x];
+    if (a == "--tsunami") {
+      opt.tsunami = true;
+    } else if (a == "--voices" && x + 1 < argc) {
+      opt.voices = atoi(argv[++x]);
+    } else if (a == "--gated") {
+      opt.gated = true;
+    } else if (a == "--legato" && x + 1 < argc) {
+      std::string m = argv[++x];
+      if (m == "off") {
+        opt.legato = 0;
+      } else if (m == "glide") {
+        opt.legato = 1;
+      } else if (m == "overlap") {
+        opt.legato = 2;
+      } else {
+        usage();
+        return 2;
+      }
+    } else if (a == "--no-gros") {
+      opt.gros = false;
+    } else if (a == "--all") {
+      opt.all = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  return cmd_run(opt);
+}
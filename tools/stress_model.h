@@ -0,0 +1,513 @@
+// A model of the gurdy's outputs, shared by the host tools.
+//
+// One StressModel is one gurdy: the messages its strings send on MIDI-OUT, USB and the Trigger/Tsunami as
+// GurdyString and key_change() send them, the links carrying them at their baud rates, and the unit's voices
+// (see stress.h).  Time is virtual, a millisecond at a time, so a model runs as fast as the computer allows.
+// All of a model's state is in the object, so any number can run at once, one per thread.
+//
+// It is a model, written from gurdystring.cpp and play_functions.cpp rather than built from them, so it can drift
+// from the firmware when they change.  "gurdy_host check-model" plays session scripts on both and compares the
+// bytes each link is given: run it after changing what the strings send.  It checks the messages, not the timing
+// (the model's links and waits are its own), and only for the unit the sketch is built for.
+//
+// A link whose send buffer is full makes the sender wait, as the Teensy's serial ports do, and time passes
+// while it waits.  MIDI-OUT can instead go through the USE_OUTPUT_GATING queue, which never waits.
+
+#ifndef STRESS_MODEL_H
+#define STRESS_MODEL_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../stress.h"
+
+// As config.h.
+const int KEYCLICK_MS = 40;
+const uint32_t STRESS_STEP_MS = 2000;
+const uint32_t STRESS_LOOP_BUDGET_US = 10000;
+const int SINK_QUEUE_SIZE = 256;
+const int LEGATO_BEND_RANGE = 2;
+
+// The Teensy's serial send buffers.
+const int TX_BUFFER = 64;
+
+// How long the gurdy lets the crank start go out before each rate (stress_settle() in benchmarks.cpp).
+const uint32_t STRESS_WARMUP_MS = 500;
+
+struct ModelOptions {
+  bool tsunami = false;
+  int voices = 0;           // The unit's voices, 0 for the unit's own
+  bool gated = false;
+  int legato = 0;           // 0 off, 1 glide, 2 overlap
+  bool gros = true;
+};
+
+// A slow serial link.
+struct ModelLink {
+  int bytes_per_sec;
+  int buffered = 0;         // In the port's send buffer
+  int queued = 0;           // In GatedSerial's queue
+  int carry = 0;            // Bytes sent, in thousandths
+  uint32_t sent = 0;
+  uint32_t dropped = 0;
+
+  ModelLink(int rate) : bytes_per_sec(rate) {}
+
+  int backlog() const {
+    return buffered + queued;
+  }
+
+  // How long until everything waiting has gone out, in us.
+  uint32_t drainUs() const {
+    return (uint32_t)((uint64_t)backlog() * 1000000 / bytes_per_sec);
+  }
+
+  // Sends for one millisecond.
+  void tick(bool gated) {
+    carry += bytes_per_sec;
+    int n = carry / 1000;
+    carry %= 1000;
+    buffered = (buffered > n) ? buffered - n : 0;
+    if (gated) {
+      int room = TX_BUFFER - buffered;
+      int move = (queued < room) ? queued : room;
+      queued -= move;
+      buffered += move;
+    }
+  }
+
+  // Writes a message.
+  // @return False if there's no room and the sender must wait.  A gated link always takes it, or drops it.
+  bool write(int bytes, bool gated) {
+    if (gated && (queued > 0 || buffered + bytes > TX_BUFFER)) {
+      if (queued + bytes > SINK_QUEUE_SIZE) {
+        dropped++;
+      } else {
+        queued += bytes;
+      }
+      sent += bytes;
+      return true;
+    }
+    if (buffered + bytes > TX_BUFFER) {
+      return false;
+    }
+    buffered += bytes;
+    sent += bytes;
+    return true;
+  }
+};
+
+// The gurdy's outputs.
+class StressModel {
+  private:
+    ModelOptions opt;
+    int play_bytes, stop_bytes;
+    std::set<int> gain_sent;
+    bool click_on = false;          // The key click's MIDI note hasn't been ended yet
+    bool click_track = false;       // Its Trigger/Tsunami track may still be playing
+    uint32_t click_ms = 0;
+    int struck = -1;                // The melody note MIDI is sounding while a glide bends it, or -1
+    int bend_steps = 0;             // How far the glide has bent it
+
+  public:
+    ModelLink midi{31250 / 10};
+    ModelLink trigger{57600 / 10};
+    uint32_t usb_bytes = 0;
+    uint32_t pass_us = 0;   // Waited so far this pass
+    StressVoices voices;
+    uint32_t now = 0;       // ms
+    bool cranking = false;
+    int note = 60;          // The melody note
+
+    StressModel(const ModelOptions &o) : opt(o) {
+      play_bytes = o.tsunami ? 10 : 9;
+      stop_bytes = o.tsunami ? 10 : 8;
+    }
+
+    // One millisecond passes.
+    void tick() {
+      now++;
+      midi.tick(opt.gated);
+      trigger.tick(false);
+    }
+
+    // Writes to a link, waiting (and letting time pass) until it has room.
+    void send(ModelLink &link, int bytes, bool gated) {
+      while (!link.write(bytes, gated)) {
+        tick();
+        pass_us += 1000;
+      }
+    }
+
+    void midiMessage(int bytes) {
+      usb_bytes += 4;
+      send(midi, bytes, opt.gated);
+    }
+
+    // A string's note on the Trigger/Tsunami, by track.
+    void trackPlay(int track) {
+      if (!gain_sent.count(track)) {
+        gain_sent.insert(track);
+        send(trigger, 9, false);
+      }
+      send(trigger, play_bytes, false);
+      voices.play(now);
+    }
+
+    void trackFade(int) {
+      send(trigger, 12, false);
+      voices.fade(now);
+    }
+
+    // How far below a string's note its gros note is, as the saturation test sets the gros modes (a fourth, a
+    // fifth and an octave), or 0 if it has none.
+    int grosBelow(int channel) const {
+      static const int below[5] = {5, 7, 12, 0, 0};
+      return opt.gros ? below[channel] : 0;
+    }
+
+    // A string's note, with its gros note if it has one: MIDI-OUT and USB, and the Trigger/Tsunami.
+    void noteOn(int channel, int n) {
+      for (int v = 0; v < (grosBelow(channel) ? 2 : 1); v++) {
+        midiMessage(3);
+        trackPlay(channel * 128 + n - v * grosBelow(channel));
+      }
+    }
+
+    void noteOff(int channel, int n) {
+      for (int v = 0; v < (grosBelow(channel) ? 2 : 1); v++) {
+        midiMessage(3);
+        trackFade(channel * 128 + n - v * grosBelow(channel));
+      }
+    }
+
+    // What loop() does when the crank starts: the melody strings, trompette, drone and buzz.
+    void crankStart() {
+      if (cranking) {
+        return;
+      }
+      cranking = true;
+      // A glide leaves the melody strings bent until they next start a note.
+      if (bend_steps != 0) {
+        midiMessage(3);
+        midiMessage(3);
+        bend_steps = 0;
+      }
+      noteOn(0, note);
+      noteOn(1, note - 12);
+      noteOn(2, 55);
+      noteOn(3, 43);
+      noteOn(4, 48);
+    }
+
+    // And when it stops (all_soundOff()).
+    void crankStop() {
+      if (!cranking) {
+        return;
+      }
+      cranking = false;
+      noteOff(0, note);
+      noteOff(1, note - 12);
+      if (click_on) {
+        midiMessage(3);
+        click_on = false;
+      }
+      noteOff(2, 55);
+      noteOff(3, 43);
+      noteOff(4, 48);
+      struck = -1;
+    }
+
+    // key_change(), to a new melody note.  Only sends while the crank is turning.
+    void keyChange(int to) {
+      int from = note;
+      note = to;
+      if (!cranking) {
+        return;
+      }
+
+      if (click_on) {
+        midiMessage(3);
+      }
+      if (opt.legato == 1) {
+        // The Trigger/Tsunami changes notes; MIDI bends the struck note within the bend range, or strikes the new
+        // one (GurdyString::changeNote()).
+        int from_midi = (struck >= 0) ? struck : from;
+        bool bend = abs(to - from_midi) <= LEGATO_BEND_RANGE;
+        for (int s = 0; s < 2; s++) {
+          int open = (s == 0) ? 0 : 12;
+          for (int v = 0; v < (grosBelow(s) ? 2 : 1); v++) {
+            trackFade(s * 128 + from - open - v * grosBelow(s));
+          }
+          for (int v = 0; v < (grosBelow(s) ? 2 : 1); v++) {
+            trackPlay(s * 128 + to - open - v * grosBelow(s));
+          }
+          if (bend) {
+            midiMessage(3);
+          } else {
+            for (int v = 0; v < (grosBelow(s) ? 4 : 2) + (bend_steps != 0 ? 1 : 0); v++) {
+              midiMessage(3);
+            }
+          }
+        }
+        struck = bend ? from_midi : -1;
+        bend_steps = bend ? to - from_midi : 0;
+      } else {
+        // Off and overlap send the same messages, in a different order.
+        noteOff(0, from);
+        noteOff(1, from - 12);
+        noteOn(0, to);
+        noteOn(1, to - 12);
+      }
+
+      // The key click: a one-shot, its track stopped if it may still be playing.
+      if (click_track) {
+        send(trigger, stop_bytes, false);
+        voices.stop();
+      }
+      midiMessage(3);
+      if (!gain_sent.count(5 * 128 + 83)) {
+        gain_sent.insert(5 * 128 + 83);
+        send(trigger, 9, false);
+      }
+      send(trigger, play_bytes, false);
+      voices.shot(now, KEYCLICK_MS);
+      click_on = true;
+      click_track = true;
+      click_ms = now;
+    }
+
+    // GurdyString::update() for the key click: only its MIDI note ends.
+    void update() {
+      if (click_on && now - click_ms >= (uint32_t)KEYCLICK_MS) {
+        midiMessage(3);
+        click_on = false;
+      }
+    }
+
+    // How long until everything sent so far has gone out on both links, in us.
+    uint32_t drainUs() const {
+      return std::max(midi.drainUs(), trigger.drainUs());
+    }
+};
+
+inline StressLimits stress_model_limits(const ModelOptions &opt) {
+  int voices = opt.voices ? opt.voices : (opt.tsunami ? 18 : 14);
+  return {voices, STRESS_LOOP_BUDGET_US};
+}
+
+/// @brief Models one rate of the saturation test, as stress_step() in benchmarks.cpp runs it.
+inline StressStep stress_model_rate(const ModelOptions &opt, int rate) {
+  StressStep s;
+  memset(&s, 0, sizeof(s));
+  s.rate = rate;
+  s.ms = STRESS_STEP_MS;
+
+  // Start the crank and play both notes once, so their gains are sent, then let it all go out, as the gurdy does.
+  StressModel m(opt);
+  m.crankStart();
+  m.keyChange(62);
+  m.keyChange(60);
+  while (m.now < STRESS_WARMUP_MS) {
+    m.update();
+    m.tick();
+  }
+  m.voices.peak = m.voices.count(m.now);
+  m.usb_bytes = 0;
+  m.midi.sent = 0;
+  m.trigger.sent = 0;
+  for (int x = 0; x < STRESS_NUM_LINKS; x++) {
+    s.backlog_start[x] = -1;
+    s.backlog_end[x] = -1;
+  }
+
+  // One pass a millisecond, longer if it waits.
+  uint64_t total_us = 0;
+  uint32_t passes = 0;
+  uint32_t start = m.now;
+  uint32_t next_key_us = start * 1000 + 1000000 / rate;
+  while (m.now - start < STRESS_STEP_MS) {
+    m.pass_us = 0;
+    if (m.now * 1000 >= next_key_us) {
+      m.keyChange((m.note == 60) ? 62 : 60);
+      next_key_us += 1000000 / rate;
+      s.keys++;
+    }
+    m.update();
+    m.tick();
+
+    total_us += m.pass_us;
+    passes++;
+    if (m.pass_us > s.loop_max_us) {
+      s.loop_max_us = m.pass_us;
+    }
+    stress_sample_backlog(&s, STRESS_MIDI_OUT, m.midi.backlog(), m.now - start, STRESS_STEP_MS);
+    stress_sample_backlog(&s, STRESS_TRIGGER, m.trigger.backlog(), m.now - start, STRESS_STEP_MS);
+  }
+
+  s.bytes_per_sec[0] = m.usb_bytes * 1000 / STRESS_STEP_MS;
+  s.bytes_per_sec[1] = m.midi.sent * 1000 / STRESS_STEP_MS;
+  s.bytes_per_sec[2] = m.trigger.sent * 1000 / STRESS_STEP_MS;
+  s.dropped = m.midi.dropped;
+  s.peak_voices = m.voices.peak;
+  s.loop_avg_us = (uint32_t)(total_us / passes);
+  return s;
+}
+
+// A scripted playing session, for stress_batch.
+//
+//   # A comment
+//   tsunami                 The unit is a Tsunami (default WAV Trigger)
+//   voices 32               The unit's voices
+//   gated                   MIDI-OUT goes through the USE_OUTPUT_GATING queue
+//   legato glide            off, glide or overlap
+//   no-gros                 No gros notes
+//   crank MS on|off         Start or stop the crank at a time
+//   key MS OFFSET           Press a key (0 is the open string) at a time
+//   trill FROM TO RATE A B  Alternate keys A and B at RATE a second from one time to another
+//
+// Times are in ms from the start.  The session ends 500ms after its last event.
+struct PlayEvent {
+  uint32_t ms;
+  int kind;                 // 0 key, 1 crank on, 2 crank off
+  int offset;
+};
+
+struct PlaySession {
+  std::string name;
+  ModelOptions opt;
+  std::vector<PlayEvent> events;
+};
+
+struct PlayResult {
+  uint32_t ms = 0;                      // Virtual time played
+  uint32_t keys = 0;
+  std::vector<uint32_t> latency_us;     // For each key change, until its last byte was sent
+  uint32_t bytes[3] = {0, 0, 0};        // USB, MIDI-OUT, Trigger/Tsunami
+  uint32_t dropped = 0;
+  int peak_voices = 0;
+  int over_voices = 0;                  // Key changes made with more voices than the unit has
+  uint32_t loop_max_us = 0;
+};
+
+inline bool play_load_session(const std::string &path, PlaySession &s, std::string &err) {
+  std::ifstream in(path);
+  if (!in) {
+    err = "can't read " + path;
+    return false;
+  }
+  s.name = path.substr(path.find_last_of('/') + 1);
+
+  std::string line;
+  int line_num = 0;
+  while (std::getline(in, line)) {
+    line_num++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::string cmd;
+    if (!(words >> cmd)) {
+      continue;
+    }
+
+    bool ok = true;
+    if (cmd == "tsunami") {
+      s.opt.tsunami = true;
+    } else if (cmd == "voices") {
+      ok = (bool)(words >> s.opt.voices);
+    } else if (cmd == "gated") {
+      s.opt.gated = true;
+    } else if (cmd == "no-gros") {
+      s.opt.gros = false;
+    } else if (cmd == "legato") {
+      std::string m;
+      words >> m;
+      s.opt.legato = (m == "glide") ? 1 : (m == "overlap") ? 2 : 0;
+      ok = (m == "off" || m == "glide" || m == "overlap");
+    } else if (cmd == "crank") {
+      uint32_t ms;
+      std::string state;
+      ok = (words >> ms >> state) && (state == "on" || state == "off");
+      if (ok) {
+        s.events.push_back({ms, (state == "on") ? 1 : 2, 0});
+      }
+    } else if (cmd == "key") {
+      uint32_t ms;
+      int offset;
+      ok = (bool)(words >> ms >> offset);
+      if (ok) {
+        s.events.push_back({ms, 0, offset});
+      }
+    } else if (cmd == "trill") {
+      uint32_t from, to;
+      int rate, a, b;
+      ok = (words >> from >> to >> rate >> a >> b) && rate > 0 && to >= from;
+      if (ok) {
+        int x = 0;
+        for (uint64_t us = (uint64_t)from * 1000; us < (uint64_t)to * 1000; us += 1000000 / rate) {
+          s.events.push_back({(uint32_t)(us / 1000), 0, (x++ % 2) ? b : a});
+        }
+      }
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      err = path + ":" + std::to_string(line_num) + ": can't read \"" + line + "\"";
+      return false;
+    }
+  }
+
+  std::stable_sort(s.events.begin(), s.events.end(),
+                   [](const PlayEvent &a, const PlayEvent &b) { return a.ms < b.ms; });
+  return true;
+}
+
+/// @brief Plays a session on a model, one pass a millisecond as stress_model_rate() does.
+inline PlayResult play_session_run(const PlaySession &s) {
+  PlayResult r;
+  StressModel m(s.opt);
+  int limit = stress_model_limits(s.opt).voices;
+  uint32_t end = s.events.empty() ? 0 : s.events.back().ms + 500;
+
+  size_t next = 0;
+  while (m.now < end) {
+    m.pass_us = 0;
+    while (next < s.events.size() && s.events[next].ms <= m.now) {
+      const PlayEvent &e = s.events[next++];
+      if (e.kind == 1) {
+        m.crankStart();
+      } else if (e.kind == 2) {
+        m.crankStop();
+      } else if (m.note != 60 + e.offset) {
+        bool sounding = m.cranking;
+        m.keyChange(60 + e.offset);
+        if (sounding) {
+          r.keys++;
+          r.latency_us.push_back((m.now - e.ms) * 1000 + m.drainUs());
+          if (m.voices.count(m.now) > limit) {
+            r.over_voices++;
+          }
+        }
+      }
+    }
+    m.update();
+    m.tick();
+    r.loop_max_us = std::max(r.loop_max_us, m.pass_us);
+  }
+
+  r.ms = m.now;
+  r.bytes[0] = m.usb_bytes;
+  r.bytes[1] = m.midi.sent;
+  r.bytes[2] = m.trigger.sent;
+  r.dropped = m.midi.dropped;
+  r.peak_voices = m.voices.peak;
+  return r;
+}
+
+#endif
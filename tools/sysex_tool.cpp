@@ -0,0 +1,363 @@
+// sysex_tool: builds and checks digigurdy-baz SysEx configuration dumps on a computer.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -o sysex_tool tools/sysex_tool.cpp
+//
+// Usage:
+//
+//   sysex_tool request <out.syx>                       Write a dump request to send to the gurdy.
+//   sysex_tool validate <in.syx>                       Check every message of a dump.
+//   sysex_tool print <in.syx>                          Print a dump as "NAME = value" lines.
+//   sysex_tool build <in.txt> <out.syx> [base.syx]     Build a dump from "NAME = value" lines.
+//
+// A text configuration uses the names from eeprom_values.h without the EEPROM_ prefix.  Tuning slot
+// fields are written SLOT1.HI_MEL, SLOT3.BUZZ_GROS and so on, and any address can be set directly
+// as @<address>.  Blank lines and lines starting with '#' are ignored.  Anything not set comes from
+// base.syx if given, or is 0.  "sysex_tool print" output is valid "sysex_tool build" input.
+//
+// Send the .syx files with any SysEx librarian (e.g. SysEx Librarian, MIDI-OX, amidi).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../eeprom_values.h"
+#include "../sysex_protocol.h"
+
+struct NamedAddr {
+  std::string name;
+  int addr;
+};
+
+static std::vector<NamedAddr> config_names() {
+  std::vector<NamedAddr> names;
+
+  const char *slot_fields[] = {"HI_MEL", "LO_MEL", "DRONE", "TROMP", "BUZZ", "TPOSE", "CAPO",
+                               "HI_MEL_VOL", "LOW_MEL_VOL", "DRONE_VOL", "TROMP_VOL", "BUZZ_VOL",
+                               "KEYCLICK_VOL", "HI_MEL_GROS", "LOW_MEL_GROS", "TROMP_GROS",
+                               "DRONE_GROS", "BUZZ_GROS"};
+  const int slot_offsets[] = {EEPROM_HI_MEL, EEPROM_LO_MEL, EEPROM_DRONE, EEPROM_TROMP, EEPROM_BUZZ,
+                              EEPROM_TPOSE, EEPROM_CAPO, EEPROM_HI_MEL_VOL, EEPROM_LOW_MEL_VOL,
+                              EEPROM_DRONE_VOL, EEPROM_TROMP_VOL, EEPROM_BUZZ_VOL, EEPROM_KEYCLICK_VOL,
+                              EEPROM_HI_MEL_GROS, EEPROM_LOW_MEL_GROS, EEPROM_TROMP_GROS,
+                              EEPROM_DRONE_GROS, EEPROM_BUZZ_GROS};
+  const int slots[] = {EEPROM_SLOT1, EEPROM_SLOT2, EEPROM_SLOT3, EEPROM_SLOT4};
+
+  for (int s = 0; s < 4; s++) {
+    for (int f = 0; f < 18; f++) {
+      names.push_back({"SLOT" + std::to_string(s + 1) + "." + slot_fields[f], slots[s] + slot_offsets[f]});
+    }
+  }
+
+  names.push_back({"DISPLY_TYPE", EEPROM_DISPLY_TYPE});
+  names.push_back({"SCENE_SIGNALLING", EEPROM_SCENE_SIGNALLING});
+  names.push_back({"BUZZ_LED", EEPROM_BUZZ_LED});
+  names.push_back({"SEC_OUT", EEPROM_SEC_OUT});
+  names.push_back({"MEL_VIBRATO", EEPROM_MEL_VIBRATO});
+  names.push_back({"MPE", EEPROM_MPE});
+  names.push_back({"LEGATO", EEPROM_LEGATO});
+
+  const char *ex_names[] = {"EX1", "EX2", "EX3", "EX4", "EX5", "EX6", "EX7", "EX8", "EX9", "EX10", "EXBB"};
+  const int ex_addrs[] = {EEPROM_EX1, EEPROM_EX2, EEPROM_EX3, EEPROM_EX4, EEPROM_EX5, EEPROM_EX6,
+                          EEPROM_EX7, EEPROM_EX8, EEPROM_EX9, EEPROM_EX10, EEPROM_EXBB};
+  const int ex_steps[] = {EEPROM_EX1_TSTEP, EEPROM_EX2_TSTEP, EEPROM_EX3_TSTEP, EEPROM_EX4_TSTEP,
+                          EEPROM_EX5_TSTEP, EEPROM_EX6_TSTEP, EEPROM_EX7_TSTEP, EEPROM_EX8_TSTEP,
+                          EEPROM_EX9_TSTEP, EEPROM_EX10_TSTEP, EEPROM_EXBB_TSTEP};
+  const int ex_slots[] = {EEPROM_EX1_SLOT, EEPROM_EX2_SLOT, EEPROM_EX3_SLOT, EEPROM_EX4_SLOT,
+                          EEPROM_EX5_SLOT, EEPROM_EX6_SLOT, EEPROM_EX7_SLOT, EEPROM_EX8_SLOT,
+                          EEPROM_EX9_SLOT, EEPROM_EX10_SLOT, EEPROM_EXBB_SLOT};
+
+  for (int x = 0; x < 11; x++) {
+    names.push_back({ex_names[x], ex_addrs[x]});
+    names.push_back({std::string(ex_names[x]) + "_TSTEP", ex_steps[x]});
+    names.push_back({std::string(ex_names[x]) + "_SLOT", ex_slots[x]});
+  }
+
+  return names;
+}
+
+static bool read_file(const std::string &path, std::vector<uint8_t> &data) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "Can't open " << path << "\n";
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static bool write_file(const std::string &path, const std::vector<uint8_t> &data) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    std::cerr << "Can't write " << path << "\n";
+    return false;
+  }
+  out.write((const char *)data.data(), data.size());
+  return true;
+}
+
+// Splits a .syx file into its messages and checks each one, filling image with the configuration.
+// Returns the number of problems found.
+static int parse_dump(const std::vector<uint8_t> &data, std::vector<uint8_t> &image, bool verbose) {
+  const int num_chunks = sysex_chunk_count(EEPROM_CONFIG_LEN);
+  std::vector<bool> seen(num_chunks, false);
+  int errors = 0;
+
+  image.assign(EEPROM_CONFIG_LEN, 0);
+
+  size_t pos = 0;
+  int msg_num = 0;
+  while (pos < data.size()) {
+    if (data[pos] != SYSEX_START) {
+      std::cerr << "Byte " << pos << ": expected F0, skipping.\n";
+      errors++;
+      pos++;
+      continue;
+    }
+
+    size_t end = pos;
+    while (end < data.size() && data[end] != SYSEX_END) {
+      end++;
+    }
+    if (end == data.size()) {
+      std::cerr << "Message " << msg_num << " at byte " << pos << " has no F7.\n";
+      errors++;
+      break;
+    }
+
+    int len = end - pos + 1;
+    uint8_t cmd, idx, count;
+    uint8_t raw[SYSEX_CHUNK_SIZE];
+    int raw_len = sysex_parse(&data[pos], len, &cmd, &idx, &count, raw);
+
+    if (raw_len < 0) {
+      std::cerr << "Message " << msg_num << " at byte " << pos << " is malformed or fails its checksum.\n";
+      errors++;
+    } else if (cmd != SYSEX_DUMP_CHUNK) {
+      if (verbose) {
+        std::cout << "Message " << msg_num << ": command " << (int)cmd << " (not a chunk), ignored.\n";
+      }
+    } else if (count != num_chunks || idx >= num_chunks) {
+      std::cerr << "Message " << msg_num << ": chunk " << (int)idx << " of " << (int)count
+                << ", but this firmware's configuration is " << num_chunks << " chunks.\n";
+      errors++;
+    } else {
+      int expect = EEPROM_CONFIG_LEN - idx * SYSEX_CHUNK_SIZE;
+      if (expect > SYSEX_CHUNK_SIZE) {
+        expect = SYSEX_CHUNK_SIZE;
+      }
+      if (raw_len != expect) {
+        std::cerr << "Message " << msg_num << ": chunk " << (int)idx << " holds " << raw_len
+                  << " bytes, expected " << expect << ".\n";
+        errors++;
+      } else {
+        if (seen[idx]) {
+          std::cerr << "Message " << msg_num << ": chunk " << (int)idx << " repeated, the later one wins.\n";
+        }
+        seen[idx] = true;
+        memcpy(&image[idx * SYSEX_CHUNK_SIZE], raw, raw_len);
+        if (verbose) {
+          std::cout << "Message " << msg_num << ": chunk " << (int)idx << "/" << num_chunks << ", "
+                    << raw_len << " bytes, OK.\n";
+        }
+      }
+    }
+
+    pos = end + 1;
+    msg_num++;
+  }
+
+  for (int x = 0; x < num_chunks; x++) {
+    if (!seen[x]) {
+      std::cerr << "Chunk " << x << " is missing.\n";
+      errors++;
+    }
+  }
+  return errors;
+}
+
+static std::vector<uint8_t> build_dump(const std::vector<uint8_t> &image) {
+  const int num_chunks = sysex_chunk_count(EEPROM_CONFIG_LEN);
+  std::vector<uint8_t> out;
+  uint8_t msg[SYSEX_MAX_MSG_LEN];
+
+  for (int x = 0; x < num_chunks; x++) {
+    int len = EEPROM_CONFIG_LEN - x * SYSEX_CHUNK_SIZE;
+    if (len > SYSEX_CHUNK_SIZE) {
+      len = SYSEX_CHUNK_SIZE;
+    }
+    int msg_len = sysex_build(SYSEX_DUMP_CHUNK, x, num_chunks, &image[x * SYSEX_CHUNK_SIZE], len, msg);
+    out.insert(out.end(), msg, msg + msg_len);
+  }
+  return out;
+}
+
+static int cmd_request(const std::string &out_path) {
+  uint8_t msg[SYSEX_MAX_MSG_LEN];
+  int len = sysex_build(SYSEX_DUMP_REQUEST, 0, 0, nullptr, 0, msg);
+  return write_file(out_path, std::vector<uint8_t>(msg, msg + len)) ? 0 : 1;
+}
+
+static int cmd_validate(const std::string &in_path) {
+  std::vector<uint8_t> data, image;
+  if (!read_file(in_path, data)) {
+    return 1;
+  }
+  int errors = parse_dump(data, image, true);
+  if (errors > 0) {
+    std::cout << in_path << ": " << errors << " problem(s).\n";
+    return 1;
+  }
+  std::cout << in_path << ": OK, " << EEPROM_CONFIG_LEN << " bytes of configuration.\n";
+  return 0;
+}
+
+static int cmd_print(const std::string &in_path) {
+  std::vector<uint8_t> data, image;
+  if (!read_file(in_path, data)) {
+    return 1;
+  }
+  if (parse_dump(data, image, false) > 0) {
+    return 1;
+  }
+
+  std::vector<bool> named(EEPROM_CONFIG_LEN, false);
+  for (const NamedAddr &n : config_names()) {
+    std::cout << n.name << " = " << (int)image[n.addr] << "\n";
+    named[n.addr] = true;
+  }
+
+  // Unused addresses are printed too if they hold anything, so a print/build round trip is exact.
+  for (int x = 0; x < EEPROM_CONFIG_LEN; x++) {
+    if (!named[x] && image[x] != 0) {
+      std::cout << "@" << x << " = " << (int)image[x] << "\n";
+    }
+  }
+  return 0;
+}
+
+static int cmd_build(const std::string &in_path, const std::string &out_path, const std::string &base_path) {
+  std::vector<uint8_t> image(EEPROM_CONFIG_LEN, 0);
+
+  if (!base_path.empty()) {
+    std::vector<uint8_t> data;
+    if (!read_file(base_path, data) || parse_dump(data, image, false) > 0) {
+      std::cerr << "Base dump " << base_path << " is unusable.\n";
+      return 1;
+    }
+  }
+
+  std::ifstream in(in_path);
+  if (!in) {
+    std::cerr << "Can't open " << in_path << "\n";
+    return 1;
+  }
+
+  std::vector<NamedAddr> names = config_names();
+  std::string line;
+  int line_num = 0;
+  int errors = 0;
+
+  while (std::getline(in, line)) {
+    line_num++;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') {
+      continue;
+    }
+
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << in_path << ":" << line_num << ": expected NAME = value\n";
+      errors++;
+      continue;
+    }
+
+    std::string name = line.substr(start, eq - start);
+    name.erase(name.find_last_not_of(" \t") + 1);
+    std::string value_str = line.substr(eq + 1);
+
+    char *end;
+    long value = strtol(value_str.c_str(), &end, 0);
+    while (*end == ' ' || *end == '\t' || *end == '\r') {
+      end++;
+    }
+    if (*end != '\0' || value < 0 || value > 255) {
+      std::cerr << in_path << ":" << line_num << ": value must be 0-255\n";
+      errors++;
+      continue;
+    }
+
+    int addr = -1;
+    if (name[0] == '@') {
+      addr = atoi(name.c_str() + 1);
+    } else {
+      for (const NamedAddr &n : names) {
+        if (n.name == name) {
+          addr = n.addr;
+          break;
+        }
+      }
+    }
+
+    if (addr < 0 || addr >= EEPROM_CONFIG_LEN) {
+      std::cerr << in_path << ":" << line_num << ": unknown setting " << name << "\n";
+      errors++;
+      continue;
+    }
+    image[addr] = (uint8_t)value;
+  }
+
+  if (errors > 0) {
+    return 1;
+  }
+
+  std::vector<uint8_t> dump = build_dump(image);
+
+  // Never hand out a file that the gurdy would refuse.
+  std::vector<uint8_t> check;
+  if (parse_dump(dump, check, false) > 0 || check != image) {
+    std::cerr << "Internal error: built dump does not validate.\n";
+    return 1;
+  }
+
+  if (!write_file(out_path, dump)) {
+    return 1;
+  }
+  std::cout << "Wrote " << dump.size() << " bytes (" << sysex_chunk_count(EEPROM_CONFIG_LEN)
+            << " messages) to " << out_path << "\n";
+  return 0;
+}
+
+static void usage() {
+  std::cerr << "usage: sysex_tool request <out.syx>\n"
+               "       sysex_tool validate <in.syx>\n"
+               "       sysex_tool print <in.syx>\n"
+               "       sysex_tool build <in.txt> <out.syx> [base.syx]\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  if (cmd == "request") {
+    return cmd_request(argv[2]);
+  } else if (cmd == "validate") {
+    return cmd_validate(argv[2]);
+  } else if (cmd == "print") {
+    return cmd_print(argv[2]);
+  } else if (cmd == "build" && argc >= 4) {
+    return cmd_build(argv[2], argv[3], argc >= 5 ? argv[4] : "");
+  }
+
+  usage();
+  return 2;
+}
@@ -0,0 +1,78 @@
+// The scaffolding of the host tools' "test" subcommands.
+//
+// Each check prints one line, "  ok    what" or "  FAIL  what", and the run ends with "All passed." or "N
+// failed.".  Temporary files and directories asked for during the run are removed at the end.
+
+#ifndef TOOL_TEST_H
+#define TOOL_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+class ToolTest {
+  private:
+    int failures = 0;
+    std::vector<std::string> made;
+
+  public:
+    ~ToolTest() {
+      for (const std::string &path : made) {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+      }
+    }
+
+    /// @brief Prints one check and counts it if it failed.
+    void expect(bool ok, const std::string &what) {
+      std::cout << (ok ? "  ok    " : "  FAIL  ") << what << "\n";
+      if (!ok) {
+        failures++;
+      }
+    }
+
+    /// @brief Makes an empty directory for the run.
+    /// @return Its path, or "" (with a message on stderr) if it can't be made.
+    std::string tempDir(const std::string &tool) {
+      std::string pattern = "/tmp/" + tool + "XXXXXX";
+      std::vector<char> name(pattern.begin(), pattern.end());
+      name.push_back('\0');
+      if (!mkdtemp(name.data())) {
+        std::cerr << "can't make a temporary directory\n";
+        return "";
+      }
+      made.push_back(name.data());
+      return name.data();
+    }
+
+    /// @brief Writes a file for the run.
+    /// @return Its path, or "" (with a message on stderr) if it can't be written.
+    std::string tempFile(const std::string &tool, const std::string &text) {
+      std::string pattern = "/tmp/" + tool + "XXXXXX";
+      std::vector<char> name(pattern.begin(), pattern.end());
+      name.push_back('\0');
+      int fd = mkstemp(name.data());
+      if (fd < 0) {
+        std::cerr << "can't make a temporary file\n";
+        return "";
+      }
+      made.push_back(name.data());
+      bool ok = write(fd, text.data(), text.size()) == (ssize_t)text.size();
+      close(fd);
+      return ok ? std::string(name.data()) : "";
+    }
+
+    /// @brief Prints the summary.
+    /// @return The tool's exit code: 0 if every check passed, 1 otherwise.
+    int finish() {
+      std::cout << (failures == 0 ? "All passed.\n" : std::to_string(failures) + " failed.\n");
+      return failures == 0 ? 0 : 1;
+    }
+};
+
+#endif
@@ -0,0 +1,574 @@
+// trace_cols: packs crank captures and traces into one columnar file (trace_cols.h) and analyzes it in place.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -o trace_cols tools/trace_cols.cpp
+//
+// Usage:
+//
+//   trace_cols pack OUT.cols [--gap-ms N] file...   Pack crank captures (.txt) and traces (.json) into OUT.cols
+//   trace_cols info FILE.cols                       Print the columns, the rows and the events of each kind
+//   trace_cols stats FILE.cols [--from S] [--to S]  Stage latencies, crank statistics and MIDI traffic
+//   trace_cols test                                 Pack known files and check what comes back
+//
+// The gurdy saves each crank capture (Diagnostics -> Crank Capture) and trace (Diagnostics -> Trace Recording)
+// on its own, each timed from when it was started, so pack lays the files end to end in the order given,
+// --gap-ms apart (default 0).  Each file is sorted by time as it's read; the gurdy's buffers keep each one small enough
+// for that, and the packed file is written a row at a time, so a gig's worth of files packs in little memory.
+//
+// stats maps the file and reads the columns from front to back, counting into fixed-size histograms, so it runs
+// in the same small memory whatever the file's length.  --from and --to (seconds) use the index to read only
+// part of the session.  It prints:
+//
+// * each trace stage's count and length (p50, p95, p99 and max, in microseconds),
+// * crank edges, revolutions, time spinning and revolutions a second (p50, p95, max over seconds spinning),
+// * the gear crank's ADC and the buzz knob's range,
+// * the outbound MIDI messages of each kind, their bytes, and a histogram of messages a second.
+
+#include <cmath>
+#include <iostream>
+
+#include "crank_replay.h"
+#include "trace_cols.h"
+#include "tool_test.h"
+
+// Quiet time that counts as the crank stopping, as crank_replay's --gap-ms.
+static const uint64_t SPIN_GAP_US = 300000;
+
+// The longest stage length counted exactly, in microseconds.  Longer ones count as this.
+static const uint32_t HIST_MAX_US = 100000;
+
+// The MIDI bytes each outbound message takes, by TraceName.
+static const int message_bytes[COLS_TRACE_NAMES] = {0, 0, 0, 0, 0, 0, 0, 3, 3, 3, 3, 2};
+
+struct Hist {
+  std::vector<uint32_t> bins;
+  uint64_t count = 0;
+  uint64_t max = 0;
+
+  Hist() : bins(HIST_MAX_US + 1, 0) {}
+
+  void add(uint64_t v) {
+    bins[std::min<uint64_t>(v, HIST_MAX_US)]++;
+    count++;
+    max = std::max(max, v);
+  }
+
+  uint64_t percentile(double p) const {
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t want = (uint64_t)std::ceil(count * p / 100.0);
+    uint64_t seen = 0;
+    for (uint32_t x = 0; x <= HIST_MAX_US; x++) {
+      seen += bins[x];
+      if (seen >= want && seen > 0) {
+        return (x == HIST_MAX_US) ? max : x;
+      }
+    }
+    return max;
+  }
+};
+
+template <typename T>
+static T sorted_percentile(const std::vector<T> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t at = (size_t)std::ceil(sorted.size() * p / 100.0);
+  return sorted[std::min(sorted.size() - 1, at > 0 ? at - 1 : 0)];
+}
+
+struct Stats {
+  double seconds = 0;
+  uint64_t rows = 0;
+  Hist span[COLS_TRACE_SPANS];                  // By TraceName, in microseconds
+  uint64_t messages[COLS_TRACE_NAMES] = {};
+  uint64_t bytes = 0;
+  std::vector<uint32_t> per_second;             // Messages sent in each second
+  uint64_t edges = 0;
+  double revs = 0;
+  double spin_s = 0;
+  std::vector<double> revs_per_second;          // For each second the crank moved in
+  int64_t adc_min = 0, adc_max = 0, knob_min = 0, knob_max = 0;
+  uint64_t adcs = 0, knobs = 0;
+};
+
+// Reads a number following "key": on a line of trace JSON.
+static bool json_number(const std::string &line, const char *key, double &out) {
+  std::string k = std::string("\"") + key + "\":";
+  size_t at = line.find(k);
+  if (at == std::string::npos) {
+    return false;
+  }
+  out = atof(line.c_str() + at + k.size());
+  return true;
+}
+
+struct Row {
+  uint64_t time;
+  int32_t value;
+  uint8_t kind;
+  uint8_t channel;
+};
+
+// Reads a trace saved by trace_save(), one event per line.
+static bool load_trace(const std::string &path, std::vector<Row> &rows, std::string &err) {
+  std::ifstream in(path);
+  if (!in) {
+    err = "can't open " + path;
+    return false;
+  }
+  std::string line;
+  int line_num = 0;
+  while (std::getline(in, line)) {
+    line_num++;
+    size_t at = line.find("{\"name\":\"");
+    if (at == std::string::npos || line.find("\"ph\":\"M\"") != std::string::npos) {
+      continue;
+    }
+    at += 9;
+    std::string name = line.substr(at, line.find('"', at) - at);
+    int kind = -1;
+    for (int x = 0; x < COLS_TRACE_NAMES; x++) {
+      if (name == COLS_TRACE_NAME[x]) {
+        kind = x;
+      }
+    }
+    double ts = 0;
+    if (kind < 0 || !json_number(line, "ts", ts)) {
+      err = path + ":" + std::to_string(line_num) + ": bad event line";
+      return false;
+    }
+
+    Row r = {(uint64_t)ts, 0, (uint8_t)kind, 0};
+    double v = 0;
+    if (kind < COLS_TRACE_SPANS) {
+      json_number(line, "dur", v);
+      r.value = (int32_t)std::lround(std::min(v * 1000.0, 2147483647.0));
+    } else {
+      json_number(line, "value", v);
+      r.value = (int32_t)v;
+      json_number(line, "ch", v);
+      r.channel = (uint8_t)v;
+    }
+    rows.push_back(r);
+  }
+  return true;
+}
+
+static bool is_trace(const std::string &path) {
+  std::ifstream in(path);
+  int c = in.get();
+  return c == '{';
+}
+
+static bool pack(const std::string &out, const std::vector<std::string> &files, uint64_t gap_us, std::string &err) {
+  ColsWriter w;
+  if (!w.open(out, err)) {
+    return false;
+  }
+
+  uint64_t start = 0;
+  bool first = true;
+  for (const std::string &path : files) {
+    std::vector<Row> rows;
+    if (is_trace(path)) {
+      if (!load_trace(path, rows, err)) {
+        return false;
+      }
+    } else {
+      CrankSession s;
+      if (!crank_load_session(path, s, err)) {
+        return false;
+      }
+      for (const CrankEvent &e : s.events) {
+        rows.push_back({e.time, e.value, (uint8_t)e.kind, 0});
+      }
+      uint32_t per_rev = (s.kind == "gear") ? 0 : (s.kind == "encoder") ? s.spokes * 2 : s.spokes;
+      if (w.edges_per_rev == 0) {
+        w.edges_per_rev = per_rev;
+      } else if (per_rev != 0 && per_rev != w.edges_per_rev) {
+        std::cerr << path << ": " << per_rev << " edges a revolution, not " << w.edges_per_rev
+                  << "; its revolutions will be off\n";
+      }
+    }
+
+    // A loop() pass's stages are stored after it, so traces aren't quite in time order.
+    std::stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.time < b.time; });
+
+    if (!first) {
+      start = w.lastTime() + gap_us;
+    }
+    first = false;
+    for (const Row &r : rows) {
+      w.add(start + r.time, r.kind, r.value, r.channel);
+    }
+  }
+  return w.finish(err);
+}
+
+static bool is_span(uint8_t kind) {
+  return kind < COLS_TRACE_SPANS;
+}
+
+static bool is_message(uint8_t kind) {
+  return kind >= COLS_TRACE_SPANS && kind < COLS_TRACE_NAMES;
+}
+
+// Reads the rows from from_us up to to_us a second at a time.
+static void compute_stats(const ColsFile &f, uint64_t from_us, uint64_t to_us, Stats &st) {
+  uint64_t row = f.find(from_us);
+  uint64_t end = f.find(to_us);
+  st.rows = end - row;
+  if (st.rows == 0) {
+    return;
+  }
+  uint64_t first_us = f.time[row];
+  uint64_t last_us = f.time[end - 1];
+  st.seconds = (last_us - first_us) / 1e6;
+
+  uint32_t per_rev = f.header->edges_per_rev;
+  bool have_edge = false, have_count = false;
+  uint64_t last_edge = 0;
+  int32_t last_count = 0;
+
+  for (uint64_t sec = first_us / COLS_INDEX_STEP_US; row < end; sec++) {
+    uint64_t sec_end = std::min(end, f.find((sec + 1) * COLS_INDEX_STEP_US));
+    uint32_t sent = 0;
+    double revs = 0;
+    bool moved = false;
+
+    for (; row < sec_end; row++) {
+      uint8_t k = f.kind[row];
+      int32_t v = f.value[row];
+      uint64_t t = f.time[row];
+
+      if (is_span(k)) {
+        st.span[k].add((uint64_t)std::max(v, 0) / 1000);
+      } else if (is_message(k)) {
+        st.messages[k]++;
+        st.bytes += message_bytes[k];
+        sent++;
+      } else if (k == 'E' || k == 'C') {
+        uint64_t since = t - last_edge;
+        if (have_edge && since < SPIN_GAP_US) {
+          st.spin_s += since / 1e6;
+        }
+        have_edge = true;
+        last_edge = t;
+        moved = true;
+
+        double steps = 1;
+        if (k == 'C') {
+          steps = have_count ? std::abs((double)v - last_count) : 0;
+          have_count = true;
+          last_count = v;
+        }
+        st.edges += (uint64_t)steps;
+        if (per_rev > 0) {
+          revs += steps / per_rev;
+        }
+      } else if (k == 'A') {
+        st.adc_min = st.adcs ? std::min<int64_t>(st.adc_min, v) : v;
+        st.adc_max = st.adcs ? std::max<int64_t>(st.adc_max, v) : v;
+        st.adcs++;
+      } else if (k == 'K') {
+        st.knob_min = st.knobs ? std::min<int64_t>(st.knob_min, v) : v;
+        st.knob_max = st.knobs ? std::max<int64_t>(st.knob_max, v) : v;
+        st.knobs++;
+      }
+    }
+
+    st.per_second.push_back(sent);
+    st.revs += revs;
+    if (moved && per_rev > 0) {
+      st.revs_per_second.push_back(revs);
+    }
+  }
+}
+
+static void print_stats(const ColsFile &f, const Stats &st) {
+  printf("%llu rows over %.1fs\n", (unsigned long long)st.rows, st.seconds);
+
+  bool spans = false;
+  for (int x = 0; x < COLS_TRACE_SPANS; x++) {
+    spans = spans || st.span[x].count > 0;
+  }
+  if (spans) {
+    printf("\n%-18s %9s %7s %7s %7s %7s\n", "stage (us)", "count", "p50", "p95", "p99", "max");
+    for (int x = 0; x < COLS_TRACE_SPANS; x++) {
+      const Hist &h = st.span[x];
+      if (h.count == 0) {
+        continue;
+      }
+      printf("%-18s %9llu %7llu %7llu %7llu %7llu\n", COLS_TRACE_NAME[x], (unsigned long long)h.count,
+             (unsigned long long)h.percentile(50), (unsigned long long)h.percentile(95),
+             (unsigned long long)h.percentile(99), (unsigned long long)h.max);
+    }
+  }
+
+  if (st.edges > 0) {
+    printf("\ncrank: %llu edges", (unsigned long long)st.edges);
+    if (f.header->edges_per_rev > 0) {
+      std::vector<double> rps = st.revs_per_second;
+      std::sort(rps.begin(), rps.end());
+      printf(", %.1f revolutions, spinning %.1fs, revolutions/s p50 %.2f p95 %.2f max %.2f", st.revs, st.spin_s,
+             sorted_percentile(rps, 50), sorted_percentile(rps, 95), rps.empty() ? 0.0 : rps.back());
+    }
+    printf("\n");
+  }
+  if (st.adcs > 0) {
+    printf("gear crank ADC: %lld-%lld over %llu updates\n", (long long)st.adc_min, (long long)st.adc_max,
+           (unsigned long long)st.adcs);
+  }
+  if (st.knobs > 0) {
+    printf("buzz knob: %lld-%lld\n", (long long)st.knob_min, (long long)st.knob_max);
+  }
+
+  uint64_t total = 0;
+  for (int x = COLS_TRACE_SPANS; x < COLS_TRACE_NAMES; x++) {
+    total += st.messages[x];
+  }
+  if (total == 0) {
+    return;
+  }
+  printf("\nMIDI out: %llu messages, %llu bytes:", (unsigned long long)total, (unsigned long long)st.bytes);
+  for (int x = COLS_TRACE_SPANS; x < COLS_TRACE_NAMES; x++) {
+    printf(" %s %llu", COLS_TRACE_NAME[x], (unsigned long long)st.messages[x]);
+  }
+  printf("\n");
+
+  // Messages a second, in up to 16 buckets.
+  uint32_t peak = *std::max_element(st.per_second.begin(), st.per_second.end());
+  uint32_t width = peak / 16 + 1;
+  std::vector<uint64_t> buckets(peak / width + 1, 0);
+  for (uint32_t n : st.per_second) {
+    buckets[n / width]++;
+  }
+  uint64_t most = *std::max_element(buckets.begin(), buckets.end());
+  printf("messages/s   seconds\n");
+  for (size_t x = 0; x < buckets.size(); x++) {
+    int bar = (int)((buckets[x] * 50 + most - 1) / most);
+    printf("%4zu-%-4zu %10llu%s%s\n", x * width, x * width + width - 1, (unsigned long long)buckets[x],
+           bar ? " " : "", std::string(bar, '#').c_str());
+  }
+}
+
+static int cmd_info(const std::string &path) {
+  ColsFile f;
+  std::string err;
+  if (!f.open(path, err)) {
+    std::cerr << err << "\n";
+    return 1;
+  }
+  const ColsHeader *h = f.header;
+  printf("version %u, %llu rows, %llu seconds indexed, %u edges a revolution\n", h->version,
+         (unsigned long long)h->rows, (unsigned long long)h->index_count, h->edges_per_rev);
+  for (int x = 0; x < COLS_NUM_COLUMNS; x++) {
+    printf("  %-8.8s %u bytes at %llu\n", h->column[x].name, h->column[x].width,
+           (unsigned long long)h->column[x].offset);
+  }
+
+  uint64_t kinds[256] = {};
+  for (uint64_t r = 0; r < f.rows; r++) {
+    kinds[f.kind[r]]++;
+  }
+  for (int k = 0; k < 256; k++) {
+    if (kinds[k] == 0) {
+      continue;
+    }
+    if (k < COLS_TRACE_NAMES) {
+      printf("  %-18s %llu\n", COLS_TRACE_NAME[k], (unsigned long long)kinds[k]);
+    } else {
+      printf("  crank %-12c %llu\n", k, (unsigned long long)kinds[k]);
+    }
+  }
+  return 0;
+}
+
+static int cmd_stats(const std::string &path, double from_s, double to_s) {
+  ColsFile f;
+  std::string err;
+  if (!f.open(path, err)) {
+    std::cerr << err << "\n";
+    return 1;
+  }
+  Stats st;
+  uint64_t to_us = (to_s < 0) ? UINT64_MAX : (uint64_t)(to_s * 1e6);
+  compute_stats(f, (uint64_t)(from_s * 1e6), to_us, st);
+  print_stats(f, st);
+  return 0;
+}
+
+// The known cases for "trace_cols test": a capture and a trace written here with known contents, so every
+// statistic has a value worked out by hand, then the files the reader must refuse or cope with.
+static int cmd_test() {
+  ToolTest t;
+  std::string dir = t.tempDir("trace_cols");
+  if (dir.empty()) {
+    return 1;
+  }
+
+  // An optical crank turning at 2 revolutions a second for 3 seconds, 80 edges a revolution.
+  {
+    std::ofstream c(dir + "/crank000.txt");
+    c << "# kind=optical edges_per_rev=80 spokes=80 noise=0 firmware=3.0.0\n";
+    c << "K 0 512\n";
+    for (int x = 0; x < 480; x++) {
+      c << "E " << 6250 * x << "\n";
+    }
+    c << "K 2500000 700\n";
+  }
+
+  // A trace in the order trace_save() writes it: a loop() pass after its stages.
+  {
+    std::ofstream tr(dir + "/trace000.json");
+    tr << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+         "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"DigiGurdy\"}}";
+    for (int x = 0; x < 100; x++) {
+      uint64_t at = 10000 * x;
+      tr << ",\n{\"name\":\"soundOn\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << at + 5 << ",\"dur\":40.500}";
+      tr << ",\n{\"name\":\"NoteOn\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":2,\"ts\":" << at + 10
+        << ",\"args\":{\"ch\":3,\"value\":" << 60 + x % 12 << "}}";
+      tr << ",\n{\"name\":\"loop\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << at << ",\"dur\":"
+        << ((x == 99) ? "2500.000" : "100.000") << "}";
+    }
+    tr << "\n]}\n";
+  }
+
+  std::string err;
+  std::string out = dir + "/session.cols";
+  t.expect(pack(out, {dir + "/crank000.txt", dir + "/trace000.json"}, 1006250, err), "packs a capture and a trace");
+
+  ColsFile f;
+  t.expect(f.open(out, err), "maps what it packed");
+  if (f.header) {
+    t.expect(f.rows == 482 + 300, "a row for every event");
+    bool sorted = true;
+    for (uint64_t r = 1; r < f.rows; r++) {
+      sorted = sorted && f.time[r - 1] <= f.time[r];
+    }
+    t.expect(sorted, "in time order");
+    t.expect(f.header->edges_per_rev == 80, "the capture's edges a revolution are kept");
+    t.expect(f.header->column[COLS_TIME].offset % 8 == 0 && f.header->column[COLS_CHANNEL].offset % 8 == 0 &&
+             f.header->index_offset % 8 == 0, "columns start on 8-byte boundaries");
+
+    // The capture ends at 2993750us, so the trace starts on a whole second.
+    uint64_t trace_start = 4000000;
+    uint64_t r = f.find(trace_start);
+    t.expect(f.time[r] == trace_start && f.kind[r] == COLS_TRACE_LOOP && f.value[r] == 100000,
+             "the trace starts the gap after the capture, with its stages in nanoseconds");
+    t.expect(f.kind[r + 1] == 3 && f.value[r + 1] == 40500 && f.kind[r + 2] == 7 && f.channel[r + 2] == 3 &&
+             f.value[r + 2] == 60, "and its passes sorted ahead of their stages and messages");
+    t.expect(f.find(1000000) == 161 && f.time[f.find(1000000)] == 1000000, "the index finds each second");
+    t.expect(f.find(UINT64_MAX) == f.rows, "and nothing past the end");
+
+    Stats st;
+    compute_stats(f, 0, UINT64_MAX, st);
+    t.expect(st.edges == 480 && std::fabs(st.revs - 6.0) < 1e-9, "6 revolutions");
+    std::vector<double> rps = st.revs_per_second;
+    std::sort(rps.begin(), rps.end());
+    t.expect(std::fabs(sorted_percentile(rps, 50) - 2.0) < 1e-9, "at 2 a second");
+    t.expect(std::fabs(st.spin_s - 479 * 0.00625) < 1e-6, "spinning from the first edge to the last");
+    t.expect(st.knob_min == 512 && st.knob_max == 700, "the knob's range");
+    t.expect(st.span[COLS_TRACE_LOOP].count == 100 && st.span[COLS_TRACE_LOOP].percentile(50) == 100 &&
+             st.span[COLS_TRACE_LOOP].max == 2500, "loop() lengths");
+    t.expect(st.messages[7] == 100 && st.bytes == 300, "MIDI messages and bytes");
+    t.expect(*std::max_element(st.per_second.begin(), st.per_second.end()) == 100, "100 messages in one second");
+
+    Stats part;
+    compute_stats(f, 1000000, 2000000, part);
+    t.expect(part.rows == 160 && part.span[COLS_TRACE_LOOP].count == 0, "--from and --to read only their seconds");
+  }
+  f.close();
+
+  // A file cut short is refused rather than read past its end.
+  {
+    FILE *in = fopen(out.c_str(), "rb");
+    std::vector<char> data(sizeof(ColsHeader) + 100);
+    size_t got = fread(data.data(), 1, data.size(), in);
+    fclose(in);
+    std::string cut = dir + "/cut.cols";
+    FILE *o = fopen(cut.c_str(), "wb");
+    fwrite(data.data(), 1, got, o);
+    fclose(o);
+    ColsFile c;
+    t.expect(!c.open(cut, err), "a file cut short is refused");
+  }
+
+  // An empty session still makes a file that opens.
+  {
+    std::string empty = dir + "/empty.cols";
+    ColsWriter w;
+    t.expect(w.open(empty, err) && w.finish(err), "an empty session packs");
+    ColsFile e;
+    Stats st;
+    t.expect(e.open(empty, err) && e.rows == 0 && e.find(0) == 0, "and opens with no rows");
+    if (e.header) {
+      compute_stats(e, 0, UINT64_MAX, st);
+    }
+    t.expect(st.rows == 0, "and has no statistics");
+  }
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: trace_cols pack OUT.cols [--gap-ms N] file...\n"
+               "       trace_cols info FILE.cols\n"
+               "       trace_cols stats FILE.cols [--from S] [--to S]\n"
+               "       trace_cols test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  if (cmd == "test") {
+    return cmd_test();
+  } else if (cmd == "info" && argc == 3) {
+    return cmd_info(argv[2]);
+  } else if (cmd == "stats" && argc >= 3) {
+    double from_s = 0, to_s = -1;
+    for (int x = 3; x < argc; x++) {
+      std::string a = argv[x];
+      if (a == "--from" && x + 1 < argc) {
+        from_s = atof(argv[++x]);
+      } else if (a == "--to" && x + 1 < argc) {
+        to_s = atof(argv[++x]);
+      } else {
+        usage();
+        return 2;
+      }
+    }
+    return cmd_stats(argv[2], from_s, to_s);
+  } else if (cmd == "pack" && argc >= 3) {
+    uint64_t gap_us = 0;
+    std::vector<std::string> files;
+    for (int x = 3; x < argc; x++) {
+      std::string a = argv[x];
+      if (a == "--gap-ms" && x + 1 < argc) {
+        gap_us = (uint64_t)atoll(argv[++x]) * 1000;
+      } else {
+        files.push_back(a);
+      }
+    }
+    if (files.empty()) {
+      usage();
+      return 2;
+    }
+    std::string err;
+    if (!pack(argv[2], files, gap_us, err)) {
+      std::cerr << err << "\n";
+      return 1;
+    }
+    return 0;
+  }
+
+  usage();
+  return 2;
+}
@@ -0,0 +1,312 @@
+// The columnar trace format, shared by the host tools.
+//
+// A long session of crank captures (crank_capture.cpp) and traces (trace.cpp) is too big to analyze as text, so
+// trace_cols packs them into one file that can be memory-mapped and read in place: each field is a column of
+// fixed-width values, one row per event, with an index of where each second starts.  A tool reads only the
+// columns and the seconds it needs, and the operating system pages them in as it goes.
+//
+// The file is little-endian:
+//
+//   ColsHeader                 magic, row count, where each column and the index are
+//   time    uint64 x rows      microseconds from the start of the session, never decreasing
+//   value   int32 x rows       the event's value (see below)
+//   kind    uint8 x rows       a TraceName for trace events, or the capture letter ('E', 'C', 'A', 'K')
+//   channel uint8 x rows       the MIDI channel of an outbound message, 0 otherwise
+//   index   uint64 x seconds   the first row at or after each whole second
+//
+// Every column starts on an 8-byte boundary.  A value is the span's length in nanoseconds for trace stages, the
+// note, controller or bend for messages, and as in the capture file for crank events (the encoder position, the
+// gear crank's ADC average, the buzz knob reading; 0 for optical edges).
+
+#ifndef TRACE_COLS_H
+#define TRACE_COLS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char COLS_MAGIC[8] = {'G', 'U', 'R', 'D', 'Y', 'C', 'O', 'L'};
+const uint32_t COLS_VERSION = 1;
+const uint64_t COLS_INDEX_STEP_US = 1000000;
+
+enum ColsColumnId {
+  COLS_TIME = 0,
+  COLS_VALUE,
+  COLS_KIND,
+  COLS_CHANNEL,
+  COLS_NUM_COLUMNS
+};
+
+static const char *const COLS_COLUMN_NAMES[COLS_NUM_COLUMNS] = {"time", "value", "kind", "channel"};
+static const uint32_t COLS_COLUMN_WIDTHS[COLS_NUM_COLUMNS] = {8, 4, 1, 1};
+
+// The TraceName values, as trace.h has them, and their names as trace.cpp saves them.
+const int COLS_TRACE_LOOP = 0;
+const int COLS_TRACE_SPANS = 7;          // TRACE_NOTE_ON: the first outbound message
+const int COLS_TRACE_NAMES = 12;         // TRACE_NAME_COUNT
+static const char *const COLS_TRACE_NAME[COLS_TRACE_NAMES] = {
+  "loop", "getMaxOffset", "crank update", "soundOn", "soundOff", "draw_play_screen", "MIDI drain",
+  "NoteOn", "NoteOff", "CC", "PitchBend", "Pressure"
+};
+
+struct ColsColumn {
+  char name[8];
+  uint32_t width;                        // Bytes per row
+  uint32_t reserved;
+  uint64_t offset;                       // From the start of the file
+};
+
+struct ColsHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t columns;
+  uint64_t rows;
+  uint64_t index_step_us;
+  uint64_t index_count;
+  uint64_t index_offset;
+  uint32_t edges_per_rev;                // From the crank captures, 0 if there were none
+  uint32_t reserved;
+  ColsColumn column[COLS_NUM_COLUMNS];
+};
+
+inline uint64_t cols_align(uint64_t n) {
+  return (n + 7) & ~(uint64_t)7;
+}
+
+/// @brief Writes a columnar file a row at a time.
+/// @details Rows go to a temporary file per column and are copied into place by finish(), so a session of any
+/// length is written without holding it in memory.  Only the index (8 bytes a second) is kept.
+class ColsWriter {
+  private:
+    std::string path;
+    FILE *col[COLS_NUM_COLUMNS] = {};
+    std::vector<uint64_t> index;
+    uint64_t rows = 0;
+    uint64_t last_time = 0;
+
+    void closeColumns() {
+      for (int x = 0; x < COLS_NUM_COLUMNS; x++) {
+        if (col[x]) {
+          fclose(col[x]);
+          col[x] = nullptr;
+        }
+      }
+    }
+
+  public:
+    uint32_t edges_per_rev = 0;
+
+    ~ColsWriter() {
+      closeColumns();
+    }
+
+    bool open(const std::string &my_path, std::string &err) {
+      path = my_path;
+      for (int x = 0; x < COLS_NUM_COLUMNS; x++) {
+        col[x] = tmpfile();
+        if (!col[x]) {
+          err = "can't make a temporary file";
+          closeColumns();
+          return false;
+        }
+      }
+      return true;
+    }
+
+    uint64_t lastTime() const {
+      return last_time;
+    }
+
+    /// @brief Adds a row.  Rows must come in time order.
+    /// @return False if the time goes backwards.
+    bool add(uint64_t time, uint8_t kind, int32_t value, uint8_t channel) {
+      if (rows > 0 && time < last_time) {
+        return false;
+      }
+      while (index.size() * COLS_INDEX_STEP_US <= time) {
+        index.push_back(rows);
+      }
+      fwrite(&time, 8, 1, col[COLS_TIME]);
+      fwrite(&value, 4, 1, col[COLS_VALUE]);
+      fwrite(&kind, 1, 1, col[COLS_KIND]);
+      fwrite(&channel, 1, 1, col[COLS_CHANNEL]);
+      last_time = time;
+      rows++;
+      return true;
+    }
+
+    /// @brief Writes the file.
+    bool finish(std::string &err) {
+      FILE *out = fopen(path.c_str(), "wb");
+      if (!out) {
+        err = "can't write " + path;
+        closeColumns();
+        return false;
+      }
+
+      ColsHeader h;
+      memset(&h, 0, sizeof(h));
+      memcpy(h.magic, COLS_MAGIC, sizeof(h.magic));
+      h.version = COLS_VERSION;
+      h.columns = COLS_NUM_COLUMNS;
+      h.rows = rows;
+      h.index_step_us = COLS_INDEX_STEP_US;
+      h.index_count = index.size();
+      h.edges_per_rev = edges_per_rev;
+
+      uint64_t at = cols_align(sizeof(h));
+      for (int x = 0; x < COLS_NUM_COLUMNS; x++) {
+        strncpy(h.column[x].name, COLS_COLUMN_NAMES[x], sizeof(h.column[x].name));
+        h.column[x].width = COLS_COLUMN_WIDTHS[x];
+        h.column[x].offset = at;
+        at = cols_align(at + rows * COLS_COLUMN_WIDTHS[x]);
+      }
+      h.index_offset = at;
+
+      static const char zeros[8] = {};
+      bool ok = fwrite(&h, sizeof(h), 1, out) == 1;
+      uint64_t written = sizeof(h);
+      char buf[65536];
+      for (int x = 0; x < COLS_NUM_COLUMNS && ok; x++) {
+        ok = fwrite(zeros, 1, h.column[x].offset - written, out) == h.column[x].offset - written;
+        written = h.column[x].offset;
+        rewind(col[x]);
+        size_t n;
+        while (ok && (n = fread(buf, 1, sizeof(buf), col[x])) > 0) {
+          ok = fwrite(buf, 1, n, out) == n;
+          written += n;
+        }
+      }
+      if (ok) {
+        ok = fwrite(zeros, 1, h.index_offset - written, out) == h.index_offset - written;
+      }
+      if (ok && !index.empty()) {
+        ok = fwrite(index.data(), 8, index.size(), out) == index.size();
+      }
+      closeColumns();
+      if (fclose(out) != 0 || !ok) {
+        err = "error writing " + path;
+        return false;
+      }
+      return true;
+    }
+};
+
+/// @brief A columnar file, memory-mapped read-only.
+class ColsFile {
+  private:
+    void *base = MAP_FAILED;
+    size_t size = 0;
+
+  public:
+    const ColsHeader *header = nullptr;
+    uint64_t rows = 0;
+    const uint64_t *time = nullptr;
+    const int32_t *value = nullptr;
+    const uint8_t *kind = nullptr;
+    const uint8_t *channel = nullptr;
+    const uint64_t *index = nullptr;
+    uint64_t index_count = 0;
+
+    ColsFile() {}
+    ColsFile(const ColsFile &) = delete;
+    ColsFile &operator=(const ColsFile &) = delete;
+
+    ~ColsFile() {
+      close();
+    }
+
+    void close() {
+      if (base != MAP_FAILED) {
+        munmap(base, size);
+        base = MAP_FAILED;
+      }
+      header = nullptr;
+      rows = 0;
+    }
+
+    /// @brief Maps a file and checks that its columns and index lie inside it.
+    bool open(const std::string &path, std::string &err) {
+      close();
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+        err = "can't open " + path;
+        return false;
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ColsHeader)) {
+        ::close(fd);
+        err = path + ": not a columnar trace";
+        return false;
+      }
+      size = st.st_size;
+      base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (base == MAP_FAILED) {
+        err = "can't map " + path;
+        return false;
+      }
+      // Each column is read from front to back.
+      madvise(base, size, MADV_SEQUENTIAL);
+
+      const ColsHeader *h = (const ColsHeader *)base;
+      if (memcmp(h->magic, COLS_MAGIC, sizeof(h->magic)) != 0 || h->columns != COLS_NUM_COLUMNS) {
+        err = path + ": not a columnar trace";
+        close();
+        return false;
+      }
+      if (h->version != COLS_VERSION) {
+        err = path + ": version " + std::to_string(h->version) + ", this reads " + std::to_string(COLS_VERSION);
+        close();
+        return false;
+      }
+      for (int x = 0; x < COLS_NUM_COLUMNS; x++) {
+        const ColsColumn &c = h->column[x];
+        if (c.width != COLS_COLUMN_WIDTHS[x] || c.offset % 8 != 0 || c.offset > size ||
+            h->rows > (size - c.offset) / c.width) {
+          err = path + ": the " + COLS_COLUMN_NAMES[x] + " column is cut short";
+          close();
+          return false;
+        }
+      }
+      if (h->index_offset % 8 != 0 || h->index_offset > size || h->index_count > (size - h->index_offset) / 8) {
+        err = path + ": the index is cut short";
+        close();
+        return false;
+      }
+
+      const uint8_t *b = (const uint8_t *)base;
+      header = h;
+      rows = h->rows;
+      time = (const uint64_t *)(b + h->column[COLS_TIME].offset);
+      value = (const int32_t *)(b + h->column[COLS_VALUE].offset);
+      kind = b + h->column[COLS_KIND].offset;
+      channel = b + h->column[COLS_CHANNEL].offset;
+      index = (const uint64_t *)(b + h->index_offset);
+      index_count = h->index_count;
+      return true;
+    }
+
+    /// @brief Returns the first row at or after a time, using the index to skip to its second.
+    uint64_t find(uint64_t t_us) const {
+      uint64_t sec = t_us / header->index_step_us;
+      if (sec >= index_count) {
+        return rows;
+      }
+      uint64_t row = index[sec];
+      while (row < rows && time[row] < t_us) {
+        row++;
+      }
+      return row;
+    }
+};
+
+#endif
@@ -0,0 +1,239 @@
+// tsunami_midi: checks the Tsunami MIDI mode (USE_TSUNAMI_MIDI) against the gurdy's track layout.
+//
+// This isn't part of the sketch (the Arduino IDE doesn't compile subdirectories).  Build it with:
+//
+//   g++ -std=c++17 -O2 -o tsunami_midi tools/tsunami_midi.cpp
+//
+// Usage:
+//
+//   tsunami_midi map [CH]        Print the MIDI bank and note that play each note of a string (default: all six)
+//   tsunami_midi test            Check the MIDI mode against the track layout, and compare the bytes sent
+//
+// The gurdy's sound packs (see sf2_wavpack) name each file for the track the serial protocol plays: note N of
+// the string on MIDI channel C is track N + 128 * (C - 1), file 0067_hi_melody_G4.wav for track 67.  In MIDI
+// mode the gurdy must reach those same tracks through the Tsunami's MIDI banks, so "test" checks every note of
+// every string plays the same track, and so the same file, either way.  It uses tsunami_midi.h, the code the
+// gurdy runs.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../tsunami_midi.h"
+#include "tool_test.h"
+
+// The strings, by MIDI channel (as created in digigurdy-baz.ino).
+static const char *string_names[6] = {"hi_melody", "lo_melody", "trompette", "drone", "buzz", "keyclick"};
+
+// Bytes per command in the Tsunami serial protocol (Tsunami.cpp).
+const int SERIAL_PLAY_BYTES = 10;
+const int SERIAL_FADE_BYTES = 10;
+const int SERIAL_STOP_BYTES = 10;
+const int SERIAL_GAIN_BYTES = 9;
+
+// The gain GurdyString gives a MIDI volume (GurdyString::setVolume()).
+static int gurdy_gain(int vol) {
+  return int(vol / 128.0 * 80 - 70);
+}
+
+// The file name sf2_wavpack gives a track for a Tsunami, up to the note name.
+static std::string pack_prefix(int track, int channel) {
+  char name[64];
+  snprintf(name, sizeof(name), "%04d_%s", track, string_names[channel - 1]);
+  return name;
+}
+
+static int cmd_map(int only) {
+  for (int ch = 1; ch <= 6; ch++) {
+    if (only != 0 && ch != only) {
+      continue;
+    }
+    std::cout << "Channel " << ch << " (" << string_names[ch - 1] << ")\n";
+    for (int note = 0; note < 128; note++) {
+      int track = trigger_track(ch, note);
+      TsunamiMidiNote n;
+      if (tsunami_midi_note(track, &n)) {
+        printf("  note %3d  track %4d  bank %2d note %3d  %s_*.wav\n", note, track, n.bank, n.note,
+               pack_prefix(track, ch).c_str());
+      } else {
+        printf("  note %3d  track %4d  not playable by MIDI\n", note, track);
+      }
+    }
+  }
+  return 0;
+}
+
+// One Trigger/Tsunami command, as GurdyString makes them.
+struct Command {
+  enum Kind { PLAY, FADE, STOP } kind;
+  int channel;
+  int note;
+};
+
+// Plays a tune the way the gurdy would: the drone and trompette held, then a walk up the keybox on both melody
+// strings with a key click on each key.  Each step is one pass through loop().
+static std::vector<std::vector<Command>> tune() {
+  std::vector<std::vector<Command>> passes;
+  passes.push_back({{Command::PLAY, 4, 43}, {Command::PLAY, 3, 55}});
+
+  int last = -1;
+  for (int step = 0; step < 24; step++) {
+    int note = 55 + step;
+    std::vector<Command> pass;
+    if (last >= 0) {
+      pass.push_back({Command::FADE, 1, last});
+      pass.push_back({Command::FADE, 2, last - 12});
+      pass.push_back({Command::STOP, 6, 60});
+    }
+    pass.push_back({Command::PLAY, 1, note});
+    pass.push_back({Command::PLAY, 2, note - 12});
+    pass.push_back({Command::PLAY, 6, 60});
+    passes.push_back(pass);
+    last = note;
+  }
+  return passes;
+}
+
+// The known cases for "tsunami_midi test".
+static int cmd_test() {
+  ToolTest t;
+
+  // Every note of every string plays the track it plays through the serial protocol, except track 0,
+  // which doesn't exist either way.
+  {
+    int wrong = 0;
+    int unplayable = 0;
+    for (int ch = 1; ch <= 6; ch++) {
+      for (int note = 0; note < 128; note++) {
+        int track = trigger_track(ch, note);
+        TsunamiMidiNote n;
+        if (!tsunami_midi_note(track, &n)) {
+          unplayable++;
+          if (track != 0) {
+            wrong++;
+          }
+          continue;
+        }
+        int midi_track = tsunami_midi_track(n.bank, n.note);
+        if (midi_track != track || n.bank < 1 || n.bank > 32 || n.note < 0 || n.note > 127) {
+          wrong++;
+        }
+      }
+    }
+    t.expect(wrong == 0, "every string's notes play the same tracks by MIDI as by serial command");
+    t.expect(unplayable == 1, "only track 0 (hi melody note 0) can't be played");
+
+    TsunamiMidiNote n;
+    t.expect(tsunami_midi_note(trigger_track(2, 0), &n) && n.bank == 1 && n.note == 127,
+             "a string's note 0 is the previous bank's note 127");
+    t.expect(tsunami_midi_note(trigger_track(4, 43), &n) && n.bank == 4 && n.note == 42, "drone G2 is bank 4 note 42");
+  }
+
+  // Velocity carries the gain: never 0, never falling as the volume rises, and 0 dB at volume 112.
+  {
+    bool ok = true;
+    int prev = 0;
+    for (int vol = 0; vol < 128; vol++) {
+      int v = tsunami_midi_velocity(gurdy_gain(vol));
+      if (v < 1 || v > 127 || v < prev) {
+        ok = false;
+      }
+      prev = v;
+    }
+    t.expect(ok, "velocity is 1-127 and rises with the volume");
+    t.expect(tsunami_midi_velocity(0) == 112, "0 dB is velocity 112");
+    t.expect(tsunami_midi_velocity(-70) == 1 && tsunami_midi_velocity(10) == 127,
+             "the gain range fits the velocity range");
+    t.expect(tsunami_midi_velocity(gurdy_gain(56)) == 55 || tsunami_midi_velocity(gurdy_gain(56)) == 56,
+             "velocity is the string's volume, give or take one");
+  }
+
+  // The encoder's bytes: bank changes, running status and Note-Offs.
+  {
+    TsunamiMidiEncoder e;
+    e.begin(0);
+    uint8_t buf[TSUNAMI_MIDI_MAX_BYTES];
+
+    int len = e.play(trigger_track(1, 60), 100, buf);
+    t.expect(len == 5 && buf[0] == 0xC0 && buf[1] == 0 && buf[2] == 0x90 && buf[3] == 59 && buf[4] == 100,
+             "the first note sends the bank and the status");
+    len = e.stop(trigger_track(1, 60), buf);
+    t.expect(len == 2 && buf[0] == 59 && buf[1] == 0, "a Note-Off in the same bank uses running status");
+    len = e.play(trigger_track(4, 43), 56, buf);
+    t.expect(len == 5 && buf[0] == 0xC0 && buf[1] == 3 && buf[2] == 0x90, "another string's bank is selected first");
+    e.breakStatus();
+    len = e.play(trigger_track(4, 45), 56, buf);
+    t.expect(len == 3 && buf[0] == 0x90, "after a serial command the status is sent again");
+    e.forgetBank();
+    len = e.play(trigger_track(4, 45), 56, buf);
+    t.expect(len == 5, "a forgotten bank is sent again");
+    t.expect(e.play(0, 56, buf) == 0, "track 0 sends nothing");
+
+    e.begin(3);
+    len = e.play(trigger_track(1, 60), 100, buf);
+    t.expect(buf[0] == 0xC3 && buf[2] == 0x93, "the channel is the output");
+  }
+
+  // What the MIDI mode saves on a tune.
+  {
+    int serial = 0;
+    int midi = 0;
+    int gain_sent[7][128] = {};
+    TsunamiMidiEncoder e;
+    e.begin(0);
+    uint8_t buf[TSUNAMI_MIDI_MAX_BYTES];
+    int events = 0;
+
+    for (auto &pass : tune()) {
+      e.breakStatus();
+      for (auto &c : pass) {
+        int track = trigger_track(c.channel, c.note);
+        events++;
+        if (c.kind == Command::PLAY) {
+          if (!gain_sent[c.channel][c.note]) {
+            serial += SERIAL_GAIN_BYTES;
+            gain_sent[c.channel][c.note] = 1;
+          }
+          serial += SERIAL_PLAY_BYTES;
+          midi += e.play(track, tsunami_midi_velocity(gurdy_gain(56)), buf);
+        } else {
+          serial += (c.kind == Command::FADE) ? SERIAL_FADE_BYTES : SERIAL_STOP_BYTES;
+          midi += e.stop(track, buf);
+        }
+      }
+    }
+    printf("  %d commands: serial protocol %d bytes (%.1f each), MIDI %d bytes (%.1f each)\n", events, serial,
+           (double)serial / events, midi, (double)midi / events);
+    t.expect(midi * 2 < serial, "MIDI takes less than half the bytes");
+  }
+
+  return t.finish();
+}
+
+static void usage() {
+  std::cerr << "usage: tsunami_midi map [CH]\n"
+               "       tsunami_midi test\n";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 2;
+  }
+  std::string cmd = argv[1];
+
+  if (cmd == "map") {
+    int only = (argc >= 3) ? atoi(argv[2]) : 0;
+    if (only < 0 || only > 6) {
+      usage();
+      return 2;
+    }
+    return cmd_map(only);
+  } else if (cmd == "test") {
+    return cmd_test();
+  }
+  usage();
+  return 2;
+}
@@ -0,0 +1,273 @@
+#include "trace.h"
+
+#include <SD.h>
+
+#include "common.h"
+#include "display.h"
+
+/// @defgroup trace Timeline Tracing
+/// These functions record a timeline of what loop() does, for viewing in Perfetto (ui.perfetto.dev) or
+/// Chrome's about:tracing.
+///
+/// While tracing, the main stages of loop() (reading the keybox, updating the crank, turning strings on and
+/// off, drawing the play screen and draining incoming MIDI) are timed with the CPU cycle counter, and every
+/// outbound MIDI message is stamped as it is sent.  A key change then shows up as one loop() with the
+/// NoteOff/NoteOn burst and the display update next to each other, so it's easy to see what holds up the
+/// next note.
+///
+/// Most passes through loop() only read the keys and crank, so a pass is only kept if it sent something,
+/// drew something or took longer than TRACE_SLOW_LOOP_US.  Kept events go in a ring buffer that holds the
+/// latest TRACE_EVENTS of them, so a trace can be saved right after a hiccup.  Saved traces go in TRACE_DIR.
+/// `tools/trace_cols.cpp` packs a session's worth of them, with any crank captures, into one file to analyze.
+/// @version *New in 3.1.0*
+/// @{
+
+volatile bool tracing = false;
+
+#ifdef USE_TRACE
+
+static const char *trace_names[TRACE_NAME_COUNT] = {
+  "loop", "getMaxOffset", "crank update", "soundOn", "soundOff", "draw_play_screen", "MIDI drain",
+  "NoteOn", "NoteOff", "CC", "PitchBend", "Pressure"
+};
+
+struct TraceEvent {
+  uint32_t time;      // micros() since trace_start()
+  uint32_t cycles;    // Span length in CPU cycles, 0 for messages
+  int16_t value;      // Message note/controller/bend
+  uint8_t channel;    // Message MIDI channel
+  uint8_t name;       // A TraceName
+};
+
+// This is big, so it goes in the Teensy 4.1's second RAM bank.
+DMAMEM static TraceEvent trace_buf[TRACE_EVENTS];
+static int trace_head = 0;
+static int trace_len = 0;
+static uint32_t trace_start_us = 0;
+
+// The events of the current loop() pass, held until we know if it's worth keeping.
+const int TRACE_LOOP_EVENTS = 48;
+static TraceEvent loop_buf[TRACE_LOOP_EVENTS];
+static int loop_len = 0;
+static bool loop_open = false;
+static bool loop_keep = false;
+static uint32_t loop_start_us = 0;
+static uint32_t loop_start_cycles = 0;
+
+static void trace_store(const TraceEvent &e) {
+  trace_buf[trace_head] = e;
+  trace_head = (trace_head + 1) % TRACE_EVENTS;
+  if (trace_len < TRACE_EVENTS) {
+    trace_len++;
+  };
+};
+
+static void trace_add(TraceName name, uint32_t time, uint32_t cycles, int channel, int value) {
+  TraceEvent e;
+  e.time = time - trace_start_us;
+  e.cycles = cycles;
+  e.value = value;
+  e.channel = channel;
+  e.name = name;
+
+  if (!loop_open) {
+    trace_store(e);
+    return;
+  };
+
+  if (loop_len < TRACE_LOOP_EVENTS) {
+    loop_buf[loop_len++] = e;
+  };
+
+  // Reading the keys and crank and draining MIDI happen every pass; anything else is worth seeing.
+  if (name != TRACE_MAX_OFFSET && name != TRACE_CRANK && name != TRACE_MIDI_DRAIN) {
+    loop_keep = true;
+  };
+};
+
+/// @brief Records a timed stage.  TRACE_SCOPE() calls this.
+/// @param name The stage
+/// @param start_us The stage's starting micros()
+/// @param cycles The stage's length in CPU cycles
+void trace_span(TraceName name, uint32_t start_us, uint32_t cycles) {
+  trace_add(name, start_us, cycles, 0, 0);
+};
+
+/// @brief Records an outbound message.  TRACE_MESSAGE() calls this.
+/// @param name TRACE_NOTE_ON, TRACE_NOTE_OFF, TRACE_CC, TRACE_PITCH_BEND or TRACE_PRESSURE
+/// @param channel The MIDI channel
+/// @param value The note, controller or bend amount
+void trace_message(TraceName name, int channel, int value) {
+  trace_add(name, micros(), 0, channel, value);
+};
+
+/// @brief Marks the start of a loop() pass.
+void trace_loop_begin() {
+  loop_open = tracing;
+  loop_keep = false;
+  loop_len = 0;
+  loop_start_us = micros();
+  loop_start_cycles = ARM_DWT_CYCCNT;
+};
+
+/// @brief Marks the end of a loop() pass, keeping its events if anything interesting happened.
+void trace_loop_end() {
+  if (!loop_open) {
+    return;
+  };
+  loop_open = false;
+
+  if (!tracing) {
+    return;
+  };
+
+  uint32_t cycles = ARM_DWT_CYCCNT - loop_start_cycles;
+  if (!loop_keep && micros() - loop_start_us < TRACE_SLOW_LOOP_US) {
+    return;
+  };
+
+  trace_add(TRACE_LOOP, loop_start_us, cycles, 0, 0);
+  for (int x = 0; x < loop_len; x++) {
+    trace_store(loop_buf[x]);
+  };
+};
+
+/// @brief Throws away any previous trace and starts a new one.
+void trace_start() {
+  tracing = false;
+  trace_head = 0;
+  trace_len = 0;
+  loop_open = false;
+  trace_start_us = micros();
+  tracing = true;
+};
+
+/// @brief Stops tracing.  The trace is kept until the next trace_start().
+void trace_stop() {
+  tracing = false;
+};
+
+/// @brief Returns the number of events in the trace.
+int trace_count() {
+  return trace_len;
+};
+
+/// @brief Saves the trace to the next free file name in TRACE_DIR as Chrome trace JSON.
+/// @param path Set to the saved file's path
+/// @return True if saved, false if there is no card or the card is full.
+bool trace_save(String *path) {
+  tracing = false;
+
+  if (!SD.begin(BUILTIN_SDCARD)) {
+    return false;
+  };
+
+  if (!SD.exists(TRACE_DIR)) {
+    SD.mkdir(TRACE_DIR);
+  };
+
+  int num = 0;
+  char name[48];
+  do {
+    snprintf(name, sizeof(name), "%s/trace%03d.json", TRACE_DIR, num);
+    num++;
+  } while (SD.exists(name) && num < 1000);
+
+  File f = SD.open(name, FILE_WRITE);
+  if (!f) {
+    return false;
+  };
+
+  // Stages go on one track and outbound messages on another.
+  f.print("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"DigiGurdy\"}},\n"
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"loop()\"}},\n"
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"MIDI out\"}}");
+
+  double cycles_per_us = F_CPU_ACTUAL / 1000000.0;
+
+  // Batch the lines up so the card sees whole blocks.
+  char block[512];
+  char line[160];
+  int used = 0;
+  int len;
+
+  int first = (trace_head - trace_len + TRACE_EVENTS) % TRACE_EVENTS;
+  for (int x = 0; x < trace_len; x++) {
+    TraceEvent *e = &trace_buf[(first + x) % TRACE_EVENTS];
+
+    if (e->name >= TRACE_NOTE_ON) {
+      len = snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":2,\"ts\":%lu,\"args\":{\"ch\":%d,\"value\":%d}}",
+                     trace_names[e->name], (unsigned long)e->time, e->channel, e->value);
+    } else {
+      len = snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%.3f}",
+                     trace_names[e->name], (unsigned long)e->time, e->cycles / cycles_per_us);
+    };
+
+    if (used + len > (int)sizeof(block)) {
+      f.write((const uint8_t *)block, used);
+      used = 0;
+    };
+    memcpy(block + used, line, len);
+    used += len;
+  };
+  f.write((const uint8_t *)block, used);
+  f.print("\n]}\n");
+  f.close();
+
+  *path = String(name);
+  return true;
+};
+
+/// @brief Prompts the user to start, stop and save traces.
+/// @return True if tracing was started (so the menus should close and play resume), false otherwise.
+bool trace_screen() {
+
+  bool done = false;
+  while (!done) {
+
+    String title = String("Trace: ") + trace_count();
+    String opt1 = tracing ? "Stop Tracing" : "Start Tracing";
+    String opt2 = trace_count() > 0 ? "Save to SD Card" : "";
+
+    print_menu_2(title, opt1, opt2);
+    delay(150);
+
+    my1Button->update();
+    my2Button->update();
+    my3Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      if (tracing) {
+        trace_stop();
+      } else {
+        trace_start();
+        print_message_2("Trace", "Tracing started,", "play away!");
+        delay(1000);
+        return true;
+      };
+
+    } else if (my2Button->wasPressed() && trace_count() > 0) {
+      print_message_2("Trace", "Saving to SD card,", "Please wait...");
+
+      String path;
+      if (trace_save(&path)) {
+        print_message_2("Trace", "Saved as:", path);
+      } else {
+        print_message_2("Trace", "Could not save,", "check the SD card.");
+      };
+      delay(2000);
+
+    } else if (my3Button->wasPressed() || myXButton->wasPressed()) {
+      done = true;
+    };
+  };
+  return false;
+};
+
+#endif
+
+/// @}
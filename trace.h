@@ -0,0 +1,72 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// The things a trace records.  Stages are timed spans of loop(), the rest are outbound messages.
+enum TraceName : uint8_t {
+  TRACE_LOOP = 0,
+  TRACE_MAX_OFFSET,
+  TRACE_CRANK,
+  TRACE_SOUND_ON,
+  TRACE_SOUND_OFF,
+  TRACE_DISPLAY,
+  TRACE_MIDI_DRAIN,
+  TRACE_NOTE_ON,
+  TRACE_NOTE_OFF,
+  TRACE_CC,
+  TRACE_PITCH_BEND,
+  TRACE_PRESSURE,
+  TRACE_NAME_COUNT
+};
+
+extern volatile bool tracing;
+
+void trace_span(TraceName name, uint32_t start_us, uint32_t cycles);
+void trace_message(TraceName name, int channel, int value);
+
+void trace_loop_begin();
+void trace_loop_end();
+
+void trace_start();
+void trace_stop();
+int trace_count();
+bool trace_save(String *path);
+
+bool trace_screen();
+
+/// @ingroup trace
+/// @brief Times the enclosing block as one trace stage.  Use through TRACE_SCOPE().
+class TraceScope {
+  private:
+    TraceName name;
+    bool active;              // Whether tracing was on when the block began
+    uint32_t start_us;
+    uint32_t start_cycles;
+
+  public:
+    TraceScope(TraceName my_name) : name(my_name), active(tracing), start_us(0), start_cycles(0) {
+      if (active) {
+        start_us = micros();
+        start_cycles = ARM_DWT_CYCCNT;
+      };
+    };
+
+    ~TraceScope() {
+      if (active) {
+        trace_span(name, start_us, ARM_DWT_CYCCNT - start_cycles);
+      };
+    };
+};
+
+#ifdef USE_TRACE
+  #define TRACE_SCOPE(name) TraceScope trace_scope_(name)
+  #define TRACE_MESSAGE(name, channel, value) if (tracing) { trace_message(name, channel, value); }
+#else
+  #define TRACE_SCOPE(name)
+  #define TRACE_MESSAGE(name, channel, value)
+#endif
+
+#endif
@@ -0,0 +1,298 @@
+#include "traffic.h"
+
+#include "common.h"
+#include "display.h"
+#include "midi_in.h"
+
+/// @defgroup traffic MIDI and Trigger Traffic Counters
+/// These functions count what the gurdy sends on each of its links, so an overloaded link shows up before
+/// notes start going missing.
+///
+/// Every message GurdyString sends is counted by link (USB MIDI, the MIDI-OUT socket, the Trigger/Tsunami
+/// serial port) and by kind, along with the bytes it puts on the wire.  Once a second the byte rate is
+/// worked out, and at the end of every pass through loop() the bytes sent in that pass (the burst) are
+/// checked against the largest so far.  The slow links can then be judged against what they can carry:
+/// MIDI-OUT runs at 31250 baud (3125 bytes a second) and the Trigger/Tsunami at 57600 (5760 bytes a
+/// second), so a 96-byte burst ties up MIDI-OUT for 31ms.
+///
+/// The counters are shown in Other Options -> Diagnostics -> MIDI Traffic, and sent to Serial every
+/// TRAFFIC_REPORT_MS.
+/// @version *New in 3.1.0*
+/// @{
+
+TrafficStats traffic[TRAFFIC_SINK_COUNT];
+
+#ifdef USE_TRAFFIC_STATS
+
+static const char *traffic_sink_names[TRAFFIC_SINK_COUNT] = {"USB", "MIDI", "Trig"};
+
+// Bytes a second each link can carry, 0 if it's fast enough not to matter.
+static const uint32_t traffic_link_rate[TRAFFIC_SINK_COUNT] = {0, 31250 / 10, 57600 / 10};
+
+// The traffic screen's pages, with incoming MIDI on the last if USE_MIDI_IN is enabled.
+#ifdef USE_MIDI_IN
+static const int traffic_pages = 4;
+#else
+static const int traffic_pages = 3;
+#endif
+
+// The bytes each kind of message puts on each link.  USB MIDI always sends 4-byte packets; the Trigger and
+// Tsunami command lengths come from wavTrigger.cpp and Tsunami.cpp.
+#ifdef USE_TSUNAMI
+static const uint8_t TRAFFIC_PLAY_BYTES = 10;
+static const uint8_t TRAFFIC_STOP_BYTES = 10;
+#else
+static const uint8_t TRAFFIC_PLAY_BYTES = 9;
+static const uint8_t TRAFFIC_STOP_BYTES = 8;
+#endif
+
+static const uint8_t traffic_bytes[TRAFFIC_SINK_COUNT][TRAFFIC_KIND_COUNT] = {
+  {4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0},
+  {3, 3, 3, 3, 3, 3, 3, 2, 2, 0, 0, 0, 0, 0},
+  {0, 0, 0, 0, 0, 0, 0, 0, 0, TRAFFIC_PLAY_BYTES, 12, TRAFFIC_STOP_BYTES, 9, 5}
+};
+
+static uint32_t window_start_ms = 0;
+static uint32_t window_bytes[TRAFFIC_SINK_COUNT];
+static uint32_t last_report_ms = 0;
+
+/// @brief Counts one message sent on a link.  Use through TRAFFIC_COUNT().
+/// @param sink The link it was sent on
+/// @param kind What it was
+void traffic_count(TrafficSink sink, TrafficKind kind) {
+  traffic_count_bytes(sink, kind, traffic_bytes[sink][kind]);
+};
+
+/// @brief Counts one message of a length that varies, such as Tsunami MIDI.  Use through TRAFFIC_COUNT_BYTES().
+/// @param sink The link it was sent on
+/// @param kind What it was
+/// @param bytes How long it was
+void traffic_count_bytes(TrafficSink sink, TrafficKind kind, int bytes) {
+  TrafficStats *t = &traffic[sink];
+  t->messages[kind]++;
+  t->bytes += bytes;
+  t->loop_bytes += bytes;
+};
+
+/// @brief Returns the TrafficKind of a MIDI CC.
+/// @param cc The controller number
+TrafficKind traffic_cc_kind(int cc) {
+  if (cc == 1) {
+    return TRAFFIC_CC1;
+  } else if (cc == 11 || cc == 43) {
+    return TRAFFIC_CC11;
+  } else if (cc == 123) {
+    return TRAFFIC_CC123;
+  };
+  return TRAFFIC_CC_OTHER;
+};
+
+/// @brief Marks the end of a loop() pass: tracks the largest burst, the byte rates and the Serial report.
+/// @note This is meant to be run every loop() cycle.
+void traffic_loop_end() {
+  for (int s = 0; s < TRAFFIC_SINK_COUNT; s++) {
+    if (traffic[s].loop_bytes > traffic[s].peak_loop_bytes) {
+      traffic[s].peak_loop_bytes = traffic[s].loop_bytes;
+    };
+    traffic[s].loop_bytes = 0;
+  };
+
+  uint32_t now = millis();
+  uint32_t elapsed = now - window_start_ms;
+  if (elapsed >= 1000) {
+    for (int s = 0; s < TRAFFIC_SINK_COUNT; s++) {
+      traffic[s].bytes_per_sec = (traffic[s].bytes - window_bytes[s]) * 1000 / elapsed;
+      if (traffic[s].bytes_per_sec > traffic[s].peak_bytes_per_sec) {
+        traffic[s].peak_bytes_per_sec = traffic[s].bytes_per_sec;
+      };
+      window_bytes[s] = traffic[s].bytes;
+    };
+    window_start_ms = now;
+  };
+
+  if (TRAFFIC_REPORT_MS > 0 && now - last_report_ms >= (uint32_t)TRAFFIC_REPORT_MS) {
+    last_report_ms = now;
+    traffic_report();
+  };
+};
+
+/// @brief Zeroes every counter and peak.
+void traffic_reset() {
+  memset(traffic, 0, sizeof(traffic));
+  memset(window_bytes, 0, sizeof(window_bytes));
+  window_start_ms = millis();
+};
+
+/// @brief Returns how much of a link a byte count uses, in percent, or -1 if the link has no limit.
+static int traffic_load(int sink, uint32_t bytes_per_sec) {
+  if (traffic_link_rate[sink] == 0) {
+    return -1;
+  };
+  return bytes_per_sec * 100 / traffic_link_rate[sink];
+};
+
+/// @brief Returns how long a burst ties up a link, in milliseconds (0 if the link has no limit).
+static uint32_t traffic_drain_ms(int sink, uint32_t bytes) {
+  if (traffic_link_rate[sink] == 0) {
+    return 0;
+  };
+  return bytes * 1000 / traffic_link_rate[sink];
+};
+
+/// @brief Sends a one-line summary of every link to Serial.
+/// @details For example: `traffic USB 340B/s pk 1204 burst 96 | MIDI 255B/s 8% pk 903 29% burst 72 23ms | Trig ...`
+void traffic_report() {
+  char line[200];
+  int len = snprintf(line, sizeof(line), "traffic");
+
+  for (int s = 0; s < TRAFFIC_SINK_COUNT && len < (int)sizeof(line); s++) {
+    const TrafficStats *t = &traffic[s];
+    if (traffic_link_rate[s] == 0) {
+      len += snprintf(line + len, sizeof(line) - len, "%s %s %luB/s pk %lu burst %lu", (s > 0) ? " |" : "",
+                      traffic_sink_names[s], (unsigned long)t->bytes_per_sec, (unsigned long)t->peak_bytes_per_sec,
+                      (unsigned long)t->peak_loop_bytes);
+    } else {
+      len += snprintf(line + len, sizeof(line) - len, "%s %s %luB/s %d%% pk %lu %d%% burst %lu %lums", (s > 0) ? " |" : "",
+                      traffic_sink_names[s], (unsigned long)t->bytes_per_sec, traffic_load(s, t->bytes_per_sec),
+                      (unsigned long)t->peak_bytes_per_sec, traffic_load(s, t->peak_bytes_per_sec),
+                      (unsigned long)t->peak_loop_bytes, (unsigned long)traffic_drain_ms(s, t->peak_loop_bytes));
+    };
+  };
+  Serial.println(line);
+};
+
+/// @brief Draws one page of the traffic screen: a title and six lines.
+static void traffic_draw_page(const char *title, char lines[6][40]) {
+  u8g2.clearBuffer();
+  u8g2.setFontMode(1);
+  u8g2.setFont(u8g2_font_finderskeepers_tf);
+
+  // Print a pretty 3-stripe line "around" the title
+  int half = u8g2.getStrWidth(title) / 2;
+  u8g2.drawHLine(0, 2, 61 - half);
+  u8g2.drawHLine(0, 4, 61 - half);
+  u8g2.drawHLine(0, 6, 61 - half);
+  u8g2.drawHLine(67 + half, 2, 64);
+  u8g2.drawHLine(67 + half, 4, 64);
+  u8g2.drawHLine(67 + half, 6, 64);
+  u8g2.drawStr(64 - half, 8, title);
+
+  for (int x = 0; x < 6; x++) {
+    u8g2.drawStr(0, 16 + x * 8, lines[x]);
+  };
+  u8g2.drawStr(64 - (u8g2.getStrWidth("1) Page 2) Reset X) Back") / 2), 64, "1) Page 2) Reset X) Back");
+
+  u8g2.sendBuffer();
+};
+
+/// @brief Shows the traffic counters, updating live.  Pages show rates and bursts, MIDI messages,
+/// Trigger/Tsunami commands and, if USE_MIDI_IN is enabled, incoming MIDI.
+void traffic_screen() {
+
+  int page = 0;
+  bool done = false;
+  while (!done) {
+
+    char lines[6][40];
+    char title[24];
+    const TrafficStats *usb = &traffic[TRAFFIC_USB];
+    const TrafficStats *ser = &traffic[TRAFFIC_SERIAL];
+    const TrafficStats *trig = &traffic[TRAFFIC_TRIGGER];
+
+    if (page == 0) {
+      // Two lines a link: rate and peak rate, then peak burst and how long it ties up the link.
+      for (int s = 0; s < TRAFFIC_SINK_COUNT; s++) {
+        const TrafficStats *t = &traffic[s];
+        if (traffic_link_rate[s] == 0) {
+          snprintf(lines[s * 2], 40, "%-4s %5luB/s  pk %lu", traffic_sink_names[s],
+                   (unsigned long)t->bytes_per_sec, (unsigned long)t->peak_bytes_per_sec);
+          snprintf(lines[s * 2 + 1], 40, "  burst pk %luB", (unsigned long)t->peak_loop_bytes);
+        } else {
+          snprintf(lines[s * 2], 40, "%-4s %5luB/s  pk %d%%", traffic_sink_names[s],
+                   (unsigned long)t->bytes_per_sec, traffic_load(s, t->peak_bytes_per_sec));
+          snprintf(lines[s * 2 + 1], 40, "  burst pk %luB %lums", (unsigned long)t->peak_loop_bytes,
+                   (unsigned long)traffic_drain_ms(s, t->peak_loop_bytes));
+        };
+        #ifdef USE_OUTPUT_GATING
+        if (!sinks[s].alive) {
+          strncat(lines[s * 2 + 1], " DEAD", 39 - strlen(lines[s * 2 + 1]));
+        };
+        #endif
+      };
+      snprintf(title, sizeof(title), "Traffic 1/%d", traffic_pages);
+      traffic_draw_page(title, lines);
+
+    } else if (page == 1) {
+      const char *names[6] = {"On", "Off", "CC1", "CC11", "CC123", "Other"};
+      for (int x = 0; x < 6; x++) {
+        uint32_t u = usb->messages[x];
+        uint32_t m = ser->messages[x];
+        if (x == 5) {
+          u += usb->messages[TRAFFIC_PITCH_BEND] + usb->messages[TRAFFIC_PROGRAM] + usb->messages[TRAFFIC_PRESSURE];
+          m += ser->messages[TRAFFIC_PITCH_BEND] + ser->messages[TRAFFIC_PROGRAM] + ser->messages[TRAFFIC_PRESSURE];
+        };
+        snprintf(lines[x], 40, "%-6s %8lu %8lu", names[x], (unsigned long)u, (unsigned long)m);
+      };
+      snprintf(title, sizeof(title), "USB / MIDI-OUT 2/%d", traffic_pages);
+      traffic_draw_page(title, lines);
+
+    } else if (page == 2) {
+      snprintf(lines[0], 40, "Play       %8lu", (unsigned long)trig->messages[TRAFFIC_TRACK_PLAY]);
+      snprintf(lines[1], 40, "Fade/Stop  %8lu %lu", (unsigned long)trig->messages[TRAFFIC_TRACK_FADE],
+               (unsigned long)trig->messages[TRAFFIC_TRACK_STOP]);
+      snprintf(lines[2], 40, "Gain       %8lu", (unsigned long)trig->messages[TRAFFIC_TRACK_GAIN]);
+      snprintf(lines[3], 40, "Stop All   %8lu", (unsigned long)trig->messages[TRAFFIC_STOP_ALL]);
+      snprintf(lines[4], 40, "Bytes      %8lu", (unsigned long)trig->bytes);
+      lines[5][0] = '\0';
+      #ifdef USE_OUTPUT_GATING
+      snprintf(lines[5], 40, "%-10s %8lu", sinks[TRAFFIC_TRIGGER].alive ? "Dropped" : "DEAD, drop",
+               (unsigned long)sinks[TRAFFIC_TRIGGER].dropped);
+      #endif
+      snprintf(title, sizeof(title), "Trigger 3/%d", traffic_pages);
+      traffic_draw_page(title, lines);
+
+    #ifdef USE_MIDI_IN
+    } else {
+      // Latency is an upper bound: see midi_in_pass_begin().
+      const MidiInStats *in = &midi_in_stats;
+      uint32_t avg = in->latency_count ? (uint32_t)(in->latency_total_us / in->latency_count) : 0;
+      snprintf(lines[0], 40, "Received   %8lu", (unsigned long)in->received);
+      snprintf(lines[1], 40, "On/Off     %8lu %lu", (unsigned long)in->note_ons, (unsigned long)in->note_offs);
+      snprintf(lines[2], 40, "CC/Live    %8lu %lu", (unsigned long)in->ccs, (unsigned long)in->live);
+      snprintf(lines[3], 40, "Late/Ignrd %8lu %lu", (unsigned long)in->late, (unsigned long)in->ignored);
+      snprintf(lines[4], 40, "Full passes%8lu", (unsigned long)in->full_passes);
+      snprintf(lines[5], 40, "Lat avg %luus max %luus", (unsigned long)avg, (unsigned long)in->latency_max_us);
+      traffic_draw_page("MIDI In 4/4", lines);
+    #endif
+    };
+
+    delay(150);
+
+    // Keep the rates moving while the screen is up.
+    traffic_loop_end();
+
+    my1Button->update();
+    my2Button->update();
+    myXButton->update();
+
+    if (my1Button->wasPressed()) {
+      page = (page + 1) % traffic_pages;
+
+    } else if (my2Button->wasPressed()) {
+      traffic_reset();
+      #ifdef USE_OUTPUT_GATING
+      sink_reset();
+      #endif
+      #ifdef USE_MIDI_IN
+      midi_in_reset();
+      #endif
+
+    } else if (myXButton->wasPressed()) {
+      done = true;
+    };
+  };
+};
+
+#endif
+
+/// @}
@@ -0,0 +1,62 @@
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// The links the gurdy sends on.
+enum TrafficSink : uint8_t {
+  TRAFFIC_USB = 0,        // usbMIDI
+  TRAFFIC_SERIAL,         // The MIDI-OUT socket
+  TRAFFIC_TRIGGER,        // A Trigger/Tsunami unit
+  TRAFFIC_SINK_COUNT
+};
+
+// The kinds of messages counted.
+enum TrafficKind : uint8_t {
+  TRAFFIC_NOTE_ON = 0,
+  TRAFFIC_NOTE_OFF,
+  TRAFFIC_CC1,            // Modulation (vibrato)
+  TRAFFIC_CC11,           // Expression (and its LSB, CC43)
+  TRAFFIC_CC123,          // All notes off
+  TRAFFIC_CC_OTHER,
+  TRAFFIC_PITCH_BEND,
+  TRAFFIC_PROGRAM,
+  TRAFFIC_PRESSURE,       // Channel pressure (MPE expression)
+  TRAFFIC_TRACK_PLAY,     // trackPlayPoly()
+  TRAFFIC_TRACK_FADE,
+  TRAFFIC_TRACK_STOP,     // trackStop() (the key click)
+  TRAFFIC_TRACK_GAIN,
+  TRAFFIC_STOP_ALL,
+  TRAFFIC_KIND_COUNT
+};
+
+struct TrafficStats {
+  uint32_t messages[TRAFFIC_KIND_COUNT];
+  uint32_t bytes;                 // Since the last reset
+  uint32_t bytes_per_sec;         // Over the last whole second
+  uint32_t peak_bytes_per_sec;
+  uint32_t loop_bytes;            // So far this pass through loop()
+  uint32_t peak_loop_bytes;       // The most sent in one pass through loop()
+};
+
+extern TrafficStats traffic[TRAFFIC_SINK_COUNT];
+
+void traffic_count(TrafficSink sink, TrafficKind kind);
+void traffic_count_bytes(TrafficSink sink, TrafficKind kind, int bytes);
+TrafficKind traffic_cc_kind(int cc);
+void traffic_loop_end();
+void traffic_reset();
+void traffic_report();
+void traffic_screen();
+
+#ifdef USE_TRAFFIC_STATS
+  #define TRAFFIC_COUNT(sink, kind) traffic_count(sink, kind)
+  #define TRAFFIC_COUNT_BYTES(sink, kind, bytes) traffic_count_bytes(sink, kind, bytes)
+#else
+  #define TRAFFIC_COUNT(sink, kind)
+  #define TRAFFIC_COUNT_BYTES(sink, kind, bytes)
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef TSUNAMI_MIDI_H
+#define TSUNAMI_MIDI_H
+
+// The Trigger/Tsunami track layout, and the Tsunami's MIDI mode (USE_TSUNAMI_MIDI in config.h).  This header is
+// plain C++ with no Arduino dependencies so tools/tsunami_midi.cpp can check the MIDI mode against the track
+// layout with exactly the same code.  GurdyString uses it on the gurdy.
+//
+// The gurdy plays note N of the string on MIDI channel C as track N + 128 * (C - 1), through the units' serial
+// protocol: a 10-byte Tsunami packet for every play and fade, and another for the gain when it changes.
+//
+// The Tsunami also plays tracks from MIDI on the same serial input.  A Note-On plays track
+// (bank - 1) * 128 + note + 1 of the current MIDI bank, at a gain set by its velocity, and the Note-Off releases
+// it.  So a string's notes are sent as Note-On/Note-Off on one MIDI channel (the output, TSUNAMI_OUT + 1),
+// after a Program Change to the right bank when it's different from the last one.  Note-Offs are sent as
+// velocity 0 Note-Ons so consecutive notes share running status: 2 bytes each, 3 with the status byte and 2
+// more for a bank change, instead of 10 (plus 9 for the gain).
+//
+// One bank holds 128 tracks but starts one track later than the string's layout, so a string's note 0 is the
+// previous bank's note 127 and the first string's note 0 (track 0) can't be played.  The gurdy never plays it.
+
+#include <stdint.h>
+
+// The tracks a Tsunami can hold, numbered from 1.
+const int TSUNAMI_MIDI_TRACKS = 4096;
+
+// The track played by MIDI note 0 of bank 1.
+const int TSUNAMI_MIDI_FIRST_TRACK = 1;
+
+// The most a single event takes: Program Change (2) and Note-On with its status byte (3).
+const int TSUNAMI_MIDI_MAX_BYTES = 5;
+
+/// @brief Returns the Trigger/Tsunami track a string plays a note on.
+/// @param channel The string's MIDI channel, 1-16
+/// @param note The MIDI note
+inline int trigger_track(int channel, int note) {
+  return note + 128 * (channel - 1);
+};
+
+// Where a track is in the Tsunami's MIDI banks.
+struct TsunamiMidiNote {
+  int bank;       // 1-32
+  int note;       // 0-127
+};
+
+/// @brief Finds the MIDI bank and note that play a track.
+/// @param track The track
+/// @param out Set to the bank and note
+/// @return False if MIDI can't play the track.
+inline bool tsunami_midi_note(int track, TsunamiMidiNote *out) {
+  if (track < TSUNAMI_MIDI_FIRST_TRACK || track >= TSUNAMI_MIDI_FIRST_TRACK + TSUNAMI_MIDI_TRACKS) {
+    return false;
+  };
+  out->bank = (track - TSUNAMI_MIDI_FIRST_TRACK) / 128 + 1;
+  out->note = (track - TSUNAMI_MIDI_FIRST_TRACK) % 128;
+  return true;
+};
+
+/// @brief Returns the track the Tsunami plays for a MIDI bank and note.
+inline int tsunami_midi_track(int bank, int note) {
+  return (bank - 1) * 128 + note + TSUNAMI_MIDI_FIRST_TRACK;
+};
+
+/// @brief Returns the Note-On velocity for a track gain.
+/// @param gain The gain in dB, -70 to +10 (see GurdyString::setVolume())
+/// @details The inverse of the gain the gurdy gives a MIDI volume, so the velocity is the string's volume and
+/// 112 is 0 dB, as on the line out.  Never 0, which would be a Note-Off.
+inline uint8_t tsunami_midi_velocity(int gain) {
+  int v = (gain + 70) * 8 / 5;
+  if (v < 1) {
+    return 1;
+  } else if (v > 127) {
+    return 127;
+  };
+  return (uint8_t)v;
+};
+
+/// @brief Turns track plays and stops into MIDI bytes, keeping track of running status and the MIDI bank.
+class TsunamiMidiEncoder {
+  private:
+    uint8_t channel = 0;      // 0-15
+    uint8_t status = 0;       // The running status, 0 if there is none
+    int bank = 0;             // The Tsunami's MIDI bank, 0 if not known
+
+    int note(int track, uint8_t velocity, uint8_t *buf) {
+      TsunamiMidiNote n;
+      if (!tsunami_midi_note(track, &n)) {
+        return 0;
+      };
+
+      int len = 0;
+      if (n.bank != bank) {
+        buf[len++] = 0xC0 | channel;
+        buf[len++] = (uint8_t)(n.bank - 1);
+        bank = n.bank;
+        status = 0;
+      };
+      if (status != (0x90 | channel)) {
+        status = 0x90 | channel;
+        buf[len++] = status;
+      };
+      buf[len++] = (uint8_t)n.note;
+      buf[len++] = velocity;
+      return len;
+    };
+
+  public:
+    /// @brief Sets the MIDI channel and forgets the bank and running status.
+    /// @param out The Tsunami output, 0-15, which is the MIDI channel less one
+    void begin(int out) {
+      channel = (uint8_t)(out & 0x0F);
+      status = 0;
+      bank = 0;
+    };
+
+    /// @brief Forgets the running status.  Call this after anything else is sent on the port.
+    void breakStatus() {
+      status = 0;
+    };
+
+    /// @brief Forgets the bank too, e.g. when the Tsunami may have restarted.
+    void forgetBank() {
+      status = 0;
+      bank = 0;
+    };
+
+    /// @brief Encodes playing a track.
+    /// @param buf At least TSUNAMI_MIDI_MAX_BYTES long
+    /// @return The bytes written to buf, 0 if MIDI can't play the track.
+    int play(int track, uint8_t velocity, uint8_t *buf) {
+      return note(track, velocity, buf);
+    };
+
+    /// @brief Encodes stopping a track, as a velocity 0 Note-On.
+    /// @param buf At least TSUNAMI_MIDI_MAX_BYTES long
+    /// @return The bytes written to buf, 0 if MIDI can't play the track.
+    int stop(int track, uint8_t *buf) {
+      return note(track, 0, buf);
+    };
+};
+
+#endif
@@ -20,7 +20,7 @@ uint8_t txbuf[5];
 
 	versionRcvd = false;
 	sysinfoRcvd = false;
-	WTSerial.begin(57600);
+	WTOut.begin(57600);
 	flush();
 
 	// Request version string
@@ -29,7 +29,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_GET_VERSION;
 	txbuf[4] = EOMWT;
-	WTSerial.write(txbuf, 5);
+	WTOut.write(txbuf, 5);
 
 	// Request system info
 	txbuf[0] = SOM1;
@@ -37,7 +37,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_GET_SYS_INFO;
 	txbuf[4] = EOMWT;
-	WTSerial.write(txbuf, 5);
+	WTOut.write(txbuf, 5);
 }
 
 // **************************************************************
@@ -52,8 +52,8 @@ int i;
 	for (i = 0; i < MAX_NUM_VOICES; i++) {
 	  voiceTable[i] = 0xffff;
 	}
-	while(WTSerial.available())
-		WTSerial.read();
+	while(WTOut.available())
+		WTOut.read();
 }
 
 
@@ -66,8 +66,8 @@ uint8_t voice;
 uint16_t track;
 
 	rxMsgReady = false;
-	while (WTSerial.available() > 0) {
-		dat = WTSerial.read();
+	while (WTOut.available() > 0) {
+		dat = WTOut.read();
 		if ((rxCount == 0) && (dat == SOM1)) {
 			rxCount++;
 		}
@@ -159,7 +159,7 @@ uint16_t track;
 
 		} // if (rxMsgReady)
 
-	} // while (WTSerial.available() > 0)
+	} // while (WTOut.available() > 0)
 }
 
 // **************************************************************
@@ -190,7 +190,7 @@ unsigned short vol;
 	txbuf[4] = (uint8_t)vol;
 	txbuf[5] = (uint8_t)(vol >> 8);
 	txbuf[6] = EOMWT;
-	WTSerial.write(txbuf, 7);
+	WTOut.write(txbuf, 7);
 }
 
 // **************************************************************
@@ -204,7 +204,7 @@ uint8_t txbuf[6];
     txbuf[3] = CMD_AMP_POWER;
     txbuf[4] = enable;
     txbuf[5] = EOMWT;
-    WTSerial.write(txbuf, 6);
+    WTOut.write(txbuf, 6);
 }
 
 // **************************************************************
@@ -218,7 +218,7 @@ uint8_t txbuf[6];
 	txbuf[3] = CMD_SET_REPORTING;
 	txbuf[4] = enable;
 	txbuf[5] = EOMWT;
-	WTSerial.write(txbuf, 6);
+	WTOut.write(txbuf, 6);
 }
 
 // **************************************************************
@@ -239,6 +239,23 @@ int i;
 	return true;
 }
 
+// **************************************************************
+// Asks for the version string again, without restarting the port as start() does.  getVersion() reports whether
+// it has come back.
+void wavTrigger::requestVersion(void) {
+
+uint8_t txbuf[5];
+
+	update();
+	versionRcvd = false;
+	txbuf[0] = SOM1;
+	txbuf[1] = SOM2;
+	txbuf[2] = 0x05;
+	txbuf[3] = CMD_GET_VERSION;
+	txbuf[4] = EOMWT;
+	WTOut.write(txbuf, 5);
+}
+
 // **************************************************************
 int wavTrigger::getNumTracks(void) {
 
@@ -322,7 +339,7 @@ uint8_t txbuf[8];
 	txbuf[5] = (uint8_t)trk;
 	txbuf[6] = (uint8_t)(trk >> 8);
 	txbuf[7] = EOMWT;
-	WTSerial.write(txbuf, 8);
+	WTOut.write(txbuf, 8);
 }
 
 // **************************************************************
@@ -339,7 +356,7 @@ uint8_t txbuf[9];
 	txbuf[6] = (uint8_t)(trk >> 8);
 	txbuf[7] = lock;
 	txbuf[8] = EOMWT;
-	WTSerial.write(txbuf, 9);
+	WTOut.write(txbuf, 9);
 }
 
 // **************************************************************
@@ -352,7 +369,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_STOP_ALL;
 	txbuf[4] = EOMWT;
-	WTSerial.write(txbuf, 5);
+	WTOut.write(txbuf, 5);
 }
 
 // **************************************************************
@@ -365,7 +382,7 @@ uint8_t txbuf[5];
 	txbuf[2] = 0x05;
 	txbuf[3] = CMD_RESUME_ALL_SYNC;
 	txbuf[4] = EOMWT;
-	WTSerial.write(txbuf, 5);
+	WTOut.write(txbuf, 5);
 }
 
 // **************************************************************
@@ -384,7 +401,7 @@ unsigned short vol;
 	txbuf[6] = (uint8_t)vol;
 	txbuf[7] = (uint8_t)(vol >> 8);
 	txbuf[8] = EOMWT;
-	WTSerial.write(txbuf, 9);
+	WTOut.write(txbuf, 9);
 }
 
 // **************************************************************
@@ -406,7 +423,7 @@ unsigned short vol;
 	txbuf[9] = (uint8_t)(time >> 8);
 	txbuf[10] = stopFlag;
 	txbuf[11] = EOMWT;
-	WTSerial.write(txbuf, 12);
+	WTOut.write(txbuf, 12);
 }
 
 // **************************************************************
@@ -423,7 +440,7 @@ unsigned short off;
 	txbuf[4] = (uint8_t)off;
 	txbuf[5] = (uint8_t)(off >> 8);
 	txbuf[6] = EOMWT;
-	WTSerial.write(txbuf, 7);
+	WTOut.write(txbuf, 7);
 }
 
 // **************************************************************
@@ -437,5 +454,5 @@ uint8_t txbuf[6];
 	txbuf[3] = CMD_SET_TRIGGER_BANK;
 	txbuf[4] = (uint8_t)bank;
 	txbuf[5] = EOMWT;
-	WTSerial.write(txbuf, 6);
+	WTOut.write(txbuf, 6);
 }
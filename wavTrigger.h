@@ -113,6 +113,15 @@
 #endif
 #endif
 
+// Everything goes through WTOut.  With USE_OUTPUT_GATING that's the gated port in sinks.cpp, so a send never
+// waits for room in WTSerial's buffer.
+#ifdef USE_OUTPUT_GATING
+#include "sinks.h"
+#define WTOut trigger_port
+#else
+#define WTOut WTSerial
+#endif
+
 class wavTrigger
 {
 public:
@@ -124,6 +133,7 @@ public:
 	void setReporting(bool enable);
 	void setAmpPwr(bool enable);
 	bool getVersion(char *pDst, int len);
+	void requestVersion(void);
 	int getNumTracks(void);
 	bool isTrackPlaying(int trk);
 	void masterGain(int gain);